@@ -0,0 +1,200 @@
+// Header file for alert_detector.cpp - large-trade and liquidity-shock alerts, detected inline and written out by a notifier thread
+#ifndef ALERT_DETECTOR_H
+#define ALERT_DETECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/un.h>
+#include "circular_buffer.h"
+#include "depth_view.h"
+#include "latency_histogram.h"
+#include "order.h"
+#include "trade.h"
+
+// alerts that can wait for the notifier, per source
+constexpr size_t ALERT_QUEUE_SIZE = 256;
+// most depth samples a liquidity window holds - older samples are dropped first when it is full
+constexpr size_t ALERT_DEPTH_SAMPLES = 256;
+
+/**
+ * @brief What an alert is for
+ */
+enum class AlertType : uint8_t
+{
+    LARGE_TRADE,     // a trade many times the recent average size
+    LIQUIDITY_SHOCK, // one side's depth near the top fell sharply within the window
+};
+
+/**
+ * @brief One alert - trivially copyable, so it is handed to the notifier without allocating
+ */
+struct Alert
+{
+    AlertType type;
+    OrderSide side;      // the trade's aggressor, or the book side that thinned
+    uint32_t symbol;
+    int64_t event_time;  // exchange event time (ms) of the trade or book update
+    int64_t detected_ns; // monotonic time it was detected, for the notifier's latency
+    double price;        // trade price, or the side's best price
+    double value;        // trade quantity, or the side's depth now
+    double reference;    // average trade quantity, or the side's peak depth in the window
+};
+
+/**
+ * @brief When to alert
+ */
+struct AlertThresholds
+{
+    double trade_multiple = 10;     // alert on a trade at least this many times the average size
+    uint32_t trade_window = 500;    // trades the average size is taken over
+    uint32_t min_trades = 50;       // trades needed before the average is trusted
+    double depth_drop = 0.5;        // alert when a side's depth falls by this fraction of its peak...
+    int64_t depth_window_ms = 1000; // ...within this long
+    uint32_t depth_levels = 5;      // levels per side counted as depth
+};
+
+/**
+ * @brief Where alerts are written
+ */
+enum class AlertOutput : uint8_t
+{
+    FILE,        // appended to a file, one line per alert
+    UNIX_SOCKET, // sent as one datagram per alert to a Unix domain datagram socket, e.g. for a desktop notifier
+};
+
+/**
+ * @brief The AlertDetector class flags trades far above the recent average size, and sudden drops in the depth near the top of a book.
+ *
+ * Detection runs inline on the thread that delivers the trade or book update and is a handful of arithmetic operations: the average trade
+ * size is a running sum over a fixed ring of recent sizes, and each side's peak depth over the window is the front of a monotonic queue
+ * of depth samples, so both are O(1) per event with nothing allocated. An alert is pushed onto a lock-free queue - one per source thread,
+ * as each queue has a single producer - and the detecting thread moves on; formatting and writing happen on the notifier thread, so a
+ * slow file or socket can never block ingestion. If a queue is full the alert is dropped and counted.
+ * After a liquidity shock the side's window restarts, so one drop alerts once rather than on every update until the peak ages out.
+ * A book reload also restarts the windows - a resync is not a shock.
+ */
+class AlertDetector
+{
+private:
+    // depth samples for one side, highest first - a monotonic queue over a fixed ring
+    struct DepthWindow
+    {
+        int64_t times[ALERT_DEPTH_SAMPLES];
+        double depths[ALERT_DEPTH_SAMPLES];
+        size_t head = 0;
+        size_t count = 0;
+
+        double push(int64_t time, double depth, int64_t window_ms);
+        void reset();
+    };
+
+    struct Symbol
+    {
+        AlertDetector *owner;
+        uint32_t id;
+        std::string name;
+        // trade sizes, a ring of trade_window entries, and their sum
+        std::vector<double> trade_sizes;
+        size_t trade_index = 0;
+        uint64_t trades = 0;
+        double trade_sum = 0;
+        DepthWindow bid_depth;
+        DepthWindow ask_depth;
+        // alerts from the book's apply thread
+        CircularBuffer<Alert, ALERT_QUEUE_SIZE> book_alerts;
+    };
+
+    AlertThresholds thresholds;
+    AlertOutput output;
+    std::string output_path;
+    std::chrono::microseconds poll_interval;
+
+    std::vector<std::unique_ptr<Symbol>> symbols;
+    // alerts from the trade thread
+    CircularBuffer<Alert, ALERT_QUEUE_SIZE> trade_alerts;
+
+    std::ofstream file;
+    int socket_fd = -1;
+    sockaddr_un socket_address{};
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> alerts{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> write_failures{0};
+    // detection to written, recorded by the notifier
+    LatencyHistogram notify_latency;
+
+    void raise(CircularBuffer<Alert, ALERT_QUEUE_SIZE> &queue, const Alert &alert);
+    void on_book_update(Symbol &symbol, const DepthView &view, bool reloaded);
+    void check_depth(Symbol &symbol, DepthWindow &window, OrderSide side, const PriceLevel *levels, uint32_t count, int64_t event_time);
+    void write(const Alert &alert);
+    size_t drain();
+    void run();
+
+public:
+    /**
+     * @brief Construct a new AlertDetector
+     * @param output_path File to append to, or socket to send to
+     * @param output Whether output_path is a file or a Unix datagram socket
+     * @param thresholds When to alert
+     * @param poll_interval How long the notifier sleeps when no alerts are waiting
+     * @throws std::invalid_argument If a threshold is out of range
+     */
+    AlertDetector(const std::string &output_path, AlertOutput output = AlertOutput::FILE, const AlertThresholds &thresholds = AlertThresholds(),
+                  std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~AlertDetector();
+
+    AlertDetector(const AlertDetector &) = delete;
+    AlertDetector &operator=(const AlertDetector &) = delete;
+
+    /**
+     * @brief Watch a symbol's trades - must be called before start(). Symbols added in BarAggregator's order get the aggregator's
+     * symbol IDs, so trade_callback() can be registered with BarAggregator::add_trade_listener() directly.
+     * @return The symbol's ID, for on_trade()
+     */
+    uint32_t add_symbol(const std::string &symbol);
+
+    /**
+     * @brief Watch a symbol's book too - must be called before start() and before the book is driven
+     * @param book The book - anything with add_update_listener()
+     */
+    template <typename Book>
+    void attach(Book &book, uint32_t symbol)
+    {
+        book.add_update_listener(&AlertDetector::book_update_callback, this->symbols[symbol].get());
+    }
+
+    // listener trampolines - trade_callback fits BarAggregator::add_trade_listener()
+    static void trade_callback(uint32_t symbol, const Trade &trade, void *user);
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+
+    /**
+     * @brief Check a trade - every trade must come from the same thread
+     */
+    void on_trade(uint32_t symbol, const Trade &trade);
+
+    /**
+     * @brief Open the output and start the notifier thread. A socket is not connected - datagrams are sent to its path, so the reader
+     * can come and go, and alerts sent while it is away count as write failures.
+     * @throws std::runtime_error If the output can't be opened
+     */
+    void start();
+
+    /**
+     * @brief Write what is queued and stop the notifier thread
+     */
+    void stop();
+
+    uint64_t get_alerts() const;
+    uint64_t get_dropped() const;
+    uint64_t get_write_failures() const;
+    const LatencyHistogram &get_notify_latency() const;
+};
+
+#endif // ALERT_DETECTOR_H
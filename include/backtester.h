@@ -0,0 +1,339 @@
+// Header file for backtester.cpp - replays captures through the live book engine and drives strategies in event-time order
+#ifndef BACKTESTER_H
+#define BACKTESTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "capture.h"
+#include "depth_view.h"
+#include "order_book.h"
+#include "trade.h"
+
+/**
+ * @brief A book change as a strategy sees it
+ */
+struct BookEvent
+{
+    uint32_t book;            // book ID from add_book()
+    bool reloaded;            // the book was just loaded from a snapshot rather than updated by an event
+    int64_t exchange_time_us; // exchange event time
+    DepthView view;           // top levels right after the change - later changes are separate events
+};
+
+/**
+ * @brief A trade as a strategy sees it
+ */
+struct TradeEvent
+{
+    uint32_t stream;          // trade stream ID from add_trade_stream()
+    int64_t exchange_time_us; // exchange event time
+    Trade trade;
+};
+
+/**
+ * @brief What a backtest replayed
+ */
+struct BacktestStats
+{
+    uint64_t records;          // records read from the captures
+    uint64_t snapshots;        // snapshots loaded into books
+    uint64_t depth_events;     // depth events applied to books
+    uint64_t stale_events;     // depth events the books already covered
+    uint64_t gaps;             // depth events that didn't continue their book - the book waits for the next snapshot
+    uint64_t unsynced_events;  // depth events dropped while a book waited for a snapshot
+    uint64_t trades;           // trades passed to strategies
+    uint64_t skipped_records;  // records of streams nothing was registered for
+    uint64_t callbacks;        // strategy callbacks made
+    int64_t first_event_time;  // exchange time of the first and last record (ms)
+    int64_t last_event_time;
+    double wall_seconds;       // time the replay took
+    double speedup;            // exchange time replayed per wall time
+};
+
+/**
+ * @brief The Backtester class replays recorded captures (see capture.h) through the same OrderBook the live system runs, and drives
+ * strategies from it on a simulated clock.
+ *
+ * Records from every capture are merged by exchange event time (ties go to the capture added first, then file order), so a run is
+ * deterministic. Depth records are applied to a real OrderBook of the stream's venue adapter through load_snapshot() and apply_event(),
+ * so the venue's sequencing rules, level listeners, update listeners and the published depth view all behave as they do live - anything
+ * that attaches to a live book (e.g. OrderFlowSignals) can attach to get_book() before run().
+ *
+ * The simulated clock is exchange event time in microseconds. Each strategy has its own market data latency: book changes and trades
+ * are delivered to it latency after the exchange published them, with the book as it was then, interleaved with everything else in
+ * time order. Listeners attached to the books, and trade listeners, see changes at exchange time. Strategies are duck typed:
+ *     void on_book(Backtester &backtester, const BookEvent &event);
+ *     void on_trade(Backtester &backtester, const TradeEvent &event);
+ * Everything runs on the calling thread with no sleeps or wall clock reads per event, so a run is bound by decoding captures and
+ * applying depth. Parameter sweeps run one Backtester per parameter set across cores with sweep().
+ */
+class Backtester
+{
+public:
+    // strategy callbacks, as generated by add_strategy()
+    using StrategyBookCallback = void (*)(void *strategy, Backtester &backtester, const BookEvent &event);
+    using StrategyTradeCallback = void (*)(void *strategy, Backtester &backtester, const TradeEvent &event);
+    // callback for every trade of a stream at exchange time, e.g. FillSimulator::trade_callback
+    using ReplayTradeListener = void (*)(const Trade &trade, void *user);
+
+private:
+    // a replayed book - the OrderBook's type is erased behind the functions add_book() generated for it
+    struct Book
+    {
+        Backtester *owner;
+        uint32_t id;
+        std::shared_ptr<void> book;
+        void (*load)(void *book, const DepthUpdate &snapshot);
+        SequenceCheck (*apply)(void *book, const DepthUpdate &event);
+        void (*listen)(void *book, BookUpdateListener listener, void *user);
+        // false until the first snapshot, and again after a gap
+        bool synced;
+    };
+
+    // a book change or trade waiting out a strategy's latency
+    struct Notification
+    {
+        int64_t deliver_at_us;
+        bool is_trade;
+        BookEvent book;
+        TradeEvent trade;
+    };
+
+    struct Strategy
+    {
+        void *strategy;
+        StrategyBookCallback on_book;
+        StrategyTradeCallback on_trade;
+        int64_t latency_us;
+        // latency is constant per strategy, so notifications come due in the order they were queued
+        std::deque<Notification> pending;
+    };
+
+    enum class RouteKind : uint8_t
+    {
+        UNRESOLVED,
+        NONE,
+        BOOK,
+        TRADES,
+    };
+
+    // where a stream's records go
+    struct Route
+    {
+        RouteKind kind;
+        uint32_t id;
+    };
+
+    // a capture and its next record
+    struct Source
+    {
+        std::unique_ptr<CaptureReader> reader;
+        CaptureRecord record;
+        bool has_record;
+        // indexed by the capture's stream IDs, resolved by name the first time each is seen
+        std::vector<Route> routes;
+    };
+
+    std::vector<std::unique_ptr<Book>> books;
+    std::vector<std::string> trade_streams;
+    // per trade stream
+    std::vector<std::vector<std::pair<ReplayTradeListener, void *>>> trade_listeners;
+    std::unordered_map<std::string, Route> stream_routes;
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<Strategy> strategies;
+
+    int64_t clock_us = 0;
+    bool ran = false;
+    BacktestStats stats{};
+
+    template <typename Venue, bool TrackLevelAge>
+    static void load_book(void *book, const DepthUpdate &snapshot)
+    {
+        static_cast<OrderBook<Venue, TrackLevelAge> *>(book)->load_snapshot(snapshot);
+    }
+
+    template <typename Venue, bool TrackLevelAge>
+    static SequenceCheck apply_book(void *book, const DepthUpdate &event)
+    {
+        return static_cast<OrderBook<Venue, TrackLevelAge> *>(book)->apply_event(event);
+    }
+
+    template <typename Venue, bool TrackLevelAge>
+    static void listen_book(void *book, BookUpdateListener listener, void *user)
+    {
+        static_cast<OrderBook<Venue, TrackLevelAge> *>(book)->add_update_listener(listener, user);
+    }
+
+    template <typename S>
+    static void strategy_book_callback(void *strategy, Backtester &backtester, const BookEvent &event)
+    {
+        static_cast<S *>(strategy)->on_book(backtester, event);
+    }
+
+    template <typename S>
+    static void strategy_trade_callback(void *strategy, Backtester &backtester, const TradeEvent &event)
+    {
+        static_cast<S *>(strategy)->on_trade(backtester, event);
+    }
+
+    uint32_t register_book(std::shared_ptr<void> book, void (*load)(void *, const DepthUpdate &), SequenceCheck (*apply)(void *, const DepthUpdate &),
+                           void (*listen)(void *, BookUpdateListener, void *), const std::string &stream);
+    void add_route(const std::string &stream, Route route);
+    Route route_for(Source &source, uint16_t stream);
+    void advance(Source &source);
+    void dispatch(Source &source);
+    void notify(const Notification &notification);
+    void deliver(Strategy &strategy, const Notification &notification);
+    void deliver_until(int64_t time_us);
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+
+public:
+    Backtester() = default;
+
+    Backtester(const Backtester &) = delete;
+    Backtester &operator=(const Backtester &) = delete;
+
+    /**
+     * @brief Replay a capture - records of streams nothing is registered for are skipped
+     * @throws std::runtime_error If the capture can't be opened
+     */
+    void add_capture(const std::string &path);
+
+    /**
+     * @brief Replay a depth stream into a book
+     * @tparam Venue The venue adapter whose sequencing rules the book applies
+     * @tparam TrackLevelAge true if the book tracks per-level age
+     * @param stream The stream name the book was recorded under (see OrderBook::attach_capture)
+     * @return The book's ID
+     */
+    template <typename Venue, bool TrackLevelAge = false>
+    uint32_t add_book(const std::string &stream)
+    {
+        // the book never fetches a snapshot, so its endpoints don't matter
+        return register_book(std::make_shared<OrderBook<Venue, TrackLevelAge>>(stream), &load_book<Venue, TrackLevelAge>,
+                             &apply_book<Venue, TrackLevelAge>, &listen_book<Venue, TrackLevelAge>, stream);
+    }
+
+    /**
+     * @brief Get a replayed book, to attach listeners or readers to before run()
+     * @throws std::invalid_argument If the book was added with a different Venue or TrackLevelAge
+     */
+    template <typename Venue, bool TrackLevelAge = false>
+    OrderBook<Venue, TrackLevelAge> &get_book(uint32_t book)
+    {
+        if (book >= this->books.size() || this->books[book]->apply != &apply_book<Venue, TrackLevelAge>)
+        {
+            throw std::invalid_argument("[Backtester] Book " + std::to_string(book) + " is not an OrderBook of that type");
+        }
+        return *static_cast<OrderBook<Venue, TrackLevelAge> *>(this->books[book]->book.get());
+    }
+
+    /**
+     * @brief Pass a trade stream to the strategies
+     * @param stream The stream name the trades were recorded under
+     * @return The trade stream's ID
+     */
+    uint32_t add_trade_stream(const std::string &stream);
+
+    /**
+     * @brief Register a callback for every trade of a stream at exchange time, before strategies see it - the trade counterpart of a book's listeners
+     * @param stream The trade stream's ID
+     * @throws std::invalid_argument If there is no such trade stream
+     */
+    void add_trade_listener(uint32_t stream, ReplayTradeListener listener, void *user);
+
+    /**
+     * @brief Drive a strategy from the replay - it must outlive run()
+     * @param strategy Anything with on_book(Backtester &, const BookEvent &) and on_trade(Backtester &, const TradeEvent &)
+     * @param latency Market data latency - how long after the exchange the strategy sees each change
+     * @return The strategy's ID
+     */
+    template <typename S>
+    uint32_t add_strategy(S &strategy, std::chrono::microseconds latency = std::chrono::microseconds(0))
+    {
+        return add_strategy(&strategy, &strategy_book_callback<S>, &strategy_trade_callback<S>, latency);
+    }
+
+    /**
+     * @brief Drive a strategy from the replay through plain callbacks
+     * @throws std::invalid_argument If the latency is negative
+     */
+    uint32_t add_strategy(void *strategy, StrategyBookCallback on_book, StrategyTradeCallback on_trade, std::chrono::microseconds latency);
+
+    /**
+     * @brief Replay every capture to the end - can only be called once
+     * @return What was replayed
+     * @throws std::runtime_error If called again
+     */
+    BacktestStats run();
+
+    /**
+     * @brief Get the simulated clock - exchange event time in microseconds, plus latency inside strategy callbacks
+     */
+    int64_t now_us() const;
+
+    /**
+     * @brief Get the replay counters so far
+     */
+    const BacktestStats &get_stats() const;
+
+    /**
+     * @brief Run independent backtests in parallel, e.g. one per parameter set.
+     * run(index) is called once for every index in [0, runs), spread over the worker threads. Each call should build, run and collect
+     * its own Backtester, so runs share nothing but the capture files - which the OS page cache keeps in memory after the first read.
+     * A run that throws is logged and the others carry on.
+     * @param runs Number of runs
+     * @param run Callable taking the run index
+     * @param threads Worker threads, 0 for one per hardware thread
+     */
+    template <typename Run>
+    static void sweep(size_t runs, Run run, size_t threads = 0)
+    {
+        if (threads == 0)
+        {
+            threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, runs);
+
+        // runs can take very different times, so workers take the next index as they finish rather than a fixed share
+        std::atomic<size_t> next{0};
+        auto work = [&next, &run, runs]()
+        {
+            for (size_t index = next.fetch_add(1); index < runs; index = next.fetch_add(1))
+            {
+                try
+                {
+                    run(index);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "[Backtester][sweep] Run " << index << " failed: " << e.what() << std::endl;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t worker = 0; worker < threads; worker++)
+        {
+            workers.emplace_back(work);
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+};
+
+#endif // BACKTESTER_H
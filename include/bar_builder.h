@@ -0,0 +1,211 @@
+// Header file for bar_builder.cpp - OHLCV bars over several intervals, built from trades and the book's BBO, closed on event time
+#ifndef BAR_BUILDER_H
+#define BAR_BUILDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "circular_buffer.h"
+#include "depth_view.h"
+#include "seqlock.h"
+#include "trade.h"
+
+// resolution of the bar close timer wheel - every interval must be a multiple of it
+constexpr int64_t BAR_WHEEL_TICK_MS = 1000;
+// number of wheel slots - every interval must be shorter than BAR_WHEEL_SLOTS ticks
+constexpr size_t BAR_WHEEL_SLOTS = 1024;
+
+/**
+ * @brief One bar of one symbol and interval. Trade prices carry the previous close when the bar has no trades,
+ * mid prices carry the previous mid when it has no BBO changes (both are zero until the symbol's first trade or BBO).
+ */
+struct Bar
+{
+    int64_t open_time;        // bar start (ms), inclusive
+    int64_t close_time;       // bar end (ms), exclusive
+    int64_t interval_ms;      // bar length (ms)
+    uint32_t symbol;          // symbol ID from add_symbol()
+    uint32_t trade_count;     // venue trades in the bar - an aggregate trade counts last_trade_id - first_trade_id + 1
+    int64_t first_trade_id;   // first venue trade ID in the bar, -1 if no trades
+    int64_t last_trade_id;    // last venue trade ID in the bar, -1 if no trades
+    double open;              // trade prices
+    double high;
+    double low;
+    double close;
+    double volume;            // base asset volume
+    double quote_volume;      // quote asset volume
+    double taker_buy_volume;  // base asset volume where the taker bought
+    double mid_open;          // BBO mid prices
+    double mid_high;
+    double mid_low;
+    double mid_close;
+    double microprice_close;  // size-weighted mid at the last BBO change, leans towards the side with less size
+    uint32_t quote_count;     // BBO changes in the bar
+    uint32_t reserved;
+};
+
+// ring closed bars are published through - one per consumer
+using BarRing = CircularBuffer<Bar, 1024>;
+
+// callback for every trade taken from a symbol's trade buffer - runs on the aggregator thread, e.g. to record trades for replay
+using TradeListener = void (*)(uint32_t symbol, const Trade &trade, void *user);
+
+/**
+ * @brief The BarAggregator class keeps bars of several intervals (e.g. 1s, 1m, 5m) per symbol, from trades and BBO changes.
+ *
+ * Every event updates the open bar of each interval in O(1). Bars are closed on event time, not wall time: the clock is the latest
+ * exchange time seen on any symbol, and a bar closes once the clock passes its end by close_delay - which gives events from slower
+ * streams time to arrive. Each (symbol, interval) has two bar slots, so the next bar can fill while the current one waits out the delay.
+ * Instead of a timer per bar, open bars are scheduled on a timer wheel with one slot per BAR_WHEEL_TICK_MS, so advancing the clock only
+ * visits the ticks it passes. Closed bars are pushed to every output ring and the next bar is opened, so a quiet symbol still produces
+ * a bar per interval. Events for bars that have already closed are counted as late and dropped.
+ * Everything runs on the aggregator thread; on_trade(), on_quote() and advance_to() can also be driven directly instead of start().
+ */
+class BarAggregator
+{
+private:
+    // a symbol, where its events come from, and its latest prices
+    struct Symbol
+    {
+        std::string symbol;
+        TradeBuffer *trades;            // nullptr if bars aren't built from trades
+        const SeqLock<DepthView> *view; // nullptr if bars aren't built from the BBO
+        uint64_t last_version;          // view version last checked
+        PriceLevel best_bid;            // BBO last seen
+        PriceLevel best_ask;
+        double last_price;              // carried into bars without trades
+        double last_mid;                // carried into bars without BBO changes
+        double last_microprice;
+    };
+
+    // a bar slot - live from the time the bar is opened until it is published
+    struct OpenBar
+    {
+        Bar bar;
+        bool live;
+    };
+
+    // a scheduled bar close - deadline_tick distinguishes bars from different laps of the wheel
+    struct WheelEntry
+    {
+        uint32_t bar;
+        int64_t deadline_tick;
+    };
+
+    std::vector<int64_t> intervals;
+    int64_t close_delay_ms;
+
+    std::vector<Symbol> symbols;
+    // two slots per (symbol, interval), indexed by ((symbol * intervals) + interval) * 2 + (bar number & 1)
+    std::vector<OpenBar> open_bars;
+    std::vector<std::vector<WheelEntry>> wheel;
+    // slot being processed, swapped out of the wheel so closes can schedule into it
+    std::vector<WheelEntry> due;
+    // last wheel tick processed, -1 until the first event
+    int64_t current_tick = -1;
+    std::vector<BarRing *> outputs;
+    std::vector<std::pair<TradeListener, void *>> trade_listeners;
+
+    std::chrono::microseconds poll_interval;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> trades{0};
+    std::atomic<uint64_t> quotes{0};
+    std::atomic<uint64_t> bars_closed{0};
+    std::atomic<uint64_t> late_events{0};
+    std::atomic<uint64_t> dropped_bars{0};
+
+    Bar *bar_for(uint32_t symbol, size_t interval, int64_t time);
+    void open_bar(uint32_t index, uint32_t symbol, size_t interval, int64_t open_time, double price, double mid, double microprice);
+    void close_bar(uint32_t index);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new BarAggregator
+     * @param intervals_ms Bar lengths (ms) - multiples of BAR_WHEEL_TICK_MS, shorter than BAR_WHEEL_SLOTS ticks
+     * @param close_delay How long past its end a bar stays open for late events - shorter than every interval
+     * @param poll_interval How long the aggregator thread sleeps when no event arrived
+     * @throws std::invalid_argument If an interval or the delay is out of range
+     */
+    explicit BarAggregator(std::vector<int64_t> intervals_ms = {1000, 60000, 300000}, std::chrono::milliseconds close_delay = std::chrono::milliseconds(0),
+                           std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~BarAggregator();
+
+    BarAggregator(const BarAggregator &) = delete;
+    BarAggregator &operator=(const BarAggregator &) = delete;
+
+    /**
+     * @brief Build bars for a symbol from a trade buffer and a book's BBO - must be called before start()
+     * @param book The symbol's book - anything with get_depth_view()
+     * @return The symbol's ID, as used in Bar::symbol
+     */
+    template <typename Book>
+    uint32_t add_symbol(const std::string &symbol, TradeBuffer &trades, Book &book)
+    {
+        return add_symbol(symbol, &trades, &book.get_depth_view());
+    }
+
+    /**
+     * @brief Build bars for a symbol - must be called before start()
+     * @param trades Trade buffer this aggregator is the only consumer of, or nullptr
+     * @param view Published depth view the BBO is read from, or nullptr
+     * @return The symbol's ID, as used in Bar::symbol
+     */
+    uint32_t add_symbol(const std::string &symbol, TradeBuffer *trades, const SeqLock<DepthView> *view);
+
+    /**
+     * @brief Publish closed bars to a ring - must be called before start(). Bars are dropped (and counted) when the ring is full.
+     */
+    void add_output(BarRing &ring);
+
+    /**
+     * @brief Register a callback for every trade taken from a trade buffer - must be called before start()
+     */
+    void add_trade_listener(TradeListener listener, void *user);
+
+    /**
+     * @brief Add a trade to the open bars of a symbol
+     */
+    void on_trade(uint32_t symbol, const Trade &trade);
+
+    /**
+     * @brief Add a BBO change to the open bars of a symbol - ignored unless both sides have a level
+     */
+    void on_quote(uint32_t symbol, int64_t event_time, const PriceLevel &best_bid, const PriceLevel &best_ask);
+
+    /**
+     * @brief Move the event clock forward, closing every bar that ends at or before time_ms - close_delay
+     */
+    void advance_to(int64_t time_ms);
+
+    /**
+     * @brief Drain every symbol's trade buffer and check its BBO - what the aggregator thread runs
+     * @return The number of trades and BBO changes processed
+     */
+    size_t poll_sources();
+
+    /**
+     * @brief Start the aggregator thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the aggregator thread
+     */
+    void stop();
+
+    const std::string &get_symbol(uint32_t symbol) const;
+    const std::vector<int64_t> &get_intervals() const;
+    uint64_t get_trades() const;
+    uint64_t get_quotes() const;
+    uint64_t get_bars_closed() const;
+    uint64_t get_late_events() const;
+    uint64_t get_dropped_bars() const;
+};
+
+#endif // BAR_BUILDER_H
@@ -0,0 +1,174 @@
+// Header file for bar_reconciler.cpp - checks locally built bars against the venue's klines to catch missed trades
+#ifndef BAR_RECONCILER_H
+#define BAR_RECONCILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "bar_builder.h"
+#include "kline.h"
+#include "seqlock.h"
+
+// bars kept per (symbol, interval) while waiting for their kline - must be a power of 2
+constexpr size_t RECONCILE_WINDOW = 8;
+
+/**
+ * @brief What differed between a local bar and the venue's kline - bit flags
+ */
+enum BarDivergenceField : uint32_t
+{
+    DIVERGENCE_TRADE_COUNT = 1 << 0,   // different number of venue trades
+    DIVERGENCE_TRADE_IDS = 1 << 1,     // different first or last trade ID
+    DIVERGENCE_VOLUME = 1 << 2,        // different base volume
+    DIVERGENCE_PRICES = 1 << 3,        // different open, high, low or close
+    DIVERGENCE_MISSING_KLINE = 1 << 4, // local bar without a kline
+    DIVERGENCE_MISSING_BAR = 1 << 5,   // kline without a local bar
+};
+
+/**
+ * @brief A local bar that didn't match the venue's kline
+ */
+struct BarDivergence
+{
+    uint32_t symbol;          // symbol ID from BarAggregator::add_symbol()
+    uint32_t fields;          // BarDivergenceField flags
+    int64_t interval_ms;
+    int64_t open_time;
+    int64_t missed_trades;    // kline trade count - local trade count, positive when trades were missed locally
+    double missed_volume;     // kline volume - local volume
+    Bar local;                // the local bar, zeroed if missing
+    Kline kline;              // the venue kline, zeroed if missing
+};
+
+/**
+ * @brief Running reconciliation totals for one symbol
+ */
+struct ReconcileStats
+{
+    uint64_t matched;         // bars that matched their kline
+    uint64_t diverged;        // bars that didn't
+    uint64_t missed_trades;   // total trades the venue counted but the local bars didn't
+    uint64_t missing_klines;  // local bars whose kline never arrived
+    uint64_t missing_bars;    // klines whose local bar never arrived
+};
+
+// callback for divergences - runs on the reconciler thread, so it should just hand the divergence off
+using DivergenceListener = void (*)(const BarDivergence &divergence, void *user);
+
+/**
+ * @brief The BarReconciler class matches the bars a BarAggregator closes against the venue's closed klines.
+ *
+ * Both sides arrive over push streams, so catching missed trades costs no REST requests. Each (symbol, interval) keeps a window of
+ * RECONCILE_WINDOW slots indexed by bar number, and a bar is compared as soon as both sides are in its slot. A side left waiting is
+ * reported as missing when its slot is reused, RECONCILE_WINDOW intervals later. The first local bar of each interval started part way
+ * through, so it (and any kline up to it) is skipped.
+ * Prices and volumes are compared with a small relative tolerance, since local volumes are sums of decoded trade quantities.
+ */
+class BarReconciler
+{
+private:
+    // one bar number's slot, filled from either side
+    struct Pending
+    {
+        int64_t open_time;
+        bool has_bar;
+        bool has_kline;
+        Bar bar;
+        Kline kline;
+    };
+
+    // a symbol, its kline buffer and its windows
+    struct Symbol
+    {
+        KlineBuffer *klines;
+        // per interval: bars before this time are skipped, -1 until the first local bar
+        std::vector<int64_t> warmup_until;
+        std::vector<std::array<Pending, RECONCILE_WINDOW>> windows;
+        ReconcileStats totals{};
+        SeqLock<ReconcileStats> stats;
+    };
+
+    const BarAggregator &bars;
+    std::vector<int64_t> intervals;
+    double tolerance;
+    // closed local bars, published by the aggregator
+    BarRing local_bars;
+    // indexed by the aggregator's symbol IDs, nullptr for symbols without klines
+    std::vector<std::unique_ptr<Symbol>> symbols;
+    std::vector<std::pair<DivergenceListener, void *>> listeners;
+
+    std::chrono::microseconds poll_interval;
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    int find_interval(int64_t interval_ms) const;
+    Pending *slot_for(Symbol &state, size_t interval, int64_t open_time, uint32_t symbol);
+    void evict(Pending &pending, uint32_t symbol, Symbol &state);
+    void compare(Pending &pending, uint32_t symbol, Symbol &state);
+    void report(const BarDivergence &divergence, Symbol &state);
+    bool same(double local, double venue) const;
+    void run();
+
+public:
+    /**
+     * @brief Construct a new BarReconciler, subscribing to the aggregator's closed bars - call before the aggregator starts
+     * @param bars The aggregator whose bars are checked
+     * @param tolerance Relative tolerance for prices and volumes
+     * @param poll_interval How long the reconciler thread sleeps when nothing arrived
+     */
+    explicit BarReconciler(BarAggregator &bars, double tolerance = 1e-9, std::chrono::microseconds poll_interval = std::chrono::milliseconds(10));
+    ~BarReconciler();
+
+    BarReconciler(const BarReconciler &) = delete;
+    BarReconciler &operator=(const BarReconciler &) = delete;
+
+    /**
+     * @brief Reconcile a symbol's bars against a kline buffer - must be called before start()
+     * @param symbol The symbol's ID in the aggregator
+     * @param klines Closed klines of the symbol - this reconciler is its only consumer
+     */
+    void add_symbol(uint32_t symbol, KlineBuffer &klines);
+
+    /**
+     * @brief Register a callback for every divergence - must be called before start()
+     */
+    void add_listener(DivergenceListener listener, void *user);
+
+    /**
+     * @brief Add a closed local bar
+     */
+    void on_bar(const Bar &bar);
+
+    /**
+     * @brief Add a closed venue kline of a symbol - klines of intervals the aggregator doesn't build are ignored
+     */
+    void on_kline(uint32_t symbol, const Kline &kline);
+
+    /**
+     * @brief Drain the local bar ring and every kline buffer - what the reconciler thread runs
+     * @return The number of bars and klines processed
+     */
+    size_t poll();
+
+    /**
+     * @brief Get a symbol's running totals - safe to call from any thread
+     */
+    ReconcileStats get_stats(uint32_t symbol) const;
+
+    /**
+     * @brief Start the reconciler thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the reconciler thread
+     */
+    void stop();
+};
+
+#endif // BAR_RECONCILER_H
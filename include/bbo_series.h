@@ -0,0 +1,240 @@
+// Header file for bbo_series.cpp - per-symbol columnar BBO history in memory, with range queries and completed blocks spilled to disk
+#ifndef BBO_SERIES_H
+#define BBO_SERIES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "depth_view.h"
+
+// samples per spilled block
+constexpr size_t BBO_BLOCK_SAMPLES = 1024;
+// largest encoded block - five columns of varints, at most 10 bytes each per sample
+constexpr size_t BBO_MAX_BLOCK_BYTES = BBO_BLOCK_SAMPLES * 5 * 10;
+// prices and quantities are stored on disk as integer multiples of 1e-8, the finest precision Binance quotes
+constexpr double BBO_SPILL_SCALE = 1e8;
+// first bytes of every spill file
+constexpr char BBO_SPILL_MAGIC[8] = {'C', 'P', 'P', 'B', 'B', 'O', '0', '1'};
+
+/**
+ * @brief One BBO sample
+ */
+struct BboSample
+{
+    int64_t time; // exchange event time (ms)
+    double bid;
+    double ask;
+    double bid_quantity;
+    double ask_quantity;
+};
+
+/**
+ * @brief Minimum, maximum and mean of one column over a range
+ */
+struct ColumnStats
+{
+    double min;
+    double max;
+    double mean;
+};
+
+/**
+ * @brief Summary of the samples in a range - every sample counts once, however long it was the BBO for
+ */
+struct BboStats
+{
+    int64_t start_time; // the range's start, or the bucket's when downsampling
+    uint32_t count;     // samples in the range, 0 if the stats are empty
+    ColumnStats bid;
+    ColumnStats ask;
+    ColumnStats spread;
+};
+
+/**
+ * @brief Block header in a spill file, followed by the symbol name and then the encoded columns.
+ * Each column is zigzag varints of the difference from the previous sample - the time column in ms from first_time, the others in
+ * units of 1 / BBO_SPILL_SCALE from 0 - stored column by column: times, bids, asks, bid quantities, ask quantities.
+ */
+struct BboBlockHeader
+{
+    uint16_t name_size;
+    uint16_t reserved;
+    uint32_t count;     // samples in the block
+    uint32_t size;      // bytes of encoded columns after the name
+    uint32_t reserved2;
+    int64_t first_time; // so a reader can skip blocks outside its range without decoding them
+    int64_t last_time;
+};
+
+/**
+ * @brief The BboSeries class keeps each symbol's BBO every time it changes, for the last window of time, and answers range queries over it.
+ *
+ * Samples are stored column by column in a fixed ring per symbol, written by the book's apply thread with a single release store of the
+ * sample count, so recording never blocks or allocates. Times never go backwards, so a range is found by binary search, and min, max and
+ * mean are computed over the contiguous columns two doubles at a time with SSE2 (the x86-64 baseline, so no build flags are needed).
+ * Queries run on any thread and never block the writer: they read the columns in place and then check the writer hasn't wrapped round
+ * onto what they read, retrying if it has. Queries only see the last window of time, and at most capacity less one block of samples -
+ * size the capacity for the window at the symbol's busiest update rate.
+ * Every completed block of samples is also compressed and appended to a spill file by the series' own thread, so history older than
+ * the window is still on disk - see read_spill(). The remaining samples are spilled by stop().
+ */
+class BboSeries
+{
+private:
+    struct Symbol
+    {
+        BboSeries *owner;
+        std::string name;
+        // columns of the ring, capacity entries each
+        std::unique_ptr<int64_t[]> times;
+        std::unique_ptr<double[]> bids;
+        std::unique_ptr<double[]> asks;
+        std::unique_ptr<double[]> bid_quantities;
+        std::unique_ptr<double[]> ask_quantities;
+        // samples ever recorded - the writer fills the slot, then publishes it by bumping this
+        alignas(64) std::atomic<uint64_t> head{0};
+        // written by the writer only
+        alignas(64) BboSample last{};
+        // written by the spill thread only - next sample to spill
+        uint64_t spilled = 0;
+    };
+
+    int64_t window_ms;
+    size_t capacity;
+    size_t mask;
+    std::string spill_path;
+    std::chrono::milliseconds poll_interval;
+
+    std::vector<std::unique_ptr<Symbol>> symbols;
+
+    std::FILE *spill_file = nullptr;
+    // encoded columns of the block being spilled, reused between blocks
+    std::vector<uint8_t> spill_buffer;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> spilled_blocks{0};
+    std::atomic<uint64_t> lost_samples{0};
+    std::atomic<uint64_t> write_failures{0};
+
+    // samples of a query - oldest is where the readable samples started, to check the writer hasn't reached it after reading
+    struct Range
+    {
+        uint64_t oldest;
+        uint64_t first;
+        uint64_t last; // one past the final sample
+    };
+
+    void append(Symbol &symbol, const BboSample &sample);
+    bool find(const Symbol &symbol, int64_t t0, int64_t t1, Range &range) const;
+    uint64_t search(const Symbol &symbol, uint64_t first, uint64_t last, int64_t time, bool after) const;
+    bool intact(const Symbol &symbol, const Range &range) const;
+    BboStats summarise(const Symbol &symbol, uint64_t first, uint64_t last) const;
+    size_t spill(Symbol &symbol, bool partial);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new BboSeries
+     * @param window How far back queries reach
+     * @param capacity Samples kept per symbol - rounded up to a power of two, at least two blocks
+     * @param spill_path File completed blocks are appended to, empty to keep nothing beyond the ring
+     * @param poll_interval How often the spill thread looks for completed blocks
+     */
+    BboSeries(std::chrono::minutes window, size_t capacity, const std::string &spill_path = "",
+              std::chrono::milliseconds poll_interval = std::chrono::milliseconds(100));
+    ~BboSeries();
+
+    BboSeries(const BboSeries &) = delete;
+    BboSeries &operator=(const BboSeries &) = delete;
+
+    /**
+     * @brief Keep a symbol's BBO - must be called before start()
+     * @return The symbol's ID
+     */
+    uint32_t add_symbol(const std::string &symbol);
+
+    /**
+     * @brief Record a symbol from its book - anything with add_update_listener(). Must be called before the book is driven.
+     * @return The symbol's ID
+     */
+    template <typename Book>
+    uint32_t add_book(Book &book, const std::string &symbol)
+    {
+        uint32_t id = add_symbol(symbol);
+        book.add_update_listener(&BboSeries::book_update_callback, this->symbols[id].get());
+        return id;
+    }
+
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+
+    /**
+     * @brief Record a sample if the BBO changed - each symbol must only be recorded from one thread.
+     * A sample with either side empty is skipped, and a time earlier than the last sample's is moved up to it.
+     */
+    void record(uint32_t symbol, const BboSample &sample);
+
+    /**
+     * @brief Copy the samples in [t0, t1] that are still in the window
+     * @param out Where to append the samples
+     * @return The number of samples appended
+     */
+    size_t query(uint32_t symbol, int64_t t0, int64_t t1, std::vector<BboSample> &out) const;
+
+    /**
+     * @brief Min, max and mean of the bid, ask and spread of the samples in [t0, t1] that are still in the window
+     */
+    BboStats stats(uint32_t symbol, int64_t t0, int64_t t1) const;
+
+    /**
+     * @brief Summarise [t0, t1] in buckets of bucket_ms, aligned to multiples of bucket_ms - buckets without samples are left out
+     * @param out Where to append the buckets
+     * @return The number of buckets appended
+     * @throws std::invalid_argument If bucket_ms isn't positive
+     */
+    size_t downsample(uint32_t symbol, int64_t t0, int64_t t1, int64_t bucket_ms, std::vector<BboStats> &out) const;
+
+    /**
+     * @brief Read a symbol's samples in [t0, t1] back from a spill file, skipping blocks outside the range without decoding them
+     * @param out Where to append the samples
+     * @return The number of samples appended
+     * @throws std::runtime_error If the file can't be opened or isn't a spill file
+     */
+    static size_t read_spill(const std::string &path, const std::string &symbol, int64_t t0, int64_t t1, std::vector<BboSample> &out);
+
+    /**
+     * @brief Open the spill file, if there is one, and start the spill thread
+     * @throws std::runtime_error If the spill file can't be opened
+     */
+    void start();
+
+    /**
+     * @brief Stop the spill thread, spilling what is left of every symbol
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of samples recorded for a symbol
+     */
+    uint64_t get_samples(uint32_t symbol) const;
+
+    uint64_t get_spilled_blocks() const;
+
+    /**
+     * @brief Get the number of samples overwritten before the spill thread got to them
+     */
+    uint64_t get_lost_samples() const;
+
+    /**
+     * @brief Get the number of blocks that couldn't be written to the spill file - their samples are only kept in the ring
+     */
+    uint64_t get_write_failures() const;
+
+    const std::string &get_symbol(uint32_t symbol) const;
+};
+
+#endif // BBO_SERIES_H
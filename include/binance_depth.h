@@ -0,0 +1,318 @@
+// Binance venue adapters for the book engine - see venue_adapter.h for what an adapter provides
+#ifndef BINANCE_DEPTH_H
+#define BINANCE_DEPTH_H
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cpr/cpr.h>
+#include "simdjson.h"
+#include "book_side.h"
+#include "depth_update.h"
+#include "venue_adapter.h"
+
+/**
+ * @brief Decoding shared by the Binance depth streams and REST snapshots
+ */
+struct BinanceDepthCodec
+{
+    /**
+     * @brief Get the lowercase symbol Binance uses in stream names
+     */
+    static std::string stream_symbol(const std::string &symbol)
+    {
+        std::string lower = symbol;
+        for (char &c : lower)
+        {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return lower;
+    }
+
+    /**
+     * @brief Get the event object out of a stream message.
+     * Combined streams (/stream?streams=...) wrap the event as {"stream":"<name>","data":{...}}, raw streams (/ws/<name>) send the event itself.
+     * Binance always writes the stream field first, so a prefix check avoids scanning raw events for a "data" field.
+     */
+    static simdjson::ondemand::object stream_event(simdjson::ondemand::document &doc, simdjson::padded_string_view message)
+    {
+        static constexpr const char COMBINED_PREFIX[] = "{\"stream\":";
+        if (message.size() > sizeof(COMBINED_PREFIX) - 1 && std::memcmp(message.data(), COMBINED_PREFIX, sizeof(COMBINED_PREFIX) - 1) == 0)
+        {
+            return doc["data"].get_object();
+        }
+        return doc.get_object();
+    }
+
+    /**
+     * @brief Decode an array of ["price", "quantity"] string pairs
+     * @param levels The JSON array of levels
+     * @param out Cleared, then filled with the decoded levels
+     */
+    static void decode_levels(simdjson::ondemand::array levels, std::vector<PriceLevel> &out)
+    {
+        out.clear();
+        for (auto level : levels)
+        {
+            // quoted decimals are parsed in place - no std::string per value
+            auto values = level.get_array();
+            auto value = values.begin();
+            PriceLevel entry;
+            entry.price = (*value).get_double_in_string();
+            ++value;
+            entry.quantity = (*value).get_double_in_string();
+            out.push_back(entry);
+        }
+    }
+
+    /**
+     * @brief Decode a depthUpdate event, from a raw or combined stream
+     * @tparam HasPreviousId true for streams that send pu, the previous event's final update ID (futures)
+     * @param venue Venue name for logs
+     * @return true if the message was a depth update, false if it should be ignored
+     */
+    template <bool HasPreviousId>
+    static bool decode_depth_update(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, DepthUpdate &update, const char *venue)
+    {
+        try
+        {
+            simdjson::ondemand::document doc = parser.iterate(message);
+            simdjson::ondemand::object event = stream_event(doc, message);
+
+            // subscription replies and other streams don't carry a depthUpdate event type
+            std::string_view event_type;
+            if (event["e"].get_string().get(event_type) != simdjson::SUCCESS || event_type != "depthUpdate")
+            {
+                return false;
+            }
+
+            // fields are read in the order Binance sends them
+            update.event_time = event["E"].get_int64();
+            update.first_update_id = event["U"].get_int64();
+            update.final_update_id = event["u"].get_int64();
+            update.previous_final_update_id = HasPreviousId ? event["pu"].get_int64().value() : -1;
+            decode_levels(event["b"].get_array(), update.bids);
+            decode_levels(event["a"].get_array(), update.asks);
+            return true;
+        }
+        catch (const simdjson::simdjson_error &e)
+        {
+            std::cerr << "[" << venue << "] JSON parsing error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    /**
+     * @brief Fetch a REST depth snapshot
+     * @param endpoints The venue endpoints - snapshot_url is fetched
+     * @param body Set to the response body
+     * @return true if the request succeeded, false otherwise
+     */
+    static bool fetch_snapshot(const VenueEndpoints &endpoints, std::string &body)
+    {
+        cpr::Response response = cpr::Get(cpr::Url{endpoints.snapshot_url});
+        if (response.status_code != 200)
+        {
+            std::cerr << "[Binance][fetch_snapshot] HTTP error: " << response.status_code << std::endl;
+            return false;
+        }
+        body = std::move(response.text);
+        return true;
+    }
+
+    /**
+     * @brief Parse a REST depth snapshot into a pair of book sides
+     * @param parser The JSON parser to use
+     * @param body The snapshot response body (non-const, simdjson may pad it)
+     * @param snapshot_bids Bid side to load the snapshot bids into (cleared first) - any BookSide<true, ...>
+     * @param snapshot_asks Ask side to load the snapshot asks into (cleared first) - any BookSide<false, ...>
+     * @param snapshot_update_id Set to the snapshot's lastUpdateId
+     * @return true if the snapshot was parsed successfully, false otherwise
+     */
+    template <typename Bids, typename Asks>
+    static bool parse_snapshot(simdjson::ondemand::parser &parser, std::string &body, Bids &snapshot_bids, Asks &snapshot_asks, int64_t &snapshot_update_id)
+    {
+        snapshot_bids.clear();
+        snapshot_asks.clear();
+
+        // levels are decoded here first, then loaded into the sides - reused between snapshots
+        thread_local std::vector<PriceLevel> levels;
+
+        try
+        {
+            auto doc = parser.iterate(body);
+            snapshot_update_id = doc["lastUpdateId"].get_int64();
+
+            decode_levels(doc["bids"].get_array(), levels);
+            for (const PriceLevel &level : levels)
+            {
+                snapshot_bids.update(level.price, level.quantity);
+            }
+
+            decode_levels(doc["asks"].get_array(), levels);
+            for (const PriceLevel &level : levels)
+            {
+                snapshot_asks.update(level.price, level.quantity);
+            }
+        }
+        catch (const simdjson::simdjson_error &e)
+        {
+            std::cerr << "[Binance][parse_snapshot] JSON parsing error: " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Binance spot diff depth stream: https://developers.binance.com/docs/binance-spot-api-docs/web-socket-streams#diff-depth-stream
+ * Continuity rule: after a snapshot with lastUpdateId L, drop events with u <= L, then every event must satisfy U <= L + 1 <= u,
+ * where L is the final update ID of the previously applied event.
+ */
+struct BinanceSpot : BinanceDepthCodec
+{
+    static constexpr const char *NAME = "binance-spot";
+
+    /**
+     * @brief Get the public Binance spot endpoints for a symbol
+     * @param symbol Venue symbol, e.g. "XRPUSDT"
+     */
+    static VenueEndpoints endpoints(const std::string &symbol)
+    {
+        return VenueEndpoints{
+            symbol,
+            "stream.binance.com",
+            443,
+            "/ws/" + stream_symbol(symbol) + "@depth@100ms",
+            true,
+            "https://api.binance.com/api/v3/depth?symbol=" + symbol + "&limit=1024"};
+    }
+
+    /**
+     * @brief Decode a depthUpdate event, from a raw or combined stream
+     * @return true if the message was a depth update, false if it should be ignored
+     */
+    static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, DepthUpdate &update)
+    {
+        return decode_depth_update<false>(parser, message, update, NAME);
+    }
+
+    /**
+     * @brief A snapshot is usable if it reaches the first buffered event - otherwise events between the two are missing
+     */
+    static bool snapshot_covers(int64_t snapshot_update_id, const DepthUpdate &first_event)
+    {
+        return snapshot_update_id >= first_event.first_update_id;
+    }
+
+    /**
+     * @brief Spot continuity: drop u <= L, gap if U > L + 1, otherwise apply
+     */
+    static SequenceCheck check_sequence(const DepthUpdate &update, int64_t last_update_id, bool first_after_snapshot)
+    {
+        (void)first_after_snapshot; // the same rule holds for the first event after a snapshot
+        if (update.final_update_id <= last_update_id)
+        {
+            return SequenceCheck::STALE;
+        }
+        if (update.first_update_id > last_update_id + 1)
+        {
+            return SequenceCheck::GAP;
+        }
+        return SequenceCheck::APPLY;
+    }
+
+    /**
+     * @brief Number of update IDs between the local book and the event
+     */
+    static int64_t gap_size(const DepthUpdate &update, int64_t last_update_id)
+    {
+        return update.first_update_id - last_update_id - 1;
+    }
+};
+
+/**
+ * @brief Binance USD-M futures diff depth stream: https://developers.binance.com/docs/derivatives/usds-margined-futures/websocket-market-streams/Diff-Book-Depth-Streams
+ * Futures update IDs are not contiguous, so continuity comes from pu (the previous event's final update ID) instead of U:
+ * after a snapshot with lastUpdateId L, drop events with u < L, the first applied event must satisfy U <= L <= u,
+ * and every later event must have pu equal to the final update ID of the previously applied event.
+ */
+struct BinanceFutures : BinanceDepthCodec
+{
+    static constexpr const char *NAME = "binance-futures";
+
+    /**
+     * @brief Get the public Binance USD-M futures endpoints for a symbol
+     * @param symbol Venue symbol, e.g. "XRPUSDT"
+     */
+    static VenueEndpoints endpoints(const std::string &symbol)
+    {
+        // futures snapshots only accept limits of 5, 10, 20, 50, 100, 500 or 1000
+        return VenueEndpoints{
+            symbol,
+            "fstream.binance.com",
+            443,
+            "/ws/" + stream_symbol(symbol) + "@depth@100ms",
+            true,
+            "https://fapi.binance.com/fapi/v1/depth?symbol=" + symbol + "&limit=1000"};
+    }
+
+    /**
+     * @brief Decode a futures depthUpdate event (with pu), from a raw or combined stream
+     * @return true if the message was a depth update, false if it should be ignored
+     */
+    static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, DepthUpdate &update)
+    {
+        return decode_depth_update<true>(parser, message, update, NAME);
+    }
+
+    /**
+     * @brief A snapshot is usable if it reaches the first buffered event - otherwise events between the two are missing
+     */
+    static bool snapshot_covers(int64_t snapshot_update_id, const DepthUpdate &first_event)
+    {
+        return snapshot_update_id >= first_event.first_update_id;
+    }
+
+    /**
+     * @brief Futures continuity: on a new snapshot the first event must straddle it (or follow an event it already covers),
+     * after that each event's pu must match the last applied u
+     */
+    static SequenceCheck check_sequence(const DepthUpdate &update, int64_t last_update_id, bool first_after_snapshot)
+    {
+        if (first_after_snapshot)
+        {
+            if (update.final_update_id < last_update_id)
+            {
+                return SequenceCheck::STALE;
+            }
+            // events ending exactly at the snapshot are dropped while the buffer is cleaned up, so the next one chains on through pu
+            if (update.first_update_id <= last_update_id || update.previous_final_update_id == last_update_id)
+            {
+                return SequenceCheck::APPLY;
+            }
+            return SequenceCheck::GAP;
+        }
+
+        // duplicates of events already applied
+        if (update.final_update_id <= last_update_id)
+        {
+            return SequenceCheck::STALE;
+        }
+        return update.previous_final_update_id == last_update_id ? SequenceCheck::APPLY : SequenceCheck::GAP;
+    }
+
+    /**
+     * @brief Update IDs covered by the missed events - IDs aren't contiguous on futures, so this over-estimates the number of missed updates
+     */
+    static int64_t gap_size(const DepthUpdate &update, int64_t last_update_id)
+    {
+        int64_t missed_until = update.previous_final_update_id >= 0 ? update.previous_final_update_id : update.first_update_id - 1;
+        return missed_until - last_update_id;
+    }
+};
+
+#endif // BINANCE_DEPTH_H
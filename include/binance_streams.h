@@ -0,0 +1,184 @@
+// Binance stream adapters for streams other than depth - see venue_adapter.h for what a stream adapter provides
+#ifndef BINANCE_STREAMS_H
+#define BINANCE_STREAMS_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "simdjson.h"
+#include "binance_depth.h"
+#include "kline.h"
+#include "trade.h"
+#include "venue_adapter.h"
+
+/**
+ * @brief Binance aggregate trade stream: https://developers.binance.com/docs/binance-spot-api-docs/web-socket-streams#aggregate-trade-streams
+ * The same payload is sent by spot and USD-M futures, so one adapter serves both - endpoints() takes the venue to connect to.
+ */
+struct BinanceAggTrades
+{
+    using Event = Trade;
+    static constexpr const char *NAME = "binance-aggtrades";
+
+    /**
+     * @brief Get a venue's aggregate trade stream endpoints for a symbol
+     * @tparam Venue The depth venue adapter whose stream host is used, e.g. BinanceSpot
+     * @param symbol Venue symbol, e.g. "XRPUSDT"
+     */
+    template <typename Venue>
+    static VenueEndpoints endpoints(const std::string &symbol)
+    {
+        VenueEndpoints endpoints = Venue::endpoints(symbol);
+        endpoints.stream_path = "/ws/" + BinanceDepthCodec::stream_symbol(symbol) + "@aggTrade";
+        endpoints.snapshot_url.clear();
+        return endpoints;
+    }
+
+    /**
+     * @brief Decode an aggTrade event, from a raw or combined stream
+     * @return true if the message was an aggregate trade, false if it should be ignored
+     */
+    static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, Trade &trade)
+    {
+        try
+        {
+            simdjson::ondemand::document doc = parser.iterate(message);
+            simdjson::ondemand::object event = BinanceDepthCodec::stream_event(doc, message);
+
+            std::string_view event_type;
+            if (event["e"].get_string().get(event_type) != simdjson::SUCCESS || event_type != "aggTrade")
+            {
+                return false;
+            }
+
+            // fields are read in the order Binance sends them
+            trade.event_time = event["E"].get_int64();
+            trade.trade_id = event["a"].get_int64();
+            trade.price = event["p"].get_double_in_string();
+            trade.quantity = event["q"].get_double_in_string();
+            trade.first_trade_id = event["f"].get_int64();
+            trade.last_trade_id = event["l"].get_int64();
+            trade.trade_time = event["T"].get_int64();
+            trade.is_buyer_maker = event["m"].get_bool();
+            return true;
+        }
+        catch (const simdjson::simdjson_error &e)
+        {
+            std::cerr << "[" << NAME << "] JSON parsing error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+};
+
+/**
+ * @brief Binance kline streams: https://developers.binance.com/docs/binance-spot-api-docs/web-socket-streams#klinecandlestick-streams
+ * Binance pushes the open kline every couple of seconds - only the final update of each kline (x = true) is decoded,
+ * so the buffer only carries klines that can be reconciled.
+ */
+struct BinanceKlines
+{
+    using Event = Kline;
+    static constexpr const char *NAME = "binance-klines";
+
+    /**
+     * @brief Get a venue's kline stream endpoints for a symbol - several intervals share one combined stream connection
+     * @tparam Venue The depth venue adapter whose stream host is used, e.g. BinanceSpot
+     * @param symbol Venue symbol, e.g. "XRPUSDT"
+     * @param intervals Binance interval names, e.g. {"1s", "1m", "5m"} (1s is spot only)
+     */
+    template <typename Venue>
+    static VenueEndpoints endpoints(const std::string &symbol, const std::vector<std::string> &intervals)
+    {
+        VenueEndpoints endpoints = Venue::endpoints(symbol);
+        endpoints.stream_path = "/stream?streams=";
+        for (size_t i = 0; i < intervals.size(); i++)
+        {
+            endpoints.stream_path += (i > 0 ? "/" : "") + BinanceDepthCodec::stream_symbol(symbol) + "@kline_" + intervals[i];
+        }
+        endpoints.snapshot_url.clear();
+        return endpoints;
+    }
+
+    /**
+     * @brief Get the length of a Binance interval name, e.g. "5m" -> 300000
+     * @return The length in ms, or 0 for intervals without a fixed length (1M) or unknown names
+     */
+    static int64_t interval_ms(std::string_view interval)
+    {
+        int64_t count = 0;
+        size_t i = 0;
+        for (; i < interval.size() && interval[i] >= '0' && interval[i] <= '9'; i++)
+        {
+            count = count * 10 + (interval[i] - '0');
+        }
+        if (i + 1 != interval.size())
+        {
+            return 0;
+        }
+        switch (interval[i])
+        {
+        case 's':
+            return count * 1000;
+        case 'm':
+            return count * 60000;
+        case 'h':
+            return count * 3600000;
+        case 'd':
+            return count * 86400000;
+        case 'w':
+            return count * 604800000;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Decode a closed kline event, from a raw or combined stream
+     * @return true if the message was the final update of a kline, false if it should be ignored
+     */
+    static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, Kline &kline)
+    {
+        try
+        {
+            simdjson::ondemand::document doc = parser.iterate(message);
+            simdjson::ondemand::object event = BinanceDepthCodec::stream_event(doc, message);
+
+            std::string_view event_type;
+            if (event["e"].get_string().get(event_type) != simdjson::SUCCESS || event_type != "kline")
+            {
+                return false;
+            }
+            kline.event_time = event["E"].get_int64();
+
+            // fields are read in the order Binance sends them
+            simdjson::ondemand::object k = event["k"].get_object();
+            kline.open_time = k["t"].get_int64();
+            kline.close_time = k["T"].get_int64() + 1; // Binance sends the last millisecond of the kline
+            kline.interval_ms = interval_ms(k["i"].get_string().value());
+            kline.first_trade_id = k["f"].get_int64();
+            kline.last_trade_id = k["L"].get_int64();
+            kline.open = k["o"].get_double_in_string();
+            kline.close = k["c"].get_double_in_string();
+            kline.high = k["h"].get_double_in_string();
+            kline.low = k["l"].get_double_in_string();
+            kline.volume = k["v"].get_double_in_string();
+            kline.trade_count = static_cast<uint32_t>(k["n"].get_uint64().value());
+            kline.closed = k["x"].get_bool();
+            if (!kline.closed)
+            {
+                return false;
+            }
+            kline.quote_volume = k["q"].get_double_in_string();
+            kline.taker_buy_volume = k["V"].get_double_in_string();
+            return kline.interval_ms > 0;
+        }
+        catch (const simdjson::simdjson_error &e)
+        {
+            std::cerr << "[" << NAME << "] JSON parsing error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+};
+
+#endif // BINANCE_STREAMS_H
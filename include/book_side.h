@@ -0,0 +1,308 @@
+// One side (bids or asks) of the local order book, stored as sorted contiguous arrays
+#ifndef BOOK_SIDE_H
+#define BOOK_SIDE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "depth_view.h"
+
+/**
+ * @brief Per-level age columns, kept parallel to the price/quantity arrays when a BookSide tracks level age
+ */
+struct LevelAgeColumns
+{
+    // event time (ms) each level was created, 0 if it was loaded from a snapshot (its age is unknown)
+    std::vector<int64_t> created_times;
+    // event time (ms) each level's quantity last changed, 0 if unchanged since a snapshot
+    std::vector<int64_t> modified_times;
+    // number of updates to each level since it was created (or loaded)
+    std::vector<uint32_t> update_counts;
+};
+
+// stand-in for LevelAgeColumns when level age isn't tracked
+struct NoLevelAgeColumns
+{
+};
+
+/**
+ * @brief The BookSide class stores the price levels for one side of the order book.
+ * Prices and quantities are kept in two parallel vectors, sorted from the worst price to the best price.
+ * Keeping the best price at the back means most updates (which land near the top of the book) only shift a handful of elements,
+ * and the top N levels can be read directly without any sorting.
+ * With TrackAge, each level's creation time, last modified time and update count are kept in further parallel vectors, so the
+ * price and quantity arrays stay as compact as without. Without it the age columns and the code maintaining them compile away.
+ * @tparam IsBid true for the bid side (best = highest price), false for the ask side (best = lowest price)
+ * @tparam TrackAge true to track per-level age
+ */
+template <bool IsBid, bool TrackAge = false>
+class BookSide
+{
+private:
+    // price of each level, ordered worst -> best
+    std::vector<double> prices;
+    // quantity of each level, same index as prices
+    std::vector<double> quantities;
+    // age of each level, same index as prices - only with TrackAge
+    std::conditional_t<TrackAge, LevelAgeColumns, NoLevelAgeColumns> ages;
+    // lowest index changed since the last take_dirty_from() - everything below it is unchanged
+    size_t dirty_from = 0;
+
+    /**
+     * @brief Comparator used to keep the arrays ordered worst -> best
+     * @return true if lhs is a worse price than rhs for this side of the book
+     */
+    static bool is_worse(double lhs, double rhs)
+    {
+        if constexpr (IsBid)
+        {
+            return lhs < rhs;
+        }
+        else
+        {
+            return lhs > rhs;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new BookSide, reserving space for a typical snapshot depth
+     */
+    BookSide()
+    {
+        prices.reserve(4096);
+        quantities.reserve(4096);
+        if constexpr (TrackAge)
+        {
+            ages.created_times.reserve(4096);
+            ages.modified_times.reserve(4096);
+            ages.update_counts.reserve(4096);
+        }
+    }
+
+    /**
+     * @brief Set the quantity of a price level, inserting or removing the level as required
+     * @param price The price level to update
+     * @param quantity The new total quantity at the price level, zero removes the level
+     * @param time Event time (ms) of the update, used for level age - 0 for snapshot levels
+     * @return The quantity at the price level before the update (zero if the level did not exist)
+     */
+    double update(double price, double quantity, int64_t time = 0)
+    {
+        auto it = std::lower_bound(prices.begin(), prices.end(), price, is_worse);
+        size_t index = static_cast<size_t>(it - prices.begin());
+        dirty_from = std::min(dirty_from, index);
+
+        // existing level - modify or remove
+        if (it != prices.end() && *it == price)
+        {
+            double previous = quantities[index];
+            if (quantity > 0)
+            {
+                quantities[index] = quantity;
+                if constexpr (TrackAge)
+                {
+                    ages.modified_times[index] = time;
+                    ages.update_counts[index]++;
+                }
+            }
+            else
+            {
+                prices.erase(it);
+                quantities.erase(quantities.begin() + index);
+                if constexpr (TrackAge)
+                {
+                    ages.created_times.erase(ages.created_times.begin() + index);
+                    ages.modified_times.erase(ages.modified_times.begin() + index);
+                    ages.update_counts.erase(ages.update_counts.begin() + index);
+                }
+            }
+            return previous;
+        }
+
+        // new level - only insert if it has a quantity
+        if (quantity > 0)
+        {
+            prices.insert(it, price);
+            quantities.insert(quantities.begin() + index, quantity);
+            if constexpr (TrackAge)
+            {
+                ages.created_times.insert(ages.created_times.begin() + index, time);
+                ages.modified_times.insert(ages.modified_times.begin() + index, time);
+                ages.update_counts.insert(ages.update_counts.begin() + index, 1u);
+            }
+        }
+        return 0.0;
+    }
+
+    /**
+     * @brief Remove all price levels
+     */
+    void clear()
+    {
+        prices.clear();
+        quantities.clear();
+        if constexpr (TrackAge)
+        {
+            ages.created_times.clear();
+            ages.modified_times.clear();
+            ages.update_counts.clear();
+        }
+        dirty_from = 0;
+    }
+
+    /**
+     * @brief Check if this side of the book has no levels
+     */
+    bool empty() const
+    {
+        return prices.empty();
+    }
+
+    /**
+     * @brief Get the number of price levels on this side of the book
+     */
+    size_t size() const
+    {
+        return prices.size();
+    }
+
+    /**
+     * @brief Get the best price - must not be called on an empty side
+     */
+    double best_price() const
+    {
+        return prices.back();
+    }
+
+    /**
+     * @brief Get the quantity at the best price - must not be called on an empty side
+     */
+    double best_quantity() const
+    {
+        return quantities.back();
+    }
+
+    /**
+     * @brief Get the price at the given depth, where depth 0 is the best price
+     */
+    double price_at(size_t depth) const
+    {
+        return prices[prices.size() - 1 - depth];
+    }
+
+    /**
+     * @brief Get the quantity at the given depth, where depth 0 is the best price
+     */
+    double quantity_at(size_t depth) const
+    {
+        return quantities[quantities.size() - 1 - depth];
+    }
+
+    /**
+     * @brief Get the raw price array, ordered worst -> best
+     */
+    const double *price_data() const
+    {
+        return prices.data();
+    }
+
+    /**
+     * @brief Get the raw quantity array, same order as price_data()
+     */
+    const double *quantity_data() const
+    {
+        return quantities.data();
+    }
+
+    /**
+     * @brief Get the lowest index changed since the last call, and mark everything as unchanged
+     * @return The lowest changed index - levels below it are identical to the last call
+     */
+    size_t take_dirty_from()
+    {
+        size_t result = dirty_from;
+        dirty_from = prices.size();
+        return result;
+    }
+
+    /**
+     * @brief Copy the top levels of this side into an output array, best price first
+     * @param out The array to copy the levels into
+     * @param max_levels The maximum number of levels to copy
+     * @return The number of levels copied
+     */
+    size_t copy_top(PriceLevel *out, size_t max_levels) const
+    {
+        size_t count = std::min(max_levels, prices.size());
+        for (size_t depth = 0; depth < count; depth++)
+        {
+            out[depth].price = price_at(depth);
+            out[depth].quantity = quantity_at(depth);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Get the age of the level at the given depth, where depth 0 is the best price - only with TrackAge
+     */
+    LevelAge age_at(size_t depth) const
+    {
+        static_assert(TrackAge, "Level age is only tracked by BookSide<IsBid, true>");
+        size_t index = prices.size() - 1 - depth;
+        return LevelAge{ages.created_times[index], ages.modified_times[index], ages.update_counts[index], 0};
+    }
+
+    /**
+     * @brief Take the ages of the levels that are also in another side, e.g. the side this one replaced after a gap repair - only with TrackAge.
+     * A level whose quantity differs keeps its creation time and update count, but its modified time becomes 0 - it changed at some
+     * point in the gap. Levels only in this side keep the snapshot ages they were loaded with.
+     * @param previous The side to take the ages from
+     */
+    void carry_ages_from(const BookSide &previous)
+    {
+        static_assert(TrackAge, "Level age is only tracked by BookSide<IsBid, true>");
+        // both sides are ordered worst -> best, so one merge walk finds the prices they share
+        size_t i = 0;
+        size_t j = 0;
+        while (i < prices.size() && j < previous.prices.size())
+        {
+            if (is_worse(prices[i], previous.prices[j]))
+            {
+                i++;
+            }
+            else if (is_worse(previous.prices[j], prices[i]))
+            {
+                j++;
+            }
+            else
+            {
+                ages.created_times[i] = previous.ages.created_times[j];
+                ages.modified_times[i] = quantities[i] == previous.quantities[j] ? previous.ages.modified_times[j] : 0;
+                ages.update_counts[i] = previous.ages.update_counts[j];
+                i++;
+                j++;
+            }
+        }
+    }
+
+    /**
+     * @brief Copy the ages of the top levels into an output array, best price first - only with TrackAge
+     * @param out The array to copy the ages into
+     * @param max_levels The maximum number of levels to copy
+     * @return The number of levels copied
+     */
+    size_t copy_top_ages(LevelAge *out, size_t max_levels) const
+    {
+        size_t count = std::min(max_levels, prices.size());
+        for (size_t depth = 0; depth < count; depth++)
+        {
+            out[depth] = age_at(depth);
+        }
+        return count;
+    }
+};
+
+#endif // BOOK_SIDE_H
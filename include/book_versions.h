@@ -0,0 +1,380 @@
+// Immutable, versioned copies of the full order book, shared between versions page by page and reclaimed with epochs
+#ifndef BOOK_VERSIONS_H
+#define BOOK_VERSIONS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "book_side.h"
+
+// number of price levels stored in each page of a BookVersion
+constexpr size_t LEVEL_PAGE_SIZE = 64;
+// maximum number of BookReader instances that can exist at the same time, per publisher
+constexpr size_t MAX_BOOK_READERS = 16;
+
+/**
+ * @brief A fixed-size block of consecutive price levels, in the same worst -> best order as BookSide.
+ * Pages are never modified once published, so unchanged pages are shared between versions.
+ */
+struct LevelPage
+{
+    uint32_t count;                        // number of valid levels in the page
+    uint32_t references;                   // number of versions using this page - only touched by the writer thread
+    double prices[LEVEL_PAGE_SIZE];        // level prices, worst -> best
+    double quantities[LEVEL_PAGE_SIZE];    // level quantities, same index as prices
+};
+
+/**
+ * @brief An immutable copy of the full order book at a given update ID
+ */
+class BookVersion
+{
+private:
+    friend class BookVersionPublisher;
+
+    int64_t update_id = 0;      // final update ID of the last event in this version
+    int64_t event_time = 0;     // exchange event time of the last event in this version (ms)
+    uint64_t version = 0;       // increases by one for every published version
+    size_t bid_count = 0;       // total bid levels
+    size_t ask_count = 0;       // total ask levels
+    uint64_t retire_epoch = 0;  // epoch the version was replaced in - only touched by the writer thread
+
+    // pages ordered worst -> best, the last page holds the best prices
+    std::vector<LevelPage *> bid_pages;
+    std::vector<LevelPage *> ask_pages;
+
+    static double price_in(const std::vector<LevelPage *> &pages, size_t count, size_t depth)
+    {
+        size_t index = count - 1 - depth;
+        return pages[index / LEVEL_PAGE_SIZE]->prices[index % LEVEL_PAGE_SIZE];
+    }
+
+    static double quantity_in(const std::vector<LevelPage *> &pages, size_t count, size_t depth)
+    {
+        size_t index = count - 1 - depth;
+        return pages[index / LEVEL_PAGE_SIZE]->quantities[index % LEVEL_PAGE_SIZE];
+    }
+
+public:
+    int64_t get_update_id() const { return update_id; }
+    int64_t get_event_time() const { return event_time; }
+    uint64_t get_version() const { return version; }
+    size_t bid_levels() const { return bid_count; }
+    size_t ask_levels() const { return ask_count; }
+
+    /**
+     * @brief Get the bid price at the given depth, where depth 0 is the best bid - depth must be < bid_levels()
+     */
+    double bid_price(size_t depth) const { return price_in(bid_pages, bid_count, depth); }
+    double bid_quantity(size_t depth) const { return quantity_in(bid_pages, bid_count, depth); }
+
+    /**
+     * @brief Get the ask price at the given depth, where depth 0 is the best ask - depth must be < ask_levels()
+     */
+    double ask_price(size_t depth) const { return price_in(ask_pages, ask_count, depth); }
+    double ask_quantity(size_t depth) const { return quantity_in(ask_pages, ask_count, depth); }
+};
+
+/**
+ * @brief Per-reader slot announcing the epoch the reader is pinned in, one cache line each so readers don't contend
+ */
+struct alignas(64) ReaderSlot
+{
+    std::atomic<uint64_t> epoch{std::numeric_limits<uint64_t>::max()}; // max = not pinned
+    std::atomic<bool> in_use{false};
+};
+
+/**
+ * @brief The BookVersionPublisher class publishes immutable BookVersions from the order book apply thread.
+ *
+ * Each publish builds a new version that shares every page below the lowest level changed since the last publish with the previous version,
+ * and only copies the pages from there to the best price - usually just the last page or two.
+ * Replaced versions are retired with the current epoch and reclaimed (their pages returned to a free list) once no reader is pinned in that epoch or earlier.
+ * Pages and versions are pooled, so publishing does not allocate once the pools are warm.
+ */
+class BookVersionPublisher
+{
+private:
+    // the latest complete version - what readers pin
+    std::atomic<BookVersion *> latest{nullptr};
+    // global epoch, advanced every time a version is retired
+    std::atomic<uint64_t> global_epoch{1};
+    // reader slots
+    std::array<ReaderSlot, MAX_BOOK_READERS> slots;
+
+    // everything below is only touched by the writer thread
+    uint64_t next_version = 1;
+    std::vector<BookVersion *> retired;
+    std::vector<BookVersion *> free_versions;
+    std::vector<LevelPage *> free_pages;
+
+    static constexpr uint64_t NOT_PINNED = std::numeric_limits<uint64_t>::max();
+
+    LevelPage *allocate_page()
+    {
+        if (free_pages.empty())
+        {
+            return new LevelPage();
+        }
+        LevelPage *page = free_pages.back();
+        free_pages.pop_back();
+        return page;
+    }
+
+    void release_page(LevelPage *page)
+    {
+        if (--page->references == 0)
+        {
+            free_pages.push_back(page);
+        }
+    }
+
+    /**
+     * @brief Build the pages for one side of a new version, sharing unchanged pages with the previous version
+     * @param side The live book side
+     * @param dirty_from Lowest level index changed since the previous version
+     * @param previous Pages of the previous version (empty if there is none)
+     * @param out Pages for the new version
+     */
+    template <typename Side>
+    void build_pages(const Side &side, size_t dirty_from, const std::vector<LevelPage *> &previous, std::vector<LevelPage *> &out)
+    {
+        out.clear();
+        size_t count = side.size();
+        const double *prices = side.price_data();
+        const double *quantities = side.quantity_data();
+
+        for (size_t start = 0; start < count; start += LEVEL_PAGE_SIZE)
+        {
+            size_t page_index = start / LEVEL_PAGE_SIZE;
+            uint32_t page_count = static_cast<uint32_t>(std::min(LEVEL_PAGE_SIZE, count - start));
+
+            // reuse the previous page if every level in it is below the dirty index and it holds the same number of levels
+            if (page_index < previous.size() && previous[page_index]->count == page_count && start + page_count <= dirty_from)
+            {
+                LevelPage *shared = previous[page_index];
+                shared->references++;
+                out.push_back(shared);
+                continue;
+            }
+
+            LevelPage *page = allocate_page();
+            page->count = page_count;
+            page->references = 1;
+            std::copy(prices + start, prices + start + page_count, page->prices);
+            std::copy(quantities + start, quantities + start + page_count, page->quantities);
+            out.push_back(page);
+        }
+    }
+
+    /**
+     * @brief Free every retired version that no pinned reader can still hold
+     */
+    void reclaim()
+    {
+        uint64_t min_epoch = NOT_PINNED;
+        for (const ReaderSlot &slot : slots)
+        {
+            uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch < min_epoch)
+            {
+                min_epoch = epoch;
+            }
+        }
+
+        size_t kept = 0;
+        for (BookVersion *version : retired)
+        {
+            // a reader pinned in an epoch after the retire epoch must have loaded a newer version
+            if (version->retire_epoch < min_epoch)
+            {
+                for (LevelPage *page : version->bid_pages)
+                {
+                    release_page(page);
+                }
+                for (LevelPage *page : version->ask_pages)
+                {
+                    release_page(page);
+                }
+                free_versions.push_back(version);
+            }
+            else
+            {
+                retired[kept++] = version;
+            }
+        }
+        retired.resize(kept);
+    }
+
+public:
+    BookVersionPublisher() = default;
+    BookVersionPublisher(const BookVersionPublisher &) = delete;
+    BookVersionPublisher &operator=(const BookVersionPublisher &) = delete;
+
+    /**
+     * @brief Free all versions and pages - no reader may be pinned when the publisher is destroyed
+     */
+    ~BookVersionPublisher()
+    {
+        BookVersion *current = latest.exchange(nullptr);
+        if (current)
+        {
+            current->retire_epoch = 0;
+            retired.push_back(current);
+        }
+        reclaim();
+        for (BookVersion *version : free_versions)
+        {
+            delete version;
+        }
+        for (LevelPage *page : free_pages)
+        {
+            delete page;
+        }
+    }
+
+    /**
+     * @brief Publish a new version of the book - must only be called from the order book apply thread
+     * @param bids The live bid side
+     * @param asks The live ask side
+     * @param bid_dirty_from Lowest bid index changed since the last publish (see BookSide::take_dirty_from)
+     * @param ask_dirty_from Lowest ask index changed since the last publish
+     * @param update_id Final update ID of the last applied event
+     * @param event_time Exchange event time of the last applied event
+     */
+    template <typename Bids, typename Asks>
+    void publish(const Bids &bids, const Asks &asks, size_t bid_dirty_from, size_t ask_dirty_from, int64_t update_id, int64_t event_time)
+    {
+        BookVersion *previous = latest.load(std::memory_order_relaxed);
+
+        BookVersion *next;
+        if (free_versions.empty())
+        {
+            next = new BookVersion();
+        }
+        else
+        {
+            next = free_versions.back();
+            free_versions.pop_back();
+        }
+
+        static const std::vector<LevelPage *> no_pages;
+        build_pages(bids, bid_dirty_from, previous ? previous->bid_pages : no_pages, next->bid_pages);
+        build_pages(asks, ask_dirty_from, previous ? previous->ask_pages : no_pages, next->ask_pages);
+        next->update_id = update_id;
+        next->event_time = event_time;
+        next->version = next_version++;
+        next->bid_count = bids.size();
+        next->ask_count = asks.size();
+
+        // publish, then retire the replaced version in the current epoch and move readers on to the next epoch
+        latest.store(next, std::memory_order_seq_cst);
+        if (previous)
+        {
+            previous->retire_epoch = global_epoch.fetch_add(1, std::memory_order_seq_cst);
+            retired.push_back(previous);
+        }
+        reclaim();
+    }
+
+    /**
+     * @brief Get the number of versions waiting to be reclaimed
+     */
+    size_t retired_count() const
+    {
+        return retired.size();
+    }
+
+    friend class BookReader;
+};
+
+/**
+ * @brief A pinned, read-only handle to the latest complete BookVersion.
+ * The version can't be reclaimed while the handle exists, so keep handles short-lived - a long-held handle stops all reclamation.
+ */
+class PinnedBook
+{
+private:
+    ReaderSlot *slot;
+    const BookVersion *version;
+
+public:
+    PinnedBook(ReaderSlot *slot, const BookVersion *version) : slot(slot), version(version) {}
+    PinnedBook(const PinnedBook &) = delete;
+    PinnedBook &operator=(const PinnedBook &) = delete;
+    PinnedBook(PinnedBook &&other) noexcept : slot(other.slot), version(other.version)
+    {
+        other.slot = nullptr;
+    }
+
+    ~PinnedBook()
+    {
+        if (slot)
+        {
+            slot->epoch.store(std::numeric_limits<uint64_t>::max(), std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Check if a version has been published yet
+     */
+    explicit operator bool() const { return version != nullptr; }
+    const BookVersion *operator->() const { return version; }
+    const BookVersion &operator*() const { return *version; }
+};
+
+/**
+ * @brief The BookReader class gives one reader thread access to a publisher's versions.
+ * It claims a reader slot for its lifetime; pin() is then O(1) - announce the epoch and load the latest version pointer.
+ */
+class BookReader
+{
+private:
+    BookVersionPublisher *publisher;
+    ReaderSlot *slot = nullptr;
+
+public:
+    /**
+     * @brief Claim a reader slot on the publisher
+     * @throws std::runtime_error If all MAX_BOOK_READERS slots are already in use
+     */
+    explicit BookReader(BookVersionPublisher &publisher) : publisher(&publisher)
+    {
+        for (ReaderSlot &candidate : publisher.slots)
+        {
+            bool expected = false;
+            if (candidate.in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                slot = &candidate;
+                return;
+            }
+        }
+        throw std::runtime_error("[BookReader] No free reader slots");
+    }
+
+    BookReader(const BookReader &) = delete;
+    BookReader &operator=(const BookReader &) = delete;
+
+    ~BookReader()
+    {
+        slot->epoch.store(std::numeric_limits<uint64_t>::max(), std::memory_order_release);
+        slot->in_use.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Pin the latest complete version of the book - only one pin per reader may be live at a time
+     * @return A handle to the version, empty if nothing has been published yet
+     */
+    PinnedBook pin()
+    {
+        // announce the epoch before loading the pointer, so the writer can't reclaim whatever we load
+        slot->epoch.store(publisher->global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        return PinnedBook(slot, publisher->latest.load(std::memory_order_seq_cst));
+    }
+};
+
+#endif // BOOK_VERSIONS_H
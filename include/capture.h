@@ -0,0 +1,259 @@
+// Header file for capture.cpp - binary recordings of depth snapshots, depth events and trades, for replay in backtests
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "depth_update.h"
+#include "trade.h"
+
+// first bytes of every capture file - the layout below is native endian, so captures are read on the machine type they were written on
+constexpr char CAPTURE_MAGIC[8] = {'C', 'P', 'P', 'C', 'A', 'P', '0', '1'};
+
+/**
+ * @brief Kind of a capture record
+ */
+enum class CaptureRecordType : uint8_t
+{
+    STREAM = 0,   // declares a stream ID - payload is the stream name
+    SNAPSHOT = 1, // the whole book after a snapshot load - payload is CaptureDepthHeader, bid levels, ask levels
+    DEPTH = 2,    // an applied depth event - payload is CaptureDepthHeader, bid levels, ask levels
+    TRADE = 3,    // a trade - payload is Trade
+};
+
+/**
+ * @brief Header in front of every record's payload
+ */
+struct CaptureRecordHeader
+{
+    uint8_t type;          // CaptureRecordType
+    uint8_t reserved;
+    uint16_t stream;       // stream ID, declared by an earlier STREAM record
+    uint32_t size;         // payload bytes after this header
+    int64_t local_time_ns; // wall clock time the record was written
+    int64_t event_time;    // exchange event time (ms)
+};
+
+/**
+ * @brief Update IDs and level counts in front of the levels of a SNAPSHOT or DEPTH record.
+ * For snapshots, first and final update IDs are both the snapshot's update ID.
+ */
+struct CaptureDepthHeader
+{
+    int64_t first_update_id;
+    int64_t final_update_id;
+    int64_t previous_final_update_id;
+    uint32_t bid_count;
+    uint32_t ask_count;
+};
+
+/**
+ * @brief One record read back from a capture. Reused between records, so the level vectors don't reallocate.
+ */
+struct CaptureRecord
+{
+    CaptureRecordType type;
+    uint16_t stream;
+    int64_t local_time_ns;
+    int64_t event_time;
+    // SNAPSHOT and DEPTH records - for snapshots the levels are the whole book and final_update_id is the snapshot's update ID
+    DepthUpdate depth;
+    // TRADE records
+    Trade trade;
+};
+
+/**
+ * @brief The CaptureWriter class appends records to a capture file from its own writer thread.
+ *
+ * Records are encoded straight into a single producer, single consumer byte ring - a whole record or nothing - and the writer thread
+ * moves them from the ring to the file, so the thread recording them (a book's apply thread, say) never calls into stdio or waits on
+ * the disk. A writer must only be written from one thread at a time - give each book (and each trade consumer) its own file.
+ * The file is flushed when flush_interval has passed since the last flush, and on stop().
+ * If the ring is full the record is dropped and counted. A dropped DEPTH or SNAPSHOT record leaves the stream's book unreplayable
+ * until its next snapshot, so the stream is flagged (see needs_snapshot()) for its book to record the whole book next.
+ */
+class CaptureWriter
+{
+private:
+    std::FILE *file;
+    std::vector<char> file_buffer;
+    int64_t flush_interval_ns;
+    std::chrono::milliseconds poll_interval;
+
+    // single producer (the recording thread), single consumer (the writer thread) - positions count bytes ever written and read
+    std::vector<char> ring;
+    uint64_t ring_mask;
+    alignas(64) std::atomic<uint64_t> ring_head{0};
+    alignas(64) std::atomic<uint64_t> ring_tail{0};
+
+    // recording thread only
+    uint16_t next_stream = 0;
+    std::vector<bool> snapshot_needed; // per stream, set when one of its book records was dropped
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> records_dropped{0};
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    bool reserve(size_t size);
+    void put(uint64_t &position, const void *data, size_t size);
+    void put_header(uint64_t &position, CaptureRecordType type, uint16_t stream, uint32_t size, int64_t event_time);
+    void commit(uint64_t position);
+    void drop(CaptureRecordType type, uint16_t stream);
+    size_t drain();
+    void run();
+
+public:
+    /**
+     * @brief Create (or truncate) a capture file - records are buffered until start()
+     * @param path Where to write the capture
+     * @param flush_interval Longest time records stay in the file's buffer
+     * @param ring_bytes Bytes of records that can wait for the writer thread - a power of two, larger than the biggest snapshot
+     * @param poll_interval How often the writer thread looks for records when the ring is empty
+     * @throws std::invalid_argument If ring_bytes isn't a power of two
+     * @throws std::runtime_error If the file can't be opened
+     */
+    explicit CaptureWriter(const std::string &path, std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000),
+                           size_t ring_bytes = 1 << 24, std::chrono::milliseconds poll_interval = std::chrono::milliseconds(10));
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    /**
+     * @brief Declare a stream - call before writing its records
+     * @param name The name the stream is looked up by on replay, e.g. "XRPUSDT@depth"
+     * @return The stream's ID in this file
+     */
+    uint16_t add_stream(const std::string &name);
+
+    /**
+     * @brief Record the whole book after a snapshot load - the levels are copied straight into the ring
+     * @param bids Bid side - anything with size(), price_at() and quantity_at() (see BookSide)
+     * @param asks Ask side
+     * @param update_id The snapshot's update ID
+     * @param event_time Exchange time the snapshot is published at (ms)
+     */
+    template <typename Bids, typename Asks>
+    void write_snapshot(uint16_t stream, const Bids &bids, const Asks &asks, int64_t update_id, int64_t event_time)
+    {
+        CaptureDepthHeader depth{update_id, update_id, -1, static_cast<uint32_t>(bids.size()), static_cast<uint32_t>(asks.size())};
+        uint32_t size = static_cast<uint32_t>(sizeof(depth) + (depth.bid_count + depth.ask_count) * sizeof(PriceLevel));
+        if (!reserve(sizeof(CaptureRecordHeader) + size))
+        {
+            drop(CaptureRecordType::SNAPSHOT, stream);
+            return;
+        }
+
+        uint64_t position = this->ring_head.load(std::memory_order_relaxed);
+        put_header(position, CaptureRecordType::SNAPSHOT, stream, size, event_time);
+        put(position, &depth, sizeof(depth));
+        for (size_t level = 0; level < bids.size(); level++)
+        {
+            PriceLevel bid{bids.price_at(level), bids.quantity_at(level)};
+            put(position, &bid, sizeof(bid));
+        }
+        for (size_t level = 0; level < asks.size(); level++)
+        {
+            PriceLevel ask{asks.price_at(level), asks.quantity_at(level)};
+            put(position, &ask, sizeof(ask));
+        }
+        commit(position);
+        this->snapshot_needed[stream] = false;
+    }
+
+    /**
+     * @brief Record an applied depth event
+     */
+    void write_depth(uint16_t stream, const DepthUpdate &update);
+
+    /**
+     * @brief Record a trade
+     */
+    void write_trade(uint16_t stream, const Trade &trade);
+
+    /**
+     * @brief Check if one of a stream's book records was dropped since its last snapshot - if so, record a snapshot instead of the next event
+     */
+    bool needs_snapshot(uint16_t stream) const;
+
+    /**
+     * @brief Start the writer thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the writer thread, writing every record already in the ring, and flush the file
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of records written, stream declarations included
+     */
+    uint64_t get_records() const;
+
+    /**
+     * @brief Get the number of records dropped because the ring was full
+     */
+    uint64_t get_records_dropped() const;
+};
+
+/**
+ * @brief The CaptureReader class reads a capture file back, record by record, in the order it was written.
+ * The file is read in large chunks and records are decoded straight out of the chunk, so reading costs about a memcpy per record.
+ * STREAM records are consumed by the reader - look names up with get_stream_name().
+ */
+class CaptureReader
+{
+private:
+    std::FILE *file;
+    std::vector<char> buffer;
+    // bytes of buffer holding unread data, and where the next record starts
+    size_t filled = 0;
+    size_t position = 0;
+    bool end_of_file = false;
+    std::vector<std::string> streams;
+    uint64_t records = 0;
+
+    bool ensure(size_t bytes);
+
+public:
+    /**
+     * @brief Open a capture file
+     * @throws std::runtime_error If the file can't be opened or isn't a capture
+     */
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    /**
+     * @brief Read the next SNAPSHOT, DEPTH or TRADE record
+     * @param record Where to store the record
+     * @return true if a record was read, false at the end of the file (a record cut short by the writer stopping counts as the end)
+     */
+    bool next(CaptureRecord &record);
+
+    /**
+     * @brief Get the name of a stream declared so far
+     */
+    const std::string &get_stream_name(uint16_t stream) const;
+
+    /**
+     * @brief Get the number of streams declared so far
+     */
+    size_t get_stream_count() const;
+
+    /**
+     * @brief Get the number of records read, stream declarations included
+     */
+    uint64_t get_records() const;
+};
+
+#endif // CAPTURE_H
@@ -2,7 +2,9 @@
 #ifndef CIRCULAR_BUFFER_H
 #define CIRCULAR_BUFFER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <iostream>
 #include <atomic>
 #include <array>
 
@@ -49,7 +51,9 @@ public:
         size_t current_write = write_index.load(std::memory_order_relaxed);
         // calculate next write index, aplying bit mask to wrap around buffer if necessary
         size_t next_write = (current_write + 1) & Mask;
+#ifdef DEBUG
         std::cout << "Next write index: " << next_write << std::endl;
+#endif
 
         // check if buffer is full - if next write index is equal to read index, buffer is full (i.e. we reached end of buffer)
         // Acquire ordering - synchronizes with release stores - using this when checking if buffer is full to ensure we see the latest writes
@@ -65,7 +69,9 @@ public:
         // update write index
         // Release ordering - synchronizes with acquire loads - ensure other threads see the write
         write_index.store(next_write, std::memory_order_release);
+#ifdef DEBUG
         std::cout << "Pushed value to buffer at index " << current_write << std::endl;
+#endif
         return true;
     }
 
@@ -79,7 +85,8 @@ public:
         // get current read index
         size_t current_read = read_index.load(std::memory_order_relaxed);
         // check if buffer is empty - if read index is equal to write index, buffer is empty
-        if (current_read == write_index.load(std::memory_order_relaxed))
+        // Acquire ordering - synchronizes with the release store in try_push, so the value written there is visible below
+        if (current_read == write_index.load(std::memory_order_acquire))
         {
             // buffer is empty
             return false;
@@ -90,7 +97,8 @@ public:
         // calculate next read index, applying bit mask to wrap around buffer if necessary
         size_t next_read = (current_read + 1) & Mask;
         // update read index
-        read_index.store(next_read, std::memory_order_relaxed);
+        // Release ordering - the writer must not reuse the slot until we've finished reading it
+        read_index.store(next_read, std::memory_order_release);
         return true;
     }
 
@@ -114,7 +122,8 @@ public:
             return false;
         }
 
-        value = std::move(buffer[current_read]); // used move for better performance
+        // copied, not moved - the item stays in the buffer for whoever pops it
+        value = buffer[current_read];
         return true;
     }
 
@@ -0,0 +1,309 @@
+// Header file for consolidated_book.cpp - one book merged from the top levels of several source books, with venue attribution
+#ifndef CONSOLIDATED_BOOK_H
+#define CONSOLIDATED_BOOK_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "depth_view.h"
+#include "level_change.h"
+#include "seqlock.h"
+
+// maximum number of source books merged into one consolidated book
+constexpr size_t CONSOLIDATED_MAX_VENUES = 8;
+
+/**
+ * @brief One consolidated price level - the total across venues, and each venue's share
+ */
+struct ConsolidatedLevel
+{
+    double price;
+    double quantity;                                   // total quantity across every venue
+    uint32_t venue_mask;                               // bit v set if venue v has quantity at this price
+    uint32_t reserved;
+    double venue_quantities[CONSOLIDATED_MAX_VENUES]; // quantity per venue, indexed by the ID add_source() returned
+};
+
+/**
+ * @brief Top levels of the consolidated book with venue attribution, published through a SeqLock like DepthView
+ */
+struct ConsolidatedDepthView
+{
+    int64_t update_id;  // consolidation sequence number, incremented on every publish
+    int64_t event_time; // latest exchange event time (ms) of any source
+    uint32_t bid_count; // valid entries in bids
+    uint32_t ask_count; // valid entries in asks
+    uint32_t venue_count;
+    uint32_t reserved;
+    ConsolidatedLevel bids[DEPTH_VIEW_LEVELS]; // best bid first
+    ConsolidatedLevel asks[DEPTH_VIEW_LEVELS]; // best ask first
+};
+
+/**
+ * @brief One side of the consolidated book - sorted arrays ordered worst -> best like BookSide, with a quantity column per venue
+ * @tparam IsBid true for the bid side (best = highest price), false for the ask side (best = lowest price)
+ */
+template <bool IsBid>
+class ConsolidatedSide
+{
+private:
+    // price of each level, ordered worst -> best
+    std::vector<double> prices;
+    // total quantity of each level, same index as prices
+    std::vector<double> totals;
+    // each venue's quantity at each level, same index as prices
+    std::vector<std::array<double, CONSOLIDATED_MAX_VENUES>> venue_quantities;
+
+    static bool is_worse(double lhs, double rhs)
+    {
+        if constexpr (IsBid)
+        {
+            return lhs < rhs;
+        }
+        else
+        {
+            return lhs > rhs;
+        }
+    }
+
+public:
+    ConsolidatedSide()
+    {
+        prices.reserve(256);
+        totals.reserve(256);
+        venue_quantities.reserve(256);
+    }
+
+    /**
+     * @brief Set one venue's quantity at a price, inserting or removing the level as required
+     * @param price The price level to update
+     * @param venue The venue ID
+     * @param quantity The venue's new quantity at the price, zero removes the venue from the level
+     * @param total Set to the level's total quantity after the update (zero if the level was removed)
+     * @return The level's total quantity before the update (zero if the level did not exist)
+     */
+    double update(double price, uint8_t venue, double quantity, double &total)
+    {
+        auto it = std::lower_bound(prices.begin(), prices.end(), price, is_worse);
+        size_t index = static_cast<size_t>(it - prices.begin());
+
+        // existing level - change the venue's share, the total is re-summed rather than adjusted so rounding can't accumulate
+        if (it != prices.end() && *it == price)
+        {
+            double previous = totals[index];
+            auto &shares = venue_quantities[index];
+            shares[venue] = quantity;
+
+            total = 0;
+            for (double share : shares)
+            {
+                total += share;
+            }
+
+            if (total > 0)
+            {
+                totals[index] = total;
+            }
+            else
+            {
+                total = 0;
+                prices.erase(it);
+                totals.erase(totals.begin() + index);
+                venue_quantities.erase(venue_quantities.begin() + index);
+            }
+            return previous;
+        }
+
+        // new level - only insert if it has a quantity
+        total = quantity > 0 ? quantity : 0.0;
+        if (quantity > 0)
+        {
+            std::array<double, CONSOLIDATED_MAX_VENUES> shares{};
+            shares[venue] = quantity;
+            prices.insert(it, price);
+            totals.insert(totals.begin() + index, quantity);
+            venue_quantities.insert(venue_quantities.begin() + index, shares);
+        }
+        return 0.0;
+    }
+
+    bool empty() const
+    {
+        return prices.empty();
+    }
+
+    size_t size() const
+    {
+        return prices.size();
+    }
+
+    /**
+     * @brief Copy the top levels as plain price/total pairs, best price first
+     * @return The number of levels copied
+     */
+    size_t copy_top(PriceLevel *out, size_t max_levels) const
+    {
+        size_t count = std::min(max_levels, prices.size());
+        for (size_t depth = 0; depth < count; depth++)
+        {
+            size_t index = prices.size() - 1 - depth;
+            out[depth].price = prices[index];
+            out[depth].quantity = totals[index];
+        }
+        return count;
+    }
+
+    /**
+     * @brief Copy the top levels with their venue breakdown, best price first
+     * @return The number of levels copied
+     */
+    size_t copy_top(ConsolidatedLevel *out, size_t max_levels) const
+    {
+        size_t count = std::min(max_levels, prices.size());
+        for (size_t depth = 0; depth < count; depth++)
+        {
+            size_t index = prices.size() - 1 - depth;
+            ConsolidatedLevel &level = out[depth];
+            level.price = prices[index];
+            level.quantity = totals[index];
+            level.venue_mask = 0;
+            level.reserved = 0;
+            for (size_t venue = 0; venue < CONSOLIDATED_MAX_VENUES; venue++)
+            {
+                level.venue_quantities[venue] = venue_quantities[index][venue];
+                if (venue_quantities[index][venue] > 0)
+                {
+                    level.venue_mask |= 1u << venue;
+                }
+            }
+        }
+        return count;
+    }
+};
+
+/**
+ * @brief The ConsolidatedBook class merges the top levels of several source books (spot, futures, other venues) into one book.
+ *
+ * It runs on its own thread and only reads the sources' SeqLock depth views, so it can't slow their apply threads down.
+ * When a source publishes a new view, it is diffed against the last view taken from that source (one merge walk over the top N)
+ * and only the changed levels are applied, rather than rebuilding the merged book. The consolidated top N is exact: a level in
+ * the merged top N can't be below any source's top N.
+ * Readers use the same API as a single OrderBook - get_depth_view() and add_level_listener() - so the DepthServer and
+ * MulticastPublisher can serve it unchanged, and get_consolidated_view() adds per-venue attribution.
+ */
+class ConsolidatedBook
+{
+private:
+    // a book being merged in
+    struct Source
+    {
+        std::string venue;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version; // view version last merged
+        DepthView last_view;   // view last merged - the next one is diffed against it
+    };
+
+    std::vector<Source> sources;
+    ConsolidatedSide<true> bids;
+    ConsolidatedSide<false> asks;
+
+    // consolidation sequence number and latest source event time, consolidator thread only
+    int64_t sequence = 0;
+    int64_t event_time = 0;
+
+    SeqLock<DepthView> depth_view;
+    SeqLock<ConsolidatedDepthView> consolidated_view;
+    // callbacks invoked on the consolidator thread for every change to a consolidated level's total
+    std::vector<std::pair<LevelListener, void *>> level_listeners;
+
+    std::chrono::microseconds poll_interval;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> levels_changed{0};
+
+    template <bool IsBid>
+    size_t merge_side(uint8_t venue, const PriceLevel *previous, uint32_t previous_count, const PriceLevel *current, uint32_t current_count,
+                      ConsolidatedSide<IsBid> &side, int64_t source_event_time);
+    size_t merge_source(uint8_t venue, Source &source, const DepthView &view);
+    void publish();
+    void run();
+
+public:
+    /**
+     * @brief Construct a new ConsolidatedBook
+     * @param poll_interval How long the consolidator thread sleeps when no source has published
+     */
+    explicit ConsolidatedBook(std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~ConsolidatedBook();
+
+    ConsolidatedBook(const ConsolidatedBook &) = delete;
+    ConsolidatedBook &operator=(const ConsolidatedBook &) = delete;
+
+    /**
+     * @brief Merge a book into the consolidated book - must be called before start()
+     * @param book The source book - anything with get_depth_view()
+     * @param venue Venue name used for attribution
+     * @return The venue ID, the index into ConsolidatedLevel::venue_quantities
+     */
+    template <typename Book>
+    uint8_t add_source(Book &book, const std::string &venue)
+    {
+        return add_source(venue, book.get_depth_view());
+    }
+
+    /**
+     * @brief Merge a published depth view into the consolidated book - must be called before start()
+     * @throws std::runtime_error If CONSOLIDATED_MAX_VENUES sources are already registered
+     */
+    uint8_t add_source(const std::string &venue, const SeqLock<DepthView> &view);
+
+    /**
+     * @brief Get the venue name for a venue ID
+     */
+    const std::string &get_venue(uint8_t venue) const;
+
+    /**
+     * @brief Get the SeqLock the consolidated top levels are published through - totals only, same as a single book
+     */
+    const SeqLock<DepthView> &get_depth_view() const;
+
+    /**
+     * @brief Get the SeqLock the consolidated top levels are published through, with each venue's share of every level
+     */
+    const SeqLock<ConsolidatedDepthView> &get_consolidated_view() const;
+
+    /**
+     * @brief Register a callback for every change to a consolidated level's total - must be called before start().
+     * Listeners run on the consolidator thread, update_id in the change is the consolidation sequence number.
+     */
+    void add_level_listener(LevelListener listener, void *user);
+
+    /**
+     * @brief Merge any sources that published since the last call and publish the result - what the consolidator thread runs
+     * @return The number of consolidated levels that changed
+     */
+    size_t poll_sources();
+
+    /**
+     * @brief Start the consolidator thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the consolidator thread
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of consolidated level changes applied so far
+     */
+    uint64_t get_levels_changed() const;
+};
+
+#endif // CONSOLIDATED_BOOK_H
@@ -0,0 +1,145 @@
+// Fixed-size history of the level updates most recently applied to the order book
+#ifndef DELTA_HISTORY_H
+#define DELTA_HISTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief A single price level update, tagged with the update IDs of the event it came from
+ */
+struct DeltaRecord
+{
+    int64_t first_update_id; // first update ID of the source event
+    int64_t final_update_id; // final update ID of the source event
+    double price;            // price level updated
+    double quantity;         // new total quantity at the price level, zero means the level was removed
+    bool is_bid;             // true for a bid level, false for an ask level
+    bool reload;             // true for a marker left when the book was reloaded at final_update_id, rather than a level update
+};
+
+/**
+ * @brief The DeltaHistory class retains the last Capacity level updates applied to the order book.
+ * It has a single writer (the order book apply thread) which never blocks - old records are simply overwritten.
+ * Readers copy records out and then re-check the write position, discarding anything that may have been overwritten while copying.
+ * @tparam Capacity Number of records retained, must be a power of 2
+ */
+template <size_t Capacity>
+class DeltaHistory
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+private:
+    // record storage, indexed by (record number & Mask)
+    std::vector<DeltaRecord> records;
+    // total number of records ever written - the next record number to write
+    alignas(64) std::atomic<uint64_t> head{0};
+
+    static constexpr uint64_t Mask = Capacity - 1;
+
+public:
+    /**
+     * @brief Construct a new DeltaHistory, allocating all record storage up front
+     */
+    DeltaHistory() : records(Capacity) {}
+
+    /**
+     * @brief Append a level update - must only be called from the single writer thread
+     */
+    void record(int64_t first_update_id, int64_t final_update_id, double price, double quantity, bool is_bid)
+    {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        records[current & Mask] = DeltaRecord{first_update_id, final_update_id, price, quantity, is_bid, false};
+        // release so readers that see the new head also see the record
+        head.store(current + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Mark that the book was replaced by a snapshot - must only be called from the single writer thread.
+     * The records before the marker don't lead to the book after it (the updates in between were never applied), so no range is
+     * rolled across it.
+     * @param update_id The update ID of the snapshot the book was reloaded from
+     */
+    void mark_reload(int64_t update_id)
+    {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        records[current & Mask] = DeltaRecord{update_id, update_id, 0, 0, false, true};
+        head.store(current + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy all retained records with after_update_id < final_update_id <= up_to_update_id, oldest first
+     * @param after_update_id Only copy records from events after this update ID
+     * @param up_to_update_id Only copy records from events up to and including this update ID
+     * @param out Vector the records are appended to (cleared first)
+     * @return true if the history still covers every event after after_update_id, false if some of those records have already been overwritten
+     * or the book was reloaded between the two update IDs
+     */
+    bool copy_range(int64_t after_update_id, int64_t up_to_update_id, std::vector<DeltaRecord> &out) const
+    {
+        out.clear();
+
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > Capacity ? end - Capacity : 0;
+
+        // the oldest retained record must come from an event at or before after_update_id, otherwise we can't tell if records are missing
+        bool covered = false;
+        // oldest record number we rely on - used below to detect the writer lapping us
+        uint64_t oldest_used = begin;
+        for (uint64_t i = begin; i < end; i++)
+        {
+            const DeltaRecord &rec = records[i & Mask];
+            if (rec.reload)
+            {
+                // the book was reloaded - a reload at or before after_update_id starts a complete history, one inside the range breaks it
+                if (rec.final_update_id > up_to_update_id)
+                {
+                    break;
+                }
+                if (rec.final_update_id > after_update_id)
+                {
+                    return false;
+                }
+                covered = true;
+                oldest_used = i;
+                out.clear();
+                continue;
+            }
+            if (rec.final_update_id <= after_update_id)
+            {
+                covered = true;
+                oldest_used = i;
+                continue;
+            }
+            if (rec.final_update_id > up_to_update_id)
+            {
+                break;
+            }
+            out.push_back(rec);
+        }
+
+        // re-check the head - the writer may have lapped the start of our range while we were copying
+        // the slot for record number (latest) may be mid-write, so anything at or before (latest - Capacity) is suspect
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t latest = head.load(std::memory_order_relaxed);
+        if (latest + 1 > oldest_used + Capacity)
+        {
+            return false;
+        }
+
+        // nothing newer than after_update_id is also fine, as long as we saw the history reach that far
+        return covered || (out.empty() && end == 0);
+    }
+
+    /**
+     * @brief Get the total number of records written so far
+     */
+    uint64_t total_records() const
+    {
+        return head.load(std::memory_order_acquire);
+    }
+};
+
+#endif // DELTA_HISTORY_H
@@ -0,0 +1,219 @@
+// Header file for depth_heatmap.cpp - time x price liquidity grids kept from level changes, with closed rows compressed to a binary file
+#ifndef DEPTH_HEATMAP_H
+#define DEPTH_HEATMAP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "book_versions.h"
+#include "circular_buffer.h"
+#include "depth_view.h"
+#include "level_change.h"
+
+// most price buckets in a row
+constexpr size_t HEATMAP_MAX_BUCKETS = 512;
+// price buckets whose quantity is kept, centred on the rows - must be a power of two, and at least twice HEATMAP_MAX_BUCKETS
+constexpr size_t HEATMAP_TRACKED_BUCKETS = 2048;
+// closed rows that can wait for the writer, per symbol
+constexpr size_t HEATMAP_ROW_QUEUE_SIZE = 64;
+// most rows closed at once when a book has been quiet for several rows - after a longer silence the rows in between are left out
+constexpr int64_t HEATMAP_MAX_FILL_ROWS = 60;
+// first bytes of every heatmap file - native endian, like captures
+constexpr char HEATMAP_MAGIC[8] = {'C', 'P', 'P', 'H', 'M', 'P', '0', '1'};
+
+/**
+ * @brief Header of each row in a heatmap file, followed by size bytes of encoded quantities.
+ * Each of the file's buckets-per-row quantities is a float, XORed with the previous row's float for the same price bucket (0 for a
+ * keyframe, or a bucket the previous row didn't cover), and written as alternating varints: a run of unchanged buckets, then the
+ * XOR of the next changed one. An unchanged bucket costs nothing beyond its run, and a small change leaves the high bits - sign, exponent
+ * and top of the mantissa - zero, so its varint is short.
+ */
+struct HeatmapRowHeader
+{
+    uint16_t symbol;      // index of the symbol in the file header
+    uint8_t keyframe;     // 1 if the row is encoded against zeros, so decoding can start from it
+    uint8_t reserved;
+    uint32_t size;        // bytes of encoded quantities after this header
+    int64_t start_time;   // exchange time the row starts at (ms) - it covers row_ms from there
+    int64_t first_bucket; // price bucket of the row's first quantity - bucket b covers [b * price_bucket, (b + 1) * price_bucket)
+};
+
+/**
+ * @brief One row read back from a heatmap file
+ */
+struct HeatmapRow
+{
+    int64_t start_time;
+    int64_t first_bucket;
+    std::vector<float> quantities; // time-weighted average quantity resting in each bucket over the row, bids and asks together
+};
+
+/**
+ * @brief One symbol's rows read back from a heatmap file
+ */
+struct HeatmapSeries
+{
+    std::string symbol;
+    double price_bucket;
+    int64_t row_ms;
+    std::vector<HeatmapRow> rows;
+};
+
+/**
+ * @brief The DepthHeatmap class builds a liquidity heatmap per symbol - the quantity resting in each price bucket over each time bucket.
+ *
+ * The grid is kept up to date from the book's level changes on its apply thread: each change moves its price bucket's quantity by the
+ * change in the level's quantity, and adds the time the old quantity rested to the bucket's running integral, so a row's cells are
+ * time-weighted averages at O(1) per change, without ever walking the book. When an event's time passes the end of a row, the row's
+ * buckets around the mid are closed, queued for the writer thread, and the next row starts centred on the current mid.
+ * Quantities are kept for HEATMAP_TRACKED_BUCKETS buckets around the rows, and read from the full book when it is (re)loaded or the
+ * mid drifts far enough that the rows need buckets that weren't kept - so add_book() turns on the book's full versions.
+ * The writer thread compresses each row against the symbol's previous one (see HeatmapRowHeader) and appends it to the file, so a
+ * viewer reads hours of rows straight through. Rows are timed by exchange event time, so a row closes on the first event after it ends.
+ */
+class DepthHeatmap
+{
+private:
+    struct Bucket
+    {
+        double quantity;
+        double integral; // quantity x ms rested since the row started
+        int64_t since;   // time the quantity was last added to the integral
+    };
+
+    struct ClosedRow
+    {
+        int64_t start_time;
+        int64_t first_bucket;
+        float quantities[HEATMAP_MAX_BUCKETS];
+    };
+
+    struct Symbol
+    {
+        DepthHeatmap *owner;
+        uint16_t id;
+        std::string name;
+        double price_bucket;
+        std::unique_ptr<BookReader> reader;
+
+        // apply thread only
+        Bucket buckets[HEATMAP_TRACKED_BUCKETS];
+        int64_t tracked_first = 0; // price bucket of the first tracked bucket
+        bool tracking = false;     // false until the book has been loaded
+        double mid = 0;
+        int64_t row_start = -1;    // -1 until the first row starts
+        int64_t row_first = 0;     // price bucket of the row's first quantity
+
+        // single producer (the apply thread), single consumer (the writer thread)
+        CircularBuffer<ClosedRow, HEATMAP_ROW_QUEUE_SIZE> rows;
+
+        // writer thread only - the last row written, to encode the next against
+        std::vector<float> previous;
+        int64_t previous_first = 0;
+        uint64_t rows_written = 0;
+    };
+
+    std::string path;
+    int64_t row_ms;
+    uint32_t row_buckets;
+    uint32_t keyframe_interval;
+    std::chrono::milliseconds poll_interval;
+
+    std::vector<std::unique_ptr<Symbol>> symbols;
+
+    std::FILE *file = nullptr;
+    // encoded quantities of the row being written, reused between rows
+    std::vector<uint8_t> encoded;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> rows_closed{0};
+    std::atomic<uint64_t> rows_dropped{0};
+    std::atomic<uint64_t> bytes_written{0};
+
+    Symbol &add_symbol(const std::string &symbol, double price_bucket);
+    int64_t bucket_of(const Symbol &symbol, double price) const;
+    void on_level_change(Symbol &symbol, const LevelChange &change);
+    void on_book_update(Symbol &symbol, const DepthView &view, bool reloaded);
+    void add_quantity(Symbol &symbol, int64_t bucket, double quantity, int64_t time);
+    void load_book(Symbol &symbol, int64_t tracked_first, int64_t time);
+    void advance(Symbol &symbol, int64_t time);
+    void open_row(Symbol &symbol, int64_t start_time);
+    void close_row(Symbol &symbol);
+    void write_row(Symbol &symbol, const ClosedRow &row);
+    size_t drain();
+    void run();
+
+public:
+    /**
+     * @brief Construct a new DepthHeatmap
+     * @param path File to write the rows to (replaced if it exists)
+     * @param row_interval Time covered by each row
+     * @param row_buckets Price buckets per row, centred on the mid when the row starts
+     * @param keyframe_interval Rows between keyframes - rows encoded on their own, so a viewer can start decoding there
+     * @param poll_interval How often the writer thread looks for closed rows
+     * @throws std::invalid_argument If row_buckets is 0 or above HEATMAP_MAX_BUCKETS, or an interval isn't positive
+     */
+    DepthHeatmap(const std::string &path, std::chrono::milliseconds row_interval = std::chrono::milliseconds(1000), uint32_t row_buckets = 256,
+                 uint32_t keyframe_interval = 60, std::chrono::milliseconds poll_interval = std::chrono::milliseconds(100));
+    ~DepthHeatmap();
+
+    DepthHeatmap(const DepthHeatmap &) = delete;
+    DepthHeatmap &operator=(const DepthHeatmap &) = delete;
+
+    /**
+     * @brief Build a heatmap of a book - must be called before start() and before the book's apply thread starts.
+     * Turns on the book's full versions, which the heatmap reads when the book is (re)loaded.
+     * @param book The book - anything with add_level_listener(), add_update_listener(), enable_versioned_snapshots() and get_versions()
+     * @param symbol The symbol's name in the file
+     * @param price_bucket Price range of each bucket - a multiple of the tick size
+     * @return The symbol's index in the file
+     * @throws std::invalid_argument If price_bucket isn't positive
+     */
+    template <typename Book>
+    uint16_t add_book(Book &book, const std::string &symbol, double price_bucket)
+    {
+        Symbol &added = add_symbol(symbol, price_bucket);
+        book.enable_versioned_snapshots();
+        added.reader = std::make_unique<BookReader>(book.get_versions());
+        book.add_level_listener(&DepthHeatmap::level_change_callback, &added);
+        book.add_update_listener(&DepthHeatmap::book_update_callback, &added);
+        return added.id;
+    }
+
+    // listener trampolines
+    static void level_change_callback(const LevelChange &change, void *user);
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+
+    /**
+     * @brief Open the file, write the symbols to its header and start the writer thread
+     * @throws std::runtime_error If the file can't be opened
+     */
+    void start();
+
+    /**
+     * @brief Stop the writer thread, writing the rows already closed - the rows still open are left out
+     */
+    void stop();
+
+    /**
+     * @brief Read a symbol's rows back from a heatmap file
+     * @throws std::runtime_error If the file can't be opened, isn't a heatmap or doesn't have the symbol
+     */
+    static HeatmapSeries read(const std::string &path, const std::string &symbol);
+
+    uint64_t get_rows_closed() const;
+
+    /**
+     * @brief Get the number of rows dropped because the writer fell behind
+     */
+    uint64_t get_rows_dropped() const;
+
+    uint64_t get_bytes_written() const;
+};
+
+#endif // DEPTH_HEATMAP_H
@@ -0,0 +1,115 @@
+// Header file for depth_ladder.cpp - a terminal depth ladder per symbol, redrawn at a fixed rate from the published depth views
+#ifndef DEPTH_LADDER_H
+#define DEPTH_LADDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "depth_view.h"
+#include "seqlock.h"
+#include "sync_stats.h"
+
+// switches the terminal to the alternate screen and hides the cursor - written by start()
+constexpr char DEPTH_LADDER_ENTER[] = "\x1b[?1049h\x1b[?25l";
+// gives the terminal back - written by stop(), and plain bytes so a signal handler can write() it too if the process is killed mid-frame
+constexpr char DEPTH_LADDER_RESTORE[] = "\x1b[?25h\x1b[?1049l";
+
+/**
+ * @brief The DepthLadder class draws the top levels of each book as a ladder in the terminal, with its spread, update rate, lag and
+ * sync state.
+ *
+ * The ladder has its own thread that wakes every refresh interval, copies each book's depth view out of its SeqLock and reads its sync
+ * state and counters from their atomics. It never writes anything the apply threads read and never waits on them, so the only cost to
+ * ingestion is the odd cache line shared with a reader a few times a second. The update rate is the number of views published
+ * since the last frame - the SeqLock version counts them. Each frame is built in one string and written to the terminal with a
+ * single write(), drawn over the last frame in the alternate screen, so other output to the same terminal will be drawn over -
+ * send logs elsewhere while the ladder runs.
+ */
+class DepthLadder
+{
+private:
+    struct Ladder
+    {
+        std::string name;
+        const SeqLock<DepthView> *view;
+        const void *book;
+        SyncState (*sync_state)(const void *book);
+        SyncStats (*sync_stats)(const void *book);
+        int price_decimals;
+        uint64_t last_version = 0;
+    };
+
+    std::vector<Ladder> ladders;
+    size_t levels;
+    std::chrono::milliseconds refresh_interval;
+    int output_fd;
+    std::chrono::steady_clock::time_point last_frame;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> frames{0};
+
+    void add_ladder(Ladder ladder);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new DepthLadder
+     * @param levels Levels shown per side, at most DEPTH_VIEW_LEVELS
+     * @param refresh_interval Time between frames
+     * @param output_fd Terminal to draw on
+     * @throws std::invalid_argument If levels is 0 or above DEPTH_VIEW_LEVELS
+     */
+    explicit DepthLadder(size_t levels = 10, std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(250), int output_fd = 1);
+    ~DepthLadder();
+
+    DepthLadder(const DepthLadder &) = delete;
+    DepthLadder &operator=(const DepthLadder &) = delete;
+
+    /**
+     * @brief Show a book - must be called before start()
+     * @param book The book - anything with get_depth_view(), get_sync_state() and get_sync_stats()
+     * @param symbol The name shown above the ladder
+     * @param price_decimals Decimals prices are shown with
+     */
+    template <typename Book>
+    void add_book(const Book &book, const std::string &symbol, int price_decimals)
+    {
+        Ladder ladder;
+        ladder.name = symbol;
+        ladder.view = &book.get_depth_view();
+        ladder.book = &book;
+        ladder.sync_state = [](const void *book)
+        {
+            return static_cast<const Book *>(book)->get_sync_state();
+        };
+        ladder.sync_stats = [](const void *book)
+        {
+            return static_cast<const Book *>(book)->get_sync_stats();
+        };
+        ladder.price_decimals = price_decimals;
+        add_ladder(ladder);
+    }
+
+    /**
+     * @brief Build the next frame - what the ladder thread draws. Rates are over the time since the last call.
+     */
+    std::string render();
+
+    /**
+     * @brief Switch the terminal to the alternate screen and start the ladder thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the ladder thread and give the terminal back
+     */
+    void stop();
+
+    uint64_t get_frames() const;
+};
+
+#endif // DEPTH_LADDER_H
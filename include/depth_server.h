@@ -0,0 +1,136 @@
+// Header file for depth_server.cpp - local Unix domain socket server for order book depth and BBO updates
+#ifndef DEPTH_SERVER_H
+#define DEPTH_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "depth_view.h"
+#include "seqlock.h"
+
+/*
+ * Wire format - every frame in both directions is:
+ *   uint32 length   number of bytes that follow (type + payload)
+ *   uint8  type     DepthMessageType
+ *   payload
+ * Integers and doubles are little endian, strings are a uint8 length followed by the bytes (no terminator).
+ */
+enum class DepthMessageType : uint8_t
+{
+    REQUEST_DEPTH = 0x01,   // client: string symbol, uint16 levels
+    SUBSCRIBE_BBO = 0x02,   // client: string symbol
+    UNSUBSCRIBE_BBO = 0x03, // client: string symbol
+    DEPTH = 0x81,           // server: string symbol, int64 update_id, int64 event_time, uint16 bid_count, uint16 ask_count,
+                            //         then (double price, double quantity) for each bid, best first, then each ask, best first
+    BBO = 0x82,             // server: string symbol, int64 update_id, int64 event_time, double bid, double bid_qty, double ask, double ask_qty
+    ERROR = 0xFF,           // server: string message
+};
+
+// maximum number of connected clients
+constexpr size_t DEPTH_SERVER_MAX_CLIENTS = 64;
+// a client with more than this many bytes waiting to be sent is disconnected
+constexpr size_t DEPTH_SERVER_MAX_PENDING_BYTES = 1 << 20;
+// largest request frame accepted from a client
+constexpr size_t DEPTH_SERVER_MAX_REQUEST_BYTES = 256;
+
+/**
+ * @brief The DepthServer class answers "top N for symbol S" requests and streams BBO changes to local clients over a Unix domain socket.
+ *
+ * It runs on its own thread and only reads the SeqLock depth views the order books publish, so it can't slow the apply threads down.
+ * Every poll interval it checks each book's view version, and queues a BBO frame to each subscribed client when the best bid/ask changed.
+ * Frames are appended to a per-client output buffer and flushed with one write per client per loop; a client that stops reading
+ * is disconnected once its buffer passes DEPTH_SERVER_MAX_PENDING_BYTES, rather than buffering forever - including a client that
+ * pipelines requests faster than it reads the replies, which stops being read as soon as it passes the limit. Input is parsed as it arrives,
+ * and a client that sends more than DEPTH_SERVER_MAX_REQUEST_BYTES without completing a request is disconnected too.
+ */
+class DepthServer
+{
+private:
+    // a book the server can answer requests for
+    struct ServedBook
+    {
+        std::string symbol;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version; // view version when the BBO was last checked
+        PriceLevel best_bid;   // BBO last sent to subscribers
+        PriceLevel best_ask;
+    };
+
+    // a connected client
+    struct Client
+    {
+        int fd;
+        std::vector<char> in;                 // bytes received but not yet parsed into a full frame - at most one request
+        std::vector<char> out;                // bytes waiting to be sent
+        size_t out_sent;                      // bytes at the front of out already sent
+        std::vector<bool> bbo_subscriptions;  // indexed like books
+        bool closing;                         // disconnect at the end of this loop
+    };
+
+    // path of the socket file
+    std::string socket_path;
+    // listening socket
+    int listen_fd = -1;
+    // how long the loop waits for socket activity before checking the books for BBO changes
+    std::chrono::microseconds poll_interval;
+
+    std::vector<ServedBook> books;
+    std::vector<Client> clients;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    // clients disconnected because they fell too far behind
+    std::atomic<uint64_t> slow_client_disconnects{0};
+
+    int find_book(const std::string &symbol) const;
+    void accept_clients();
+    void read_client(Client &client);
+    void handle_frames(Client &client);
+    void handle_request(Client &client, DepthMessageType type, const char *payload, size_t len);
+    void queue_depth(Client &client, const ServedBook &book, uint16_t levels);
+    void queue_error(Client &client, const std::string &message);
+    void publish_bbo_changes();
+    bool over_pending_limit(Client &client);
+    void flush_client(Client &client);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new DepthServer
+     * @param socket_path Path of the Unix domain socket file to listen on (replaced if it exists)
+     * @param poll_interval How often books are checked for BBO changes
+     */
+    DepthServer(const std::string &socket_path, std::chrono::microseconds poll_interval = std::chrono::microseconds(500));
+    ~DepthServer();
+
+    DepthServer(const DepthServer &) = delete;
+    DepthServer &operator=(const DepthServer &) = delete;
+
+    /**
+     * @brief Make a book available to clients - must be called before start()
+     * @param symbol The symbol clients request the book by
+     * @param view The book's published depth view
+     */
+    void add_book(const std::string &symbol, const SeqLock<DepthView> &view);
+
+    /**
+     * @brief Bind the socket and start the server thread
+     * @throws std::runtime_error If the socket can't be created or bound
+     */
+    void start();
+
+    /**
+     * @brief Stop the server thread, disconnect every client and remove the socket file
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of clients disconnected for not keeping up
+     */
+    uint64_t get_slow_client_disconnects() const;
+};
+
+#endif
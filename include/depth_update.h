@@ -0,0 +1,33 @@
+// Venue-neutral depth update, decoded from the stream by a venue adapter and applied by the book engine
+#ifndef DEPTH_UPDATE_H
+#define DEPTH_UPDATE_H
+
+#include <cstdint>
+#include <vector>
+#include "depth_view.h"
+
+/**
+ * @brief One incremental depth event, with prices and quantities already decoded.
+ * A quantity of zero removes the level. Levels are reused between events (see CircularBuffer), so decoders should clear() rather than reallocate.
+ */
+struct DepthUpdate
+{
+    int64_t event_time = 0;                // exchange event time (ms)
+    int64_t first_update_id = 0;           // first update ID in the event
+    int64_t final_update_id = 0;           // final update ID in the event
+    int64_t previous_final_update_id = -1; // final update ID of the venue's previous event, -1 if the venue doesn't send it
+    std::vector<PriceLevel> bids;          // bid levels to update
+    std::vector<PriceLevel> asks;          // ask levels to update
+};
+
+/**
+ * @brief What a venue's sequencing rules say to do with an event
+ */
+enum class SequenceCheck : uint8_t
+{
+    STALE, // already covered by the local book - drop it
+    APPLY, // continues the local book - apply it
+    GAP,   // updates were missed between the local book and this event
+};
+
+#endif // DEPTH_UPDATE_H
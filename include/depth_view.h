@@ -0,0 +1,83 @@
+// Fixed-size top-of-book view that the order book publishes after every applied update
+#ifndef DEPTH_VIEW_H
+#define DEPTH_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+
+// number of levels per side published in a DepthView
+constexpr size_t DEPTH_VIEW_LEVELS = 20;
+
+/**
+ * @brief A single price level - price and total quantity at that price
+ */
+struct PriceLevel
+{
+    double price;
+    double quantity;
+};
+
+/**
+ * @brief The top levels of the order book at a given update ID.
+ * Trivially copyable so it can be published through a SeqLock.
+ */
+struct DepthView
+{
+    int64_t update_id;                    // final update ID of the last event applied to the book
+    int64_t event_time;                   // exchange event time of the last event applied (ms)
+    uint32_t bid_count;                   // number of valid entries in bids
+    uint32_t ask_count;                   // number of valid entries in asks
+    PriceLevel bids[DEPTH_VIEW_LEVELS];   // best bid first
+    PriceLevel asks[DEPTH_VIEW_LEVELS];   // best ask first
+};
+
+/**
+ * @brief Age of a single price level - see BookSide level age tracking
+ */
+struct LevelAge
+{
+    int64_t created_time;  // event time (ms) the level was created, 0 if it came from a snapshot
+    int64_t modified_time; // event time (ms) the level's quantity last changed, 0 if unchanged since a snapshot
+    uint32_t update_count; // updates to the level since it was created (or loaded)
+    uint32_t reserved;
+};
+
+/**
+ * @brief Ages of the top levels of a book that tracks level age, published alongside its DepthView and indexed the same way
+ */
+struct LevelAgeView
+{
+    int64_t update_id;                  // final update ID of the last event applied to the book
+    uint32_t bid_count;                 // number of valid entries in bids
+    uint32_t ask_count;                 // number of valid entries in asks
+    LevelAge bids[DEPTH_VIEW_LEVELS];   // best bid first
+    LevelAge asks[DEPTH_VIEW_LEVELS];   // best ask first
+};
+
+/**
+ * @brief Hash the populated levels of a DepthView (FNV-1a over the raw level bytes)
+ * Two views with the same levels always produce the same hash, so this can be used for a quick equality check before comparing level by level
+ * @param view The view to hash
+ * @return The 64 bit hash
+ */
+inline uint64_t hash_depth_view(const DepthView &view)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void *data, size_t len)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < len; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(&view.bid_count, sizeof(view.bid_count));
+    mix(&view.ask_count, sizeof(view.ask_count));
+    mix(view.bids, sizeof(PriceLevel) * view.bid_count);
+    mix(view.asks, sizeof(PriceLevel) * view.ask_count);
+    return hash;
+}
+
+#endif // DEPTH_VIEW_H
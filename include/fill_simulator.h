@@ -0,0 +1,171 @@
+// Header file for fill_simulator.cpp - simulated matching of our own orders against a replayed book, with queue position
+#ifndef FILL_SIMULATOR_H
+#define FILL_SIMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "depth_view.h"
+#include "level_change.h"
+#include "order.h"
+#include "trade.h"
+
+/**
+ * @brief State of a simulated order after an update
+ */
+enum class SimOrderStatus : uint8_t
+{
+    RESTING,          // accepted and resting, nothing filled yet
+    PARTIALLY_FILLED, // filled in part, the rest is resting
+    FILLED,           // completely filled
+    CANCELLED,        // cancelled, by request or because an IOC or market order couldn't fill the rest
+    REJECTED,         // cancel for an order that isn't live
+};
+
+/**
+ * @brief Something that happened to a simulated order
+ */
+struct SimOrderUpdate
+{
+    uint64_t order_id;
+    SimOrderStatus status;
+    bool maker;             // the fill was against our resting order rather than by crossing the book
+    int64_t time_us;        // exchange time it happened at
+    double fill_price;      // price and quantity of this fill, zero if the update isn't a fill
+    double fill_quantity;
+    double filled;          // total filled so far
+    double remaining;       // quantity still open
+};
+
+// callback for every order update - runs wherever the simulator is driven from (the replay loop in a backtest)
+using SimOrderListener = void (*)(const SimOrderUpdate &update, void *user);
+
+/**
+ * @brief The FillSimulator class matches our own orders against one replayed book, modelling where a resting order sits in the queue.
+ *
+ * Orders and cancels reach the simulated venue at an arrival time (sent time plus order entry latency) and take effect before the
+ * first book event or trade at or after it. On arrival an order crosses the visible levels of the book as it was then, up to its price;
+ * liquidity it takes is remembered until the book next changes, so two orders can't take the same quantity.
+ * Whatever a limit order doesn't fill rests behind the quantity already at its price. That queue ahead shrinks with trades at the price
+ * and with quantity decreases at the level - decreases that only echo trades already counted are netted out - and never exceeds the level's
+ * quantity, so additions always join behind us. Once the queue ahead is gone, trades at the price fill the order, and trades through the
+ * price or the opposite side moving to it fill the rest.
+ * Levels deeper than the depth view start with an unknown queue, taken from the level's quantity the first time it changes.
+ * Driving is all on one thread (the book's apply thread, or the backtest loop) and costs nothing per event when there are no orders on a side.
+ */
+class FillSimulator
+{
+private:
+    struct Order
+    {
+        uint64_t id;
+        OrderSide side;
+        double price;
+        double quantity;
+        double filled;
+        double queue_ahead;     // quantity at our price in front of us
+        double traded_at_level; // trade volume at our price not yet seen as a depth decrease
+        bool queue_known;       // false until the level's quantity is known
+    };
+
+    // an order or cancel on its way to the venue
+    struct Pending
+    {
+        int64_t arrival_time_us;
+        bool is_cancel;
+        uint64_t id;
+        OrderSide side;
+        OrderType type;
+        double price;
+        double quantity;
+    };
+
+    // book as of the last applied event
+    DepthView view{};
+    bool has_view = false;
+    // quantity taken from each visible level by crossing orders since the book last changed
+    double bid_taken[DEPTH_VIEW_LEVELS] = {};
+    double ask_taken[DEPTH_VIEW_LEVELS] = {};
+
+    std::vector<Order> bids;
+    std::vector<Order> asks;
+    // ordered by arrival time
+    std::vector<Pending> pending;
+    // actions arriving in the current advance_to(), reused between calls
+    std::vector<Pending> arriving;
+    uint64_t next_id = 1;
+    std::vector<std::pair<SimOrderListener, void *>> listeners;
+
+    void schedule(const Pending &action);
+    void arrive(const Pending &action);
+    void cross(uint64_t id, OrderSide side, OrderType type, double price, double quantity, int64_t time_us);
+    void cancel_now(uint64_t id, int64_t time_us);
+    bool fill(std::vector<Order> &orders, size_t index, double price, double quantity, int64_t time_us);
+    void report(uint64_t id, SimOrderStatus status, bool maker, int64_t time_us, double price, double quantity, double filled, double remaining);
+    void on_level_change(const LevelChange &change);
+    void on_book_update(const DepthView &view);
+
+public:
+    FillSimulator() = default;
+
+    FillSimulator(const FillSimulator &) = delete;
+    FillSimulator &operator=(const FillSimulator &) = delete;
+
+    /**
+     * @brief Drive the simulator from a book's changes - must be called before the book is driven, and only for one book
+     * @param book The book - anything with add_level_listener() and add_update_listener()
+     */
+    template <typename Book>
+    void attach(Book &book)
+    {
+        book.add_level_listener(&FillSimulator::level_change_callback, this);
+        book.add_update_listener(&FillSimulator::book_update_callback, this);
+    }
+
+    // listener trampolines, public so the simulator can also be driven without a book - trade_callback fits Backtester::add_trade_listener()
+    static void level_change_callback(const LevelChange &change, void *user);
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+    static void trade_callback(const Trade &trade, void *user);
+
+    /**
+     * @brief Register a callback for every order update
+     */
+    void add_listener(SimOrderListener listener, void *user);
+
+    /**
+     * @brief Send an order
+     * @param arrival_time_us When it reaches the venue - the sending time plus order entry latency
+     * @return The order's ID
+     * @throws std::invalid_argument If the quantity isn't positive
+     */
+    uint64_t submit(OrderSide side, OrderType type, double price, double quantity, int64_t arrival_time_us);
+
+    /**
+     * @brief Send a cancel - an order that has filled or been cancelled by then gets a REJECTED update
+     * @param arrival_time_us When it reaches the venue
+     */
+    void cancel(uint64_t order_id, int64_t arrival_time_us);
+
+    /**
+     * @brief Apply every order and cancel arriving by a time - called before each event and trade, and by hand at the end of a replay
+     */
+    void advance_to(int64_t time_us);
+
+    /**
+     * @brief Match a trade against the resting orders, at its trade time
+     */
+    void on_trade(const Trade &trade);
+
+    /**
+     * @brief Get the quantity ahead of a resting order, -1 if it isn't resting or the queue isn't known yet
+     */
+    double get_queue_ahead(uint64_t order_id) const;
+
+    /**
+     * @brief Get the number of resting orders
+     */
+    size_t get_resting_count() const;
+};
+
+#endif // FILL_SIMULATOR_H
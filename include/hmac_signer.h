@@ -0,0 +1,153 @@
+// Header file for hmac_signer.cpp - HMAC-SHA256 request signing from precomputed key pad states, and an allocation-free payload writer
+#ifndef HMAC_SIGNER_H
+#define HMAC_SIGNER_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <openssl/sha.h>
+
+// length of a hex HMAC-SHA256 signature
+constexpr size_t HMAC_SHA256_HEX_LENGTH = 2 * SHA256_DIGEST_LENGTH;
+
+/**
+ * @brief The HmacSigner class signs payloads with HMAC-SHA256 under one key.
+ *
+ * HMAC is SHA256((key ^ opad) || SHA256((key ^ ipad) || payload)). The padded key blocks never change for a key, so the signer hashes them
+ * once when it is constructed and keeps the two SHA-256 states. Each signature then resumes from a copy of those states - a struct copy -
+ * and only hashes the payload and the inner digest, two compression runs fewer than HMAC() and without its per-call context set up,
+ * key hashing or allocation.
+ * A signer is immutable after construction, so it can be shared by threads.
+ */
+class HmacSigner
+{
+private:
+    // SHA-256 states after the inner and outer padded key blocks
+    SHA256_CTX inner;
+    SHA256_CTX outer;
+
+public:
+    /**
+     * @brief Precompute the pad states for a key
+     * @param secret The key - keys longer than a block are hashed first, as HMAC requires
+     */
+    explicit HmacSigner(const std::string &secret);
+
+    /**
+     * @brief Sign a payload
+     * @param digest Set to the SHA256_DIGEST_LENGTH byte signature
+     */
+    void sign(const char *payload, size_t length, unsigned char *digest) const;
+
+    /**
+     * @brief Sign a payload, as lowercase hex
+     * @param signature Set to the HMAC_SHA256_HEX_LENGTH character signature (not terminated)
+     * @return HMAC_SHA256_HEX_LENGTH
+     */
+    size_t sign_hex(const char *payload, size_t length, char *signature) const;
+};
+
+/**
+ * @brief The PayloadWriter class appends text and numbers to a fixed buffer with std::to_chars - no locale, no format parsing and no
+ * allocation. Writes that don't fit are dropped and mark the writer as overflowed, so a request is checked once at the end.
+ */
+class PayloadWriter
+{
+private:
+    char *position;
+    char *end;
+    char *begin;
+    // start of the most recent write, see last()
+    char *last_start;
+    bool overflowed = false;
+
+public:
+    PayloadWriter(char *buffer, size_t capacity)
+        : position(buffer), end(buffer + capacity), begin(buffer), last_start(buffer) {}
+
+    PayloadWriter &text(std::string_view value)
+    {
+        this->last_start = this->position;
+        if (value.size() > static_cast<size_t>(this->end - this->position))
+        {
+            this->overflowed = true;
+            return *this;
+        }
+        std::memcpy(this->position, value.data(), value.size());
+        this->position += value.size();
+        return *this;
+    }
+
+    PayloadWriter &character(char value)
+    {
+        this->last_start = this->position;
+        if (this->position == this->end)
+        {
+            this->overflowed = true;
+            return *this;
+        }
+        *this->position++ = value;
+        return *this;
+    }
+
+    template <typename Integer>
+    PayloadWriter &integer(Integer value)
+    {
+        this->last_start = this->position;
+        std::to_chars_result result = std::to_chars(this->position, this->end, value);
+        if (result.ec != std::errc())
+        {
+            this->overflowed = true;
+            return *this;
+        }
+        this->position = result.ptr;
+        return *this;
+    }
+
+    /**
+     * @brief Append a number with a fixed number of decimals, e.g. a price at the symbol's tick size
+     */
+    PayloadWriter &decimal(double value, int decimals)
+    {
+        this->last_start = this->position;
+        std::to_chars_result result = std::to_chars(this->position, this->end, value, std::chars_format::fixed, decimals);
+        if (result.ec != std::errc())
+        {
+            this->overflowed = true;
+            return *this;
+        }
+        this->position = result.ptr;
+        return *this;
+    }
+
+    const char *data() const
+    {
+        return this->begin;
+    }
+
+    /**
+     * @brief Get what the most recent write appended - lets one scratch writer format several values that are used separately
+     */
+    std::string_view last() const
+    {
+        return std::string_view(this->last_start, static_cast<size_t>(this->position - this->last_start));
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(this->position - this->begin);
+    }
+
+    /**
+     * @brief Whether everything written so far fitted
+     */
+    bool ok() const
+    {
+        return !this->overflowed;
+    }
+};
+
+#endif // HMAC_SIGNER_H
@@ -0,0 +1,34 @@
+// Venue-neutral kline (candlestick) published by the venue, used to reconcile locally built bars
+#ifndef KLINE_H
+#define KLINE_H
+
+#include <cstdint>
+#include "circular_buffer.h"
+
+/**
+ * @brief One venue kline, with prices and volumes already decoded. Times follow Bar: close_time is exclusive.
+ * Trivially copyable, so it can be passed through a CircularBuffer without allocating.
+ */
+struct Kline
+{
+    int64_t event_time;       // exchange event time (ms)
+    int64_t open_time;        // kline start (ms), inclusive
+    int64_t close_time;       // kline end (ms), exclusive
+    int64_t interval_ms;      // kline length (ms)
+    int64_t first_trade_id;   // first venue trade ID in the kline
+    int64_t last_trade_id;    // last venue trade ID in the kline
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;            // base asset volume
+    double quote_volume;      // quote asset volume
+    double taker_buy_volume;  // base asset volume where the taker bought
+    uint32_t trade_count;     // venue trades in the kline
+    bool closed;              // true for the final update of the kline
+};
+
+// buffer between a kline stream's websocket thread and its consumer
+using KlineBuffer = CircularBuffer<Kline, 4096>;
+
+#endif // KLINE_H
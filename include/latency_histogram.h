@@ -0,0 +1,118 @@
+// A fixed-size log-linear latency histogram, recorded from one thread and readable from any
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// buckets per power of two - 8 keeps every bucket within 12.5% of its lower bound
+constexpr size_t LATENCY_SUB_BUCKETS = 8;
+// enough buckets for any uint64_t nanosecond value
+constexpr size_t LATENCY_BUCKETS = 64 * LATENCY_SUB_BUCKETS;
+
+/**
+ * @brief The LatencyHistogram class counts latencies in log-linear buckets: exact below LATENCY_SUB_BUCKETS ns, then LATENCY_SUB_BUCKETS
+ * equal buckets per power of two. Recording is a bit scan and a few relaxed atomic adds, with no allocation, so it can sit on a hot path.
+ * Counters are relaxed atomics - readers on other threads see a consistent enough picture for reporting, not an exact snapshot.
+ */
+class LatencyHistogram
+{
+private:
+    std::atomic<uint64_t> counts[LATENCY_BUCKETS] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+
+    static size_t bucket_for(uint64_t ns)
+    {
+        if (ns < LATENCY_SUB_BUCKETS)
+        {
+            return static_cast<size_t>(ns);
+        }
+        // the top bit picks the power of two, the next three bits the sub-bucket within it
+        size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+        size_t sub = static_cast<size_t>(ns >> (msb - 3)) & (LATENCY_SUB_BUCKETS - 1);
+        return (msb - 2) * LATENCY_SUB_BUCKETS + sub;
+    }
+
+    static uint64_t bucket_lower_bound(size_t bucket)
+    {
+        if (bucket < LATENCY_SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        size_t msb = bucket / LATENCY_SUB_BUCKETS + 2;
+        size_t sub = bucket % LATENCY_SUB_BUCKETS;
+        return static_cast<uint64_t>(LATENCY_SUB_BUCKETS + sub) << (msb - 3);
+    }
+
+public:
+    /**
+     * @brief Record a latency - must only be called from one thread
+     */
+    void record(uint64_t ns)
+    {
+        this->counts[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+        this->count.fetch_add(1, std::memory_order_relaxed);
+        this->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > this->max_ns.load(std::memory_order_relaxed))
+        {
+            this->max_ns.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Get a percentile, as the upper bound of the bucket it falls in
+     * @param percentile Between 0 and 100
+     * @return The latency (ns), 0 if nothing was recorded
+     */
+    uint64_t percentile(double percentile) const
+    {
+        uint64_t total = this->count.load(std::memory_order_relaxed);
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+        {
+            seen += this->counts[bucket].load(std::memory_order_relaxed);
+            if (seen > target)
+            {
+                uint64_t upper = bucket + 1 < LATENCY_BUCKETS ? bucket_lower_bound(bucket + 1) - 1 : UINT64_MAX;
+                return upper < get_max() ? upper : get_max();
+            }
+        }
+        return get_max();
+    }
+
+    uint64_t get_count() const
+    {
+        return this->count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_max() const
+    {
+        return this->max_ns.load(std::memory_order_relaxed);
+    }
+
+    double get_mean() const
+    {
+        uint64_t total = get_count();
+        return total == 0 ? 0 : static_cast<double>(this->sum_ns.load(std::memory_order_relaxed)) / static_cast<double>(total);
+    }
+
+    /**
+     * @brief Write a one-line summary - count, mean, p50, p90, p99, p99.9 and max in microseconds
+     */
+    void print(std::ostream &out, const char *name) const
+    {
+        out << name << ": count " << get_count() << " mean " << get_mean() / 1000.0 << "us p50 " << percentile(50) / 1000.0 << "us p90 " << percentile(90) / 1000.0
+            << "us p99 " << percentile(99) / 1000.0 << "us p99.9 " << percentile(99.9) / 1000.0 << "us max " << get_max() / 1000.0 << "us" << std::endl;
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
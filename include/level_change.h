@@ -0,0 +1,36 @@
+// Level change notifications emitted by the order book apply thread
+#ifndef LEVEL_CHANGE_H
+#define LEVEL_CHANGE_H
+
+#include <cstdint>
+#include "depth_view.h"
+
+/**
+ * @brief A single price level change applied to the order book, with the quantity before and after
+ */
+struct LevelChange
+{
+    int64_t update_id;        // final update ID of the event the change came from
+    int64_t event_time;       // exchange event time of that event (ms)
+    double price;             // price level changed
+    double previous_quantity; // quantity before the change, zero if the level was new
+    double quantity;          // quantity after the change, zero if the level was removed
+    bool is_bid;              // true for a bid level, false for an ask level
+};
+
+/**
+ * @brief Callback invoked on the apply thread for every level change - must be quick and must not block
+ * @param change The level change
+ * @param user The user pointer given when the listener was added
+ */
+using LevelListener = void (*)(const LevelChange &change, void *user);
+
+/**
+ * @brief Callback invoked on the apply thread after each event has been applied - must be quick and must not block
+ * @param view The book's top levels after the event, as just published
+ * @param reloaded true if the book was (re)loaded from a snapshot instead - no level changes came before it
+ * @param user The user pointer given when the listener was added
+ */
+using BookUpdateListener = void (*)(const DepthView &view, bool reloaded, void *user);
+
+#endif // LEVEL_CHANGE_H
@@ -0,0 +1,108 @@
+// Header file for mock_order_venue.cpp - a local stand-in for the Binance WebSocket API, for testing order entry without a venue
+#ifndef MOCK_ORDER_VENUE_H
+#define MOCK_ORDER_VENUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <libwebsockets.h>
+#include "simdjson.h"
+
+/**
+ * @brief The MockOrderVenue class answers order.place and order.cancel requests on a local plain WebSocket port, the way the Binance
+ * WebSocket API does, so an OrderGateway can be run end to end against it (see OrderGatewayEndpoints::mock()).
+ *
+ * Every request's signature is checked against the API key's secret, so signing bugs show up as -1022 errors just as they would live.
+ * Orders are accepted straight away as NEW and never fill; cancels succeed for orders the venue has seen and fail with -2011 otherwise.
+ * An optional delay before each response stands in for the venue's matching engine - responses are held on a libwebsockets timer rather
+ * than by sleeping, so requests keep being read (and answered in order) while earlier ones wait. Runs on its own thread with libwebsockets.
+ */
+class MockOrderVenue
+{
+private:
+    // a response held until it is due
+    struct Response
+    {
+        std::string text;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    // fires when a session's next response is due - plain data, so the callback can get back to it with lws_container_of
+    struct ResponseTimer
+    {
+        lws_sorted_usec_list_t sul;
+        struct lws *wsi;
+    };
+
+    // a connected client
+    struct Session
+    {
+        std::string message;            // message being reassembled from fragments
+        std::deque<Response> responses; // responses waiting to be written, due in order
+        ResponseTimer timer;
+    };
+
+    int port;
+    std::string api_key;
+    std::string secret;
+    std::chrono::microseconds response_delay;
+
+    struct lws_protocols protocols[3];
+    struct lws_context *context = nullptr;
+    std::thread thread;
+    std::atomic<bool> stop_requested{false};
+
+    // everything below is only touched on the venue's thread
+    std::unordered_map<struct lws *, Session> sessions;
+    // client order ID -> venue order ID of live orders
+    std::unordered_map<std::string, int64_t> orders;
+    int64_t next_order_id = 1;
+    simdjson::ondemand::parser parser;
+    uint64_t requests = 0;
+
+    std::string handle(std::string &message);
+    std::string error(const std::string &id, int status, int code, const char *message) const;
+    bool verify(const std::string &payload, const std::string &signature) const;
+    void write_when_due(Session &session);
+    static void response_due(lws_sorted_usec_list_t *sul);
+
+public:
+    /**
+     * @brief Construct a venue - nothing listens until start()
+     * @param port Port to listen on
+     * @param api_key The only API key accepted
+     * @param secret Its secret
+     * @param response_delay Time to wait before answering each request
+     */
+    MockOrderVenue(int port, const std::string &api_key, const std::string &secret,
+                   std::chrono::microseconds response_delay = std::chrono::microseconds(0));
+    ~MockOrderVenue();
+
+    MockOrderVenue(const MockOrderVenue &) = delete;
+    MockOrderVenue &operator=(const MockOrderVenue &) = delete;
+
+    // libwebsockets callback for client connections
+    static int venue_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
+
+    /**
+     * @brief Start listening
+     * @throws std::runtime_error If the port can't be listened on
+     */
+    void start();
+
+    /**
+     * @brief Stop listening and wait for the venue's thread
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of requests answered - only exact once stopped
+     */
+    uint64_t get_requests() const;
+};
+
+#endif // MOCK_ORDER_VENUE_H
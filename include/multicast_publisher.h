@@ -0,0 +1,181 @@
+// Header file for multicast_publisher.cpp - publishes normalised order book deltas over UDP multicast
+#ifndef MULTICAST_PUBLISHER_H
+#define MULTICAST_PUBLISHER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include "depth_view.h"
+#include "seqlock.h"
+
+/*
+ * Packet format - one UDP datagram per packet, all fields little endian:
+ *   MulticastPacketHeader
+ *   DELTAS:   count x MulticastDelta
+ *   SNAPSHOT: MulticastSnapshot
+ *
+ * Each symbol's stream describes its top DEPTH_VIEW_LEVELS levels per side, the levels a snapshot carries: a level leaving the top levels
+ * is sent as a delta with quantity 0, and a level moving into them as a delta with its quantity, so applying the deltas keeps exactly
+ * the levels a snapshot would have.
+ * Sequence numbers are per symbol and count deltas: a DELTAS packet carries deltas first_sequence .. first_sequence + count - 1.
+ * A SNAPSHOT carries the levels after delta first_sequence; a late joiner applies it, then the deltas after first_sequence.
+ * A gap in sequence numbers means a packet was lost - wait for the next snapshot.
+ */
+
+// identifies a CryptoPlusPlus multicast packet ("CPPD")
+constexpr uint32_t MULTICAST_MAGIC = 0x44505043;
+// bumped whenever the packet layout changes
+constexpr uint16_t MULTICAST_PROTOCOL_VERSION = 2;
+// keep datagrams under a typical 1500 byte Ethernet MTU
+constexpr size_t MULTICAST_MAX_PACKET_BYTES = 1400;
+
+enum class MulticastPacketType : uint8_t
+{
+    DELTAS = 1,
+    SNAPSHOT = 2,
+};
+
+struct MulticastPacketHeader
+{
+    uint32_t magic;          // MULTICAST_MAGIC
+    uint16_t version;        // MULTICAST_PROTOCOL_VERSION
+    uint16_t symbol_id;      // index of the symbol, as assigned by add_book()
+    uint8_t type;            // MulticastPacketType
+    uint8_t reserved;
+    uint16_t count;          // number of deltas (DELTAS) or 1 (SNAPSHOT)
+    uint64_t first_sequence; // sequence number of the first delta (DELTAS), or of the last delta sent before the snapshot (SNAPSHOT)
+    int64_t send_time_ns;    // publisher wall clock time (ns since epoch)
+};
+static_assert(sizeof(MulticastPacketHeader) == 32, "MulticastPacketHeader layout changed");
+
+struct MulticastDelta
+{
+    int64_t update_id;  // exchange update ID of the book the delta was taken from
+    int64_t event_time; // exchange event time (ms)
+    double price;       // price level
+    double quantity;    // new total quantity at the level, zero means removed
+    uint8_t is_bid;     // 1 for bid, 0 for ask
+    uint8_t reserved[7];
+};
+static_assert(sizeof(MulticastDelta) == 40, "MulticastDelta layout changed");
+
+struct MulticastSnapshot
+{
+    char symbol[16];                      // null terminated symbol, so joiners can map symbol_id to a name
+    int64_t update_id;                    // exchange update ID the levels are correct at
+    int64_t event_time;                   // exchange event time (ms)
+    uint16_t bid_count;                   // valid entries in bids
+    uint16_t ask_count;                   // valid entries in asks
+    uint32_t reserved;
+    PriceLevel bids[DEPTH_VIEW_LEVELS];   // best bid first
+    PriceLevel asks[DEPTH_VIEW_LEVELS];   // best ask first
+};
+
+// number of deltas that fit in one packet
+constexpr size_t MULTICAST_DELTAS_PER_PACKET = (MULTICAST_MAX_PACKET_BYTES - sizeof(MulticastPacketHeader)) / sizeof(MulticastDelta);
+static_assert(sizeof(MulticastPacketHeader) + sizeof(MulticastSnapshot) <= MULTICAST_MAX_PACKET_BYTES, "Snapshot does not fit in one packet");
+
+/**
+ * @brief The MulticastPublisher class fans order book changes out to any number of consumers over UDP multicast.
+ *
+ * The publisher thread watches each book's depth view version, like the DepthServer, and when a new view is published diffs it
+ * against the last view it sent - the same merge walk the ConsolidatedBook uses - batching as many deltas as fit into each packet.
+ * The apply thread does nothing beyond publishing its view. Every snapshot_interval it sends the last view it sent as a snapshot,
+ * so a snapshot always lines up exactly with the deltas before it, and late joiners (and anyone who lost a packet) can recover.
+ * Views published while the publisher is busy are merged into the next diff rather than dropped, so the publisher never leaves a gap -
+ * sequence numbers are used up even when sendto() fails, so a packet lost on the way out still shows as a gap.
+ */
+class MulticastPublisher
+{
+private:
+    // per-book state, publisher thread only
+    struct Channel
+    {
+        std::string symbol;
+        uint16_t symbol_id;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version = 0;  // view version when the view was last diffed
+        DepthView sent{};           // the levels receivers hold after every delta sent so far
+        uint64_t next_sequence = 1;
+    };
+
+    std::string group;
+    uint16_t port;
+    int ttl;
+    std::string interface_address;
+    int socket_fd = -1;
+    sockaddr_in destination{};
+    std::chrono::milliseconds snapshot_interval;
+
+    std::vector<std::unique_ptr<Channel>> channels;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> packets_sent{0};
+    std::atomic<uint64_t> deltas_sent{0};
+
+    // packet being built and the deltas in it, publisher thread only
+    alignas(8) char packet[MULTICAST_MAX_PACKET_BYTES];
+    size_t packet_deltas = 0;
+
+    uint16_t add_channel(const std::string &symbol, const SeqLock<DepthView> &view);
+    void send_packet(size_t len);
+    void add_delta(Channel &channel, const DepthView &view, const PriceLevel &level, bool is_bid);
+    void flush_deltas(Channel &channel);
+    template <bool IsBid>
+    void diff_side(Channel &channel, const DepthView &view, const PriceLevel *previous, uint32_t previous_count, const PriceLevel *current,
+                   uint32_t current_count);
+    size_t publish_changes(Channel &channel);
+    void send_snapshot(Channel &channel);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new MulticastPublisher
+     * @param group Multicast group address, e.g. "239.255.0.1"
+     * @param port Destination UDP port
+     * @param snapshot_interval How often a snapshot of every book is sent
+     * @param ttl Multicast TTL - 0 keeps packets on this host, 1 on the local network
+     * @param interface_address Local interface address to send from (e.g. "127.0.0.1" for loopback only), empty for the system default
+     */
+    MulticastPublisher(const std::string &group, uint16_t port, std::chrono::milliseconds snapshot_interval = std::chrono::milliseconds(1000), int ttl = 1,
+                       const std::string &interface_address = "");
+    ~MulticastPublisher();
+
+    MulticastPublisher(const MulticastPublisher &) = delete;
+    MulticastPublisher &operator=(const MulticastPublisher &) = delete;
+
+    /**
+     * @brief Publish a book's changes - must be called before start()
+     * @param book The order book - anything with get_depth_view()
+     * @param symbol The book's symbol
+     * @return The symbol ID used in packets for this book
+     * @throws std::invalid_argument If the symbol doesn't fit in a snapshot
+     */
+    template <typename Book>
+    uint16_t add_book(const Book &book, const std::string &symbol)
+    {
+        return add_channel(symbol, book.get_depth_view());
+    }
+
+    /**
+     * @brief Open the socket and start the publisher thread
+     * @throws std::runtime_error If the socket can't be created or the group address is invalid
+     */
+    void start();
+
+    /**
+     * @brief Stop the publisher thread and close the socket
+     */
+    void stop();
+
+    uint64_t get_packets_sent() const;
+    uint64_t get_deltas_sent() const;
+};
+
+#endif
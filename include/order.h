@@ -0,0 +1,26 @@
+// Venue-neutral order enums, shared by the fill simulator and the order gateway
+#ifndef ORDER_H
+#define ORDER_H
+
+#include <cstdint>
+
+/**
+ * @brief Side of an order
+ */
+enum class OrderSide : uint8_t
+{
+    BUY,
+    SELL,
+};
+
+/**
+ * @brief How an order handles quantity it can't fill on arrival
+ */
+enum class OrderType : uint8_t
+{
+    LIMIT,  // rests at its price
+    IOC,    // cancelled
+    MARKET, // cancelled - the price is ignored and the order walks the book
+};
+
+#endif // ORDER_H
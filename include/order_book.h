@@ -1,123 +1,558 @@
 #ifndef ORDER_BOOK_H
 #define ORDER_BOOK_H
 
-#include <unordered_map>
-#include <queue>
 #include <vector>
+#include <atomic>
+#include <type_traits>
 #include "circular_buffer.h"
-#include "binance.h"
-#include <cpr/cpr.h>
+#include "book_side.h"
+#include "book_versions.h"
+#include "capture.h"
+#include "delta_history.h"
+#include "depth_update.h"
+#include "level_change.h"
+#include "depth_view.h"
+#include "seqlock.h"
+#include "shared_book_region.h"
+#include "sync_stats.h"
+#include "venue_adapter.h"
 #include <iostream>
 #include <thread>
 #include "simdjson.h"
-#include "file_IO.h"
 
-// https://developers.binance.com/docs/binance-spot-api-docs/web-socket-streams#diff-depth-stream
+// number of applied level updates retained for snapshot verification
+constexpr size_t DELTA_HISTORY_CAPACITY = 65536;
+// largest sequence gap (in update IDs) repaired from a single snapshot - anything bigger triggers a full resync
+constexpr int64_t MAX_REPAIRABLE_GAP = 10000;
 
 /**
  * The OrderBook class maintains a local order book data structure.
- * Bid/Ask price points and their quantities are stored in hash maps, and the max bid/min ask are stored in heaps.
+ * Bid/Ask price points and their quantities are stored in sorted arrays (see BookSide), with the best price at the back.
+ * After every applied update the top levels are published through a SeqLock so other threads can read them without blocking the apply thread,
+ * and optionally the whole book is published as an immutable BookVersion (see book_versions.h).
+ * Everything venue specific - snapshot fetching and parsing, and the update ID continuity rules - comes from the Venue adapter (see venue_adapter.h).
+ * With TrackLevelAge, each level's creation time, last modified time and update count are tracked too, and the ages of the top levels
+ * are published alongside the depth view. Ages are carried over gap repairs for the levels the repair snapshot still has, but
+ * start again on a full resync.
+ * @tparam Venue The venue adapter
+ * @tparam TrackLevelAge true to track per-level age - books that don't need it pay nothing for it
  */
+template <typename Venue, bool TrackLevelAge = false>
 class OrderBook
 {
 private:
     int counter;                                               // Counter to track the cycles
     std::chrono::high_resolution_clock::time_point start_time; // Timer to measure time elapsed
 
-    // hashmaps for bid/ask prices and quantities - note Binance API returns quantity as floating point values
+    // Bids: price levels and their total order quantity
+    BookSide<true, TrackLevelAge> bids;
+    // Asks: price levels and their total order quantity
+    BookSide<false, TrackLevelAge> asks;
 
-    // Bids: key = price, value = total order quantity
-    std::unordered_map<double, double> bid_map;
-    // Asks: key = price, value = total order quantity
-    std::unordered_map<double, double> ask_map;
+    // last update ID applied to the local book (snapshot lastUpdateId right after init)
+    int64_t last_update_id = 0;
+    // true until an event has been applied on top of the current snapshot - some venues check the first event differently
+    bool first_after_snapshot = true;
 
-    // heaps for best bid/ask
-    // Note: priority_queue is a container adopter - it uses vectors as its internal structure, and is why we pass a vector for the min heap
+    // top levels of the book, republished after every applied event
+    SeqLock<DepthView> depth_view;
+    // ages of the top levels, republished with the depth view - an empty stand-in without TrackLevelAge
+    struct NoLevelAgeView
+    {
+    };
+    std::conditional_t<TrackLevelAge, SeqLock<LevelAgeView>, NoLevelAgeView> level_age_view;
+    // level updates recently applied to the book - lets readers roll a REST snapshot forward to the live update ID
+    DeltaHistory<DELTA_HISTORY_CAPACITY> delta_history;
+    // immutable full-book versions for readers that need more than the top levels - only published when enabled
+    BookVersionPublisher versions;
+    bool versions_enabled = false;
+    // callbacks invoked on the apply thread for every level change, with their user pointers
+    std::vector<std::pair<LevelListener, void *>> level_listeners;
+    // callbacks invoked on the apply thread once per applied event (or snapshot load), with the new top levels
+    std::vector<std::pair<BookUpdateListener, void *>> update_listeners;
+    // slot in the shared memory region this book is mirrored into, nullptr if not mirrored
+    SharedBookSlot *shared_slot = nullptr;
+    // capture the book's snapshots and applied events are recorded to, nullptr if not recorded
+    CaptureWriter *capture = nullptr;
+    uint16_t capture_stream = 0;
+    // set by other threads (e.g. the snapshot verifier) to ask the apply thread for a full resync
+    std::atomic<bool> resync_requested{false};
+    // set by stop() to end keep_orderbook_sync()
+    std::atomic<bool> stop_requested{false};
+
+    // events already taken from the data buffer that still need applying (kept during init and gap repair), applied before the buffer
+    std::vector<DepthUpdate> retained_events;
+    // index of the next retained event to apply
+    size_t retained_cursor = 0;
+    // scratch book sides a repair snapshot is loaded into, so the live book is untouched if the repair fails
+    BookSide<true, TrackLevelAge> repair_bids;
+    BookSide<false, TrackLevelAge> repair_asks;
+
+    // current sync state and resync counters, readable from any thread
+    std::atomic<SyncState> sync_state{SyncState::INITIALISING};
+    std::atomic<uint64_t> gap_repairs{0};
+    std::atomic<uint64_t> repair_failures{0};
+    std::atomic<uint64_t> full_resyncs{0};
+    std::atomic<uint64_t> last_resync_us{0};
+    std::atomic<uint64_t> max_resync_us{0};
+    std::atomic<uint64_t> total_resync_us{0};
+    std::atomic<int64_t> last_gap_size{0};
+
+    // where the venue stream and snapshots come from
+    VenueEndpoints endpoints;
+    // pointer to the data ingestion buffer, nullptr for books driven directly (e.g. by the backtester)
+    CircularBuffer<DepthUpdate, 1024> *data_buffer = nullptr;
+
+    /**
+     * @brief Publish the current top levels of the book through the depth view SeqLock
+     * @param event_time The exchange event time of the last applied event
+     * @param reloaded true if the book was just loaded from a snapshot rather than updated by an event
+     */
+    void publish_depth_view(int64_t event_time, bool reloaded)
+    {
+        DepthView view;
+        view.update_id = this->last_update_id;
+        view.event_time = event_time;
+        view.bid_count = static_cast<uint32_t>(bids.copy_top(view.bids, DEPTH_VIEW_LEVELS));
+        view.ask_count = static_cast<uint32_t>(asks.copy_top(view.asks, DEPTH_VIEW_LEVELS));
+        depth_view.store(view);
+
+        if constexpr (TrackLevelAge)
+        {
+            LevelAgeView age_view;
+            age_view.update_id = this->last_update_id;
+            age_view.bid_count = static_cast<uint32_t>(bids.copy_top_ages(age_view.bids, DEPTH_VIEW_LEVELS));
+            age_view.ask_count = static_cast<uint32_t>(asks.copy_top_ages(age_view.asks, DEPTH_VIEW_LEVELS));
+            level_age_view.store(age_view);
+        }
+
+        if (this->shared_slot)
+        {
+            SharedBookRecord record;
+            record.view = view;
+            record.publish_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            record.gap_repairs = this->gap_repairs.load(std::memory_order_relaxed);
+            record.full_resyncs = this->full_resyncs.load(std::memory_order_relaxed);
+            record.sync_state = this->sync_state.load(std::memory_order_relaxed);
+            this->shared_slot->book.store(record);
+        }
+
+        if (this->versions_enabled)
+        {
+            versions.publish(bids, asks, bids.take_dirty_from(), asks.take_dirty_from(), this->last_update_id, event_time);
+        }
 
-    // Stores best bid price (max)
-    std::priority_queue<double> bid_heap;
-    // Stores best ask price (min)
-    std::priority_queue<double, std::vector<double>, std::greater<double>> ask_heap;
+        // the updates recorded before a reload don't lead to the new book, so mark where it happened for readers of the history
+        if (reloaded)
+        {
+            delta_history.mark_reload(this->last_update_id);
+        }
 
-    // URL used for getting the order book snapshot
-    std::string snapshot_url;
-    // pointer to the data ingestion buffer
-    CircularBuffer<Binance_DiffDepth, 1024> *data_buffer;
+        // a reload replaces the whole book, so the replay needs all of it - applied events are recorded by apply_event()
+        if (this->capture && reloaded)
+        {
+            this->capture->write_snapshot(this->capture_stream, bids, asks, this->last_update_id, event_time);
+        }
 
-    // used to write stats to file
-    FileIO file_io;
+        for (const auto &listener : this->update_listeners)
+        {
+            listener.first(view, reloaded, listener.second);
+        }
+    }
 
     /**
-     * @brief Parses a price level from a JSON array.
-     *
-     * This method extracts the price and quantity from a JSON array representing a price level.
-     * The JSON array is expected to have at least two elements: the first element is the price as a string,
-     * and the second element is the quantity as a string. These values are converted to double and stored
-     * in the provided references.
-     *
-     * @param level The JSON array representing the price level.
-     * @param price Reference to a double where the parsed price will be stored.
-     * @param quantity Reference to a double where the parsed quantity will be stored.
-     * @return true if the price level was successfully parsed, false otherwise.
+     * @brief Pass a level change to every registered level listener
      */
-    bool parse_price_level(simdjson::ondemand::array level, double &price, double &quantity)
+    void notify_level_listeners(const LevelChange &change)
     {
-        try
+        for (const auto &listener : this->level_listeners)
         {
-            // Get values directly using at() to avoid iteration
-            auto price_val = level.at(0);
-            auto qty_val = level.at(1);
-
-            std::string price_str, quantity_str;
+            listener.first(change, listener.second);
+        }
+    }
 
-            // Handle price
-            if (price_val.type() == simdjson::ondemand::json_type::string)
-            {
-                price_str = std::string(price_val.get_string().value());
-            }
-            else if (price_val.type() == simdjson::ondemand::json_type::number)
-            {
-                price_str = std::to_string(price_val.get_double().value());
-            }
-            else
+    /**
+     * @brief Get the next event to apply - retained events first, then the data buffer
+     * @param event Where to store the event
+     * @return true if an event was available, false otherwise
+     */
+    bool next_event(DepthUpdate &event)
+    {
+        if (this->retained_cursor < this->retained_events.size())
+        {
+            event = std::move(this->retained_events[this->retained_cursor++]);
+            if (this->retained_cursor == this->retained_events.size())
             {
-                return false;
+                this->retained_events.clear();
+                this->retained_cursor = 0;
             }
+            return true;
+        }
+        return this->data_buffer->get_is_ready() && this->data_buffer->try_pop(event);
+    }
+
+    /**
+     * @brief Move everything currently in the data buffer to the back of the retained events, so the buffer can't fill up while we wait on REST
+     */
+    void drain_buffer_to_retained()
+    {
+        DepthUpdate event;
+        while (this->data_buffer->try_pop(event))
+        {
+            this->retained_events.push_back(std::move(event));
+        }
+    }
+
+    /**
+     * @brief Record how long a repair or resync took
+     * @param start When the repair or resync started
+     */
+    void record_resync_duration(std::chrono::steady_clock::time_point start)
+    {
+        uint64_t duration_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        this->last_resync_us.store(duration_us, std::memory_order_relaxed);
+        this->total_resync_us.fetch_add(duration_us, std::memory_order_relaxed);
+        // only the apply thread writes these, so a plain compare is enough
+        if (duration_us > this->max_resync_us.load(std::memory_order_relaxed))
+        {
+            this->max_resync_us.store(duration_us, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Repair a small sequence gap without a full re-initialisation.
+     * The event that revealed the gap, and every event after it, are kept. A single snapshot that reaches past the gap is loaded into
+     * scratch book sides, swapped in, and the kept events are then replayed through the normal apply path (which drops the ones the snapshot already covers).
+     * @param gap_event The event the venue's sequencing rules reported a gap before
+     * @return true if the book was repaired, false if no suitable snapshot could be fetched (the live book is left unchanged)
+     */
+    bool repair_gap(const DepthUpdate &gap_event)
+    {
+        auto start = std::chrono::steady_clock::now();
+        this->sync_state.store(SyncState::REPAIRING, std::memory_order_release);
+
+        // keep the gap event in front of any events not yet applied - these get replayed on top of the snapshot
+        this->retained_events.erase(this->retained_events.begin(), this->retained_events.begin() + this->retained_cursor);
+        this->retained_cursor = 0;
+        this->retained_events.insert(this->retained_events.begin(), gap_event);
 
-            // Handle quantity
-            if (qty_val.type() == simdjson::ondemand::json_type::string)
+        simdjson::ondemand::parser parser;
+        const int MAX_REPAIR_SNAPSHOT_RETRIES = 3;
+
+        for (int retry_count = 0; retry_count < MAX_REPAIR_SNAPSHOT_RETRIES; retry_count++)
+        {
+            drain_buffer_to_retained();
+
+            int64_t snapshot_update_id = 0;
+            if (!fetch_snapshot(parser, this->repair_bids, this->repair_asks, snapshot_update_id))
             {
-                quantity_str = std::string(qty_val.get_string().value());
+                continue;
             }
-            else if (qty_val.type() == simdjson::ondemand::json_type::number)
+
+            // the snapshot has to reach the gap, otherwise the missing updates are still missing
+            if (!Venue::snapshot_covers(snapshot_update_id, gap_event))
             {
-                quantity_str = std::to_string(qty_val.get_double().value());
+                std::cout << "[OrderBook][repair_gap] Snapshot " << snapshot_update_id << " does not cover gap at " << gap_event.first_update_id << ", retrying" << std::endl;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
             }
-            else
+
+            // swap the snapshot in - the old book sides become the scratch sides for the next repair
+            std::swap(this->bids, this->repair_bids);
+            std::swap(this->asks, this->repair_asks);
+            // levels that survived the gap keep their ages, rather than looking as if they had just been loaded
+            if constexpr (TrackLevelAge)
             {
-                return false;
+                this->bids.carry_ages_from(this->repair_bids);
+                this->asks.carry_ages_from(this->repair_asks);
             }
+            this->last_update_id = snapshot_update_id;
+            this->first_after_snapshot = true;
+            publish_depth_view(gap_event.event_time, true);
 
-            price = std::stod(price_str);
-            quantity = std::stod(quantity_str);
+            record_resync_duration(start);
+            this->gap_repairs.fetch_add(1, std::memory_order_relaxed);
+            this->sync_state.store(SyncState::SYNCED, std::memory_order_release);
+
+            std::cout << "[OrderBook][repair_gap] Repaired from snapshot " << snapshot_update_id << ", replaying " << this->retained_events.size() << " retained events" << std::endl;
             return true;
         }
-        catch (const std::exception &e)
+
+        std::cerr << "[OrderBook][repair_gap] Failed to fetch a snapshot covering the gap" << std::endl;
+        return false;
+    }
+
+    /**
+     * @brief Discard the local book and re-initialise it from scratch, recording the resync
+     * @return true if the book was re-initialised
+     */
+    bool full_resync()
+    {
+        auto start = std::chrono::steady_clock::now();
+        this->sync_state.store(SyncState::RESYNCING, std::memory_order_release);
+
+        if (!this->init())
         {
-            std::cerr << "Error parsing price level: " << e.what() << std::endl;
+            std::cerr << "Failed to re-initialize the order book." << std::endl;
             return false;
         }
+
+        record_resync_duration(start);
+        this->full_resyncs.fetch_add(1, std::memory_order_relaxed);
+        std::cout << "Order book re-initialized successfully." << std::endl;
+        return true;
     }
 
 public:
     /**
-     * @brief Construct a new OrderBook object
+     * @brief Construct a new OrderBook object fed from the venue's default endpoints
+     *
+     * @param symbol The venue symbol, e.g. "XRPUSDT"
+     * @param data_buffer Reference to the data buffer for order book updates
+     */
+    OrderBook(const std::string &symbol, CircularBuffer<DepthUpdate, 1024> &data_buffer)
+        : endpoints(Venue::endpoints(symbol)), data_buffer(&data_buffer) {}
+
+    /**
+     * @brief Construct a new OrderBook object fed from custom endpoints (e.g. a mock venue)
      *
-     * @param snapshot_url The URL to fetch the order book snapshot from
+     * @param endpoints Where to fetch snapshots from - the stream endpoints are only used by whoever starts the websocket client
      * @param data_buffer Reference to the data buffer for order book updates
      */
-    OrderBook(std::string snapshot_url, CircularBuffer<Binance_DiffDepth, 1024> &data_buffer)
-        : snapshot_url(snapshot_url), data_buffer(&data_buffer) {}
+    OrderBook(const VenueEndpoints &endpoints, CircularBuffer<DepthUpdate, 1024> &data_buffer)
+        : endpoints(endpoints), data_buffer(&data_buffer) {}
+
+    /**
+     * @brief Construct a new OrderBook object without a stream, driven directly through load_snapshot() and apply_event() (e.g. by the backtester).
+     * init() and keep_orderbook_sync() can't be used on it.
+     *
+     * @param symbol The venue symbol, e.g. "XRPUSDT"
+     */
+    explicit OrderBook(const std::string &symbol)
+        : endpoints(Venue::endpoints(symbol)) {}
+
+    /**
+     * @brief Fetch a REST depth snapshot from the venue and load it into a pair of book sides
+     * @param parser The JSON parser to use
+     * @param snapshot_bids Bid side to load the snapshot bids into (cleared first) - any BookSide<true, ...>
+     * @param snapshot_asks Ask side to load the snapshot asks into (cleared first) - any BookSide<false, ...>
+     * @param snapshot_update_id Set to the snapshot's update ID
+     * @return true if a snapshot was fetched and parsed, false otherwise
+     */
+    template <typename Bids, typename Asks>
+    bool fetch_snapshot(simdjson::ondemand::parser &parser, Bids &snapshot_bids, Asks &snapshot_asks, int64_t &snapshot_update_id) const
+    {
+        std::string body;
+        return Venue::fetch_snapshot(this->endpoints, body) && Venue::parse_snapshot(parser, body, snapshot_bids, snapshot_asks, snapshot_update_id);
+    }
+
+    /**
+     * @brief Get the stream and snapshot endpoints the book is fed from
+     */
+    const VenueEndpoints &get_endpoints() const
+    {
+        return this->endpoints;
+    }
+
+    /**
+     * @brief Get the SeqLock the top levels of the book are published through
+     */
+    const SeqLock<DepthView> &get_depth_view() const
+    {
+        return this->depth_view;
+    }
+
+    /**
+     * @brief Get the SeqLock the ages of the top levels are published through, indexed like the depth view - only with TrackLevelAge
+     */
+    const SeqLock<LevelAgeView> &get_level_age_view() const
+    {
+        static_assert(TrackLevelAge, "Level age is only tracked by OrderBook<Venue, true>");
+        return this->level_age_view;
+    }
+
+    /**
+     * @brief Get the history of level updates recently applied to the book
+     */
+    const DeltaHistory<DELTA_HISTORY_CAPACITY> &get_delta_history() const
+    {
+        return this->delta_history;
+    }
+
+    /**
+     * @brief Enable publishing a full immutable BookVersion after every applied event.
+     * Must be called before the apply thread starts.
+     */
+    void enable_versioned_snapshots()
+    {
+        this->versions_enabled = true;
+    }
+
+    /**
+     * @brief Register a callback for every level change the apply thread makes.
+     * Must be called before the apply thread starts. Listeners run on the apply thread, so they should just hand the change off.
+     * @param listener The callback
+     * @param user Passed back to the callback unchanged
+     */
+    void add_level_listener(LevelListener listener, void *user)
+    {
+        this->level_listeners.emplace_back(listener, user);
+    }
+
+    /**
+     * @brief Register a callback for the end of every applied event, after its level changes have been passed to the level listeners.
+     * Also called when the book is (re)loaded from a snapshot, with reloaded set. Must be called before the apply thread starts.
+     * @param listener The callback
+     * @param user Passed back to the callback unchanged
+     */
+    void add_update_listener(BookUpdateListener listener, void *user)
+    {
+        this->update_listeners.emplace_back(listener, user);
+    }
+
+    /**
+     * @brief Mirror this book's depth view and sync metadata into a shared memory region, so other processes can read it.
+     * Must be called before the apply thread starts.
+     * @param region The region to publish into
+     * @param symbol The symbol other processes will look the book up by
+     */
+    void attach_shared_region(SharedBookRegion &region, const std::string &symbol)
+    {
+        this->shared_slot = region.register_book(symbol);
+    }
+
+    /**
+     * @brief Record the book's snapshot loads and applied events to a capture, for replay in backtests.
+     * Must be called before the apply thread starts. The writer is written from the apply thread, so it must not be shared with other books.
+     * @param writer The capture to record to
+     * @param stream The stream name the book is replayed under, e.g. "XRPUSDT@depth"
+     */
+    void attach_capture(CaptureWriter &writer, const std::string &stream)
+    {
+        this->capture = &writer;
+        this->capture_stream = writer.add_stream(stream);
+    }
+
+    /**
+     * @brief Get the publisher of full book versions - create a BookReader on it to pin the latest complete book
+     */
+    BookVersionPublisher &get_versions()
+    {
+        return this->versions;
+    }
+
+    /**
+     * @brief Ask the apply thread to discard the local book and resync from a fresh snapshot.
+     * Safe to call from any thread - the resync happens before the next event is applied.
+     */
+    void request_resync()
+    {
+        this->resync_requested.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Ask keep_orderbook_sync() to return - it finishes the event it is applying first. Safe to call from any thread.
+     */
+    void stop()
+    {
+        this->stop_requested.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Get what the apply thread is currently doing
+     */
+    SyncState get_sync_state() const
+    {
+        return this->sync_state.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get a copy of the resync counters and durations
+     */
+    SyncStats get_sync_stats() const
+    {
+        return SyncStats{
+            this->gap_repairs.load(std::memory_order_relaxed),
+            this->repair_failures.load(std::memory_order_relaxed),
+            this->full_resyncs.load(std::memory_order_relaxed),
+            this->last_resync_us.load(std::memory_order_relaxed),
+            this->max_resync_us.load(std::memory_order_relaxed),
+            this->total_resync_us.load(std::memory_order_relaxed),
+            this->last_gap_size.load(std::memory_order_relaxed)};
+    }
+
+    /**
+     * @brief Replace the book with a snapshot, as init() and gap repair do after fetching one - for books driven without a stream
+     * @param snapshot The whole book - bids and asks best first, final_update_id the snapshot's update ID, event_time the time to publish at
+     */
+    void load_snapshot(const DepthUpdate &snapshot)
+    {
+        bids.clear();
+        asks.clear();
+        for (const PriceLevel &level : snapshot.bids)
+        {
+            bids.update(level.price, level.quantity);
+        }
+        for (const PriceLevel &level : snapshot.asks)
+        {
+            asks.update(level.price, level.quantity);
+        }
+        this->last_update_id = snapshot.final_update_id;
+        this->first_after_snapshot = true;
+        publish_depth_view(snapshot.event_time, true);
+        this->sync_state.store(SyncState::SYNCED, std::memory_order_release);
+    }
+
+    /**
+     * @brief Check an event against the venue's sequencing rules and apply it if it continues the book.
+     * This is the apply step of keep_orderbook_sync(), without the gap handling - a GAP leaves the book unchanged for the caller to resolve.
+     * @param event The event
+     * @return What the sequencing rules said - the event was only applied on APPLY
+     */
+    SequenceCheck apply_event(const DepthUpdate &event)
+    {
+        SequenceCheck check = Venue::check_sequence(event, this->last_update_id, this->first_after_snapshot);
+        if (check != SequenceCheck::APPLY)
+        {
+            return check;
+        }
+
+        // Update bids and asks, recording each level update so the book can be verified against a later snapshot
+        for (const PriceLevel &bid : event.bids)
+        {
+            double previous_quantity = bids.update(bid.price, bid.quantity, event.event_time);
+            delta_history.record(event.first_update_id, event.final_update_id, bid.price, bid.quantity, true);
+            notify_level_listeners(LevelChange{event.final_update_id, event.event_time, bid.price, previous_quantity, bid.quantity, true});
+        }
+
+        for (const PriceLevel &ask : event.asks)
+        {
+            double previous_quantity = asks.update(ask.price, ask.quantity, event.event_time);
+            delta_history.record(event.first_update_id, event.final_update_id, ask.price, ask.quantity, false);
+            notify_level_listeners(LevelChange{event.final_update_id, event.event_time, ask.price, previous_quantity, ask.quantity, false});
+        }
+
+        // Set the local update ID to the event's last update ID
+        this->last_update_id = event.final_update_id;
+        this->first_after_snapshot = false;
+
+        if (this->capture)
+        {
+            // after a dropped record the capture can't be replayed from here - record the whole book instead, which it can
+            if (this->capture->needs_snapshot(this->capture_stream))
+            {
+                this->capture->write_snapshot(this->capture_stream, bids, asks, this->last_update_id, event.event_time);
+            }
+            else
+            {
+                this->capture->write_depth(this->capture_stream, event);
+            }
+        }
+
+        // publish the new top of book for readers on other threads
+        publish_depth_view(event.event_time, false);
+        return check;
+    }
 
     /**
      * Initialises the Order Book.
@@ -133,6 +568,10 @@ public:
             throw std::invalid_argument("[OrderBook][init] Data buffer reference is pointing to nullptr!");
         }
 
+        // anything retained from before is older than the buffer contents, and will be covered by the new snapshot
+        this->retained_events.clear();
+        this->retained_cursor = 0;
+
         // wait for data buffer to be ready
         do
         {
@@ -141,7 +580,7 @@ public:
         } while (!this->data_buffer->get_is_ready());
 
         // read the first update from the buffer
-        Binance_DiffDepth first_update;
+        DepthUpdate first_update;
         bool read_success = false;
         const int MAX_RETRIES = 10;
         const int MAX_SNAPSHOT_RETRIES = 10;
@@ -172,251 +611,128 @@ public:
             throw std::runtime_error("[OrderBook][init] Failed to read initial update after maximum retries");
         }
 
-        // parse the first update ID
-        int64_t first_update_id;
-        try
-        {
-            first_update_id = std::stoll(first_update.first_update_id);
-        }
-        catch (const std::exception &e)
-        {
-            throw std::runtime_error("[OrderBook][init] Failed to parse first_update_id: " + std::string(e.what()));
-        }
-
         // create a JSON parser
         simdjson::ondemand::parser parser;
-        int64_t last_update_id = 0;
+        int64_t snapshot_update_id = 0;
+        bool snapshot_valid = false;
 
         // fetch the snapshot and parse it
-        for (int snapshot_retry_count = 0; snapshot_retry_count < MAX_SNAPSHOT_RETRIES; snapshot_retry_count++)
+        for (int snapshot_retry_count = 0; snapshot_retry_count < MAX_SNAPSHOT_RETRIES && !snapshot_valid; snapshot_retry_count++)
         {
-            cpr::Response snapshot_response = cpr::Get(cpr::Url{this->snapshot_url});
-            if (snapshot_response.status_code != 200)
+            if (!fetch_snapshot(parser, this->bids, this->asks, snapshot_update_id))
             {
-                std::cerr << "HTTP error: " << snapshot_response.status_code << std::endl;
                 continue;
             }
 
-            // parse the snapshot - if the last update ID (from snapshot) is greater than or equal to the first update ID (from first event in buffer), we have a valid snapshot
-            try
-            {
-                auto doc = parser.iterate(snapshot_response.text);
-                last_update_id = doc["lastUpdateId"].get_int64();
-
-                if (last_update_id >= first_update_id)
-                {
-                    std::cout << "Last update ID from snapshot: " << last_update_id << std::endl;
-
-                    // Parse bids with more careful array handling
-                    auto bids = doc["bids"].get_array();
-                    for (auto bid : bids)
-                    {
-                        double price, quantity;
-                        if (parse_price_level(bid.get_array(), price, quantity))
-                        {
-                            if (quantity > 0)
-                            {
-                                bid_map[price] = quantity;
-                                bid_heap.push(price);
-                            }
-                        }
-                    }
-
-                    // Parse asks with more careful array handling
-                    auto asks = doc["asks"].get_array();
-                    for (auto ask : asks)
-                    {
-                        double price, quantity;
-                        if (parse_price_level(ask.get_array(), price, quantity))
-                        {
-                            if (quantity > 0)
-                            {
-                                ask_map[price] = quantity;
-                                ask_heap.push(price);
-                            }
-                        }
-                    }
-                    break;
-                }
-            }
-            catch (const simdjson::simdjson_error &e)
+            // the snapshot is only valid if it reaches the first event in the buffer, otherwise the events in between are missing
+            snapshot_valid = Venue::snapshot_covers(snapshot_update_id, first_update);
+            if (snapshot_valid)
             {
-                std::cerr << "[OrderBook][init] JSON parsing error: " << e.what() << std::endl;
-                continue;
+                std::cout << "Last update ID from snapshot: " << snapshot_update_id << std::endl;
+                break;
             }
 
             // if the last update ID is invalid, wait and retry
-            std::cout << "[WARNING] Snapshot lastUpdateId < first update ID, fetching new snapshot" << std::endl;
+            std::cout << "[WARNING] Snapshot " << snapshot_update_id << " does not reach first update ID " << first_update.first_update_id << ", fetching new snapshot" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
 
         // if we failed to get a valid snapshot after maximum retries, throw an exception
-        if (last_update_id < first_update_id)
+        if (!snapshot_valid)
         {
             throw std::runtime_error("[OrderBook][init] Failed to get valid snapshot after maximum retries");
         }
 
         std::cout << "[OrderBook][init] Snapshot validated and stored, checking buffered events" << std::endl;
+        this->last_update_id = snapshot_update_id;
+        this->first_after_snapshot = true;
+        publish_depth_view(first_update.event_time, true);
 
-        // Clean up buffer - remove events with final update ID <= last_update_id
-        Binance_DiffDepth event;
+        // Clean up buffer - remove events with final update ID <= snapshot_update_id
+        DepthUpdate event;
         while (this->data_buffer->try_pop(event)) // Use try_pop instead of try_read
         {
-            try
+            // If we find an event with final_update_id > snapshot_update_id, it's still needed
+            // retain it so it's applied before anything else in the buffer (pushing it back would put it behind newer events)
+            if (event.final_update_id > snapshot_update_id)
             {
-                if (event.final_update_id.empty())
-                {
-                    std::cerr << "Warning: Empty final_update_id encountered" << std::endl;
-                    continue; // Skip this event
-                }
-
-                int64_t event_final_id = std::stoll(event.final_update_id);
-
-                // If we find an event with final_update_id > last_update_id,
-                // we need to put it back in the buffer as it's still needed
-                if (event_final_id > last_update_id)
-                {
-                    if (!this->data_buffer->try_push(event))
-                    {
-                        std::cerr << "Failed to push back valid event to buffer" << std::endl;
-                    }
-                    break; // Exit the loop as all subsequent events will also be newer
-                }
-
-                // Otherwise, the event is old and has been removed by try_pop
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error processing buffered event: " << e.what() << " (final_update_id: '" << event.final_update_id << "')" << std::endl;
+                this->retained_events.push_back(std::move(event));
+                break; // Exit the loop as all subsequent events will also be newer
             }
+
+            // Otherwise, the event is old and has been removed by try_pop
         }
 
         // order book is synced
+        this->sync_state.store(SyncState::SYNCED, std::memory_order_release);
         std::cout << "[OrderBook][init] Order book is synced!" << std::endl;
         return true;
     }
 
     /**
-     * @brief Continuously update the order book using the websocket data buffer events
+     * @brief Continuously update the order book using the websocket data buffer events, until stop() is called
+     * @return true once stopped, false if the book couldn't be re-initialised after a gap
      */
     bool keep_orderbook_sync()
     {
         // stores the event to be processed
-        Binance_DiffDepth event;
-        int64_t local_update_id = 0; // Local order book update ID
+        DepthUpdate event;
 
         // continuously process events from the buffer
-        while (true)
+        while (!this->stop_requested.load(std::memory_order_acquire))
         {
-            // check if the buffer is ready and try to pop an event
-            if (this->data_buffer->get_is_ready() && this->data_buffer->try_pop(event))
+            // a resync was requested by another thread (e.g. the snapshot verifier found the book has drifted)
+            if (this->resync_requested.exchange(false, std::memory_order_acq_rel))
             {
-                try
+                std::cerr << "[OrderBook][keep_orderbook_sync] Resync requested. Discarding local order book and restarting." << std::endl;
+                if (!full_resync())
                 {
-                    int64_t event_first_update_id = std::stoll(event.first_update_id);
-                    int64_t event_last_update_id = std::stoll(event.final_update_id);
-
-                    // If the event's last update ID is less than the local update ID, ignore the event
-                    if (event_last_update_id < local_update_id)
-                    {
-                        continue;
-                    }
+                    return false;
+                }
+            }
 
-                    // If the event's first update ID is greater than the local update ID, discard the local order book and restart
-                    if (event_first_update_id > local_update_id)
-                    {
-                        std::cerr << "Event's first update ID is greater than the local update ID. Discarding local order book and restarting." << std::endl;
+            // take the next retained event, or pop one from the buffer
+            if (next_event(event))
+            {
+                SequenceCheck check = apply_event(event);
 
-                        // Call init() to reinitialize the order book
-                        if (!this->init())
-                        {
-                            std::cerr << "Failed to re-initialize the order book." << std::endl;
-                            return false; // Return false to indicate failure to re-initialize
-                        }
+                // If the event is entirely covered by the local book (e.g. buffered before the snapshot), ignore the event
+                if (check == SequenceCheck::STALE)
+                {
+                    continue;
+                }
 
-                        // Reset the local update ID after re-initialization
-                        local_update_id = event_last_update_id;
-                        std::cout << "Order book re-initialized successfully." << std::endl;
-                    }
+                // the venue's continuity rules say updates were missed between the local book and this event
+                if (check == SequenceCheck::GAP)
+                {
+                    int64_t gap_size = Venue::gap_size(event, this->last_update_id);
+                    this->last_gap_size.store(gap_size, std::memory_order_relaxed);
+                    std::cerr << "[OrderBook][keep_orderbook_sync] Gap of " << gap_size << " update IDs before event " << event.first_update_id << std::endl;
 
-                    // Update bids and asks
-                    for (const auto &bid : event.bids)
+                    // small gaps: repair from one snapshot, the retained events (including this one) are then replayed by this loop
+                    if (gap_size <= MAX_REPAIRABLE_GAP)
                     {
-                        if (bid.size() >= 2)
+                        if (repair_gap(event))
                         {
-                            double price = std::stod(bid[0]);
-                            double quantity = std::stod(bid[1]);
-
-                            if (quantity > 0)
-                            {
-                                bid_map[price] = quantity;
-                                bid_heap.push(price);
-                            }
-                            else
-                            {
-                                bid_map.erase(price);
-                            }
+                            continue;
                         }
+                        this->repair_failures.fetch_add(1, std::memory_order_relaxed);
                     }
 
-                    for (const auto &ask : event.asks)
+                    // large gap or failed repair - discard the local order book and restart
+                    std::cerr << "Discarding local order book and restarting." << std::endl;
+                    if (!full_resync())
                     {
-                        if (ask.size() >= 2)
-                        {
-                            double price = std::stod(ask[0]);
-                            double quantity = std::stod(ask[1]);
-
-                            if (quantity > 0)
-                            {
-                                ask_map[price] = quantity;
-                                ask_heap.push(price);
-                            }
-                            else
-                            {
-                                ask_map.erase(price);
-                            }
-                        }
+                        return false; // Return false to indicate failure to re-initialize
                     }
-
-                    // Set the local update ID to the event's last update ID
-                    local_update_id = event_last_update_id;
-
-                    // Log that the update was processed
-                    std::cout << "Processed update: " << event.final_update_id << std::endl;
-                }
-                catch (const std::exception &e)
-                {
-                    std::cerr << "Error processing update: " << e.what() << std::endl;
+                    continue;
                 }
             }
 
-            // check if the top of each heap is still a valid price in the maps, otherwise remove value
-            while (!bid_heap.empty() && bid_map.find(bid_heap.top()) == bid_map.end())
-            {
-                bid_heap.pop();
-            }
-
-            while (!ask_heap.empty() && ask_map.find(ask_heap.top()) == ask_map.end())
-            {
-                ask_heap.pop();
-            }
-
-            // log best current bid/ask
-            if (!bid_heap.empty() && !ask_heap.empty())
-            {
-                std::cout << "Best bid: $" << bid_heap.top() << " Best ask: $" << ask_heap.top() << std::endl;
-                double spread = ask_heap.top() - bid_heap.top();
-                std::cout << "Spread: $" << spread << std::endl;
-
-                // write stats to file
-                std::string stats = "Timestamp: " + std::to_string(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
-                stats += " Best bid: $" + std::to_string(bid_heap.top()) + " Best ask: $" + std::to_string(ask_heap.top()) + " Spread: $" + std::to_string(spread) + "\n";
-                file_io.append_to_file("order_book_stats.txt", stats);
-            }
-
             // sleep for a short time before checking the buffer again
             // std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
+        return true;
     }
 };
 
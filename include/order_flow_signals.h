@@ -0,0 +1,104 @@
+// Header file for order_flow_signals.cpp - order flow imbalance, queue depletion and cancel/replenish intensity, computed on the apply thread
+#ifndef ORDER_FLOW_SIGNALS_H
+#define ORDER_FLOW_SIGNALS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "depth_view.h"
+#include "level_change.h"
+#include "seqlock.h"
+
+// maximum number of levels the signals are computed for
+constexpr size_t ORDER_FLOW_LEVELS = 10;
+
+/**
+ * @brief Order flow signals of one book after an applied event. Rates are exponentially decayed sums divided by the decay time constant,
+ * i.e. quantity per second over roughly the last time constant. Levels are by depth from the best price (0 = best).
+ */
+struct OrderFlowSnapshot
+{
+    int64_t update_id;                                  // final update ID of the last event
+    int64_t event_time;                                 // exchange event time of the last event (ms)
+    uint32_t levels;                                    // valid entries in the per-level arrays
+    uint32_t reserved;
+    double ofi[ORDER_FLOW_LEVELS];                      // order flow imbalance of the last event at each level
+    double ofi_rate[ORDER_FLOW_LEVELS];                 // decayed order flow imbalance at each level
+    double bid_depletion_rate;                          // quantity leaving the best bid queue
+    double ask_depletion_rate;                          // quantity leaving the best ask queue
+    double bid_cancel_rate[ORDER_FLOW_LEVELS];          // quantity removed at each bid level (cancels and fills - depth diffs can't tell them apart)
+    double ask_cancel_rate[ORDER_FLOW_LEVELS];
+    double bid_replenish_rate[ORDER_FLOW_LEVELS];       // quantity added at each bid level
+    double ask_replenish_rate[ORDER_FLOW_LEVELS];
+};
+
+/**
+ * @brief The OrderFlowSignals class computes incremental order flow features for one book, on the book's apply thread.
+ *
+ * Level changes arrive from the apply loop with the quantity before and after, so removals and additions are classified as they are
+ * applied, without a second pass over the book. At the end of each event the new top levels are compared with the previous ones to
+ * get the order flow imbalance at each level (Cont, Kukanov and Stoikov, extended to several levels):
+ *     e = [P_b >= P_b'] q_b - [P_b <= P_b'] q_b' - [P_a <= P_a'] q_a + [P_a >= P_a'] q_a'
+ * where primes are the level before the event. Everything is O(levels) per event and decayed on exchange event time.
+ * Signals are published through a SeqLock after every event, so any thread can read them without blocking the apply thread.
+ * A snapshot reload resets the baseline rather than counting the jump as flow.
+ */
+class OrderFlowSignals
+{
+private:
+    size_t levels;
+    double time_constant_ms;
+
+    // top levels before the current event
+    DepthView previous{};
+    bool has_previous = false;
+    int64_t last_event_time = 0;
+
+    // quantity removed and added at each level during the current event
+    double bid_removed[ORDER_FLOW_LEVELS] = {};
+    double ask_removed[ORDER_FLOW_LEVELS] = {};
+    double bid_added[ORDER_FLOW_LEVELS] = {};
+    double ask_added[ORDER_FLOW_LEVELS] = {};
+
+    // decayed sums, published as rates
+    OrderFlowSnapshot sums{};
+    SeqLock<OrderFlowSnapshot> snapshot;
+
+    size_t depth_of(double price, bool is_bid) const;
+    void clear_event();
+    void on_level_change(const LevelChange &change);
+    void on_book_update(const DepthView &view, bool reloaded);
+
+public:
+    /**
+     * @brief Construct a new OrderFlowSignals
+     * @param levels Number of levels to compute signals for, at most ORDER_FLOW_LEVELS
+     * @param time_constant Decay time constant of the rates
+     */
+    explicit OrderFlowSignals(size_t levels = 5, std::chrono::milliseconds time_constant = std::chrono::milliseconds(1000));
+
+    OrderFlowSignals(const OrderFlowSignals &) = delete;
+    OrderFlowSignals &operator=(const OrderFlowSignals &) = delete;
+
+    /**
+     * @brief Compute signals from a book's apply thread - must be called before the apply thread starts, and only for one book
+     * @param book The book - anything with add_level_listener() and add_update_listener()
+     */
+    template <typename Book>
+    void attach(Book &book)
+    {
+        book.add_level_listener(&OrderFlowSignals::level_change_callback, this);
+        book.add_update_listener(&OrderFlowSignals::book_update_callback, this);
+    }
+
+    // listener trampolines, public so the engine can also be driven without a book
+    static void level_change_callback(const LevelChange &change, void *user);
+    static void book_update_callback(const DepthView &view, bool reloaded, void *user);
+
+    /**
+     * @brief Get the SeqLock the signals are published through after every event
+     */
+    const SeqLock<OrderFlowSnapshot> &get_snapshot() const;
+};
+
+#endif // ORDER_FLOW_SIGNALS_H
@@ -0,0 +1,246 @@
+// Header file for order_gateway.cpp - order entry over the Binance WebSocket API, with request correlation and ack latency histograms
+#ifndef ORDER_GATEWAY_H
+#define ORDER_GATEWAY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <libwebsockets.h>
+#include "simdjson.h"
+#include "circular_buffer.h"
+#include "hmac_signer.h"
+#include "latency_histogram.h"
+#include "order.h"
+#include "websocket_client.h"
+
+// request slots, which is also the most requests in flight - must be a power of 2
+constexpr size_t ORDER_GATEWAY_SLOTS = 1024;
+// largest request message, after the LWS_PRE padding
+constexpr size_t ORDER_REQUEST_SIZE = 1024;
+
+/**
+ * @brief Where an order gateway connects to
+ */
+struct OrderGatewayEndpoints
+{
+    std::string host;
+    int port;
+    std::string path;
+    bool ssl;
+
+    /**
+     * @brief The Binance spot WebSocket API: https://developers.binance.com/docs/binance-spot-api-docs/web-socket-api
+     */
+    static OrderGatewayEndpoints binance_spot()
+    {
+        return OrderGatewayEndpoints{"ws-api.binance.com", 443, "/ws-api/v3", true};
+    }
+
+    /**
+     * @brief A MockOrderVenue on this machine
+     */
+    static OrderGatewayEndpoints mock(int port)
+    {
+        return OrderGatewayEndpoints{"127.0.0.1", port, "/ws-api/v3", false};
+    }
+};
+
+/**
+ * @brief A new order
+ */
+struct OrderRequest
+{
+    char symbol[16];           // venue symbol, e.g. "XRPUSDT"
+    OrderSide side;
+    OrderType type;            // LIMIT is sent as good-till-cancelled, IOC as a limit order with timeInForce IOC
+    uint8_t price_decimals;    // decimals the price and quantity are sent with - at most the symbol's tick and step size
+    uint8_t quantity_decimals;
+    double price;              // ignored for MARKET
+    double quantity;
+    uint64_t client_order_id;  // sent as newClientOrderId, and what cancels refer to
+};
+
+/**
+ * @brief Where a request is - only the gateway's threads move it on, see OrderGateway
+ */
+enum class RequestState : uint8_t
+{
+    FREE,       // slot never used
+    QUEUED,     // built, waiting for the socket
+    SENT,       // written, waiting for the response
+    COMPLETING, // response being recorded
+    ACKED,      // the venue accepted it
+    REJECTED,   // the venue refused it, or the connection dropped before it was sent
+    TIMED_OUT,  // no response in time - a late response is dropped
+};
+
+/**
+ * @brief The venue's response to a request
+ */
+struct OrderResponse
+{
+    int64_t request_id;
+    RequestState state;      // ACKED or REJECTED
+    int32_t status;          // HTTP-style status from the venue, 0 if the request was never sent
+    int32_t error_code;      // venue error code, 0 if accepted
+    int64_t order_id;        // venue order ID, -1 if rejected
+    int64_t submit_to_ack_ns; // from place()/cancel() to the response
+    int64_t write_to_ack_ns;  // from the socket write to the response, i.e. the wire and the venue
+};
+
+// callback for every response - runs on the gateway's connection thread, so it should just hand the response off
+using OrderResponseListener = void (*)(const OrderResponse &response, void *user);
+
+/**
+ * @brief The OrderGateway class sends orders and cancels over one persistent WebSocket API connection and correlates the responses.
+ *
+ * Requests are built straight into pre-allocated slots that already have LWS_PRE bytes of padding in front, so sending is a single
+ * lws_write() with no copy or allocation. The sending thread claims the slot for the next request ID (request ID & (slots - 1)),
+ * skipping request IDs whose slots are still in flight so one slow request doesn't hold up the others. It fills the slot, publishes it
+ * with a release store, queues its index on a lock-free ring and wakes the connection thread. The connection thread writes it and,
+ * when the response arrives, finds the slot from the response's ID, checks it still belongs to that request, and records the result
+ * and the send-to-ack latencies with a compare-and-swap - so a request that timed out can't be completed by a late response.
+ * Requests are signed with HMAC-SHA256 of their parameters in alphabetical order, as Binance requires for HMAC API keys, from the key's
+ * precomputed pad states (see HmacSigner). HMAC keys can't log a WebSocket API session on, so every request carries apiKey, timestamp
+ * and signature. Parameters are formatted with std::to_chars and the request is built on the stack and in its slot, without allocating.
+ * place() and cancel() must be called from a single sending thread.
+ */
+class OrderGateway
+{
+private:
+    // one request, from place()/cancel() until its slot is reused
+    struct alignas(64) Slot
+    {
+        std::atomic<int64_t> request_id{0};
+        std::atomic<RequestState> state{RequestState::FREE};
+        size_t length = 0;
+        int64_t submit_ns = 0;
+        int64_t write_ns = 0;
+        int32_t status = 0;
+        int32_t error_code = 0;
+        int64_t order_id = -1;
+        int64_t submit_to_ack_ns = 0;
+        int64_t write_to_ack_ns = 0;
+        unsigned char buffer[LWS_PRE + ORDER_REQUEST_SIZE];
+    };
+
+    // a request parameter - given in alphabetical order, which is the order Binance signs them in
+    struct Param
+    {
+        const char *key;
+        std::string_view value;
+        bool quoted; // a JSON string rather than a number
+    };
+
+    OrderGatewayEndpoints endpoints;
+    std::string api_key;
+    HmacSigner signer;
+    std::chrono::nanoseconds request_timeout;
+
+    std::vector<Slot> slots;
+    // slot indices waiting for the socket - single producer (the sending thread), single consumer (the connection thread).
+    // Twice the slots, as the ring keeps one entry empty and every slot can be queued at once
+    CircularBuffer<uint32_t, 2 * ORDER_GATEWAY_SLOTS> queue;
+    int64_t next_request_id = 1;
+
+    WebSocketClient client;
+    std::thread client_thread;
+    // the connection, only touched on the connection thread
+    struct lws *connection = nullptr;
+    std::atomic<bool> connected{false};
+    simdjson::ondemand::parser parser;
+    std::vector<std::pair<OrderResponseListener, void *>> listeners;
+
+    LatencyHistogram submit_to_ack;
+    LatencyHistogram write_to_ack;
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> unmatched_responses{0};
+
+    Slot *claim(int64_t &request_id);
+    bool build(const char *method, const Param *params, size_t count, int64_t request_id, Slot &slot) const;
+    void publish(Slot &slot, int64_t request_id);
+    void write_next();
+    void on_message(std::string &message);
+    void fail_queued();
+    void complete(Slot &slot, int64_t request_id, RequestState state, int32_t status, int32_t error_code, int64_t order_id);
+
+public:
+    /**
+     * @brief Construct a gateway - nothing is connected until connect()
+     * @param endpoints Where to connect
+     * @param api_key The API key sent with every request
+     * @param secret The API key's secret, used to sign requests
+     * @param request_timeout How long a request can go without a response before its slot can be reused
+     */
+    OrderGateway(const OrderGatewayEndpoints &endpoints, const std::string &api_key, const std::string &secret,
+                 std::chrono::milliseconds request_timeout = std::chrono::milliseconds(10000));
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway &) = delete;
+    OrderGateway &operator=(const OrderGateway &) = delete;
+
+    // libwebsockets callback for the connection - the gateway is its client's stream_buffer
+    static int gateway_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
+
+    /**
+     * @brief Register a callback for every response - must be called before connect()
+     */
+    void add_listener(OrderResponseListener listener, void *user);
+
+    /**
+     * @brief Start the connection thread
+     */
+    void connect();
+
+    /**
+     * @brief Close the connection and wait for its thread
+     */
+    void stop();
+
+    /**
+     * @brief Whether the connection is up - requests are refused until it is
+     */
+    bool is_connected() const;
+
+    /**
+     * @brief Send a new order
+     * @return The request ID, or -1 if the gateway isn't connected or every slot is in flight
+     */
+    int64_t place(const OrderRequest &order);
+
+    /**
+     * @brief Cancel an order by its client order ID
+     * @return The request ID, or -1 if the gateway isn't connected or every slot is in flight
+     */
+    int64_t cancel(const char *symbol, uint64_t client_order_id);
+
+    /**
+     * @brief Get a request's response - responses are kept until the request's slot is reused, at least ORDER_GATEWAY_SLOTS request IDs later.
+     * Must be called from the sending thread, the only thread that reuses slots.
+     * @param request_id The request ID from place() or cancel()
+     * @param response Set to the response
+     * @return true if the response has arrived, false if it hasn't (or the slot has moved on to another request)
+     */
+    bool get_response(int64_t request_id, OrderResponse &response) const;
+
+    /**
+     * @brief Get the latency from place()/cancel() to the response
+     */
+    const LatencyHistogram &get_submit_to_ack() const;
+
+    /**
+     * @brief Get the latency from the socket write to the response
+     */
+    const LatencyHistogram &get_write_to_ack() const;
+
+    uint64_t get_timeouts() const;
+    uint64_t get_unmatched_responses() const;
+};
+
+#endif // ORDER_GATEWAY_H
@@ -0,0 +1,184 @@
+// Header file for pnl_tracker.cpp - positions, average cost and mark-to-market PnL, marked only for symbols with an open position
+#ifndef PNL_TRACKER_H
+#define PNL_TRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "circular_buffer.h"
+#include "depth_view.h"
+#include "order.h"
+#include "seqlock.h"
+
+// fills that can wait for the tracker thread
+constexpr size_t PNL_FILL_QUEUE_SIZE = 4096;
+
+/**
+ * @brief Price open positions are marked at
+ */
+enum class MarkPrice : uint8_t
+{
+    MID,        // (bid + ask) / 2
+    MICROPRICE, // mid weighted towards the side with less quantity: (bid * ask_qty + ask * bid_qty) / (bid_qty + ask_qty)
+};
+
+/**
+ * @brief One of our fills
+ */
+struct PositionFill
+{
+    uint32_t symbol; // tracker symbol ID
+    OrderSide side;
+    double price;
+    double quantity;
+    double fee;      // in quote currency, taken off realised PnL
+};
+
+/**
+ * @brief A symbol's position and PnL, in quote currency
+ */
+struct SymbolPnl
+{
+    double position;       // base currency, negative when short
+    double average_cost;   // average entry price of the open position, 0 when flat
+    double mark;           // price the position was last marked at, 0 if the book had no BBO yet
+    double realised_pnl;
+    double unrealised_pnl; // position * (mark - average_cost)
+    int64_t mark_time;     // exchange event time (ms) of the book the mark came from
+    uint64_t fills;
+};
+
+/**
+ * @brief Totals over every symbol, in quote currency - assumes every symbol is quoted in the same currency
+ */
+struct PortfolioSnapshot
+{
+    double realised_pnl;
+    double unrealised_pnl;
+    double total_pnl;
+    double gross_exposure; // sum of |position| * mark
+    double net_exposure;   // sum of position * mark
+    uint32_t open_positions;
+    uint64_t fills;
+    uint64_t marks;        // times an open position was re-marked
+};
+
+/**
+ * @brief The PnlTracker class keeps each symbol's position, average cost and realised PnL from our fills, and marks open positions to
+ * their book's mid or microprice.
+ *
+ * Fills are handed over through a lock-free queue and applied on the tracker's thread, which owns all the state. The thread only
+ * looks at the books of symbols with an open position - kept in a dense list that a symbol joins when its position opens and leaves when
+ * it goes flat - so hundreds of flat books add nothing to a pass. An open symbol is re-marked when its book's SeqLock version has changed,
+ * reading just the top levels in place, and the portfolio totals are adjusted by the difference in its unrealised PnL and exposure
+ * rather than summed again.
+ * Each symbol's SymbolPnl and the PortfolioSnapshot are published through SeqLocks after every pass that changed them, so any thread
+ * can read them without blocking the tracker.
+ */
+class PnlTracker
+{
+private:
+    struct Symbol
+    {
+        std::string name;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version;
+        int32_t open_index;   // index in open, -1 when flat
+        SymbolPnl pnl;
+        double exposure;      // position * mark, as counted in the totals
+        SeqLock<SymbolPnl> published;
+    };
+
+    MarkPrice mark_price;
+    std::chrono::microseconds poll_interval;
+
+    std::vector<std::unique_ptr<Symbol>> symbols;
+    // symbols with an open position
+    std::vector<uint32_t> open;
+    // single producer (the order thread), single consumer (the tracker thread)
+    CircularBuffer<PositionFill, PNL_FILL_QUEUE_SIZE> fills;
+
+    PortfolioSnapshot totals{};
+    SeqLock<PortfolioSnapshot> portfolio;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    void apply_fill(const PositionFill &fill);
+    bool mark(Symbol &symbol);
+    void set_unrealised(Symbol &symbol);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new PnlTracker
+     * @param mark_price Price open positions are marked at
+     * @param poll_interval How long the tracker thread sleeps when nothing changed
+     */
+    explicit PnlTracker(MarkPrice mark_price = MarkPrice::MID, std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~PnlTracker();
+
+    PnlTracker(const PnlTracker &) = delete;
+    PnlTracker &operator=(const PnlTracker &) = delete;
+
+    /**
+     * @brief Track a symbol - must be called before start()
+     * @param book The symbol's book - anything with get_depth_view()
+     * @return The symbol's ID, for fills
+     */
+    template <typename Book>
+    uint32_t add_book(Book &book, const std::string &symbol)
+    {
+        return add_symbol(symbol, book.get_depth_view());
+    }
+
+    /**
+     * @brief Track a symbol marked from a published depth view - must be called before start()
+     */
+    uint32_t add_symbol(const std::string &symbol, const SeqLock<DepthView> &view);
+
+    /**
+     * @brief Hand a fill to the tracker - must only be called from one thread
+     * @return false if the queue is full and the fill was dropped
+     */
+    bool on_fill(const PositionFill &fill);
+
+    /**
+     * @brief Apply queued fills and re-mark open positions whose book changed - what the tracker thread runs
+     * @return The number of fills applied and positions re-marked
+     */
+    size_t poll();
+
+    /**
+     * @brief Start the tracker thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the tracker thread
+     */
+    void stop();
+
+    /**
+     * @brief Get a consistent copy of a symbol's position and PnL as of the last pass
+     */
+    SymbolPnl get_symbol_pnl(uint32_t symbol) const;
+
+    /**
+     * @brief Get a consistent copy of the portfolio totals as of the last pass
+     */
+    PortfolioSnapshot get_portfolio() const;
+
+    /**
+     * @brief Get the SeqLock the portfolio totals are published through
+     */
+    const SeqLock<PortfolioSnapshot> &get_portfolio_view() const;
+
+    const std::string &get_symbol(uint32_t symbol) const;
+};
+
+#endif // PNL_TRACKER_H
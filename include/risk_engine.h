@@ -0,0 +1,139 @@
+// Header file for risk_engine.cpp - constant-time pre-trade risk checks against per-symbol limits and the live BBO
+#ifndef RISK_ENGINE_H
+#define RISK_ENGINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "depth_view.h"
+#include "order.h"
+#include "seqlock.h"
+
+/**
+ * @brief Limits for one symbol
+ */
+struct RiskLimits
+{
+    double max_notional;     // largest order value in quote currency, at its limit price (or the touch for market orders)
+    double price_collar;     // furthest a limit price may be outside the BBO, as a fraction - e.g. 0.05 allows bid * 0.95 to ask * 1.05
+    double max_position;     // largest absolute position in base currency, counting open orders as if they fill
+    double orders_per_second; // sustained order rate
+    uint32_t burst;          // orders that can be sent at once above the sustained rate
+};
+
+/**
+ * @brief Why an order was refused - the checks are all evaluated, so a result can carry several of these
+ */
+enum RiskRejection : uint32_t
+{
+    RISK_PASSED = 0,
+    RISK_INVALID = 1 << 0,      // quantity or limit price isn't positive
+    RISK_NO_MARKET = 1 << 1,    // the book has no bid or no ask to check against
+    RISK_NOTIONAL = 1 << 2,     // order value above max_notional
+    RISK_PRICE_COLLAR = 1 << 3, // limit price outside the collar
+    RISK_POSITION = 1 << 4,     // would take the position past max_position
+    RISK_RATE = 1 << 5,         // above the order rate
+};
+
+/**
+ * @brief The RiskEngine class checks orders against per-symbol limits before they are sent.
+ *
+ * Each symbol's state - its cached BBO, position, open quantity, rate limit and limits - sits in its own cache-line-aligned block, so a
+ * check touches only that block and the book's SeqLock sequence number. The BBO is re-read only when the book's version has changed, and
+ * then only the two top levels are read in place rather than copying the whole depth view.
+ * Every check is evaluated on every order and combined into a bit mask with no early exits; the only branch that depends on the order
+ * is whether it passed, to commit its rate and open quantity. The rate limit is a generic cell rate algorithm - one timestamp per symbol,
+ * one comparison per check - so it costs the same however many orders were sent.
+ * check(), on_fill() and on_done() must be called from one thread (the order sending thread). Symbols must be added before checks start.
+ */
+class RiskEngine
+{
+private:
+    struct alignas(64) SymbolRisk
+    {
+        // book and the BBO last read from it
+        const SeqLock<DepthView> *view;
+        uint64_t version;
+        double bid;
+        double ask;
+
+        double position;  // filled position, negative when short
+        double open_buy;  // quantity of passed buy orders not yet filled or done
+        double open_sell;
+        int64_t rate_tat_ns; // theoretical arrival time of the next order at the sustained rate
+
+        // limits, pre-computed into the form the checks use
+        double max_notional;
+        double collar_low;  // 1 - price_collar
+        double collar_high; // 1 + price_collar
+        double max_position;
+        int64_t rate_interval_ns;  // time per order at the sustained rate
+        int64_t rate_tolerance_ns; // how far ahead of the sustained rate a burst may run
+
+        uint64_t checks;
+        uint64_t rejections;
+    };
+
+    std::vector<SymbolRisk> symbols;
+    std::vector<std::string> names;
+
+    void refresh_bbo(SymbolRisk &risk) const;
+
+public:
+    RiskEngine() = default;
+
+    RiskEngine(const RiskEngine &) = delete;
+    RiskEngine &operator=(const RiskEngine &) = delete;
+
+    /**
+     * @brief Add a symbol to check orders for
+     * @param symbol The symbol's name
+     * @param view The SeqLock its book publishes top levels through
+     * @param limits Its limits
+     * @return The symbol's ID, for check()
+     * @throws std::invalid_argument If a limit isn't positive
+     */
+    uint32_t add_symbol(const std::string &symbol, const SeqLock<DepthView> &view, const RiskLimits &limits);
+
+    /**
+     * @brief Add a symbol from its book - anything with get_depth_view()
+     */
+    template <typename Book>
+    uint32_t add_book(Book &book, const std::string &symbol, const RiskLimits &limits)
+    {
+        return add_symbol(symbol, book.get_depth_view(), limits);
+    }
+
+    /**
+     * @brief Check an order, and count it against the rate limit and the open quantity if it passes
+     * @param symbol The symbol's ID
+     * @param price Limit price, ignored for market orders
+     * @param now_ns Monotonic time now, e.g. steady_clock - passed in so a caller that has already read the clock doesn't read it again
+     * @return RISK_PASSED, or the RiskRejection bits of every check that failed
+     */
+    uint32_t check(uint32_t symbol, OrderSide side, OrderType type, double price, double quantity, int64_t now_ns);
+
+    /**
+     * @brief Move filled quantity of a passed order from open to the position
+     */
+    void on_fill(uint32_t symbol, OrderSide side, double quantity);
+
+    /**
+     * @brief Release the unfilled quantity of a passed order that is done (cancelled, expired or rejected by the venue)
+     */
+    void on_done(uint32_t symbol, OrderSide side, double remaining);
+
+    double get_position(uint32_t symbol) const;
+    double get_open_quantity(uint32_t symbol, OrderSide side) const;
+    uint64_t get_checks(uint32_t symbol) const;
+    uint64_t get_rejections(uint32_t symbol) const;
+    const std::string &get_symbol(uint32_t symbol) const;
+
+    /**
+     * @brief Describe a check result, e.g. "notional|price collar"
+     */
+    static std::string describe(uint32_t result);
+};
+
+#endif // RISK_ENGINE_H
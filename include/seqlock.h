@@ -0,0 +1,104 @@
+// A single-writer, multi-reader sequence lock for publishing small trivially copyable values without blocking the writer
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief The SeqLock class publishes a value from one writer thread to any number of reader threads.
+ * The writer never waits - it bumps the sequence number to an odd value, copies the new value in, then bumps it to the next even value.
+ * Readers copy the value out and retry if the sequence number was odd or changed while they were copying (i.e. they saw a torn write).
+ * @tparam T The published type, must be trivially copyable
+ */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock value must be trivially copyable");
+
+private:
+    // sequence number - odd while a write is in progress
+    // aligned to its own cache line so readers polling it don't share a line with unrelated data
+    alignas(64) std::atomic<uint64_t> sequence{0};
+    // the published value
+    T value{};
+
+public:
+    /**
+     * @brief Publish a new value - must only be called from the single writer thread
+     * @param new_value The value to publish
+     */
+    void store(const T &new_value)
+    {
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+        // odd sequence marks the write as in progress
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        // make sure the odd sequence is visible before any of the value bytes change
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value, &new_value, sizeof(T));
+        // even sequence publishes the completed write
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Try to read a consistent copy of the value, without retrying
+     * @param out Where to copy the value to
+     * @return true if the copy is consistent, false if a write was in progress or happened during the copy
+     */
+    bool try_load(T &out) const
+    {
+        uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            return false;
+        }
+
+        std::memcpy(&out, &value, sizeof(T));
+        // make sure the value bytes are read before the sequence is checked again
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    /**
+     * @brief Try to read part of the value in place, without copying all of it - for readers that only need a few fields of a large value
+     * @param reader Called with the value, copies out what it needs - it may see a torn write, so it must only copy, and its copies
+     * must be discarded if this returns false
+     * @return true if what the reader copied is consistent
+     */
+    template <typename Reader>
+    bool try_read(Reader &&reader) const
+    {
+        uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            return false;
+        }
+
+        reader(value);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    /**
+     * @brief Read a consistent copy of the value, spinning until one is obtained
+     * @param out Where to copy the value to
+     */
+    void load(T &out) const
+    {
+        while (!try_load(out))
+        {
+        }
+    }
+
+    /**
+     * @brief Get the current sequence number - changes every time a new value is published
+     */
+    uint64_t version() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SEQLOCK_H
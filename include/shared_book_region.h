@@ -0,0 +1,293 @@
+// Named POSIX shared memory region that mirrors the top levels of every order book for other processes on the same machine
+#ifndef SHARED_BOOK_REGION_H
+#define SHARED_BOOK_REGION_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "depth_view.h"
+#include "seqlock.h"
+#include "sync_stats.h"
+
+// identifies a CryptoPlusPlus book region ("CPPBOOKS")
+constexpr uint64_t SHARED_BOOK_MAGIC = 0x435050424f4f4b53ULL;
+// bumped whenever the layout of the structs below changes
+constexpr uint32_t SHARED_BOOK_LAYOUT_VERSION = 1;
+// maximum symbol length stored in a slot, including the terminating null
+constexpr size_t SHARED_SYMBOL_LENGTH = 24;
+
+/**
+ * @brief Everything published for one book - the top levels plus sync metadata
+ */
+struct SharedBookRecord
+{
+    DepthView view;           // top levels of the book
+    int64_t publish_time_ns;  // local wall clock time the record was published (ns since epoch)
+    uint64_t gap_repairs;     // see SyncStats
+    uint64_t full_resyncs;    // see SyncStats
+    SyncState sync_state;     // what the apply thread was doing when the record was published
+};
+
+/**
+ * @brief One book's entry in the region - its symbol and a SeqLock protecting its latest record
+ */
+struct alignas(64) SharedBookSlot
+{
+    char symbol[SHARED_SYMBOL_LENGTH];
+    SeqLock<SharedBookRecord> book;
+};
+
+/**
+ * @brief Header at the start of the region, followed directly by max_books SharedBookSlots
+ */
+struct alignas(64) SharedBookDirectory
+{
+    std::atomic<uint64_t> magic;      // SHARED_BOOK_MAGIC once the region is initialised - stored last, with release
+    uint32_t layout_version;          // SHARED_BOOK_LAYOUT_VERSION
+    uint32_t max_books;               // number of slots following the directory
+    uint32_t depth_levels;            // DEPTH_VIEW_LEVELS of the writer
+    std::atomic<uint32_t> book_count; // number of registered slots - a slot is complete before it's counted
+    int64_t created_ns;               // wall clock time the region was created (ns since epoch)
+};
+
+// the atomics are shared between processes, so they must not fall back to a (process-local) lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Shared book region atomics must be lock free");
+
+/**
+ * @brief Get the size in bytes of a region holding max_books books
+ */
+inline size_t shared_book_region_size(uint32_t max_books)
+{
+    return sizeof(SharedBookDirectory) + static_cast<size_t>(max_books) * sizeof(SharedBookSlot);
+}
+
+/**
+ * @brief The SharedBookRegion class creates and owns the shared memory region, on the feed handler side.
+ * Each order book registers a slot and then publishes into it from its apply thread.
+ */
+class SharedBookRegion
+{
+private:
+    std::string name;
+    size_t size;
+    SharedBookDirectory *directory = nullptr;
+    SharedBookSlot *slots = nullptr;
+
+public:
+    /**
+     * @brief Create (or replace) the named shared memory region
+     * @param name POSIX shared memory name, e.g. "/cryptopp_books"
+     * @param max_books Maximum number of books that can be registered
+     * @throws std::runtime_error If the region can't be created or mapped
+     */
+    SharedBookRegion(const std::string &name, uint32_t max_books)
+        : name(name), size(shared_book_region_size(max_books))
+    {
+        // start from a clean region, readers of a stale one will see the magic disappear on their next open
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("[SharedBookRegion] shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("[SharedBookRegion] ftruncate failed for " + name + ": " + std::strerror(errno));
+        }
+
+        void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            shm_unlink(name.c_str());
+            throw std::runtime_error("[SharedBookRegion] mmap failed for " + name + ": " + std::strerror(errno));
+        }
+
+        directory = new (base) SharedBookDirectory();
+        slots = reinterpret_cast<SharedBookSlot *>(static_cast<char *>(base) + sizeof(SharedBookDirectory));
+        for (uint32_t i = 0; i < max_books; i++)
+        {
+            new (&slots[i]) SharedBookSlot();
+        }
+
+        directory->layout_version = SHARED_BOOK_LAYOUT_VERSION;
+        directory->max_books = max_books;
+        directory->depth_levels = static_cast<uint32_t>(DEPTH_VIEW_LEVELS);
+        directory->created_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        directory->book_count.store(0, std::memory_order_relaxed);
+        // magic last, so a reader never sees a half-initialised directory as valid
+        directory->magic.store(SHARED_BOOK_MAGIC, std::memory_order_release);
+    }
+
+    SharedBookRegion(const SharedBookRegion &) = delete;
+    SharedBookRegion &operator=(const SharedBookRegion &) = delete;
+
+    /**
+     * @brief Unmap and remove the region
+     */
+    ~SharedBookRegion()
+    {
+        if (directory)
+        {
+            directory->magic.store(0, std::memory_order_release);
+            munmap(directory, size);
+            shm_unlink(name.c_str());
+        }
+    }
+
+    /**
+     * @brief Register a book and get the slot it should publish into - call before the book's apply thread starts
+     * @param symbol The book's symbol, as readers will look it up
+     * @return The slot for the book
+     * @throws std::runtime_error If every slot is taken or the symbol is too long
+     */
+    SharedBookSlot *register_book(const std::string &symbol)
+    {
+        if (symbol.size() >= SHARED_SYMBOL_LENGTH)
+        {
+            throw std::runtime_error("[SharedBookRegion] Symbol too long: " + symbol);
+        }
+
+        uint32_t index = directory->book_count.load(std::memory_order_relaxed);
+        if (index >= directory->max_books)
+        {
+            throw std::runtime_error("[SharedBookRegion] No free slots for " + symbol);
+        }
+
+        std::memcpy(slots[index].symbol, symbol.c_str(), symbol.size() + 1);
+        // release so readers that see the new count also see the symbol
+        directory->book_count.store(index + 1, std::memory_order_release);
+        return &slots[index];
+    }
+};
+
+/**
+ * @brief The SharedBookView class maps an existing region read-only, on the reader (other process) side.
+ * Reads are a SeqLock copy straight out of shared memory - no syscalls or locks.
+ */
+class SharedBookView
+{
+private:
+    size_t size = 0;
+    const SharedBookDirectory *directory = nullptr;
+    const SharedBookSlot *slots = nullptr;
+
+public:
+    /**
+     * @brief Map the named region read-only and validate its header
+     * @param name POSIX shared memory name the feed handler created the region with
+     * @throws std::runtime_error If the region doesn't exist or has an unexpected layout
+     */
+    explicit SharedBookView(const std::string &name)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("[SharedBookView] shm_open failed for " + name + ": " + std::strerror(errno));
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedBookDirectory))
+        {
+            close(fd);
+            throw std::runtime_error("[SharedBookView] Region " + name + " is too small");
+        }
+        size = static_cast<size_t>(info.st_size);
+
+        void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            throw std::runtime_error("[SharedBookView] mmap failed for " + name + ": " + std::strerror(errno));
+        }
+
+        directory = static_cast<const SharedBookDirectory *>(base);
+        slots = reinterpret_cast<const SharedBookSlot *>(static_cast<const char *>(base) + sizeof(SharedBookDirectory));
+
+        // acquire pairs with the writer's release, so the rest of the directory is initialised once the magic is seen
+        if (directory->magic.load(std::memory_order_acquire) != SHARED_BOOK_MAGIC || directory->layout_version != SHARED_BOOK_LAYOUT_VERSION ||
+            size < shared_book_region_size(directory->max_books))
+        {
+            munmap(base, size);
+            directory = nullptr;
+            throw std::runtime_error("[SharedBookView] Region " + name + " has an unexpected layout");
+        }
+    }
+
+    SharedBookView(const SharedBookView &) = delete;
+    SharedBookView &operator=(const SharedBookView &) = delete;
+
+    ~SharedBookView()
+    {
+        if (directory)
+        {
+            munmap(const_cast<SharedBookDirectory *>(directory), size);
+        }
+    }
+
+    /**
+     * @brief Check the writer hasn't torn the region down (or replaced it) since it was mapped
+     */
+    bool is_live() const
+    {
+        return directory->magic.load(std::memory_order_acquire) == SHARED_BOOK_MAGIC;
+    }
+
+    /**
+     * @brief Get the number of books currently registered
+     */
+    size_t book_count() const
+    {
+        return directory->book_count.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get a registered slot by index - index must be < book_count()
+     */
+    const SharedBookSlot *slot(size_t index) const
+    {
+        return &slots[index];
+    }
+
+    /**
+     * @brief Find a book by symbol - resolve once and keep the pointer, it stays valid for the life of the region
+     * @return The book's slot, or nullptr if no book with that symbol is registered
+     */
+    const SharedBookSlot *find(const std::string &symbol) const
+    {
+        size_t count = book_count();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (symbol == slots[i].symbol)
+            {
+                return &slots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Copy a consistent record out of a slot
+     * @param slot The slot to read
+     * @param out Where to copy the record
+     * @return false if a write was in progress - retry or use the previous record
+     */
+    static bool try_read(const SharedBookSlot *slot, SharedBookRecord &out)
+    {
+        return slot->book.try_load(out);
+    }
+};
+
+#endif // SHARED_BOOK_REGION_H
@@ -0,0 +1,283 @@
+// Background thread that periodically checks the live order book against a REST depth snapshot
+#ifndef SNAPSHOT_VERIFIER_H
+#define SNAPSHOT_VERIFIER_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "simdjson.h"
+#include "order_book.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief Counters describing the verifier's results so far
+ */
+struct VerifierStats
+{
+    uint64_t checks;            // verification attempts
+    uint64_t matches;           // checks where the live book matched the snapshot
+    uint64_t mismatches;        // checks where the live book differed from the snapshot
+    uint64_t skipped;           // checks that could not be aligned (snapshot failed, history overwritten, book behind snapshot)
+    uint64_t resyncs_triggered; // resyncs requested from the order book
+};
+
+/**
+ * @brief The SnapshotVerifier class detects drift in the live order book (e.g. updates dropped when the ingestion buffer was full).
+ *
+ * Every interval it fetches a REST depth snapshot, reads the book's published depth view, and rolls the snapshot forward to the view's
+ * update ID using the book's delta history. The rolled-forward snapshot and the view then describe the same point in the stream and are
+ * compared by hash, then level by level to report where they differ.
+ * The apply thread is never paused - the verifier only reads the SeqLock depth view and the delta history.
+ * A resync is only requested after mismatch_threshold consecutive mismatches, so a single unlucky check can't throw away a good book.
+ */
+template <typename Book>
+class SnapshotVerifier
+{
+private:
+    // the book being verified - an OrderBook for any venue
+    Book *order_book;
+    // time between checks
+    std::chrono::milliseconds interval;
+    // consecutive mismatches required before a resync is requested
+    int mismatch_threshold;
+    // consecutive mismatches seen so far
+    int consecutive_mismatches = 0;
+
+    // verifier thread and its run flag
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    // counters, written by the verifier thread only
+    std::atomic<uint64_t> checks{0};
+    std::atomic<uint64_t> matches{0};
+    std::atomic<uint64_t> mismatches{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> resyncs_triggered{0};
+
+    // reused between checks to avoid reallocating
+    simdjson::ondemand::parser parser;
+    BookSide<true> snapshot_bids;
+    BookSide<false> snapshot_asks;
+    std::vector<DeltaRecord> deltas;
+
+    /**
+     * @brief Lower the verifier thread's scheduling priority so it never competes with ingestion
+     */
+    static void lower_thread_priority()
+    {
+#ifdef __linux__
+        sched_param param{};
+        param.sched_priority = 0;
+        if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0)
+        {
+            std::cerr << "[SnapshotVerifier] Failed to set SCHED_IDLE, running at normal priority" << std::endl;
+        }
+#endif
+    }
+
+    /**
+     * @brief Sleep for the check interval, waking early if the verifier is stopped
+     */
+    void wait_interval()
+    {
+        auto deadline = std::chrono::steady_clock::now() + this->interval;
+        while (this->running.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    /**
+     * @brief Log the first level that differs between the live view and the rolled-forward snapshot
+     */
+    static void report_mismatch(const DepthView &live, const DepthView &expected)
+    {
+        std::cerr << "[SnapshotVerifier] Mismatch at update ID " << live.update_id
+                  << " (live levels " << live.bid_count << "/" << live.ask_count
+                  << ", snapshot levels " << expected.bid_count << "/" << expected.ask_count << ")" << std::endl;
+
+        auto report_side = [](const char *side, const PriceLevel *live_levels, uint32_t live_count, const PriceLevel *expected_levels, uint32_t expected_count)
+        {
+            uint32_t count = std::min(live_count, expected_count);
+            for (uint32_t depth = 0; depth < count; depth++)
+            {
+                if (live_levels[depth].price != expected_levels[depth].price || live_levels[depth].quantity != expected_levels[depth].quantity)
+                {
+                    std::cerr << "[SnapshotVerifier]   " << side << " level " << depth
+                              << ": live $" << live_levels[depth].price << " x " << live_levels[depth].quantity
+                              << ", snapshot $" << expected_levels[depth].price << " x " << expected_levels[depth].quantity << std::endl;
+                    return;
+                }
+            }
+        };
+
+        report_side("bid", live.bids, live.bid_count, expected.bids, expected.bid_count);
+        report_side("ask", live.asks, live.ask_count, expected.asks, expected.ask_count);
+    }
+
+    /**
+     * @brief Fetch a snapshot and compare it against the live book
+     * @return 1 if the book matched, 0 if it did not match, -1 if the check could not be aligned
+     */
+    int check_once()
+    {
+        int64_t snapshot_update_id = 0;
+        if (!this->order_book->fetch_snapshot(this->parser, this->snapshot_bids, this->snapshot_asks, snapshot_update_id))
+        {
+            return -1;
+        }
+
+        // the live book can lag the REST snapshot slightly - give it a moment to catch up
+        DepthView live;
+        const int MAX_ALIGN_RETRIES = 20;
+        for (int retry_count = 0; retry_count < MAX_ALIGN_RETRIES; retry_count++)
+        {
+            this->order_book->get_depth_view().load(live);
+            if (live.update_id >= snapshot_update_id)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (live.update_id < snapshot_update_id)
+        {
+            std::cerr << "[SnapshotVerifier] Live book did not reach snapshot update ID " << snapshot_update_id << ", skipping check" << std::endl;
+            return -1;
+        }
+
+        // roll the snapshot forward to the live view's update ID using the retained deltas
+        if (!this->order_book->get_delta_history().copy_range(snapshot_update_id, live.update_id, this->deltas))
+        {
+            std::cerr << "[SnapshotVerifier] Delta history no longer covers snapshot update ID " << snapshot_update_id << ", skipping check" << std::endl;
+            return -1;
+        }
+        for (const DeltaRecord &delta : this->deltas)
+        {
+            if (delta.is_bid)
+            {
+                this->snapshot_bids.update(delta.price, delta.quantity);
+            }
+            else
+            {
+                this->snapshot_asks.update(delta.price, delta.quantity);
+            }
+        }
+
+        DepthView expected;
+        expected.update_id = live.update_id;
+        expected.event_time = live.event_time;
+        expected.bid_count = static_cast<uint32_t>(this->snapshot_bids.copy_top(expected.bids, DEPTH_VIEW_LEVELS));
+        expected.ask_count = static_cast<uint32_t>(this->snapshot_asks.copy_top(expected.asks, DEPTH_VIEW_LEVELS));
+
+        if (hash_depth_view(live) == hash_depth_view(expected))
+        {
+            return 1;
+        }
+
+        report_mismatch(live, expected);
+        return 0;
+    }
+
+    /**
+     * @brief Verifier thread body - check, update counters, request a resync if the book keeps mismatching
+     */
+    void run()
+    {
+        lower_thread_priority();
+
+        while (this->running.load(std::memory_order_acquire))
+        {
+            wait_interval();
+            if (!this->running.load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            this->checks.fetch_add(1, std::memory_order_relaxed);
+            int result = check_once();
+
+            if (result < 0)
+            {
+                this->skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (result == 1)
+            {
+                this->matches.fetch_add(1, std::memory_order_relaxed);
+                this->consecutive_mismatches = 0;
+                continue;
+            }
+
+            this->mismatches.fetch_add(1, std::memory_order_relaxed);
+            this->consecutive_mismatches++;
+            if (this->consecutive_mismatches >= this->mismatch_threshold)
+            {
+                std::cerr << "[SnapshotVerifier] " << this->consecutive_mismatches << " consecutive mismatches, requesting resync" << std::endl;
+                this->order_book->request_resync();
+                this->resyncs_triggered.fetch_add(1, std::memory_order_relaxed);
+                this->consecutive_mismatches = 0;
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new SnapshotVerifier
+     * @param order_book The order book to verify
+     * @param interval Time between checks
+     * @param mismatch_threshold Consecutive mismatches required before a resync is requested
+     */
+    SnapshotVerifier(Book &order_book, std::chrono::milliseconds interval, int mismatch_threshold = 2)
+        : order_book(&order_book), interval(interval), mismatch_threshold(mismatch_threshold) {}
+
+    ~SnapshotVerifier()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Start the verifier thread
+     */
+    void start()
+    {
+        if (this->running.exchange(true))
+        {
+            return;
+        }
+        this->worker = std::thread(&SnapshotVerifier::run, this);
+    }
+
+    /**
+     * @brief Stop the verifier thread and wait for it to exit
+     */
+    void stop()
+    {
+        this->running.store(false, std::memory_order_release);
+        if (this->worker.joinable())
+        {
+            this->worker.join();
+        }
+    }
+
+    /**
+     * @brief Get a copy of the verifier's counters
+     */
+    VerifierStats get_stats() const
+    {
+        return VerifierStats{
+            this->checks.load(std::memory_order_relaxed),
+            this->matches.load(std::memory_order_relaxed),
+            this->mismatches.load(std::memory_order_relaxed),
+            this->skipped.load(std::memory_order_relaxed),
+            this->resyncs_triggered.load(std::memory_order_relaxed)};
+    }
+};
+
+#endif // SNAPSHOT_VERIFIER_H
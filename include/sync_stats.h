@@ -0,0 +1,52 @@
+// Order book synchronisation state and resync counters
+#ifndef SYNC_STATS_H
+#define SYNC_STATS_H
+
+#include <cstdint>
+
+/**
+ * @brief What the order book apply thread is currently doing
+ */
+enum class SyncState : uint8_t
+{
+    INITIALISING, // waiting for the first snapshot
+    SYNCED,       // applying live events
+    REPAIRING,    // fetching a snapshot to repair a small sequence gap
+    RESYNCING,    // full re-initialisation in progress
+};
+
+/**
+ * @brief Counters describing how often the order book lost sync and how long it took to recover
+ */
+struct SyncStats
+{
+    uint64_t gap_repairs;        // small gaps repaired by replaying retained events on a fresh snapshot
+    uint64_t repair_failures;    // repairs that failed and fell back to a full resync
+    uint64_t full_resyncs;       // full re-initialisations (large gaps, failed repairs, requested resyncs)
+    uint64_t last_resync_us;     // duration of the most recent repair or resync
+    uint64_t max_resync_us;      // longest repair or resync
+    uint64_t total_resync_us;    // total time spent repairing or resyncing
+    int64_t last_gap_size;       // number of update IDs missing in the most recent gap
+};
+
+/**
+ * @brief Convert a SyncState to a short display string
+ */
+inline const char *to_string(SyncState state)
+{
+    switch (state)
+    {
+    case SyncState::INITIALISING:
+        return "INIT";
+    case SyncState::SYNCED:
+        return "SYNCED";
+    case SyncState::REPAIRING:
+        return "REPAIR";
+    case SyncState::RESYNCING:
+        return "RESYNC";
+    default:
+        return "Unknown";
+    }
+}
+
+#endif // SYNC_STATS_H
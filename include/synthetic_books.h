@@ -0,0 +1,145 @@
+// Header file for synthetic_books.cpp - implied cross-rate books built from two leg books, recomputed only when a leg moves
+#ifndef SYNTHETIC_BOOKS_H
+#define SYNTHETIC_BOOKS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "depth_view.h"
+#include "seqlock.h"
+
+/**
+ * @brief How a synthetic pair is built from its two legs
+ */
+enum class SyntheticLegs : uint8_t
+{
+    DIVIDE,   // legs share a quote asset: XRPBTC = XRPUSDT / BTCUSDT
+    MULTIPLY, // legs chain through a middle asset: XRPUSDT = XRPBTC * BTCUSDT
+};
+
+/**
+ * @brief The SyntheticBookEngine class prices synthetic pairs by combining the books of two legs.
+ *
+ * Each synthetic's top levels are implied by walking both legs' top levels at once, so sizes account for the depth of both legs:
+ * a synthetic level is the liquidity available before either leg runs out of its current level. Fees are not applied.
+ * The engine runs on its own thread and only reads the legs' SeqLock depth views. A dependency index maps each leg to the
+ * synthetics that use it, and a leg counts as moved only if its top levels changed - so only synthetics whose legs actually
+ * moved are recomputed. Every synthetic publishes a SeqLock<DepthView>, the same read API as a real book.
+ */
+class SyntheticBookEngine
+{
+private:
+    // a leg book synthetics can be built from
+    struct Leg
+    {
+        std::string symbol;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version; // view version last checked
+        DepthView current;     // top levels last seen
+    };
+
+    // a synthetic pair and its published book
+    struct Synthetic
+    {
+        std::string symbol;
+        uint32_t first_leg;
+        uint32_t second_leg;
+        SyntheticLegs legs;
+        bool dirty = false;        // a leg moved since the last recompute
+        int64_t sequence = 0;      // recompute count, published as the view's update_id
+        SeqLock<DepthView> view;
+    };
+
+    std::vector<Leg> legs;
+    std::vector<std::unique_ptr<Synthetic>> synthetics;
+    // dependency index - dependents[leg] lists the synthetics built from that leg
+    std::vector<std::vector<uint32_t>> dependents;
+    // synthetics marked dirty in the current poll, reused between polls
+    std::vector<uint32_t> dirty;
+
+    std::chrono::microseconds poll_interval;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> recomputes{0};
+
+    int find_leg(const std::string &symbol) const;
+    void recompute(Synthetic &synthetic);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new SyntheticBookEngine
+     * @param poll_interval How long the engine thread sleeps when no leg has moved
+     */
+    explicit SyntheticBookEngine(std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~SyntheticBookEngine();
+
+    SyntheticBookEngine(const SyntheticBookEngine &) = delete;
+    SyntheticBookEngine &operator=(const SyntheticBookEngine &) = delete;
+
+    /**
+     * @brief Register a book synthetics can use as a leg - must be called before start()
+     * @param book The leg book - anything with get_depth_view()
+     * @param symbol The symbol synthetics refer to the leg by
+     */
+    template <typename Book>
+    void add_leg(Book &book, const std::string &symbol)
+    {
+        add_leg(symbol, book.get_depth_view());
+    }
+
+    /**
+     * @brief Register a published depth view synthetics can use as a leg - must be called before start()
+     * @throws std::invalid_argument If a leg with the symbol is already registered
+     */
+    void add_leg(const std::string &symbol, const SeqLock<DepthView> &view);
+
+    /**
+     * @brief Define a synthetic pair - must be called before start()
+     * @param symbol The synthetic's symbol, e.g. "XRPBTC"
+     * @param first_leg Symbol of the first leg, e.g. "XRPUSDT" - synthetic quantities are in this leg's base asset
+     * @param second_leg Symbol of the second leg, e.g. "BTCUSDT"
+     * @param legs How the legs combine
+     * @return The synthetic's ID
+     * @throws std::invalid_argument If either leg isn't registered
+     */
+    uint32_t add_synthetic(const std::string &symbol, const std::string &first_leg, const std::string &second_leg, SyntheticLegs legs);
+
+    /**
+     * @brief Get the SeqLock a synthetic's implied top levels are published through
+     */
+    const SeqLock<DepthView> &get_depth_view(uint32_t synthetic) const;
+
+    /**
+     * @brief Get the IDs of the synthetics built from a leg
+     * @throws std::invalid_argument If the leg isn't registered
+     */
+    const std::vector<uint32_t> &get_dependents(const std::string &leg) const;
+
+    /**
+     * @brief Check every leg and recompute the synthetics of legs that moved - what the engine thread runs
+     * @return The number of synthetics recomputed
+     */
+    size_t poll_legs();
+
+    /**
+     * @brief Start the engine thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the engine thread
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of synthetic recomputes so far
+     */
+    uint64_t get_recomputes() const;
+};
+
+#endif // SYNTHETIC_BOOKS_H
@@ -0,0 +1,74 @@
+// Header file for touch_quoter.cpp - a replay strategy that quotes the touch, and the --backtest run that drives it over recorded captures
+#ifndef TOUCH_QUOTER_H
+#define TOUCH_QUOTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "backtester.h"
+#include "fill_simulator.h"
+#include "order.h"
+#include "pnl_tracker.h"
+
+/**
+ * @brief The TouchQuoter class is a replay strategy that quotes a fixed size at the best bid and ask, moving its quotes when the touch
+ * moves, and books its simulated fills into a PnlTracker marked against the replayed book.
+ * Register order_update_callback() with the simulator, and the quoter itself with Backtester::add_strategy().
+ */
+class TouchQuoter
+{
+private:
+    FillSimulator &simulator;
+    PnlTracker &pnl;
+    uint32_t pnl_symbol;
+    double quantity;
+    double fee_rate; // fee per unit of quote traded
+    std::chrono::microseconds order_latency;
+    uint64_t bid_order = 0; // 0 when not quoting the side
+    uint64_t ask_order = 0;
+    double bid_price = 0;
+    double ask_price = 0;
+    // side of every order still open, as order updates don't carry it
+    std::unordered_map<uint64_t, OrderSide> open_orders;
+
+    void requote(Backtester &backtester, OrderSide side, double price, uint64_t &order, double &quoted_price);
+
+public:
+    /**
+     * @brief Construct a quoter
+     * @param simulator The simulator orders are sent to
+     * @param pnl The tracker fills are booked into
+     * @param pnl_symbol The tracker's symbol ID for the quoted book
+     * @param quantity Size of each quote
+     * @param fee_rate Fee per unit of quote traded
+     * @param order_latency How long after the quoter sees a book change its orders reach the simulator
+     */
+    TouchQuoter(FillSimulator &simulator, PnlTracker &pnl, uint32_t pnl_symbol, double quantity, double fee_rate, std::chrono::microseconds order_latency);
+
+    TouchQuoter(const TouchQuoter &) = delete;
+    TouchQuoter &operator=(const TouchQuoter &) = delete;
+
+    /**
+     * @brief Requote a side whose best price moved
+     */
+    void on_book(Backtester &backtester, const BookEvent &event);
+
+    void on_trade(Backtester &backtester, const TradeEvent &event);
+
+    /**
+     * @brief Simulator listener - books fills and forgets finished orders
+     * @param user The quoter
+     */
+    static void order_update_callback(const SimOrderUpdate &update, void *user);
+};
+
+/**
+ * @brief Replay the recorded spot book and trades through the fill simulator with a TouchQuoter, and print its PnL
+ * @param depth_path The spot book capture (XRPUSDT-depth.cap)
+ * @param trades_path The trade capture (trades.cap)
+ * @return Process exit code
+ */
+int run_touch_backtest(const std::string &depth_path, const std::string &trades_path);
+
+#endif // TOUCH_QUOTER_H
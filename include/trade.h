@@ -0,0 +1,27 @@
+// Venue-neutral trade, decoded from a trade stream and consumed by the bar aggregator
+#ifndef TRADE_H
+#define TRADE_H
+
+#include <cstdint>
+#include "circular_buffer.h"
+
+/**
+ * @brief One aggregated trade - fills of one taker order at one price, with prices and quantities already decoded.
+ * Trivially copyable, so it can be passed through a CircularBuffer without allocating.
+ */
+struct Trade
+{
+    int64_t event_time;     // exchange event time (ms)
+    int64_t trade_time;     // exchange trade time (ms) - bars are bucketed by this
+    int64_t trade_id;       // aggregate trade ID
+    int64_t first_trade_id; // first venue trade ID in the aggregate
+    int64_t last_trade_id;  // last venue trade ID in the aggregate
+    double price;           // trade price
+    double quantity;        // trade quantity (base asset)
+    bool is_buyer_maker;    // true if the buyer was the maker, i.e. the taker sold
+};
+
+// buffer between a trade stream's websocket thread and its consumer
+using TradeBuffer = CircularBuffer<Trade, 4096>;
+
+#endif // TRADE_H
@@ -0,0 +1,163 @@
+// Header file for triangular_arbitrage.cpp - scans three-asset cycles for fee-adjusted arbitrage as BBOs change
+#ifndef TRIANGULAR_ARBITRAGE_H
+#define TRIANGULAR_ARBITRAGE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "depth_view.h"
+#include "seqlock.h"
+
+/**
+ * @brief A cycle whose fee-adjusted return was above the threshold when it was evaluated
+ */
+struct ArbitrageOpportunity
+{
+    uint32_t cycle;               // cycle ID, see get_cycle_description()
+    uint16_t assets[3];           // start asset, then the assets held after the first and second trade
+    uint16_t pairs[3];            // pair traded at each step
+    bool sells_base[3];           // true if the step sells the pair's base asset (at the bid), false if it buys it (at the ask)
+    double net_return;            // fee-adjusted return of one pass around the cycle, e.g. 0.002 = 0.2%
+    double start_quantity;        // most of the start asset the three top-of-book levels can carry around the cycle
+    int64_t event_time;           // exchange event time (ms) of the BBO change that triggered the evaluation
+    int64_t detected_ns;          // local wall clock time (ns since epoch) the opportunity was found
+    int64_t detection_latency_us; // detected_ns - event_time, i.e. exchange event to detection
+};
+
+// callback for opportunities - runs on the scanner thread, so it should just hand the opportunity off
+using OpportunityListener = void (*)(const ArbitrageOpportunity &opportunity, void *user);
+
+/**
+ * @brief The TriangularArbitrageScanner class keeps a graph of assets, with an edge for each direction a pair can be traded in.
+ *
+ * Edge weights are log rates: selling base at the bid converts at bid * (1 - fee), buying it at the ask at (1 - fee) / ask.
+ * A cycle is profitable when its log rates sum above log(1 + threshold), so evaluating a cycle is three additions.
+ * Every three-asset cycle is found once when the scanner starts, and indexed by the pairs it uses. When a pair's best bid or ask
+ * changes, only its edges are updated and only the cycles through it are re-evaluated.
+ * The scanner runs on its own thread and only reads the pairs' SeqLock depth views.
+ */
+class TriangularArbitrageScanner
+{
+private:
+    // a traded pair and its current edges
+    struct Pair
+    {
+        std::string symbol;
+        uint16_t base;
+        uint16_t quote;
+        const SeqLock<DepthView> *view;
+        uint64_t last_version; // view version last checked
+        PriceLevel best_bid;   // BBO last seen
+        PriceLevel best_ask;
+        double log_sell;       // log rate base -> quote, at the bid after fees
+        double log_buy;        // log rate quote -> base, at the ask after fees
+        bool valid;            // both sides have a level
+    };
+
+    // one direction of a three-asset cycle
+    struct Cycle
+    {
+        uint16_t assets[3];
+        uint16_t pairs[3];
+        bool sells_base[3];
+    };
+
+    double fee_rate;
+    // log(1 + threshold), compared against the summed log rates
+    double log_threshold;
+
+    std::vector<std::string> assets;
+    std::vector<Pair> pairs;
+    std::vector<Cycle> cycles;
+    // cycles_by_pair[pair] lists the cycles that trade that pair
+    std::vector<std::vector<uint32_t>> cycles_by_pair;
+    std::vector<std::pair<OpportunityListener, void *>> listeners;
+
+    std::chrono::microseconds poll_interval;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> evaluations{0};
+    std::atomic<uint64_t> opportunities{0};
+
+    uint16_t asset_id(const std::string &asset);
+    int find_pair(uint16_t from, uint16_t to, bool &sells_base) const;
+    void build_cycles();
+    bool evaluate(uint32_t cycle_id, int64_t event_time);
+    void run();
+
+public:
+    /**
+     * @brief Construct a new TriangularArbitrageScanner
+     * @param fee_rate Taker fee charged on every trade, e.g. 0.001 = 0.1%
+     * @param threshold Minimum fee-adjusted return of a cycle to report, e.g. 0.0005 = 0.05%
+     * @param poll_interval How long the scanner thread sleeps when no BBO changed
+     */
+    TriangularArbitrageScanner(double fee_rate = 0.001, double threshold = 0.0, std::chrono::microseconds poll_interval = std::chrono::microseconds(200));
+    ~TriangularArbitrageScanner();
+
+    TriangularArbitrageScanner(const TriangularArbitrageScanner &) = delete;
+    TriangularArbitrageScanner &operator=(const TriangularArbitrageScanner &) = delete;
+
+    /**
+     * @brief Add a pair to the graph - must be called before start()
+     * @param book The pair's book - anything with get_depth_view()
+     * @param symbol The pair's symbol, e.g. "XRPBTC"
+     * @param base The base asset, e.g. "XRP"
+     * @param quote The quote asset, e.g. "BTC"
+     */
+    template <typename Book>
+    void add_pair(Book &book, const std::string &symbol, const std::string &base, const std::string &quote)
+    {
+        add_pair(symbol, base, quote, book.get_depth_view());
+    }
+
+    /**
+     * @brief Add a pair's published depth view to the graph - must be called before start()
+     */
+    void add_pair(const std::string &symbol, const std::string &base, const std::string &quote, const SeqLock<DepthView> &view);
+
+    /**
+     * @brief Register a callback for every opportunity found - must be called before start()
+     */
+    void add_listener(OpportunityListener listener, void *user);
+
+    /**
+     * @brief Find every three-asset cycle in the graph - called by start(), or directly when driving poll_pairs() by hand
+     */
+    void prepare();
+
+    /**
+     * @brief Check every pair for a BBO change and re-evaluate the cycles through the pairs that changed - what the scanner thread runs
+     * @return The number of pairs whose BBO changed
+     */
+    size_t poll_pairs();
+
+    /**
+     * @brief Get a readable description of a cycle, e.g. "USDT -> XRP -> BTC -> USDT (buy XRPUSDT, sell XRPBTC, sell BTCUSDT)"
+     */
+    std::string get_cycle_description(uint32_t cycle) const;
+
+    /**
+     * @brief Get the number of cycles in the graph
+     */
+    size_t get_cycle_count() const;
+
+    /**
+     * @brief Start the scanner thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the scanner thread
+     */
+    void stop();
+
+    uint64_t get_evaluations() const;
+    uint64_t get_opportunities() const;
+};
+
+#endif // TRIANGULAR_ARBITRAGE_H
@@ -0,0 +1,200 @@
+// Compile-time venue adapters - everything venue specific the book engine needs, and the websocket callback that feeds it
+#ifndef VENUE_ADAPTER_H
+#define VENUE_ADAPTER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <libwebsockets.h>
+#include "simdjson.h"
+#include "book_side.h"
+#include "depth_update.h"
+#include "websocket_client.h"
+
+/*
+ * A venue adapter is a struct of static members, passed as the Venue template parameter of OrderBook and venue_callback.
+ * Calls are resolved at compile time, so there is no virtual dispatch on the apply thread. An adapter provides:
+ *
+ *   static constexpr const char *NAME;
+ *       Short venue name used in logs.
+ *   static VenueEndpoints endpoints(const std::string &symbol);
+ *       Default stream and snapshot endpoints for a symbol.
+ *   static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, DepthUpdate &update);
+ *       Decode one complete stream message (any stream framing included) into update. Returns false for messages that
+ *       aren't depth updates (subscription replies, other streams), which are ignored.
+ *   static bool fetch_snapshot(const VenueEndpoints &endpoints, std::string &body);
+ *       Fetch a REST depth snapshot for the endpoints' symbol.
+ *   template <typename Bids, typename Asks>
+ *   static bool parse_snapshot(simdjson::ondemand::parser &parser, std::string &body, Bids &bids, Asks &asks, int64_t &update_id);
+ *       Load a snapshot into a pair of book sides (cleared first) and return its update ID. Templated, since books that track
+ *       level age use a different BookSide instantiation.
+ *   static bool snapshot_covers(int64_t snapshot_update_id, const DepthUpdate &first_event);
+ *       Whether a snapshot can be used with the first buffered event, or a newer snapshot is needed.
+ *   static SequenceCheck check_sequence(const DepthUpdate &update, int64_t last_update_id, bool first_after_snapshot);
+ *       The venue's continuity rules. first_after_snapshot is true until an event has been applied on top of a new snapshot.
+ *   static int64_t gap_size(const DepthUpdate &update, int64_t last_update_id);
+ *       Estimated number of missed update IDs when check_sequence returned GAP.
+ */
+
+/**
+ * @brief Where a venue's stream and snapshots are fetched from - defaults come from the adapter, and can be pointed at a mock venue
+ */
+struct VenueEndpoints
+{
+    std::string symbol;       // venue symbol, e.g. "XRPUSDT"
+    std::string stream_host;  // websocket host
+    int stream_port;          // websocket port
+    std::string stream_path;  // websocket path including the stream name
+    bool stream_ssl;          // use TLS for the websocket
+    std::string snapshot_url; // full REST depth snapshot URL
+};
+
+/**
+ * @brief Collect one websocket fragment into the client's message
+ * @return true once the message is complete - its padding is then allocated, so it can be parsed in place with simdjson
+ */
+inline bool append_fragment(struct lws *wsi, WebSocketClientData *client_data, const void *in, size_t len)
+{
+    // large messages (e.g. busy depth events) can arrive in several fragments - collect them until the final one
+    std::string &message = client_data->message;
+    if (lws_is_first_fragment(wsi))
+    {
+        message.clear();
+    }
+    message.append(static_cast<const char *>(in), len);
+    if (!lws_is_final_fragment(wsi))
+    {
+        return false;
+    }
+
+    // simdjson may read past the end of the message, so make sure the padding is allocated rather than copying into a padded_string
+    message.reserve(message.size() + simdjson::SIMDJSON_PADDING);
+    return true;
+}
+
+/**
+ * @brief libwebsockets callback for a venue's depth stream.
+ * Reassembles fragmented messages, decodes them with the venue adapter and pushes the DepthUpdate to the client's buffer.
+ * Use venue_callback<Venue> wherever a WebSocketClient callback is expected.
+ * @param wsi The websocket instance
+ * @param reason The reason for the callback
+ * @param user User data (WebSocketClientData)
+ * @param in Incoming data
+ * @param len Length of incoming data
+ */
+template <typename Venue>
+int venue_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+{
+    WebSocketClientData *client_data = static_cast<WebSocketClientData *>(user);
+
+    // Only proceed if we have valid client data
+    if (!client_data)
+    {
+        return 0;
+    }
+
+    switch (reason)
+    {
+    case LWS_CALLBACK_CLIENT_ESTABLISHED:
+        lws_callback_on_writable(wsi);
+        break;
+
+    case LWS_CALLBACK_CLIENT_RECEIVE:
+    {
+        if (!append_fragment(wsi, client_data, in, len))
+        {
+            break;
+        }
+
+        // one parser and one update per websocket thread, their buffers are reused from message to message
+        std::string &message = client_data->message;
+        thread_local simdjson::ondemand::parser parser;
+        thread_local DepthUpdate update;
+        if (Venue::decode(parser, simdjson::padded_string_view(message.data(), message.size(), message.capacity()), update))
+        {
+            if (!client_data->buffer->try_push(update))
+            {
+                std::cerr << "[" << Venue::NAME << "] Buffer full, dropping update " << update.final_update_id << std::endl;
+            }
+        }
+        break;
+    }
+
+    case LWS_CALLBACK_CLIENT_CLOSED:
+        std::cout << "[" << Venue::NAME << "] Connection to server closed" << std::endl;
+        // Clean up our client data when connection closes
+        delete client_data;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/*
+ * A stream adapter decodes a venue stream other than depth (trades, klines) into a trivially copyable event. It provides:
+ *
+ *   using Event = ...;
+ *       The decoded event type.
+ *   static constexpr const char *NAME;
+ *       Short stream name used in logs.
+ *   static bool decode(simdjson::ondemand::parser &parser, simdjson::padded_string_view message, Event &event);
+ *       Decode one complete stream message, returning false for messages that should be ignored.
+ */
+
+/**
+ * @brief libwebsockets callback for a non-depth stream - like venue_callback, but pushes Stream::Event to the client's stream buffer.
+ * Use stream_callback<Stream, Size> with a WebSocketClient constructed from a CircularBuffer<typename Stream::Event, Size>.
+ * @param wsi The websocket instance
+ * @param reason The reason for the callback
+ * @param user User data (WebSocketClientData)
+ * @param in Incoming data
+ * @param len Length of incoming data
+ */
+template <typename Stream, size_t Size>
+int stream_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+{
+    WebSocketClientData *client_data = static_cast<WebSocketClientData *>(user);
+    if (!client_data)
+    {
+        return 0;
+    }
+
+    switch (reason)
+    {
+    case LWS_CALLBACK_CLIENT_RECEIVE:
+    {
+        if (!append_fragment(wsi, client_data, in, len))
+        {
+            break;
+        }
+
+        std::string &message = client_data->message;
+        thread_local simdjson::ondemand::parser parser;
+        typename Stream::Event event;
+        if (Stream::decode(parser, simdjson::padded_string_view(message.data(), message.size(), message.capacity()), event))
+        {
+            auto *buffer = static_cast<CircularBuffer<typename Stream::Event, Size> *>(client_data->stream_buffer);
+            if (!buffer->try_push(event))
+            {
+                std::cerr << "[" << Stream::NAME << "] Buffer full, dropping event" << std::endl;
+            }
+        }
+        break;
+    }
+
+    case LWS_CALLBACK_CLIENT_CLOSED:
+        std::cout << "[" << Stream::NAME << "] Connection to server closed" << std::endl;
+        delete client_data;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+#endif // VENUE_ADAPTER_H
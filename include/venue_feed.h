@@ -0,0 +1,166 @@
+// Everything needed to keep one venue book live - ingestion buffer, order book, websocket client and their threads - and the same for non-depth streams
+#ifndef VENUE_FEED_H
+#define VENUE_FEED_H
+
+#include <string>
+#include <thread>
+#include "circular_buffer.h"
+#include "depth_update.h"
+#include "order_book.h"
+#include "venue_adapter.h"
+#include "websocket_client.h"
+
+/**
+ * @brief The VenueFeed class wires a venue's websocket stream into an OrderBook.
+ * connect() starts streaming into the buffer, sync() snapshots the book and starts its apply thread.
+ * The feed owns its buffer, so it must not move once constructed.
+ * @tparam Venue The venue adapter (see venue_adapter.h)
+ * @tparam TrackLevelAge true if the book tracks per-level age
+ */
+template <typename Venue, bool TrackLevelAge = false>
+class VenueFeed
+{
+private:
+    // buffer between the websocket thread and the apply thread
+    CircularBuffer<DepthUpdate, 1024> buffer;
+    OrderBook<Venue, TrackLevelAge> book;
+    WebSocketClient client;
+
+    std::thread client_thread;
+    std::thread sync_thread;
+
+public:
+    /**
+     * @brief Construct a feed for a symbol on the venue's default endpoints
+     * @param symbol Venue symbol, e.g. "XRPUSDT"
+     */
+    explicit VenueFeed(const std::string &symbol)
+        : VenueFeed(Venue::endpoints(symbol)) {}
+
+    /**
+     * @brief Construct a feed on custom endpoints (e.g. a mock venue)
+     */
+    explicit VenueFeed(const VenueEndpoints &endpoints)
+        : book(endpoints, buffer),
+          client(book.get_endpoints().stream_host.c_str(), book.get_endpoints().stream_port, book.get_endpoints().stream_path.c_str(),
+                 venue_callback<Venue>, &buffer, book.get_endpoints().stream_ssl) {}
+
+    VenueFeed(const VenueFeed &) = delete;
+    VenueFeed &operator=(const VenueFeed &) = delete;
+
+    /**
+     * @brief Get the feed's order book
+     */
+    OrderBook<Venue, TrackLevelAge> &get_book()
+    {
+        return this->book;
+    }
+
+    /**
+     * @brief Start the websocket client thread
+     */
+    void connect()
+    {
+        this->client_thread = std::thread(&WebSocketClient::init, &this->client);
+    }
+
+    /**
+     * @brief Initialise the book from a snapshot (blocks until synced), then start its apply thread
+     */
+    void sync()
+    {
+        this->book.init();
+        this->sync_thread = std::thread(&OrderBook<Venue, TrackLevelAge>::keep_orderbook_sync, &this->book);
+    }
+
+    /**
+     * @brief Ask the apply thread and the websocket client to stop - join() then returns once they have
+     */
+    void stop()
+    {
+        this->book.stop();
+        this->client.stop();
+    }
+
+    /**
+     * @brief Wait for the feed's threads to finish
+     */
+    void join()
+    {
+        if (this->client_thread.joinable())
+        {
+            this->client_thread.join();
+        }
+        if (this->sync_thread.joinable())
+        {
+            this->sync_thread.join();
+        }
+    }
+};
+
+/**
+ * @brief The StreamFeed class connects a non-depth venue stream (trades, klines) to a buffer its consumer pops from.
+ * The feed owns its buffer, so it must not move once constructed.
+ * @tparam Stream The stream adapter (see venue_adapter.h)
+ * @tparam Size Buffer size, must be a power of 2
+ */
+template <typename Stream, size_t Size = 4096>
+class StreamFeed
+{
+private:
+    CircularBuffer<typename Stream::Event, Size> buffer;
+    // kept alive for the client, which holds pointers into it
+    VenueEndpoints endpoints;
+    WebSocketClient client;
+
+    std::thread client_thread;
+
+public:
+    /**
+     * @brief Construct a feed on a stream's endpoints, e.g. BinanceAggTrades::endpoints<BinanceSpot>("XRPUSDT")
+     */
+    explicit StreamFeed(const VenueEndpoints &endpoints)
+        : endpoints(endpoints),
+          client(this->endpoints.stream_host.c_str(), this->endpoints.stream_port, this->endpoints.stream_path.c_str(),
+                 stream_callback<Stream, Size>, static_cast<void *>(&buffer), this->endpoints.stream_ssl) {}
+
+    StreamFeed(const StreamFeed &) = delete;
+    StreamFeed &operator=(const StreamFeed &) = delete;
+
+    /**
+     * @brief Get the buffer decoded events are pushed to - it has a single consumer
+     */
+    CircularBuffer<typename Stream::Event, Size> &get_buffer()
+    {
+        return this->buffer;
+    }
+
+    /**
+     * @brief Start the websocket client thread
+     */
+    void connect()
+    {
+        this->client_thread = std::thread(&WebSocketClient::init, &this->client);
+    }
+
+    /**
+     * @brief Ask the websocket client to stop - join() then returns once it has
+     */
+    void stop()
+    {
+        this->client.stop();
+    }
+
+    /**
+     * @brief Wait for the client thread to finish
+     */
+    void join()
+    {
+        if (this->client_thread.joinable())
+        {
+            this->client_thread.join();
+        }
+    }
+};
+
+#endif // VENUE_FEED_H
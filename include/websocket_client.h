@@ -3,10 +3,12 @@
 #define WEBSOCKET_CLIENT_H
 
 #include <libwebsockets.h>
+#include <atomic>
 #include <iostream>
 #include <queue>
-#include "binance.h"
+#include <string>
 #include "circular_buffer.h"
+#include "depth_update.h"
 
 /**
  * @brief The WebSocketClient class is a wrapper around the libwebsockets library. It enables connection to a websocket server as a client
@@ -14,8 +16,8 @@
 class WebSocketClient
 {
 private:
-    // libwebsocket context
-    struct lws_context *context;
+    // libwebsocket context, set by init() on the client thread while the service loop runs - read by wake() and stop() from other threads
+    std::atomic<struct lws_context *> context{nullptr};
     // libwebsocket instance
     struct lws *wsi;
     // libwebsocket info
@@ -26,13 +28,23 @@ private:
     const char *path;
     // WS server port
     int port;
+    // connect with TLS - disabled for plain ws:// servers such as a local mock venue
+    bool use_ssl = true;
+    // protocol table handed to libwebsockets - per client, so each connection keeps its own callback
+    struct lws_protocols protocols[2];
     // callback method, uses default_callback if custom callback not provided
     int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
     // callback method that also takes in a queue
-    int (*callback_queue)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len, CircularBuffer<Binance_DiffDepth, 1024> &buffer);
+    int (*callback_queue)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len, CircularBuffer<DepthUpdate, 1024> &buffer);
 
     // CircularBuffer for storing incoming data
-    CircularBuffer<Binance_DiffDepth, 1024> *buffer;
+    CircularBuffer<DepthUpdate, 1024> *buffer = nullptr;
+    // buffer for streams that don't carry depth updates (e.g. trades) - its type is only known to the stream's callback
+    void *stream_buffer = nullptr;
+    // don't sleep or ask for a writable callback on every service pass - the callback asks for writes itself (see enable_event_driven)
+    bool event_driven = false;
+    // set by stop() to end the service loop
+    std::atomic<bool> stop_requested{false};
 
 public:
     // constructors
@@ -66,8 +78,20 @@ public:
      * @param path The WS server path
      * @param callback The custom callback method
      * @param buffer A pointer to the CircularBuffer to store incoming data
+     * @param use_ssl Connect with TLS
      */
-    WebSocketClient(const char *uri, int port, const char *path, int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len), CircularBuffer<Binance_DiffDepth, 1024> *buffer);
+    WebSocketClient(const char *uri, int port, const char *path, int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len), CircularBuffer<DepthUpdate, 1024> *buffer, bool use_ssl = true);
+
+    /**
+     * @brief Constructor for streams other than depth, whose callback knows the buffer's type (see stream_callback)
+     * @param uri The WS server URI
+     * @param port The WS server port
+     * @param path The WS server path
+     * @param callback The custom callback method
+     * @param stream_buffer Buffer (or any other state the callback needs) handed to the callback through WebSocketClientData::stream_buffer
+     * @param use_ssl Connect with TLS
+     */
+    WebSocketClient(const char *uri, int port, const char *path, int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len), void *stream_buffer, bool use_ssl = true);
 
     // default callback method
     static int default_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len);
@@ -75,15 +99,43 @@ public:
     // initialise Websocket connection
     int init();
 
+    /**
+     * @brief Service the connection without the fixed sleep between passes - for connections that send (e.g. order entry).
+     * The loop then blocks until there is traffic or wake() is called, and the callback must ask for writable callbacks itself.
+     * Must be called before init().
+     */
+    void enable_event_driven();
+
+    /**
+     * @brief Wake the service loop from another thread, which then calls the callback with LWS_CALLBACK_EVENT_WAIT_CANCELLED.
+     * Does nothing while init() isn't running - callers must not rely on a wake before the connection is established.
+     */
+    void wake();
+
+    /**
+     * @brief Ask the service loop to end - init() then returns. Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * @brief Get the buffer (or other state) handed to the callback - the libwebsockets context's user pointer is this client,
+     * so callbacks without a connection (e.g. LWS_CALLBACK_EVENT_WAIT_CANCELLED) can reach it through lws_context_user()
+     */
+    void *get_stream_buffer() const;
+
     // get buffer instance
-    CircularBuffer<Binance_DiffDepth, 1024> *get_buffer();
+    CircularBuffer<DepthUpdate, 1024> *get_buffer();
 };
 
 // WebSocketClientData - used to pass data to callback method in libwebsockets
 struct WebSocketClientData
 {
-    CircularBuffer<Binance_DiffDepth, 1024> *buffer;
+    CircularBuffer<DepthUpdate, 1024> *buffer;
+    // buffer of a non-depth stream, nullptr for depth streams
+    void *stream_buffer;
     WebSocketClient *client;
+    // message being reassembled from fragments, reused between messages
+    std::string message;
 };
 
 #endif
\ No newline at end of file
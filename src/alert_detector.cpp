@@ -0,0 +1,358 @@
+// implementation for AlertDetector class
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../include/alert_detector.h"
+
+namespace
+{
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+/**
+ * @brief Add a depth sample, dropping samples older than the window and any sample no higher than this one
+ * @return The highest depth in the window, this sample included
+ */
+double AlertDetector::DepthWindow::push(int64_t time, double depth, int64_t window_ms)
+{
+    while (this->count > 0 && this->times[this->head] < time - window_ms)
+    {
+        this->head = (this->head + 1) % ALERT_DEPTH_SAMPLES;
+        this->count--;
+    }
+    // a lower sample can never be the peak again while this one is in the window
+    while (this->count > 0 && this->depths[(this->head + this->count - 1) % ALERT_DEPTH_SAMPLES] <= depth)
+    {
+        this->count--;
+    }
+    if (this->count == ALERT_DEPTH_SAMPLES)
+    {
+        this->head = (this->head + 1) % ALERT_DEPTH_SAMPLES;
+        this->count--;
+    }
+    size_t tail = (this->head + this->count) % ALERT_DEPTH_SAMPLES;
+    this->times[tail] = time;
+    this->depths[tail] = depth;
+    this->count++;
+    return this->depths[this->head];
+}
+
+void AlertDetector::DepthWindow::reset()
+{
+    this->head = 0;
+    this->count = 0;
+}
+
+/**
+ * @brief Construct a new AlertDetector
+ * @param output_path File to append to, or socket to send to
+ * @param output Whether output_path is a file or a Unix datagram socket
+ * @param thresholds When to alert
+ * @param poll_interval How long the notifier sleeps when no alerts are waiting
+ * @throws std::invalid_argument If a threshold is out of range
+ */
+AlertDetector::AlertDetector(const std::string &output_path, AlertOutput output, const AlertThresholds &thresholds, std::chrono::microseconds poll_interval)
+    : thresholds(thresholds), output(output), output_path(output_path), poll_interval(poll_interval)
+{
+    if (!(thresholds.trade_multiple > 1) || thresholds.trade_window == 0 || thresholds.min_trades == 0)
+    {
+        throw std::invalid_argument("[AlertDetector] Trade multiple must be above 1, and the trade window and minimum trades positive");
+    }
+    if (!(thresholds.depth_drop > 0) || !(thresholds.depth_drop < 1) || thresholds.depth_window_ms <= 0 || thresholds.depth_levels == 0 ||
+        thresholds.depth_levels > DEPTH_VIEW_LEVELS)
+    {
+        throw std::invalid_argument("[AlertDetector] Depth drop must be between 0 and 1, the window positive, and depth levels 1 to " +
+                                    std::to_string(DEPTH_VIEW_LEVELS));
+    }
+}
+
+AlertDetector::~AlertDetector()
+{
+    stop();
+}
+
+/**
+ * @brief Watch a symbol's trades - must be called before start()
+ * @return The symbol's ID, for on_trade()
+ */
+uint32_t AlertDetector::add_symbol(const std::string &symbol)
+{
+    std::unique_ptr<Symbol> watched = std::make_unique<Symbol>();
+    watched->owner = this;
+    watched->id = static_cast<uint32_t>(this->symbols.size());
+    watched->name = symbol;
+    watched->trade_sizes.assign(this->thresholds.trade_window, 0);
+    this->symbols.push_back(std::move(watched));
+    return static_cast<uint32_t>(this->symbols.size() - 1);
+}
+
+void AlertDetector::trade_callback(uint32_t symbol, const Trade &trade, void *user)
+{
+    static_cast<AlertDetector *>(user)->on_trade(symbol, trade);
+}
+
+void AlertDetector::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    Symbol *symbol = static_cast<Symbol *>(user);
+    symbol->owner->on_book_update(*symbol, view, reloaded);
+}
+
+/**
+ * @brief Queue an alert for the notifier, or count it as dropped if the queue is full
+ */
+void AlertDetector::raise(CircularBuffer<Alert, ALERT_QUEUE_SIZE> &queue, const Alert &alert)
+{
+    if (!queue.try_push(alert))
+    {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    this->alerts.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Check a trade against the average size of the trades before it, then add it to the average
+ */
+void AlertDetector::on_trade(uint32_t symbol, const Trade &trade)
+{
+    if (symbol >= this->symbols.size())
+    {
+        return;
+    }
+    Symbol &watched = *this->symbols[symbol];
+    size_t window = watched.trade_sizes.size();
+
+    if (watched.trades >= this->thresholds.min_trades)
+    {
+        double average = watched.trade_sum / static_cast<double>(std::min<uint64_t>(watched.trades, window));
+        if (average > 0 && trade.quantity >= average * this->thresholds.trade_multiple)
+        {
+            // the buyer is the maker when the seller took liquidity
+            Alert alert{AlertType::LARGE_TRADE, trade.is_buyer_maker ? OrderSide::SELL : OrderSide::BUY, symbol, trade.event_time, now_ns(),
+                        trade.price, trade.quantity, average};
+            raise(this->trade_alerts, alert);
+        }
+    }
+
+    watched.trade_sum += trade.quantity - watched.trade_sizes[watched.trade_index];
+    watched.trade_sizes[watched.trade_index] = trade.quantity;
+    watched.trade_index = (watched.trade_index + 1) % window;
+    watched.trades++;
+    if (watched.trade_index == 0)
+    {
+        // once per window, so rounding in the running sum never builds up
+        watched.trade_sum = 0;
+        for (double size : watched.trade_sizes)
+        {
+            watched.trade_sum += size;
+        }
+    }
+}
+
+/**
+ * @brief Check both sides of an updated book for a sudden drop in depth
+ */
+void AlertDetector::on_book_update(Symbol &symbol, const DepthView &view, bool reloaded)
+{
+    if (reloaded)
+    {
+        symbol.bid_depth.reset();
+        symbol.ask_depth.reset();
+    }
+    check_depth(symbol, symbol.bid_depth, OrderSide::BUY, view.bids, view.bid_count, view.event_time);
+    check_depth(symbol, symbol.ask_depth, OrderSide::SELL, view.asks, view.ask_count, view.event_time);
+}
+
+/**
+ * @brief Add one side's depth to its window, and alert if it is down by depth_drop from the window's peak
+ */
+void AlertDetector::check_depth(Symbol &symbol, DepthWindow &window, OrderSide side, const PriceLevel *levels, uint32_t count, int64_t event_time)
+{
+    uint32_t counted = std::min(count, this->thresholds.depth_levels);
+    double depth = 0;
+    for (uint32_t i = 0; i < counted; i++)
+    {
+        depth += levels[i].quantity;
+    }
+
+    double peak = window.push(event_time, depth, this->thresholds.depth_window_ms);
+    if (peak > 0 && depth <= peak * (1 - this->thresholds.depth_drop))
+    {
+        Alert alert{AlertType::LIQUIDITY_SHOCK, side, symbol.id, event_time, now_ns(), counted > 0 ? levels[0].price : 0, depth, peak};
+        raise(symbol.book_alerts, alert);
+        // start again from the thinned book, so the drop alerts once
+        window.reset();
+        window.push(event_time, depth, this->thresholds.depth_window_ms);
+    }
+}
+
+/**
+ * @brief Write one alert as a line of text
+ */
+void AlertDetector::write(const Alert &alert)
+{
+    std::ostringstream line;
+    line << (alert.type == AlertType::LARGE_TRADE ? "LARGE_TRADE " : "LIQUIDITY_SHOCK ") << this->symbols[alert.symbol]->name << " "
+         << (alert.side == OrderSide::BUY ? "BUY" : "SELL") << " event_time=" << alert.event_time << " price=" << alert.price;
+    if (alert.type == AlertType::LARGE_TRADE)
+    {
+        line << " quantity=" << alert.value << " average=" << alert.reference << " multiple=" << alert.value / alert.reference;
+    }
+    else
+    {
+        line << " depth=" << alert.value << " peak=" << alert.reference << " drop=" << (1 - alert.value / alert.reference) * 100 << "%";
+    }
+    line << "\n";
+    std::string text = line.str();
+
+    bool written;
+    if (this->output == AlertOutput::FILE)
+    {
+        this->file << text;
+        this->file.flush();
+        written = static_cast<bool>(this->file);
+    }
+    else
+    {
+        written = sendto(this->socket_fd, text.data(), text.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&this->socket_address),
+                         sizeof(this->socket_address)) >= 0;
+    }
+    if (!written)
+    {
+        this->write_failures.fetch_add(1, std::memory_order_relaxed);
+        this->file.clear();
+        return;
+    }
+    this->notify_latency.record(static_cast<uint64_t>(now_ns() - alert.detected_ns));
+}
+
+/**
+ * @brief Write every queued alert
+ * @return The number of alerts written
+ */
+size_t AlertDetector::drain()
+{
+    size_t written = 0;
+    Alert alert;
+    while (this->trade_alerts.try_pop(alert))
+    {
+        write(alert);
+        written++;
+    }
+    for (const std::unique_ptr<Symbol> &symbol : this->symbols)
+    {
+        while (symbol->book_alerts.try_pop(alert))
+        {
+            write(alert);
+            written++;
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Open the output and start the notifier thread
+ * @throws std::runtime_error If the output can't be opened
+ */
+void AlertDetector::start()
+{
+    if (this->running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    if (this->output == AlertOutput::FILE)
+    {
+        this->file.open(this->output_path, std::ios::app);
+        if (!this->file)
+        {
+            throw std::runtime_error("[AlertDetector] Failed to open " + this->output_path);
+        }
+    }
+    else
+    {
+        std::memset(&this->socket_address, 0, sizeof(this->socket_address));
+        this->socket_address.sun_family = AF_UNIX;
+        if (this->output_path.size() >= sizeof(this->socket_address.sun_path))
+        {
+            throw std::runtime_error("[AlertDetector] Socket path too long: " + this->output_path);
+        }
+        std::memcpy(this->socket_address.sun_path, this->output_path.c_str(), this->output_path.size() + 1);
+
+        this->socket_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (this->socket_fd < 0)
+        {
+            throw std::runtime_error(std::string("[AlertDetector] socket failed: ") + std::strerror(errno));
+        }
+    }
+
+    std::cout << "[AlertDetector] Writing alerts for " << this->symbols.size() << " symbols to " << this->output_path << std::endl;
+    this->running.store(true, std::memory_order_release);
+    this->worker = std::thread(&AlertDetector::run, this);
+}
+
+/**
+ * @brief Write what is queued and stop the notifier thread
+ */
+void AlertDetector::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+    if (this->socket_fd >= 0)
+    {
+        close(this->socket_fd);
+        this->socket_fd = -1;
+    }
+    if (this->file.is_open())
+    {
+        this->file.close();
+    }
+}
+
+/**
+ * @brief Notifier thread body - write queued alerts, back off briefly when there are none
+ */
+void AlertDetector::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (drain() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+    // what was raised before stop()
+    drain();
+}
+
+uint64_t AlertDetector::get_alerts() const
+{
+    return this->alerts.load(std::memory_order_relaxed);
+}
+
+uint64_t AlertDetector::get_dropped() const
+{
+    return this->dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t AlertDetector::get_write_failures() const
+{
+    return this->write_failures.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram &AlertDetector::get_notify_latency() const
+{
+    return this->notify_latency;
+}
@@ -0,0 +1,305 @@
+// implementation for Backtester class
+
+#include <limits>
+#include "../include/backtester.h"
+
+/**
+ * @brief Replay a capture - records of streams nothing is registered for are skipped
+ * @throws std::runtime_error If the capture can't be opened
+ */
+void Backtester::add_capture(const std::string &path)
+{
+    std::unique_ptr<Source> source = std::make_unique<Source>();
+    source->reader = std::make_unique<CaptureReader>(path);
+    source->has_record = false;
+    this->sources.push_back(std::move(source));
+}
+
+uint32_t Backtester::register_book(std::shared_ptr<void> book, void (*load)(void *, const DepthUpdate &), SequenceCheck (*apply)(void *, const DepthUpdate &),
+                                   void (*listen)(void *, BookUpdateListener, void *), const std::string &stream)
+{
+    uint32_t id = static_cast<uint32_t>(this->books.size());
+    add_route(stream, Route{RouteKind::BOOK, id});
+    this->books.push_back(std::make_unique<Book>(Book{this, id, std::move(book), load, apply, listen, false}));
+    return id;
+}
+
+uint32_t Backtester::add_trade_stream(const std::string &stream)
+{
+    uint32_t id = static_cast<uint32_t>(this->trade_streams.size());
+    add_route(stream, Route{RouteKind::TRADES, id});
+    this->trade_streams.push_back(stream);
+    this->trade_listeners.emplace_back();
+    return id;
+}
+
+void Backtester::add_trade_listener(uint32_t stream, ReplayTradeListener listener, void *user)
+{
+    if (stream >= this->trade_streams.size())
+    {
+        throw std::invalid_argument("[Backtester] No trade stream " + std::to_string(stream));
+    }
+    this->trade_listeners[stream].emplace_back(listener, user);
+}
+
+void Backtester::add_route(const std::string &stream, Route route)
+{
+    if (!this->stream_routes.emplace(stream, route).second)
+    {
+        throw std::invalid_argument("[Backtester] Stream " + stream + " is already registered");
+    }
+}
+
+/**
+ * @brief Drive a strategy from the replay through plain callbacks
+ * @throws std::invalid_argument If the latency is negative
+ */
+uint32_t Backtester::add_strategy(void *strategy, StrategyBookCallback on_book, StrategyTradeCallback on_trade, std::chrono::microseconds latency)
+{
+    if (latency.count() < 0)
+    {
+        throw std::invalid_argument("[Backtester] Latency can't be negative");
+    }
+    this->strategies.push_back(Strategy{strategy, on_book, on_trade, static_cast<int64_t>(latency.count()), {}});
+    return static_cast<uint32_t>(this->strategies.size() - 1);
+}
+
+/**
+ * @brief Find where a capture's stream goes, by name the first time it is seen
+ */
+Backtester::Route Backtester::route_for(Source &source, uint16_t stream)
+{
+    if (stream >= source.routes.size())
+    {
+        source.routes.resize(stream + 1, Route{RouteKind::UNRESOLVED, 0});
+    }
+
+    Route &route = source.routes[stream];
+    if (route.kind == RouteKind::UNRESOLVED)
+    {
+        route = Route{RouteKind::NONE, 0};
+        if (stream < source.reader->get_stream_count())
+        {
+            auto it = this->stream_routes.find(source.reader->get_stream_name(stream));
+            if (it != this->stream_routes.end())
+            {
+                route = it->second;
+            }
+        }
+    }
+    return route;
+}
+
+void Backtester::advance(Source &source)
+{
+    source.has_record = source.reader->next(source.record);
+}
+
+/**
+ * @brief Apply a capture's current record to its book, or pass its trade to the strategies
+ */
+void Backtester::dispatch(Source &source)
+{
+    const CaptureRecord &record = source.record;
+    Route route = route_for(source, record.stream);
+
+    if (route.kind == RouteKind::TRADES && record.type == CaptureRecordType::TRADE)
+    {
+        this->stats.trades++;
+        for (const auto &listener : this->trade_listeners[route.id])
+        {
+            listener.first(record.trade, listener.second);
+        }
+        Notification notification;
+        notification.deliver_at_us = record.event_time * 1000;
+        notification.is_trade = true;
+        notification.trade = TradeEvent{route.id, record.event_time * 1000, record.trade};
+        notify(notification);
+        return;
+    }
+
+    if (route.kind != RouteKind::BOOK || record.type == CaptureRecordType::TRADE)
+    {
+        this->stats.skipped_records++;
+        return;
+    }
+
+    Book &book = *this->books[route.id];
+    if (record.type == CaptureRecordType::SNAPSHOT)
+    {
+        book.load(book.book.get(), record.depth);
+        book.synced = true;
+        this->stats.snapshots++;
+        return;
+    }
+
+    // after a gap nothing is applied until the next snapshot - the live book recorded one when it repaired or resynced
+    if (!book.synced)
+    {
+        this->stats.unsynced_events++;
+        return;
+    }
+
+    switch (book.apply(book.book.get(), record.depth))
+    {
+    case SequenceCheck::APPLY:
+        this->stats.depth_events++;
+        break;
+    case SequenceCheck::STALE:
+        this->stats.stale_events++;
+        break;
+    case SequenceCheck::GAP:
+        this->stats.gaps++;
+        book.synced = false;
+        break;
+    }
+}
+
+/**
+ * @brief Pass a book change to the strategies - runs on the book's update listener, after every listener attached before run()
+ */
+void Backtester::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    Book *book = static_cast<Book *>(user);
+    Notification notification;
+    notification.deliver_at_us = view.event_time * 1000;
+    notification.is_trade = false;
+    notification.book.book = book->id;
+    notification.book.reloaded = reloaded;
+    notification.book.exchange_time_us = view.event_time * 1000;
+    notification.book.view = view;
+    book->owner->notify(notification);
+}
+
+/**
+ * @brief Deliver a change to strategies without latency now, and queue it for the rest
+ * @param notification The change, with deliver_at_us set to its exchange time
+ */
+void Backtester::notify(const Notification &notification)
+{
+    for (Strategy &strategy : this->strategies)
+    {
+        if (strategy.latency_us == 0)
+        {
+            deliver(strategy, notification);
+            continue;
+        }
+        strategy.pending.push_back(notification);
+        strategy.pending.back().deliver_at_us += strategy.latency_us;
+    }
+}
+
+void Backtester::deliver(Strategy &strategy, const Notification &notification)
+{
+    this->clock_us = std::max(this->clock_us, notification.deliver_at_us);
+    this->stats.callbacks++;
+    if (notification.is_trade)
+    {
+        strategy.on_trade(strategy.strategy, *this, notification.trade);
+    }
+    else
+    {
+        strategy.on_book(strategy.strategy, *this, notification.book);
+    }
+}
+
+/**
+ * @brief Deliver every queued change due by a time, in time order across strategies (ties to the strategy added first)
+ */
+void Backtester::deliver_until(int64_t time_us)
+{
+    while (true)
+    {
+        Strategy *next = nullptr;
+        for (Strategy &strategy : this->strategies)
+        {
+            if (!strategy.pending.empty() && strategy.pending.front().deliver_at_us <= time_us &&
+                (!next || strategy.pending.front().deliver_at_us < next->pending.front().deliver_at_us))
+            {
+                next = &strategy;
+            }
+        }
+        if (!next)
+        {
+            return;
+        }
+
+        // taken off the queue first, the callback may cause more notifications
+        Notification notification = std::move(next->pending.front());
+        next->pending.pop_front();
+        deliver(*next, notification);
+    }
+}
+
+/**
+ * @brief Replay every capture to the end - can only be called once
+ * @return What was replayed
+ * @throws std::runtime_error If called again
+ */
+BacktestStats Backtester::run()
+{
+    if (this->ran)
+    {
+        throw std::runtime_error("[Backtester] A backtester can only be run once");
+    }
+    this->ran = true;
+
+    // registered last, so strategies see each change after every listener attached to the book
+    for (const std::unique_ptr<Book> &book : this->books)
+    {
+        book->listen(book->book.get(), &Backtester::book_update_callback, book.get());
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    for (const std::unique_ptr<Source> &source : this->sources)
+    {
+        advance(*source);
+    }
+
+    while (true)
+    {
+        // merge the captures by event time - a linear scan, as a backtest replays a handful of captures
+        Source *source = nullptr;
+        for (const std::unique_ptr<Source> &candidate : this->sources)
+        {
+            if (candidate->has_record && (!source || candidate->record.event_time < source->record.event_time))
+            {
+                source = candidate.get();
+            }
+        }
+        if (!source)
+        {
+            break;
+        }
+
+        int64_t time_us = source->record.event_time * 1000;
+        if (this->stats.records == 0)
+        {
+            this->stats.first_event_time = source->record.event_time;
+        }
+        this->stats.last_event_time = std::max(this->stats.last_event_time, source->record.event_time);
+        this->stats.records++;
+
+        // strategies see everything that came due before this record, on the clock it came due at
+        deliver_until(time_us);
+        this->clock_us = std::max(this->clock_us, time_us);
+        dispatch(*source);
+        advance(*source);
+    }
+    deliver_until(std::numeric_limits<int64_t>::max());
+
+    this->stats.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double replayed_seconds = static_cast<double>(this->stats.last_event_time - this->stats.first_event_time) / 1000.0;
+    this->stats.speedup = this->stats.wall_seconds > 0 ? replayed_seconds / this->stats.wall_seconds : 0;
+    return this->stats;
+}
+
+int64_t Backtester::now_us() const
+{
+    return this->clock_us;
+}
+
+const BacktestStats &Backtester::get_stats() const
+{
+    return this->stats;
+}
@@ -0,0 +1,401 @@
+// implementation for BarAggregator class
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "../include/bar_builder.h"
+
+/**
+ * @brief Construct a new BarAggregator
+ * @param intervals_ms Bar lengths (ms) - multiples of BAR_WHEEL_TICK_MS, shorter than BAR_WHEEL_SLOTS ticks
+ * @param close_delay How long past its end a bar stays open for late events - shorter than every interval
+ * @param poll_interval How long the aggregator thread sleeps when no event arrived
+ */
+BarAggregator::BarAggregator(std::vector<int64_t> intervals_ms, std::chrono::milliseconds close_delay, std::chrono::microseconds poll_interval)
+    : intervals(std::move(intervals_ms)), close_delay_ms(close_delay.count()), wheel(BAR_WHEEL_SLOTS), poll_interval(poll_interval)
+{
+    if (this->intervals.empty())
+    {
+        throw std::invalid_argument("[BarAggregator] No intervals given");
+    }
+    for (int64_t interval : this->intervals)
+    {
+        if (interval <= 0 || interval % BAR_WHEEL_TICK_MS != 0 || interval / BAR_WHEEL_TICK_MS >= static_cast<int64_t>(BAR_WHEEL_SLOTS))
+        {
+            throw std::invalid_argument("[BarAggregator] Unsupported interval: " + std::to_string(interval) + "ms");
+        }
+        // two slots per (symbol, interval) only hold if a bar closes before the one after next opens
+        if (this->close_delay_ms < 0 || this->close_delay_ms >= interval)
+        {
+            throw std::invalid_argument("[BarAggregator] Close delay must be shorter than every interval");
+        }
+    }
+}
+
+BarAggregator::~BarAggregator()
+{
+    stop();
+}
+
+/**
+ * @brief Add a symbol and allocate its bar slots
+ */
+uint32_t BarAggregator::add_symbol(const std::string &symbol, TradeBuffer *trades, const SeqLock<DepthView> *view)
+{
+    Symbol state{};
+    state.symbol = symbol;
+    state.trades = trades;
+    state.view = view;
+    this->symbols.push_back(state);
+
+    OpenBar unused{};
+    unused.bar.open_time = -1;
+    unused.live = false;
+    this->open_bars.resize(this->symbols.size() * this->intervals.size() * 2, unused);
+    return static_cast<uint32_t>(this->symbols.size() - 1);
+}
+
+void BarAggregator::add_output(BarRing &ring)
+{
+    this->outputs.push_back(&ring);
+}
+
+void BarAggregator::add_trade_listener(TradeListener listener, void *user)
+{
+    this->trade_listeners.emplace_back(listener, user);
+}
+
+/**
+ * @brief Reset a bar slot to a new bar and schedule its close on the wheel
+ * @param price, mid, microprice Carried in from the previous bar, until the new bar sees its own trades and BBO changes
+ */
+void BarAggregator::open_bar(uint32_t index, uint32_t symbol, size_t interval, int64_t open_time, double price, double mid, double microprice)
+{
+    OpenBar &open = this->open_bars[index];
+    Bar &bar = open.bar;
+    bar = Bar{};
+    bar.open_time = open_time;
+    bar.close_time = open_time + this->intervals[interval];
+    bar.interval_ms = this->intervals[interval];
+    bar.symbol = symbol;
+    bar.first_trade_id = -1;
+    bar.last_trade_id = -1;
+    bar.open = bar.high = bar.low = bar.close = price;
+    bar.mid_open = bar.mid_high = bar.mid_low = bar.mid_close = mid;
+    bar.microprice_close = microprice;
+    open.live = true;
+
+    int64_t deadline = bar.close_time / BAR_WHEEL_TICK_MS;
+    this->wheel[deadline & (BAR_WHEEL_SLOTS - 1)].push_back(WheelEntry{index, deadline});
+}
+
+/**
+ * @brief Publish a bar and open the next one in the other slot, unless an event already has
+ */
+void BarAggregator::close_bar(uint32_t index)
+{
+    OpenBar &open = this->open_bars[index];
+    open.live = false;
+
+    for (BarRing *ring : this->outputs)
+    {
+        if (!ring->try_push(open.bar))
+        {
+            this->dropped_bars.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    this->bars_closed.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t next = index ^ 1;
+    if (!this->open_bars[next].live)
+    {
+        size_t interval = (index >> 1) % this->intervals.size();
+        open_bar(next, open.bar.symbol, interval, open.bar.close_time, open.bar.close, open.bar.mid_close, open.bar.microprice_close);
+    }
+}
+
+/**
+ * @brief Find the open bar of a symbol and interval an event belongs to, opening it if needed
+ * @return The bar, or nullptr if it has already closed (the event is late)
+ */
+Bar *BarAggregator::bar_for(uint32_t symbol, size_t interval, int64_t time)
+{
+    int64_t length = this->intervals[interval];
+    int64_t number = time / length;
+    int64_t open_time = number * length;
+    uint32_t index = static_cast<uint32_t>(((symbol * this->intervals.size() + interval) << 1) | static_cast<size_t>(number & 1));
+
+    OpenBar &open = this->open_bars[index];
+    if (open.live && open.bar.open_time == open_time)
+    {
+        return &open.bar;
+    }
+
+    // the slot holds this bar or a later one, or the clock has already passed this bar's close
+    if (open.live || open.bar.open_time >= open_time || (this->current_tick >= 0 && (open_time + length) / BAR_WHEEL_TICK_MS <= this->current_tick))
+    {
+        return nullptr;
+    }
+
+    const Symbol &state = this->symbols[symbol];
+    open_bar(index, symbol, interval, open_time, state.last_price, state.last_mid, state.last_microprice);
+    return &open.bar;
+}
+
+/**
+ * @brief Move the event clock forward, closing every bar that ends at or before time_ms - close_delay
+ */
+void BarAggregator::advance_to(int64_t time_ms)
+{
+    int64_t target = (time_ms - this->close_delay_ms) / BAR_WHEEL_TICK_MS;
+    if (this->current_tick < 0)
+    {
+        // nothing can be scheduled before the first event
+        this->current_tick = target;
+        return;
+    }
+
+    // only the ticks the clock passes are visited, and only the bars due on them are touched
+    while (this->current_tick < target)
+    {
+        this->current_tick++;
+        std::vector<WheelEntry> &slot = this->wheel[this->current_tick & (BAR_WHEEL_SLOTS - 1)];
+        this->due.swap(slot);
+        for (const WheelEntry &entry : this->due)
+        {
+            if (entry.deadline_tick != this->current_tick)
+            {
+                // due on a later lap of the wheel
+                slot.push_back(entry);
+                continue;
+            }
+            const OpenBar &open = this->open_bars[entry.bar];
+            if (open.live && open.bar.close_time == this->current_tick * BAR_WHEEL_TICK_MS)
+            {
+                close_bar(entry.bar);
+            }
+        }
+        this->due.clear();
+    }
+}
+
+/**
+ * @brief Add a trade to the open bars of a symbol
+ */
+void BarAggregator::on_trade(uint32_t symbol, const Trade &trade)
+{
+    advance_to(trade.trade_time);
+
+    bool late = false;
+    uint32_t venue_trades = static_cast<uint32_t>(trade.last_trade_id - trade.first_trade_id + 1);
+    for (size_t interval = 0; interval < this->intervals.size(); interval++)
+    {
+        Bar *bar = bar_for(symbol, interval, trade.trade_time);
+        if (!bar)
+        {
+            late = true;
+            continue;
+        }
+
+        if (bar->trade_count == 0)
+        {
+            bar->open = bar->high = bar->low = bar->close = trade.price;
+            bar->first_trade_id = trade.first_trade_id;
+        }
+        else
+        {
+            bar->high = std::max(bar->high, trade.price);
+            bar->low = std::min(bar->low, trade.price);
+            bar->close = trade.price;
+        }
+        bar->last_trade_id = trade.last_trade_id;
+        bar->trade_count += venue_trades;
+        bar->volume += trade.quantity;
+        bar->quote_volume += trade.price * trade.quantity;
+        if (!trade.is_buyer_maker)
+        {
+            bar->taker_buy_volume += trade.quantity;
+        }
+    }
+
+    if (late)
+    {
+        this->late_events.fetch_add(1, std::memory_order_relaxed);
+    }
+    this->symbols[symbol].last_price = trade.price;
+    this->trades.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Add a BBO change to the open bars of a symbol - ignored unless both sides have a level
+ */
+void BarAggregator::on_quote(uint32_t symbol, int64_t event_time, const PriceLevel &best_bid, const PriceLevel &best_ask)
+{
+    if (best_bid.price <= 0 || best_ask.price <= 0 || best_bid.quantity + best_ask.quantity <= 0)
+    {
+        return;
+    }
+    advance_to(event_time);
+
+    double mid = (best_bid.price + best_ask.price) / 2;
+    double microprice = (best_bid.price * best_ask.quantity + best_ask.price * best_bid.quantity) / (best_bid.quantity + best_ask.quantity);
+
+    bool late = false;
+    for (size_t interval = 0; interval < this->intervals.size(); interval++)
+    {
+        Bar *bar = bar_for(symbol, interval, event_time);
+        if (!bar)
+        {
+            late = true;
+            continue;
+        }
+
+        if (bar->quote_count == 0)
+        {
+            bar->mid_open = bar->mid_high = bar->mid_low = bar->mid_close = mid;
+        }
+        else
+        {
+            bar->mid_high = std::max(bar->mid_high, mid);
+            bar->mid_low = std::min(bar->mid_low, mid);
+            bar->mid_close = mid;
+        }
+        bar->microprice_close = microprice;
+        bar->quote_count++;
+    }
+
+    if (late)
+    {
+        this->late_events.fetch_add(1, std::memory_order_relaxed);
+    }
+    Symbol &state = this->symbols[symbol];
+    state.last_mid = mid;
+    state.last_microprice = microprice;
+    this->quotes.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Drain every symbol's trade buffer and check its BBO
+ * @return The number of trades and BBO changes processed
+ */
+size_t BarAggregator::poll_sources()
+{
+    size_t processed = 0;
+    Trade trade;
+    DepthView view;
+    for (uint32_t id = 0; id < this->symbols.size(); id++)
+    {
+        Symbol &state = this->symbols[id];
+        if (state.trades)
+        {
+            while (state.trades->try_pop(trade))
+            {
+                for (const auto &listener : this->trade_listeners)
+                {
+                    listener.first(id, trade, listener.second);
+                }
+                on_trade(id, trade);
+                processed++;
+            }
+        }
+
+        // cheap check first - nothing published since the last poll
+        if (!state.view)
+        {
+            continue;
+        }
+        uint64_t version = state.view->version();
+        if (version == state.last_version || !state.view->try_load(view))
+        {
+            continue;
+        }
+        state.last_version = version;
+
+        PriceLevel best_bid = view.bid_count > 0 ? view.bids[0] : PriceLevel{0, 0};
+        PriceLevel best_ask = view.ask_count > 0 ? view.asks[0] : PriceLevel{0, 0};
+        if (best_bid.price == state.best_bid.price && best_bid.quantity == state.best_bid.quantity &&
+            best_ask.price == state.best_ask.price && best_ask.quantity == state.best_ask.quantity)
+        {
+            continue;
+        }
+        state.best_bid = best_bid;
+        state.best_ask = best_ask;
+        on_quote(id, view.event_time, best_bid, best_ask);
+        processed++;
+    }
+    return processed;
+}
+
+const std::string &BarAggregator::get_symbol(uint32_t symbol) const
+{
+    return this->symbols.at(symbol).symbol;
+}
+
+const std::vector<int64_t> &BarAggregator::get_intervals() const
+{
+    return this->intervals;
+}
+
+uint64_t BarAggregator::get_trades() const
+{
+    return this->trades.load(std::memory_order_relaxed);
+}
+
+uint64_t BarAggregator::get_quotes() const
+{
+    return this->quotes.load(std::memory_order_relaxed);
+}
+
+uint64_t BarAggregator::get_bars_closed() const
+{
+    return this->bars_closed.load(std::memory_order_relaxed);
+}
+
+uint64_t BarAggregator::get_late_events() const
+{
+    return this->late_events.load(std::memory_order_relaxed);
+}
+
+uint64_t BarAggregator::get_dropped_bars() const
+{
+    return this->dropped_bars.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Start the aggregator thread
+ */
+void BarAggregator::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    std::cout << "[BarAggregator] Building " << this->intervals.size() << " intervals for " << this->symbols.size() << " symbols" << std::endl;
+    this->worker = std::thread(&BarAggregator::run, this);
+}
+
+/**
+ * @brief Stop the aggregator thread
+ */
+void BarAggregator::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Aggregator thread body - build bars as events arrive, back off briefly when none have
+ */
+void BarAggregator::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll_sources() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
@@ -0,0 +1,344 @@
+// implementation for BarReconciler class
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include "../include/bar_reconciler.h"
+
+/**
+ * @brief Construct a new BarReconciler, subscribing to the aggregator's closed bars
+ * @param bars The aggregator whose bars are checked
+ * @param tolerance Relative tolerance for prices and volumes
+ * @param poll_interval How long the reconciler thread sleeps when nothing arrived
+ */
+BarReconciler::BarReconciler(BarAggregator &bars, double tolerance, std::chrono::microseconds poll_interval)
+    : bars(bars), intervals(bars.get_intervals()), tolerance(tolerance), poll_interval(poll_interval)
+{
+    bars.add_output(this->local_bars);
+}
+
+BarReconciler::~BarReconciler()
+{
+    stop();
+}
+
+void BarReconciler::add_symbol(uint32_t symbol, KlineBuffer &klines)
+{
+    if (symbol >= this->symbols.size())
+    {
+        this->symbols.resize(symbol + 1);
+    }
+    if (this->symbols[symbol])
+    {
+        throw std::invalid_argument("[BarReconciler] Symbol already added: " + this->bars.get_symbol(symbol));
+    }
+
+    auto state = std::make_unique<Symbol>();
+    state->klines = &klines;
+    state->warmup_until.assign(this->intervals.size(), -1);
+    Pending empty{};
+    empty.open_time = -1;
+    state->windows.resize(this->intervals.size());
+    for (auto &window : state->windows)
+    {
+        window.fill(empty);
+    }
+    this->symbols[symbol] = std::move(state);
+}
+
+void BarReconciler::add_listener(DivergenceListener listener, void *user)
+{
+    this->listeners.emplace_back(listener, user);
+}
+
+int BarReconciler::find_interval(int64_t interval_ms) const
+{
+    for (size_t i = 0; i < this->intervals.size(); i++)
+    {
+        if (this->intervals[i] == interval_ms)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Compare a price or volume within the relative tolerance
+ */
+bool BarReconciler::same(double local, double venue) const
+{
+    return std::fabs(local - venue) <= this->tolerance * std::max(std::fabs(local), std::fabs(venue));
+}
+
+/**
+ * @brief Publish a symbol's totals and notify listeners of a divergence
+ */
+void BarReconciler::report(const BarDivergence &divergence, Symbol &state)
+{
+    state.stats.store(state.totals);
+    for (const auto &listener : this->listeners)
+    {
+        listener.first(divergence, listener.second);
+    }
+}
+
+/**
+ * @brief Report whichever side of a slot is still waiting for the other - called when the slot is reused
+ */
+void BarReconciler::evict(Pending &pending, uint32_t symbol, Symbol &state)
+{
+    if (pending.has_bar == pending.has_kline)
+    {
+        return;
+    }
+
+    BarDivergence divergence{};
+    divergence.symbol = symbol;
+    divergence.open_time = pending.open_time;
+    if (pending.has_bar)
+    {
+        divergence.fields = DIVERGENCE_MISSING_KLINE;
+        divergence.interval_ms = pending.bar.interval_ms;
+        divergence.local = pending.bar;
+        state.totals.missing_klines++;
+    }
+    else
+    {
+        divergence.fields = DIVERGENCE_MISSING_BAR;
+        divergence.interval_ms = pending.kline.interval_ms;
+        divergence.kline = pending.kline;
+        state.totals.missing_bars++;
+    }
+    report(divergence, state);
+}
+
+/**
+ * @brief Get the slot for a bar number, reusing it if it still holds an older bar
+ * @return The slot, or nullptr if it already holds a newer bar (the arrival is too late to reconcile)
+ */
+BarReconciler::Pending *BarReconciler::slot_for(Symbol &state, size_t interval, int64_t open_time, uint32_t symbol)
+{
+    Pending &pending = state.windows[interval][(open_time / this->intervals[interval]) & (RECONCILE_WINDOW - 1)];
+    if (pending.open_time == open_time)
+    {
+        return &pending;
+    }
+    if (pending.open_time > open_time)
+    {
+        return nullptr;
+    }
+
+    evict(pending, symbol, state);
+    pending.open_time = open_time;
+    pending.has_bar = false;
+    pending.has_kline = false;
+    return &pending;
+}
+
+/**
+ * @brief Compare a slot's bar and kline, then mark the slot done
+ */
+void BarReconciler::compare(Pending &pending, uint32_t symbol, Symbol &state)
+{
+    const Bar &bar = pending.bar;
+    const Kline &kline = pending.kline;
+
+    uint32_t fields = 0;
+    if (bar.trade_count != kline.trade_count)
+    {
+        fields |= DIVERGENCE_TRADE_COUNT;
+    }
+    // venues don't agree on the trade IDs of an empty bar, so they're only compared when both sides have trades
+    if (bar.trade_count > 0 && kline.trade_count > 0 && (bar.first_trade_id != kline.first_trade_id || bar.last_trade_id != kline.last_trade_id))
+    {
+        fields |= DIVERGENCE_TRADE_IDS;
+    }
+    if (!same(bar.volume, kline.volume))
+    {
+        fields |= DIVERGENCE_VOLUME;
+    }
+    if (!same(bar.open, kline.open) || !same(bar.high, kline.high) || !same(bar.low, kline.low) || !same(bar.close, kline.close))
+    {
+        fields |= DIVERGENCE_PRICES;
+    }
+    pending.has_bar = false;
+    pending.has_kline = false;
+
+    if (fields == 0)
+    {
+        state.totals.matched++;
+        state.stats.store(state.totals);
+        return;
+    }
+
+    BarDivergence divergence{};
+    divergence.symbol = symbol;
+    divergence.fields = fields;
+    divergence.interval_ms = bar.interval_ms;
+    divergence.open_time = bar.open_time;
+    divergence.missed_trades = static_cast<int64_t>(kline.trade_count) - static_cast<int64_t>(bar.trade_count);
+    divergence.missed_volume = kline.volume - bar.volume;
+    divergence.local = bar;
+    divergence.kline = kline;
+
+    state.totals.diverged++;
+    state.totals.missed_trades += static_cast<uint64_t>(std::max<int64_t>(divergence.missed_trades, 0));
+    report(divergence, state);
+}
+
+/**
+ * @brief Add a closed local bar
+ */
+void BarReconciler::on_bar(const Bar &bar)
+{
+    if (bar.symbol >= this->symbols.size() || !this->symbols[bar.symbol])
+    {
+        return;
+    }
+    Symbol &state = *this->symbols[bar.symbol];
+    int interval = find_interval(bar.interval_ms);
+    if (interval < 0)
+    {
+        return;
+    }
+
+    // the first bar started part way through its interval
+    int64_t &warmup_until = state.warmup_until[interval];
+    if (warmup_until < 0)
+    {
+        warmup_until = bar.close_time;
+        return;
+    }
+    if (bar.open_time < warmup_until)
+    {
+        return;
+    }
+
+    Pending *pending = slot_for(state, interval, bar.open_time, bar.symbol);
+    if (!pending)
+    {
+        return;
+    }
+    pending->bar = bar;
+    pending->has_bar = true;
+    if (pending->has_kline)
+    {
+        compare(*pending, bar.symbol, state);
+    }
+}
+
+/**
+ * @brief Add a closed venue kline of a symbol
+ */
+void BarReconciler::on_kline(uint32_t symbol, const Kline &kline)
+{
+    if (symbol >= this->symbols.size() || !this->symbols[symbol])
+    {
+        return;
+    }
+    Symbol &state = *this->symbols[symbol];
+    int interval = find_interval(kline.interval_ms);
+    if (interval < 0)
+    {
+        return;
+    }
+
+    // nothing to match until the first complete local bar
+    int64_t warmup_until = state.warmup_until[interval];
+    if (warmup_until < 0 || kline.open_time < warmup_until)
+    {
+        return;
+    }
+
+    Pending *pending = slot_for(state, interval, kline.open_time, symbol);
+    if (!pending)
+    {
+        return;
+    }
+    pending->kline = kline;
+    pending->has_kline = true;
+    if (pending->has_bar)
+    {
+        compare(*pending, symbol, state);
+    }
+}
+
+/**
+ * @brief Drain the local bar ring and every kline buffer
+ * @return The number of bars and klines processed
+ */
+size_t BarReconciler::poll()
+{
+    size_t processed = 0;
+    Bar bar;
+    while (this->local_bars.try_pop(bar))
+    {
+        on_bar(bar);
+        processed++;
+    }
+
+    Kline kline;
+    for (uint32_t symbol = 0; symbol < this->symbols.size(); symbol++)
+    {
+        if (!this->symbols[symbol])
+        {
+            continue;
+        }
+        while (this->symbols[symbol]->klines->try_pop(kline))
+        {
+            on_kline(symbol, kline);
+            processed++;
+        }
+    }
+    return processed;
+}
+
+ReconcileStats BarReconciler::get_stats(uint32_t symbol) const
+{
+    ReconcileStats stats{};
+    if (symbol < this->symbols.size() && this->symbols[symbol])
+    {
+        this->symbols[symbol]->stats.load(stats);
+    }
+    return stats;
+}
+
+/**
+ * @brief Start the reconciler thread
+ */
+void BarReconciler::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    this->worker = std::thread(&BarReconciler::run, this);
+}
+
+/**
+ * @brief Stop the reconciler thread
+ */
+void BarReconciler::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Reconciler thread body - match bars and klines as they arrive, back off when neither has
+ */
+void BarReconciler::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
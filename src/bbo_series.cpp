@@ -0,0 +1,624 @@
+// implementation for BboSeries class
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "../include/bbo_series.h"
+
+namespace
+{
+    struct Accumulator
+    {
+        double min;
+        double max;
+        double sum;
+    };
+
+    /**
+     * @brief Add a column - or with Difference, the differences b[i] - a[i] of two columns - to a running min, max and sum
+     */
+    template <bool Difference>
+    void accumulate(const double *a, const double *b, size_t n, Accumulator &acc)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        // two accumulators of two lanes each, so consecutive iterations don't wait on each other
+        __m128d min0 = _mm_set1_pd(acc.min);
+        __m128d min1 = min0;
+        __m128d max0 = _mm_set1_pd(acc.max);
+        __m128d max1 = max0;
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128d x0 = _mm_loadu_pd(a + i);
+            __m128d x1 = _mm_loadu_pd(a + i + 2);
+            if (Difference)
+            {
+                x0 = _mm_sub_pd(_mm_loadu_pd(b + i), x0);
+                x1 = _mm_sub_pd(_mm_loadu_pd(b + i + 2), x1);
+            }
+            min0 = _mm_min_pd(min0, x0);
+            min1 = _mm_min_pd(min1, x1);
+            max0 = _mm_max_pd(max0, x0);
+            max1 = _mm_max_pd(max1, x1);
+            sum0 = _mm_add_pd(sum0, x0);
+            sum1 = _mm_add_pd(sum1, x1);
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_min_pd(min0, min1));
+        acc.min = std::min(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, _mm_max_pd(max0, max1));
+        acc.max = std::max(lanes[0], lanes[1]);
+        _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+        acc.sum += lanes[0] + lanes[1];
+#endif
+        for (; i < n; i++)
+        {
+            double x = Difference ? b[i] - a[i] : a[i];
+            acc.min = std::min(acc.min, x);
+            acc.max = std::max(acc.max, x);
+            acc.sum += x;
+        }
+    }
+
+    ColumnStats finish(const Accumulator &acc, uint64_t count)
+    {
+        return ColumnStats{acc.min, acc.max, acc.sum / static_cast<double>(count)};
+    }
+
+    void put_varint(std::vector<uint8_t> &buffer, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool get_varint(const uint8_t *&position, const uint8_t *end, uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < end; shift += 7)
+        {
+            uint8_t byte = *position++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // zigzag encoding, so small negative differences are small varints too
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    /**
+     * @brief Append a column of values as scaled integer differences
+     */
+    void put_column(std::vector<uint8_t> &buffer, const double *column, uint64_t first, uint64_t count, size_t mask)
+    {
+        int64_t previous = 0;
+        for (uint64_t i = first; i < first + count; i++)
+        {
+            int64_t scaled = std::llround(column[i & mask] * BBO_SPILL_SCALE);
+            put_varint(buffer, zigzag(scaled - previous));
+            previous = scaled;
+        }
+    }
+}
+
+/**
+ * @brief Construct a new BboSeries
+ * @param window How far back queries reach
+ * @param capacity Samples kept per symbol - rounded up to a power of two, at least two blocks
+ * @param spill_path File completed blocks are appended to, empty to keep nothing beyond the ring
+ * @param poll_interval How often the spill thread looks for completed blocks
+ */
+BboSeries::BboSeries(std::chrono::minutes window, size_t capacity, const std::string &spill_path, std::chrono::milliseconds poll_interval)
+    : window_ms(std::chrono::duration_cast<std::chrono::milliseconds>(window).count()), capacity(2 * BBO_BLOCK_SAMPLES),
+      spill_path(spill_path), poll_interval(poll_interval)
+{
+    while (this->capacity < capacity)
+    {
+        this->capacity <<= 1;
+    }
+    this->mask = this->capacity - 1;
+}
+
+BboSeries::~BboSeries()
+{
+    stop();
+}
+
+/**
+ * @brief Keep a symbol's BBO - must be called before start()
+ * @return The symbol's ID
+ */
+uint32_t BboSeries::add_symbol(const std::string &symbol)
+{
+    std::unique_ptr<Symbol> series = std::make_unique<Symbol>();
+    series->owner = this;
+    series->name = symbol;
+    series->times = std::make_unique<int64_t[]>(this->capacity);
+    series->bids = std::make_unique<double[]>(this->capacity);
+    series->asks = std::make_unique<double[]>(this->capacity);
+    series->bid_quantities = std::make_unique<double[]>(this->capacity);
+    series->ask_quantities = std::make_unique<double[]>(this->capacity);
+    this->symbols.push_back(std::move(series));
+    return static_cast<uint32_t>(this->symbols.size() - 1);
+}
+
+void BboSeries::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    (void)reloaded; // a reload's BBO is recorded like any other change
+    if (view.bid_count == 0 || view.ask_count == 0)
+    {
+        return;
+    }
+    Symbol *symbol = static_cast<Symbol *>(user);
+    BboSample sample{view.event_time, view.bids[0].price, view.asks[0].price, view.bids[0].quantity, view.asks[0].quantity};
+    symbol->owner->append(*symbol, sample);
+}
+
+void BboSeries::record(uint32_t symbol, const BboSample &sample)
+{
+    append(*this->symbols[symbol], sample);
+}
+
+/**
+ * @brief Write a sample into the next slot and publish it, if the BBO changed
+ */
+void BboSeries::append(Symbol &symbol, const BboSample &sample)
+{
+    BboSample &last = symbol.last;
+    if (!(sample.bid > 0) || !(sample.ask > 0) ||
+        (sample.bid == last.bid && sample.ask == last.ask && sample.bid_quantity == last.bid_quantity && sample.ask_quantity == last.ask_quantity))
+    {
+        return;
+    }
+
+    int64_t time = std::max(sample.time, last.time);
+    last = sample;
+    last.time = time;
+    uint64_t head = symbol.head.load(std::memory_order_relaxed);
+    size_t slot = head & this->mask;
+    symbol.times[slot] = last.time;
+    symbol.bids[slot] = last.bid;
+    symbol.asks[slot] = last.ask;
+    symbol.bid_quantities[slot] = last.bid_quantity;
+    symbol.ask_quantities[slot] = last.ask_quantity;
+    symbol.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Find the first sample at or after time (or strictly after, with after) among samples [first, last)
+ */
+uint64_t BboSeries::search(const Symbol &symbol, uint64_t first, uint64_t last, int64_t time, bool after) const
+{
+    while (first < last)
+    {
+        uint64_t middle = first + (last - first) / 2;
+        int64_t sample_time = symbol.times[middle & this->mask];
+        if (sample_time < time || (after && sample_time == time))
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+/**
+ * @brief Find the readable samples in [t0, t1]
+ * @return false if there are none
+ */
+bool BboSeries::find(const Symbol &symbol, int64_t t0, int64_t t1, Range &range) const
+{
+    uint64_t head = symbol.head.load(std::memory_order_acquire);
+    if (head == 0)
+    {
+        return false;
+    }
+    // a block of slack, so the writer has to record a whole block during a query before the query has to retry
+    uint64_t readable = this->capacity - BBO_BLOCK_SAMPLES;
+    range.oldest = head > readable ? head - readable : 0;
+
+    int64_t newest_time = symbol.times[(head - 1) & this->mask];
+    t0 = std::max(t0, newest_time - this->window_ms);
+    if (t1 < t0)
+    {
+        return false;
+    }
+    range.first = search(symbol, range.oldest, head, t0, false);
+    range.last = search(symbol, range.first, head, t1, true);
+    return range.first < range.last;
+}
+
+/**
+ * @brief Check the writer hasn't started overwriting the samples a query read
+ */
+bool BboSeries::intact(const Symbol &symbol, const Range &range) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return symbol.head.load(std::memory_order_relaxed) < range.oldest + this->capacity;
+}
+
+/**
+ * @brief Min, max and mean of the bid, ask and spread of samples [first, last), which must be non-empty
+ */
+BboStats BboSeries::summarise(const Symbol &symbol, uint64_t first, uint64_t last) const
+{
+    Accumulator bid{INFINITY, -INFINITY, 0};
+    Accumulator ask = bid;
+    Accumulator spread = bid;
+    // at most two contiguous runs of slots, split where the ring wraps
+    uint64_t index = first;
+    while (index < last)
+    {
+        size_t slot = index & this->mask;
+        size_t run = static_cast<size_t>(std::min<uint64_t>(last - index, this->capacity - slot));
+        accumulate<false>(symbol.bids.get() + slot, nullptr, run, bid);
+        accumulate<false>(symbol.asks.get() + slot, nullptr, run, ask);
+        accumulate<true>(symbol.bids.get() + slot, symbol.asks.get() + slot, run, spread);
+        index += run;
+    }
+
+    uint64_t count = last - first;
+    return BboStats{symbol.times[first & this->mask], static_cast<uint32_t>(count), finish(bid, count), finish(ask, count), finish(spread, count)};
+}
+
+/**
+ * @brief Copy the samples in [t0, t1] that are still in the window
+ * @param out Where to append the samples
+ * @return The number of samples appended
+ */
+size_t BboSeries::query(uint32_t symbol, int64_t t0, int64_t t1, std::vector<BboSample> &out) const
+{
+    const Symbol &series = *this->symbols[symbol];
+    size_t start = out.size();
+    Range range;
+    while (find(series, t0, t1, range))
+    {
+        for (uint64_t i = range.first; i < range.last; i++)
+        {
+            size_t slot = i & this->mask;
+            out.push_back(BboSample{series.times[slot], series.bids[slot], series.asks[slot], series.bid_quantities[slot], series.ask_quantities[slot]});
+        }
+        if (intact(series, range))
+        {
+            break;
+        }
+        out.resize(start);
+    }
+    return out.size() - start;
+}
+
+/**
+ * @brief Min, max and mean of the bid, ask and spread of the samples in [t0, t1] that are still in the window
+ */
+BboStats BboSeries::stats(uint32_t symbol, int64_t t0, int64_t t1) const
+{
+    const Symbol &series = *this->symbols[symbol];
+    Range range;
+    while (find(series, t0, t1, range))
+    {
+        BboStats result = summarise(series, range.first, range.last);
+        if (intact(series, range))
+        {
+            return result;
+        }
+    }
+    return BboStats{t0, 0, {}, {}, {}};
+}
+
+/**
+ * @brief Summarise [t0, t1] in buckets of bucket_ms, aligned to multiples of bucket_ms - buckets without samples are left out
+ * @param out Where to append the buckets
+ * @return The number of buckets appended
+ * @throws std::invalid_argument If bucket_ms isn't positive
+ */
+size_t BboSeries::downsample(uint32_t symbol, int64_t t0, int64_t t1, int64_t bucket_ms, std::vector<BboStats> &out) const
+{
+    if (bucket_ms <= 0)
+    {
+        throw std::invalid_argument("[BboSeries] Bucket size must be positive");
+    }
+
+    const Symbol &series = *this->symbols[symbol];
+    size_t start = out.size();
+    Range range;
+    while (find(series, t0, t1, range))
+    {
+        uint64_t index = range.first;
+        while (index < range.last)
+        {
+            int64_t time = series.times[index & this->mask];
+            int64_t bucket_start = time - time % bucket_ms;
+            uint64_t end = search(series, index, range.last, bucket_start + bucket_ms, false);
+            BboStats bucket = summarise(series, index, end);
+            bucket.start_time = bucket_start;
+            out.push_back(bucket);
+            index = end;
+        }
+        if (intact(series, range))
+        {
+            break;
+        }
+        out.resize(start);
+    }
+    return out.size() - start;
+}
+
+/**
+ * @brief Compress and append a symbol's next block of samples to the spill file
+ * @param partial Spill fewer than a block's samples too - when stopping
+ * @return The number of samples spilled
+ */
+size_t BboSeries::spill(Symbol &symbol, bool partial)
+{
+    uint64_t head = symbol.head.load(std::memory_order_acquire);
+    // the writer may be filling the slot of the sample a whole ring behind the head
+    uint64_t safe = head >= this->capacity ? head - this->capacity + 1 : 0;
+    if (symbol.spilled < safe)
+    {
+        this->lost_samples.fetch_add(safe - symbol.spilled, std::memory_order_relaxed);
+        symbol.spilled = safe;
+    }
+    uint64_t count = std::min<uint64_t>(head - symbol.spilled, BBO_BLOCK_SAMPLES);
+    if (count == 0 || (count < BBO_BLOCK_SAMPLES && !partial))
+    {
+        return 0;
+    }
+
+    uint64_t first = symbol.spilled;
+    int64_t first_time = symbol.times[first & this->mask];
+    int64_t last_time = symbol.times[(first + count - 1) & this->mask];
+    this->spill_buffer.clear();
+    int64_t previous = first_time;
+    for (uint64_t i = first; i < first + count; i++)
+    {
+        int64_t time = symbol.times[i & this->mask];
+        put_varint(this->spill_buffer, zigzag(time - previous));
+        previous = time;
+    }
+    put_column(this->spill_buffer, symbol.bids.get(), first, count, this->mask);
+    put_column(this->spill_buffer, symbol.asks.get(), first, count, this->mask);
+    put_column(this->spill_buffer, symbol.bid_quantities.get(), first, count, this->mask);
+    put_column(this->spill_buffer, symbol.ask_quantities.get(), first, count, this->mask);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (symbol.head.load(std::memory_order_relaxed) >= first + this->capacity)
+    {
+        // overwritten while encoding - the next pass counts what was lost and moves on
+        return 0;
+    }
+
+    BboBlockHeader header{static_cast<uint16_t>(symbol.name.size()), 0, static_cast<uint32_t>(count), static_cast<uint32_t>(this->spill_buffer.size()), 0,
+                          first_time, last_time};
+    bool written = std::fwrite(&header, sizeof(header), 1, this->spill_file) == 1 &&
+                   std::fwrite(symbol.name.data(), 1, symbol.name.size(), this->spill_file) == symbol.name.size() &&
+                   std::fwrite(this->spill_buffer.data(), 1, this->spill_buffer.size(), this->spill_file) == this->spill_buffer.size();
+    // move on either way - retrying a full disk would hold every later block up behind this one
+    symbol.spilled += count;
+    if (!written)
+    {
+        this->write_failures.fetch_add(1, std::memory_order_relaxed);
+        std::clearerr(this->spill_file);
+        return count;
+    }
+    this->spilled_blocks.fetch_add(1, std::memory_order_relaxed);
+    return count;
+}
+
+/**
+ * @brief Read a symbol's samples in [t0, t1] back from a spill file, skipping blocks outside the range without decoding them
+ * @param out Where to append the samples
+ * @return The number of samples appended
+ * @throws std::runtime_error If the file can't be opened or isn't a spill file
+ */
+size_t BboSeries::read_spill(const std::string &path, const std::string &symbol, int64_t t0, int64_t t1, std::vector<BboSample> &out)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        throw std::runtime_error("[BboSeries] Failed to open " + path);
+    }
+    char magic[sizeof(BBO_SPILL_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || std::memcmp(magic, BBO_SPILL_MAGIC, sizeof(magic)) != 0)
+    {
+        std::fclose(file);
+        throw std::runtime_error("[BboSeries] " + path + " is not a BBO spill file");
+    }
+    // block sizes are checked against what is left of the file, so a torn or corrupt header can't make the reader allocate or seek past the end
+    std::fseek(file, 0, SEEK_END);
+    long file_size = std::ftell(file);
+    std::fseek(file, sizeof(BBO_SPILL_MAGIC), SEEK_SET);
+
+    size_t start = out.size();
+    std::string name;
+    std::vector<uint8_t> payload;
+    std::vector<int64_t> columns;
+    BboBlockHeader header;
+    while (std::fread(&header, sizeof(header), 1, file) == 1)
+    {
+        uint64_t remaining = static_cast<uint64_t>(file_size - std::ftell(file));
+        if (header.count == 0 || header.count > BBO_BLOCK_SAMPLES || header.size > BBO_MAX_BLOCK_BYTES ||
+            static_cast<uint64_t>(header.name_size) + header.size > remaining)
+        {
+            std::cerr << "[BboSeries] Corrupt block header in " << path << ", stopping" << std::endl;
+            break;
+        }
+        name.resize(header.name_size);
+        if (std::fread(&name[0], 1, header.name_size, file) != header.name_size)
+        {
+            break;
+        }
+        if (name != symbol || header.last_time < t0 || header.first_time > t1)
+        {
+            if (std::fseek(file, header.size, SEEK_CUR) != 0)
+            {
+                break;
+            }
+            continue;
+        }
+        payload.resize(header.size);
+        if (std::fread(payload.data(), 1, header.size, file) != header.size)
+        {
+            std::cerr << "[BboSeries] Spill file ends part way through a block, stopping" << std::endl;
+            break;
+        }
+
+        // five columns of running sums
+        columns.assign(static_cast<size_t>(header.count) * 5, 0);
+        const uint8_t *position = payload.data();
+        const uint8_t *end = position + payload.size();
+        bool decoded = true;
+        for (size_t column = 0; column < 5 && decoded; column++)
+        {
+            int64_t value = column == 0 ? header.first_time : 0;
+            for (size_t i = 0; i < header.count; i++)
+            {
+                uint64_t encoded;
+                if (!get_varint(position, end, encoded))
+                {
+                    decoded = false;
+                    break;
+                }
+                value += unzigzag(encoded);
+                columns[column * header.count + i] = value;
+            }
+        }
+        if (!decoded)
+        {
+            std::cerr << "[BboSeries] Corrupt block in " << path << ", stopping" << std::endl;
+            break;
+        }
+
+        for (size_t i = 0; i < header.count; i++)
+        {
+            int64_t time = columns[i];
+            if (time < t0 || time > t1)
+            {
+                continue;
+            }
+            out.push_back(BboSample{time, columns[header.count + i] / BBO_SPILL_SCALE, columns[2 * header.count + i] / BBO_SPILL_SCALE,
+                                    columns[3 * header.count + i] / BBO_SPILL_SCALE, columns[4 * header.count + i] / BBO_SPILL_SCALE});
+        }
+    }
+    std::fclose(file);
+    return out.size() - start;
+}
+
+/**
+ * @brief Open the spill file, if there is one, and start the spill thread
+ * @throws std::runtime_error If the spill file can't be opened
+ */
+void BboSeries::start()
+{
+    if (this->spill_path.empty() || this->running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    this->spill_file = std::fopen(this->spill_path.c_str(), "wb");
+    if (!this->spill_file)
+    {
+        throw std::runtime_error("[BboSeries] Failed to open " + this->spill_path);
+    }
+    std::fwrite(BBO_SPILL_MAGIC, 1, sizeof(BBO_SPILL_MAGIC), this->spill_file);
+
+    this->running.store(true, std::memory_order_release);
+    this->worker = std::thread(&BboSeries::run, this);
+}
+
+/**
+ * @brief Stop the spill thread, spilling what is left of every symbol
+ */
+void BboSeries::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+    if (!this->spill_file)
+    {
+        return;
+    }
+    for (const std::unique_ptr<Symbol> &symbol : this->symbols)
+    {
+        while (spill(*symbol, true) > 0)
+        {
+        }
+    }
+    std::fclose(this->spill_file);
+    this->spill_file = nullptr;
+}
+
+/**
+ * @brief Spill thread body - spill every completed block, then wait for more
+ */
+void BboSeries::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        size_t spilled = 0;
+        for (const std::unique_ptr<Symbol> &symbol : this->symbols)
+        {
+            size_t count;
+            while ((count = spill(*symbol, false)) > 0)
+            {
+                spilled += count;
+            }
+        }
+        if (spilled > 0)
+        {
+            std::fflush(this->spill_file);
+        }
+        std::this_thread::sleep_for(this->poll_interval);
+    }
+}
+
+uint64_t BboSeries::get_samples(uint32_t symbol) const
+{
+    return this->symbols[symbol]->head.load(std::memory_order_relaxed);
+}
+
+uint64_t BboSeries::get_spilled_blocks() const
+{
+    return this->spilled_blocks.load(std::memory_order_relaxed);
+}
+
+uint64_t BboSeries::get_lost_samples() const
+{
+    return this->lost_samples.load(std::memory_order_relaxed);
+}
+
+uint64_t BboSeries::get_write_failures() const
+{
+    return this->write_failures.load(std::memory_order_relaxed);
+}
+
+const std::string &BboSeries::get_symbol(uint32_t symbol) const
+{
+    return this->symbols[symbol]->name;
+}
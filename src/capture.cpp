@@ -0,0 +1,370 @@
+// implementation for CaptureWriter and CaptureReader classes
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "../include/capture.h"
+
+// stdio buffer of a writer and initial chunk size of a reader
+constexpr size_t CAPTURE_BUFFER_SIZE = 1 << 20;
+
+static int64_t wall_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Create (or truncate) a capture file - records are buffered until start()
+ * @param path Where to write the capture
+ * @param flush_interval Longest time records stay in the file's buffer
+ * @param ring_bytes Bytes of records that can wait for the writer thread - a power of two, larger than the biggest snapshot
+ * @param poll_interval How often the writer thread looks for records when the ring is empty
+ * @throws std::invalid_argument If ring_bytes isn't a power of two
+ * @throws std::runtime_error If the file can't be opened
+ */
+CaptureWriter::CaptureWriter(const std::string &path, std::chrono::milliseconds flush_interval, size_t ring_bytes, std::chrono::milliseconds poll_interval)
+    : file(nullptr), file_buffer(CAPTURE_BUFFER_SIZE), flush_interval_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(flush_interval).count()),
+      poll_interval(poll_interval), ring(ring_bytes), ring_mask(ring_bytes - 1)
+{
+    if (ring_bytes == 0 || (ring_bytes & (ring_bytes - 1)) != 0)
+    {
+        throw std::invalid_argument("[CaptureWriter] Ring size must be a power of two");
+    }
+    this->file = std::fopen(path.c_str(), "wb");
+    if (!this->file)
+    {
+        throw std::runtime_error("[CaptureWriter] Failed to open " + path);
+    }
+    std::setvbuf(this->file, this->file_buffer.data(), _IOFBF, this->file_buffer.size());
+    std::fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), this->file);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    stop();
+    // records left by a writer that was never started
+    drain();
+    std::fclose(this->file);
+}
+
+uint16_t CaptureWriter::add_stream(const std::string &name)
+{
+    uint16_t stream = this->next_stream++;
+    this->snapshot_needed.push_back(false);
+    if (!reserve(sizeof(CaptureRecordHeader) + name.size()))
+    {
+        // a replay can't route anything on a stream it never saw declared
+        throw std::runtime_error("[CaptureWriter] No room to declare stream " + name);
+    }
+    uint64_t position = this->ring_head.load(std::memory_order_relaxed);
+    put_header(position, CaptureRecordType::STREAM, stream, static_cast<uint32_t>(name.size()), 0);
+    put(position, name.data(), name.size());
+    commit(position);
+    return stream;
+}
+
+/**
+ * @brief Check the ring has room for a record of the given size
+ */
+bool CaptureWriter::reserve(size_t size)
+{
+    uint64_t head = this->ring_head.load(std::memory_order_relaxed);
+    // acquire so the writer thread has finished reading the bytes we are about to reuse
+    return head + size - this->ring_tail.load(std::memory_order_acquire) <= this->ring.size();
+}
+
+/**
+ * @brief Copy bytes into the ring at a position, wrapping at the end, and advance the position
+ */
+void CaptureWriter::put(uint64_t &position, const void *data, size_t size)
+{
+    size_t offset = static_cast<size_t>(position & this->ring_mask);
+    size_t first = std::min(size, this->ring.size() - offset);
+    std::memcpy(this->ring.data() + offset, data, first);
+    std::memcpy(this->ring.data(), static_cast<const char *>(data) + first, size - first);
+    position += size;
+}
+
+void CaptureWriter::put_header(uint64_t &position, CaptureRecordType type, uint16_t stream, uint32_t size, int64_t event_time)
+{
+    CaptureRecordHeader header{static_cast<uint8_t>(type), 0, stream, size, wall_time_ns(), event_time};
+    put(position, &header, sizeof(header));
+}
+
+/**
+ * @brief Hand a complete record to the writer thread
+ * @param position The ring position just after the record
+ */
+void CaptureWriter::commit(uint64_t position)
+{
+    // release so the writer thread sees the whole record once it sees the new head
+    this->ring_head.store(position, std::memory_order_release);
+    this->records.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Count a record the ring had no room for, and flag its stream if the record was part of a book
+ */
+void CaptureWriter::drop(CaptureRecordType type, uint16_t stream)
+{
+    if (this->records_dropped.fetch_add(1, std::memory_order_relaxed) == 0)
+    {
+        std::cerr << "[CaptureWriter] Ring full, dropping records" << std::endl;
+    }
+    if (type != CaptureRecordType::TRADE)
+    {
+        this->snapshot_needed[stream] = true;
+    }
+}
+
+void CaptureWriter::write_depth(uint16_t stream, const DepthUpdate &update)
+{
+    CaptureDepthHeader depth{update.first_update_id, update.final_update_id, update.previous_final_update_id,
+                             static_cast<uint32_t>(update.bids.size()), static_cast<uint32_t>(update.asks.size())};
+    uint32_t size = static_cast<uint32_t>(sizeof(depth) + (depth.bid_count + depth.ask_count) * sizeof(PriceLevel));
+    if (!reserve(sizeof(CaptureRecordHeader) + size))
+    {
+        drop(CaptureRecordType::DEPTH, stream);
+        return;
+    }
+
+    uint64_t position = this->ring_head.load(std::memory_order_relaxed);
+    put_header(position, CaptureRecordType::DEPTH, stream, size, update.event_time);
+    put(position, &depth, sizeof(depth));
+    put(position, update.bids.data(), depth.bid_count * sizeof(PriceLevel));
+    put(position, update.asks.data(), depth.ask_count * sizeof(PriceLevel));
+    commit(position);
+}
+
+void CaptureWriter::write_trade(uint16_t stream, const Trade &trade)
+{
+    if (!reserve(sizeof(CaptureRecordHeader) + sizeof(Trade)))
+    {
+        drop(CaptureRecordType::TRADE, stream);
+        return;
+    }
+
+    uint64_t position = this->ring_head.load(std::memory_order_relaxed);
+    put_header(position, CaptureRecordType::TRADE, stream, sizeof(Trade), trade.event_time);
+    put(position, &trade, sizeof(Trade));
+    commit(position);
+}
+
+bool CaptureWriter::needs_snapshot(uint16_t stream) const
+{
+    return this->snapshot_needed[stream];
+}
+
+/**
+ * @brief Move every record in the ring to the file - writer thread (or, once it has stopped, the owner) only
+ * @return The number of bytes moved
+ */
+size_t CaptureWriter::drain()
+{
+    uint64_t tail = this->ring_tail.load(std::memory_order_relaxed);
+    uint64_t head = this->ring_head.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+        return 0;
+    }
+
+    size_t size = static_cast<size_t>(head - tail);
+    size_t offset = static_cast<size_t>(tail & this->ring_mask);
+    size_t first = std::min(size, this->ring.size() - offset);
+    std::fwrite(this->ring.data() + offset, 1, first, this->file);
+    std::fwrite(this->ring.data(), 1, size - first, this->file);
+    // release so the recording thread only reuses the bytes once they have been copied out
+    this->ring_tail.store(head, std::memory_order_release);
+    return size;
+}
+
+/**
+ * @brief Start the writer thread
+ */
+void CaptureWriter::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    this->worker = std::thread(&CaptureWriter::run, this);
+}
+
+/**
+ * @brief Stop the writer thread, writing every record already in the ring, and flush the file
+ */
+void CaptureWriter::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Writer thread body - move records to the file as they arrive, flushing it every flush interval
+ */
+void CaptureWriter::run()
+{
+    int64_t last_flush_ns = wall_time_ns();
+    while (this->running.load(std::memory_order_acquire))
+    {
+        size_t written = drain();
+
+        int64_t now = wall_time_ns();
+        if (now - last_flush_ns >= this->flush_interval_ns)
+        {
+            std::fflush(this->file);
+            last_flush_ns = now;
+        }
+
+        if (written == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+    drain();
+    std::fflush(this->file);
+}
+
+uint64_t CaptureWriter::get_records() const
+{
+    return this->records.load(std::memory_order_relaxed);
+}
+
+uint64_t CaptureWriter::get_records_dropped() const
+{
+    return this->records_dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Open a capture file
+ * @throws std::runtime_error If the file can't be opened or isn't a capture
+ */
+CaptureReader::CaptureReader(const std::string &path)
+    : file(std::fopen(path.c_str(), "rb")), buffer(CAPTURE_BUFFER_SIZE)
+{
+    if (!this->file)
+    {
+        throw std::runtime_error("[CaptureReader] Failed to open " + path);
+    }
+    if (!ensure(sizeof(CAPTURE_MAGIC)) || std::memcmp(this->buffer.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+    {
+        std::fclose(this->file);
+        throw std::runtime_error("[CaptureReader] " + path + " is not a capture file");
+    }
+    this->position = sizeof(CAPTURE_MAGIC);
+}
+
+CaptureReader::~CaptureReader()
+{
+    std::fclose(this->file);
+}
+
+/**
+ * @brief Make sure the next bytes of the file are in the buffer, reading another chunk if needed
+ * @return true if they are, false if the file ends first
+ */
+bool CaptureReader::ensure(size_t bytes)
+{
+    if (this->filled - this->position >= bytes)
+    {
+        return true;
+    }
+
+    // move the unread tail to the front, growing the buffer for records bigger than a chunk
+    size_t remaining = this->filled - this->position;
+    std::memmove(this->buffer.data(), this->buffer.data() + this->position, remaining);
+    this->filled = remaining;
+    this->position = 0;
+    if (this->buffer.size() < bytes)
+    {
+        this->buffer.resize(bytes);
+    }
+
+    while (this->filled < bytes && !this->end_of_file)
+    {
+        size_t read = std::fread(this->buffer.data() + this->filled, 1, this->buffer.size() - this->filled, this->file);
+        this->filled += read;
+        this->end_of_file = read == 0;
+    }
+    return this->filled >= bytes;
+}
+
+bool CaptureReader::next(CaptureRecord &record)
+{
+    while (true)
+    {
+        CaptureRecordHeader header;
+        if (!ensure(sizeof(header)))
+        {
+            return false;
+        }
+        std::memcpy(&header, this->buffer.data() + this->position, sizeof(header));
+        if (!ensure(sizeof(header) + header.size))
+        {
+            std::cerr << "[CaptureReader] Capture ends part way through a record, stopping" << std::endl;
+            return false;
+        }
+        const char *payload = this->buffer.data() + this->position + sizeof(header);
+        this->position += sizeof(header) + header.size;
+        this->records++;
+
+        CaptureRecordType type = static_cast<CaptureRecordType>(header.type);
+        if (type == CaptureRecordType::STREAM)
+        {
+            if (header.stream >= this->streams.size())
+            {
+                this->streams.resize(header.stream + 1);
+            }
+            this->streams[header.stream].assign(payload, header.size);
+            continue;
+        }
+        // record types from newer writers are skipped, the size says how far
+        if (type != CaptureRecordType::SNAPSHOT && type != CaptureRecordType::DEPTH && type != CaptureRecordType::TRADE)
+        {
+            continue;
+        }
+
+        record.type = type;
+        record.stream = header.stream;
+        record.local_time_ns = header.local_time_ns;
+        record.event_time = header.event_time;
+
+        if (type == CaptureRecordType::TRADE)
+        {
+            std::memcpy(&record.trade, payload, sizeof(Trade));
+            return true;
+        }
+
+        CaptureDepthHeader depth;
+        std::memcpy(&depth, payload, sizeof(depth));
+        const char *levels = payload + sizeof(depth);
+        record.depth.event_time = header.event_time;
+        record.depth.first_update_id = depth.first_update_id;
+        record.depth.final_update_id = depth.final_update_id;
+        record.depth.previous_final_update_id = depth.previous_final_update_id;
+        record.depth.bids.resize(depth.bid_count);
+        record.depth.asks.resize(depth.ask_count);
+        std::memcpy(record.depth.bids.data(), levels, depth.bid_count * sizeof(PriceLevel));
+        std::memcpy(record.depth.asks.data(), levels + depth.bid_count * sizeof(PriceLevel), depth.ask_count * sizeof(PriceLevel));
+        return true;
+    }
+}
+
+const std::string &CaptureReader::get_stream_name(uint16_t stream) const
+{
+    return this->streams.at(stream);
+}
+
+size_t CaptureReader::get_stream_count() const
+{
+    return this->streams.size();
+}
+
+uint64_t CaptureReader::get_records() const
+{
+    return this->records;
+}
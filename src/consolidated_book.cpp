@@ -0,0 +1,248 @@
+// implementation for ConsolidatedBook class
+
+#include <iostream>
+#include <stdexcept>
+#include "../include/consolidated_book.h"
+
+namespace
+{
+    /**
+     * @brief Check if lhs is a better price than rhs for a side of the book
+     */
+    template <bool IsBid>
+    bool is_better(double lhs, double rhs)
+    {
+        if constexpr (IsBid)
+        {
+            return lhs > rhs;
+        }
+        else
+        {
+            return lhs < rhs;
+        }
+    }
+}
+
+/**
+ * @brief Construct a new ConsolidatedBook
+ * @param poll_interval How long the consolidator thread sleeps when no source has published
+ */
+ConsolidatedBook::ConsolidatedBook(std::chrono::microseconds poll_interval)
+    : poll_interval(poll_interval) {}
+
+ConsolidatedBook::~ConsolidatedBook()
+{
+    stop();
+}
+
+/**
+ * @brief Merge a published depth view into the consolidated book - must be called before start()
+ */
+uint8_t ConsolidatedBook::add_source(const std::string &venue, const SeqLock<DepthView> &view)
+{
+    if (this->sources.size() >= CONSOLIDATED_MAX_VENUES)
+    {
+        throw std::runtime_error("[ConsolidatedBook] Too many sources, cannot add " + venue);
+    }
+
+    Source source{};
+    source.venue = venue;
+    source.view = &view;
+    // the empty last view makes the first merge insert every level
+    source.last_version = 0;
+    this->sources.push_back(source);
+    return static_cast<uint8_t>(this->sources.size() - 1);
+}
+
+const std::string &ConsolidatedBook::get_venue(uint8_t venue) const
+{
+    return this->sources.at(venue).venue;
+}
+
+const SeqLock<DepthView> &ConsolidatedBook::get_depth_view() const
+{
+    return this->depth_view;
+}
+
+const SeqLock<ConsolidatedDepthView> &ConsolidatedBook::get_consolidated_view() const
+{
+    return this->consolidated_view;
+}
+
+void ConsolidatedBook::add_level_listener(LevelListener listener, void *user)
+{
+    this->level_listeners.emplace_back(listener, user);
+}
+
+uint64_t ConsolidatedBook::get_levels_changed() const
+{
+    return this->levels_changed.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Apply the difference between two top-N snapshots of one side of a source book.
+ * Both arrays are sorted best first, so a single merge walk finds levels that were removed, added or changed.
+ * @return The number of consolidated levels that changed
+ */
+template <bool IsBid>
+size_t ConsolidatedBook::merge_side(uint8_t venue, const PriceLevel *previous, uint32_t previous_count, const PriceLevel *current, uint32_t current_count,
+                                    ConsolidatedSide<IsBid> &side, int64_t source_event_time)
+{
+    size_t changed = 0;
+    auto apply = [&](double price, double quantity)
+    {
+        double total = 0;
+        double previous_total = side.update(price, venue, quantity, total);
+        changed++;
+        if (total == previous_total)
+        {
+            return;
+        }
+        LevelChange change{this->sequence + 1, source_event_time, price, previous_total, total, IsBid};
+        for (const auto &listener : this->level_listeners)
+        {
+            listener.first(change, listener.second);
+        }
+    };
+
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < previous_count || j < current_count)
+    {
+        if (j == current_count || (i < previous_count && is_better<IsBid>(previous[i].price, current[j].price)))
+        {
+            // in the previous view only - the venue no longer has this level in its top N
+            apply(previous[i].price, 0.0);
+            i++;
+        }
+        else if (i == previous_count || is_better<IsBid>(current[j].price, previous[i].price))
+        {
+            // new level for this venue
+            apply(current[j].price, current[j].quantity);
+            j++;
+        }
+        else
+        {
+            // same price in both - only a quantity change matters
+            if (previous[i].quantity != current[j].quantity)
+            {
+                apply(current[j].price, current[j].quantity);
+            }
+            i++;
+            j++;
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Merge a new view from one source, diffed against the last view merged from it
+ * @return The number of consolidated levels that changed
+ */
+size_t ConsolidatedBook::merge_source(uint8_t venue, Source &source, const DepthView &view)
+{
+    size_t changed = merge_side<true>(venue, source.last_view.bids, source.last_view.bid_count, view.bids, view.bid_count, this->bids, view.event_time);
+    changed += merge_side<false>(venue, source.last_view.asks, source.last_view.ask_count, view.asks, view.ask_count, this->asks, view.event_time);
+    source.last_view = view;
+    this->event_time = std::max(this->event_time, view.event_time);
+    return changed;
+}
+
+/**
+ * @brief Publish the consolidated top levels through both SeqLocks
+ */
+void ConsolidatedBook::publish()
+{
+    this->sequence++;
+
+    DepthView view;
+    view.update_id = this->sequence;
+    view.event_time = this->event_time;
+    view.bid_count = static_cast<uint32_t>(this->bids.copy_top(view.bids, DEPTH_VIEW_LEVELS));
+    view.ask_count = static_cast<uint32_t>(this->asks.copy_top(view.asks, DEPTH_VIEW_LEVELS));
+    this->depth_view.store(view);
+
+    ConsolidatedDepthView consolidated;
+    consolidated.update_id = this->sequence;
+    consolidated.event_time = this->event_time;
+    consolidated.venue_count = static_cast<uint32_t>(this->sources.size());
+    consolidated.reserved = 0;
+    consolidated.bid_count = static_cast<uint32_t>(this->bids.copy_top(consolidated.bids, DEPTH_VIEW_LEVELS));
+    consolidated.ask_count = static_cast<uint32_t>(this->asks.copy_top(consolidated.asks, DEPTH_VIEW_LEVELS));
+    this->consolidated_view.store(consolidated);
+}
+
+/**
+ * @brief Merge any sources that published since the last call and publish the result
+ * @return The number of consolidated levels that changed
+ */
+size_t ConsolidatedBook::poll_sources()
+{
+    size_t changed = 0;
+    for (size_t index = 0; index < this->sources.size(); index++)
+    {
+        Source &source = this->sources[index];
+
+        // cheap check first - nothing published since the last merge
+        uint64_t version = source.view->version();
+        if (version == source.last_version)
+        {
+            continue;
+        }
+
+        DepthView view;
+        if (!source.view->try_load(view))
+        {
+            // mid-write, pick it up on the next poll
+            continue;
+        }
+        source.last_version = version;
+        changed += merge_source(static_cast<uint8_t>(index), source, view);
+    }
+
+    if (changed > 0)
+    {
+        publish();
+        this->levels_changed.fetch_add(changed, std::memory_order_relaxed);
+    }
+    return changed;
+}
+
+/**
+ * @brief Start the consolidator thread
+ */
+void ConsolidatedBook::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    std::cout << "[ConsolidatedBook] Merging " << this->sources.size() << " sources" << std::endl;
+    this->worker = std::thread(&ConsolidatedBook::run, this);
+}
+
+/**
+ * @brief Stop the consolidator thread
+ */
+void ConsolidatedBook::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Consolidator thread body - merge sources as they publish, back off briefly when none have
+ */
+void ConsolidatedBook::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll_sources() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
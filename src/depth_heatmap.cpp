@@ -0,0 +1,569 @@
+// implementation for DepthHeatmap class
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "../include/depth_heatmap.h"
+
+namespace
+{
+    uint32_t float_bits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void put_varint(std::vector<uint8_t> &buffer, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool get_varint(const uint8_t *&position, const uint8_t *end, uint32_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35 && position < end; shift += 7)
+        {
+            uint8_t byte = *position++;
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief The previous row's quantity for a price bucket, 0 if it didn't cover the bucket
+     */
+    float previous_quantity(const std::vector<float> &previous, int64_t previous_first, int64_t bucket)
+    {
+        int64_t index = bucket - previous_first;
+        return index >= 0 && index < static_cast<int64_t>(previous.size()) ? previous[index] : 0.0f;
+    }
+}
+
+/**
+ * @brief Construct a new DepthHeatmap
+ * @param path File to write the rows to (replaced if it exists)
+ * @param row_interval Time covered by each row
+ * @param row_buckets Price buckets per row, centred on the mid when the row starts
+ * @param keyframe_interval Rows between keyframes - rows encoded on their own, so a viewer can start decoding there
+ * @param poll_interval How often the writer thread looks for closed rows
+ * @throws std::invalid_argument If row_buckets is 0 or above HEATMAP_MAX_BUCKETS, or an interval isn't positive
+ */
+DepthHeatmap::DepthHeatmap(const std::string &path, std::chrono::milliseconds row_interval, uint32_t row_buckets, uint32_t keyframe_interval,
+                           std::chrono::milliseconds poll_interval)
+    : path(path), row_ms(row_interval.count()), row_buckets(row_buckets), keyframe_interval(keyframe_interval), poll_interval(poll_interval)
+{
+    if (row_buckets == 0 || row_buckets > HEATMAP_MAX_BUCKETS)
+    {
+        throw std::invalid_argument("[DepthHeatmap] Buckets per row must be 1 to " + std::to_string(HEATMAP_MAX_BUCKETS));
+    }
+    if (this->row_ms <= 0 || keyframe_interval == 0)
+    {
+        throw std::invalid_argument("[DepthHeatmap] Row and keyframe intervals must be positive");
+    }
+}
+
+DepthHeatmap::~DepthHeatmap()
+{
+    stop();
+}
+
+DepthHeatmap::Symbol &DepthHeatmap::add_symbol(const std::string &symbol, double price_bucket)
+{
+    if (!(price_bucket > 0))
+    {
+        throw std::invalid_argument("[DepthHeatmap] Price bucket for " + symbol + " must be positive");
+    }
+    std::unique_ptr<Symbol> added = std::make_unique<Symbol>();
+    added->owner = this;
+    added->id = static_cast<uint16_t>(this->symbols.size());
+    added->name = symbol;
+    added->price_bucket = price_bucket;
+    std::memset(added->buckets, 0, sizeof(added->buckets));
+    this->symbols.push_back(std::move(added));
+    return *this->symbols.back();
+}
+
+void DepthHeatmap::level_change_callback(const LevelChange &change, void *user)
+{
+    Symbol *symbol = static_cast<Symbol *>(user);
+    symbol->owner->on_level_change(*symbol, change);
+}
+
+void DepthHeatmap::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    Symbol *symbol = static_cast<Symbol *>(user);
+    symbol->owner->on_book_update(*symbol, view, reloaded);
+}
+
+int64_t DepthHeatmap::bucket_of(const Symbol &symbol, double price) const
+{
+    // a little over, so a price on a bucket boundary isn't put in the bucket below by rounding in the division
+    return static_cast<int64_t>(std::floor(price / symbol.price_bucket + 1e-6));
+}
+
+/**
+ * @brief Move a price bucket's quantity, first adding the time its old quantity rested to the integral
+ */
+void DepthHeatmap::add_quantity(Symbol &symbol, int64_t bucket, double quantity, int64_t time)
+{
+    int64_t index = bucket - symbol.tracked_first;
+    if (index < 0 || index >= static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS))
+    {
+        return;
+    }
+    Bucket &tracked = symbol.buckets[index];
+    if (time > tracked.since)
+    {
+        tracked.integral += tracked.quantity * static_cast<double>(time - tracked.since);
+        tracked.since = time;
+    }
+    tracked.quantity += quantity;
+    // what rounding leaves once the levels in the bucket are gone
+    if (tracked.quantity < 1e-9)
+    {
+        tracked.quantity = 0;
+    }
+}
+
+void DepthHeatmap::on_level_change(Symbol &symbol, const LevelChange &change)
+{
+    advance(symbol, change.event_time);
+    if (symbol.tracking)
+    {
+        add_quantity(symbol, bucket_of(symbol, change.price), change.quantity - change.previous_quantity, change.event_time);
+    }
+}
+
+void DepthHeatmap::on_book_update(Symbol &symbol, const DepthView &view, bool reloaded)
+{
+    if (reloaded)
+    {
+        // rows that ended before the reload are closed on the buckets and mid they were tracked with
+        advance(symbol, view.event_time);
+    }
+    if (view.bid_count > 0 && view.ask_count > 0)
+    {
+        symbol.mid = (view.bids[0].price + view.asks[0].price) / 2;
+    }
+    if (!(symbol.mid > 0))
+    {
+        return;
+    }
+
+    if (reloaded)
+    {
+        // keep the tracked buckets where they are if they still cover the mid and the open row, so its integrals so far are kept
+        int64_t centre = bucket_of(symbol, symbol.mid);
+        int64_t row_buckets = static_cast<int64_t>(this->row_buckets);
+        int64_t tracked_end = symbol.tracked_first + static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS);
+        bool covered = symbol.tracking && centre - row_buckets >= symbol.tracked_first && centre + row_buckets < tracked_end &&
+                       (symbol.row_start < 0 || (symbol.row_first >= symbol.tracked_first && symbol.row_first + row_buckets <= tracked_end));
+        load_book(symbol, covered ? symbol.tracked_first : centre - static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS / 2), view.event_time);
+        if (!covered && symbol.row_start >= 0)
+        {
+            // the open row's buckets moved with the tracked ones, so restart it on the new mid - the reloaded book stands in for its start
+            open_row(symbol, symbol.row_start);
+        }
+    }
+    if (symbol.row_start < 0 && symbol.tracking)
+    {
+        open_row(symbol, view.event_time - view.event_time % this->row_ms);
+    }
+    advance(symbol, view.event_time);
+}
+
+/**
+ * @brief Set every tracked bucket's quantity from the latest full book version
+ * @param tracked_first Price bucket of the first tracked bucket - integrals so far are kept if it hasn't changed
+ */
+void DepthHeatmap::load_book(Symbol &symbol, int64_t tracked_first, int64_t time)
+{
+    bool moved = !symbol.tracking || tracked_first != symbol.tracked_first;
+    for (Bucket &tracked : symbol.buckets)
+    {
+        tracked.integral = moved ? 0 : tracked.integral + tracked.quantity * static_cast<double>(std::max<int64_t>(time - tracked.since, 0));
+        tracked.quantity = 0;
+        tracked.since = time;
+    }
+    symbol.tracked_first = tracked_first;
+    symbol.tracking = true;
+
+    PinnedBook book = symbol.reader->pin();
+    if (!book)
+    {
+        return;
+    }
+    int64_t tracked_end = tracked_first + static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS);
+    // bids best (highest) first, so stop once below the tracked buckets - asks the other way
+    for (size_t depth = 0; depth < book->bid_levels(); depth++)
+    {
+        int64_t bucket = bucket_of(symbol, book->bid_price(depth));
+        if (bucket < tracked_first)
+        {
+            break;
+        }
+        add_quantity(symbol, bucket, book->bid_quantity(depth), time);
+    }
+    for (size_t depth = 0; depth < book->ask_levels(); depth++)
+    {
+        int64_t bucket = bucket_of(symbol, book->ask_price(depth));
+        if (bucket >= tracked_end)
+        {
+            break;
+        }
+        add_quantity(symbol, bucket, book->ask_quantity(depth), time);
+    }
+}
+
+/**
+ * @brief Close every row that ends at or before time, starting the next row each time
+ */
+void DepthHeatmap::advance(Symbol &symbol, int64_t time)
+{
+    if (symbol.row_start < 0)
+    {
+        return;
+    }
+    int64_t closed = 0;
+    while (time >= symbol.row_start + this->row_ms)
+    {
+        close_row(symbol);
+        int64_t next = symbol.row_start + this->row_ms;
+        if (++closed >= HEATMAP_MAX_FILL_ROWS && time >= next + this->row_ms)
+        {
+            next = time - time % this->row_ms;
+        }
+        open_row(symbol, next);
+    }
+}
+
+/**
+ * @brief Start a row centred on the current mid, reloading the tracked buckets from the book if the row would run past them
+ */
+void DepthHeatmap::open_row(Symbol &symbol, int64_t start_time)
+{
+    int64_t centre = bucket_of(symbol, symbol.mid);
+    symbol.row_start = start_time;
+    symbol.row_first = centre - static_cast<int64_t>(this->row_buckets / 2);
+    if (symbol.row_first < symbol.tracked_first ||
+        symbol.row_first + static_cast<int64_t>(this->row_buckets) > symbol.tracked_first + static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS))
+    {
+        load_book(symbol, centre - static_cast<int64_t>(HEATMAP_TRACKED_BUCKETS / 2), start_time);
+    }
+    for (Bucket &tracked : symbol.buckets)
+    {
+        tracked.integral = 0;
+        tracked.since = start_time;
+    }
+}
+
+/**
+ * @brief Finish the row's time-weighted averages and queue it for the writer
+ */
+void DepthHeatmap::close_row(Symbol &symbol)
+{
+    int64_t end = symbol.row_start + this->row_ms;
+    ClosedRow row;
+    row.start_time = symbol.row_start;
+    row.first_bucket = symbol.row_first;
+    int64_t offset = symbol.row_first - symbol.tracked_first;
+    for (uint32_t i = 0; i < this->row_buckets; i++)
+    {
+        const Bucket &tracked = symbol.buckets[offset + i];
+        double rested = tracked.integral + tracked.quantity * static_cast<double>(std::max<int64_t>(end - tracked.since, 0));
+        row.quantities[i] = static_cast<float>(rested / static_cast<double>(this->row_ms));
+    }
+
+    if (!symbol.rows.try_push(row))
+    {
+        this->rows_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    this->rows_closed.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Encode a row against the symbol's previous row and append it to the file
+ */
+void DepthHeatmap::write_row(Symbol &symbol, const ClosedRow &row)
+{
+    bool keyframe = symbol.rows_written % this->keyframe_interval == 0;
+    this->encoded.clear();
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < this->row_buckets; i++)
+    {
+        float previous = keyframe ? 0.0f : previous_quantity(symbol.previous, symbol.previous_first, row.first_bucket + i);
+        uint32_t changed = float_bits(row.quantities[i]) ^ float_bits(previous);
+        if (changed == 0)
+        {
+            run++;
+            continue;
+        }
+        put_varint(this->encoded, run);
+        put_varint(this->encoded, changed);
+        run = 0;
+    }
+    if (run > 0)
+    {
+        put_varint(this->encoded, run);
+    }
+
+    HeatmapRowHeader header{symbol.id, static_cast<uint8_t>(keyframe), 0, static_cast<uint32_t>(this->encoded.size()), row.start_time, row.first_bucket};
+    std::fwrite(&header, sizeof(header), 1, this->file);
+    std::fwrite(this->encoded.data(), 1, this->encoded.size(), this->file);
+    this->bytes_written.fetch_add(sizeof(header) + this->encoded.size(), std::memory_order_relaxed);
+
+    symbol.previous.assign(row.quantities, row.quantities + this->row_buckets);
+    symbol.previous_first = row.first_bucket;
+    symbol.rows_written++;
+}
+
+/**
+ * @brief Write every closed row
+ * @return The number of rows written
+ */
+size_t DepthHeatmap::drain()
+{
+    size_t written = 0;
+    ClosedRow row;
+    for (const std::unique_ptr<Symbol> &symbol : this->symbols)
+    {
+        while (symbol->rows.try_pop(row))
+        {
+            write_row(*symbol, row);
+            written++;
+        }
+    }
+    if (written > 0)
+    {
+        std::fflush(this->file);
+    }
+    return written;
+}
+
+/**
+ * @brief Open the file, write the symbols to its header and start the writer thread
+ * @throws std::runtime_error If the file can't be opened
+ */
+void DepthHeatmap::start()
+{
+    if (this->running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    this->file = std::fopen(this->path.c_str(), "wb");
+    if (!this->file)
+    {
+        throw std::runtime_error("[DepthHeatmap] Failed to open " + this->path);
+    }
+    uint32_t symbol_count = static_cast<uint32_t>(this->symbols.size());
+    std::fwrite(HEATMAP_MAGIC, 1, sizeof(HEATMAP_MAGIC), this->file);
+    std::fwrite(&symbol_count, sizeof(symbol_count), 1, this->file);
+    std::fwrite(&this->row_buckets, sizeof(this->row_buckets), 1, this->file);
+    std::fwrite(&this->row_ms, sizeof(this->row_ms), 1, this->file);
+    for (const std::unique_ptr<Symbol> &symbol : this->symbols)
+    {
+        uint16_t name_size = static_cast<uint16_t>(symbol->name.size());
+        std::fwrite(&name_size, sizeof(name_size), 1, this->file);
+        std::fwrite(symbol->name.data(), 1, name_size, this->file);
+        std::fwrite(&symbol->price_bucket, sizeof(symbol->price_bucket), 1, this->file);
+    }
+    std::fflush(this->file);
+
+    this->running.store(true, std::memory_order_release);
+    this->worker = std::thread(&DepthHeatmap::run, this);
+}
+
+/**
+ * @brief Stop the writer thread, writing the rows already closed
+ */
+void DepthHeatmap::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+    if (this->file)
+    {
+        drain();
+        std::fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+/**
+ * @brief Writer thread body - write closed rows, then wait for more
+ */
+void DepthHeatmap::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        drain();
+        std::this_thread::sleep_for(this->poll_interval);
+    }
+}
+
+/**
+ * @brief Read a symbol's rows back from a heatmap file
+ * @throws std::runtime_error If the file can't be opened, isn't a heatmap or doesn't have the symbol
+ */
+HeatmapSeries DepthHeatmap::read(const std::string &path, const std::string &symbol)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        throw std::runtime_error("[DepthHeatmap] Failed to open " + path);
+    }
+    char magic[sizeof(HEATMAP_MAGIC)];
+    uint32_t symbol_count = 0;
+    uint32_t row_buckets = 0;
+    HeatmapSeries series{symbol, 0, 0, {}};
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || std::memcmp(magic, HEATMAP_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&symbol_count, sizeof(symbol_count), 1, file) != 1 || std::fread(&row_buckets, sizeof(row_buckets), 1, file) != 1 ||
+        std::fread(&series.row_ms, sizeof(series.row_ms), 1, file) != 1 || row_buckets == 0 || row_buckets > HEATMAP_MAX_BUCKETS)
+    {
+        std::fclose(file);
+        throw std::runtime_error("[DepthHeatmap] " + path + " is not a heatmap file");
+    }
+
+    int32_t wanted = -1;
+    std::string name;
+    for (uint32_t i = 0; i < symbol_count; i++)
+    {
+        uint16_t name_size = 0;
+        double price_bucket = 0;
+        if (std::fread(&name_size, sizeof(name_size), 1, file) != 1)
+        {
+            break;
+        }
+        name.resize(name_size);
+        if (std::fread(&name[0], 1, name_size, file) != name_size || std::fread(&price_bucket, sizeof(price_bucket), 1, file) != 1)
+        {
+            break;
+        }
+        if (name == symbol)
+        {
+            wanted = static_cast<int32_t>(i);
+            series.price_bucket = price_bucket;
+        }
+    }
+    if (wanted < 0)
+    {
+        std::fclose(file);
+        throw std::runtime_error("[DepthHeatmap] " + path + " has no rows for " + symbol);
+    }
+
+    // row sizes are checked against what is left of the file, and against the largest row - a run and a changed bucket per bucket,
+    // each a varint of at most 5 bytes - so a torn or corrupt header can't make the reader allocate or seek past the end
+    long rows_start = std::ftell(file);
+    std::fseek(file, 0, SEEK_END);
+    long file_size = std::ftell(file);
+    std::fseek(file, rows_start, SEEK_SET);
+    uint64_t max_row_size = static_cast<uint64_t>(row_buckets) * 2 * 5;
+
+    std::vector<uint8_t> payload;
+    std::vector<float> previous;
+    int64_t previous_first = 0;
+    HeatmapRowHeader header;
+    while (std::fread(&header, sizeof(header), 1, file) == 1)
+    {
+        if (header.size > max_row_size || header.size > static_cast<uint64_t>(file_size - std::ftell(file)))
+        {
+            std::cerr << "[DepthHeatmap] Corrupt row header in " << path << ", stopping" << std::endl;
+            break;
+        }
+        if (header.symbol != wanted)
+        {
+            if (std::fseek(file, header.size, SEEK_CUR) != 0)
+            {
+                break;
+            }
+            continue;
+        }
+        payload.resize(header.size);
+        if (std::fread(payload.data(), 1, header.size, file) != header.size)
+        {
+            std::cerr << "[DepthHeatmap] Heatmap ends part way through a row, stopping" << std::endl;
+            break;
+        }
+
+        HeatmapRow row{header.start_time, header.first_bucket, std::vector<float>(row_buckets)};
+        for (uint32_t i = 0; i < row_buckets; i++)
+        {
+            row.quantities[i] = header.keyframe ? 0.0f : previous_quantity(previous, previous_first, row.first_bucket + i);
+        }
+        const uint8_t *position = payload.data();
+        const uint8_t *end = position + payload.size();
+        uint32_t index = 0;
+        bool decoded = true;
+        while (index < row_buckets)
+        {
+            uint32_t run;
+            uint32_t changed;
+            if (!get_varint(position, end, run))
+            {
+                decoded = false;
+                break;
+            }
+            index += run;
+            if (index >= row_buckets)
+            {
+                break;
+            }
+            if (!get_varint(position, end, changed))
+            {
+                decoded = false;
+                break;
+            }
+            row.quantities[index] = bits_float(float_bits(row.quantities[index]) ^ changed);
+            index++;
+        }
+        if (!decoded)
+        {
+            std::cerr << "[DepthHeatmap] Corrupt row in " << path << ", stopping" << std::endl;
+            break;
+        }
+
+        previous = row.quantities;
+        previous_first = row.first_bucket;
+        series.rows.push_back(std::move(row));
+    }
+    std::fclose(file);
+    return series;
+}
+
+uint64_t DepthHeatmap::get_rows_closed() const
+{
+    return this->rows_closed.load(std::memory_order_relaxed);
+}
+
+uint64_t DepthHeatmap::get_rows_dropped() const
+{
+    return this->rows_dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t DepthHeatmap::get_bytes_written() const
+{
+    return this->bytes_written.load(std::memory_order_relaxed);
+}
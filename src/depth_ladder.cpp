@@ -0,0 +1,175 @@
+// implementation for DepthLadder class
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include "../include/depth_ladder.h"
+
+namespace
+{
+    // column width of prices and quantities
+    constexpr int LADDER_COLUMN_WIDTH = 14;
+
+    const char *const CLEAR_LINE = "\x1b[K\n";
+    const char *const GREEN = "\x1b[32m";
+    const char *const RED = "\x1b[31m";
+    const char *const YELLOW = "\x1b[33m";
+    const char *const RESET = "\x1b[0m";
+
+    /**
+     * @brief Write all of a buffer, however many write() calls it takes
+     */
+    void write_all(int fd, const std::string &data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+            if (result <= 0)
+            {
+                return;
+            }
+            written += static_cast<size_t>(result);
+        }
+    }
+}
+
+/**
+ * @brief Construct a new DepthLadder
+ * @param levels Levels shown per side, at most DEPTH_VIEW_LEVELS
+ * @param refresh_interval Time between frames
+ * @param output_fd Terminal to draw on
+ * @throws std::invalid_argument If levels is 0 or above DEPTH_VIEW_LEVELS
+ */
+DepthLadder::DepthLadder(size_t levels, std::chrono::milliseconds refresh_interval, int output_fd)
+    : levels(levels), refresh_interval(refresh_interval), output_fd(output_fd), last_frame(std::chrono::steady_clock::now())
+{
+    if (levels == 0 || levels > DEPTH_VIEW_LEVELS)
+    {
+        throw std::invalid_argument("[DepthLadder] Levels must be 1 to " + std::to_string(DEPTH_VIEW_LEVELS));
+    }
+}
+
+DepthLadder::~DepthLadder()
+{
+    stop();
+}
+
+void DepthLadder::add_ladder(Ladder ladder)
+{
+    ladder.last_version = ladder.view->version() & ~static_cast<uint64_t>(1);
+    this->ladders.push_back(std::move(ladder));
+}
+
+/**
+ * @brief Build the next frame - what the ladder thread draws. Rates are over the time since the last call.
+ */
+std::string DepthLadder::render()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - this->last_frame).count();
+    this->last_frame = now;
+    int64_t wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::ostringstream frame;
+    // draw over the last frame from the top left, clearing what it leaves behind
+    frame << "\x1b[H";
+    for (Ladder &ladder : this->ladders)
+    {
+        // the version goes up by two for every published view
+        uint64_t version = ladder.view->version() & ~static_cast<uint64_t>(1);
+        DepthView view;
+        ladder.view->load(view);
+        double rate = elapsed > 0 ? static_cast<double>(version - ladder.last_version) / 2 / elapsed : 0;
+        ladder.last_version = version;
+        SyncState state = ladder.sync_state(ladder.book);
+        SyncStats stats = ladder.sync_stats(ladder.book);
+
+        frame << std::fixed << std::setprecision(0) << ladder.name << "  " << (state == SyncState::SYNCED ? GREEN : YELLOW) << to_string(state) << RESET
+              << "  " << rate << " upd/s";
+        if (view.bid_count > 0 && view.ask_count > 0)
+        {
+            double spread = view.asks[0].price - view.bids[0].price;
+            double mid = (view.asks[0].price + view.bids[0].price) / 2;
+            frame << "  spread " << std::setprecision(ladder.price_decimals) << spread << " (" << std::setprecision(1) << spread / mid * 1e4 << "bp)";
+        }
+        frame << std::setprecision(0) << "  lag " << (view.event_time > 0 ? wall_ms - view.event_time : 0) << "ms  repairs " << stats.gap_repairs
+              << "  resyncs " << stats.full_resyncs << CLEAR_LINE;
+
+        frame << std::setw(LADDER_COLUMN_WIDTH) << "bid qty" << std::setw(LADDER_COLUMN_WIDTH) << "bid" << "  |" << std::setw(LADDER_COLUMN_WIDTH) << "ask"
+              << std::setw(LADDER_COLUMN_WIDTH) << "ask qty" << CLEAR_LINE;
+        for (size_t level = 0; level < this->levels; level++)
+        {
+            frame << GREEN;
+            if (level < view.bid_count)
+            {
+                frame << std::setprecision(4) << std::setw(LADDER_COLUMN_WIDTH) << view.bids[level].quantity << std::setprecision(ladder.price_decimals)
+                      << std::setw(LADDER_COLUMN_WIDTH) << view.bids[level].price;
+            }
+            else
+            {
+                frame << std::setw(2 * LADDER_COLUMN_WIDTH) << "";
+            }
+            frame << RESET << "  |" << RED;
+            if (level < view.ask_count)
+            {
+                frame << std::setprecision(ladder.price_decimals) << std::setw(LADDER_COLUMN_WIDTH) << view.asks[level].price << std::setprecision(4)
+                      << std::setw(LADDER_COLUMN_WIDTH) << view.asks[level].quantity;
+            }
+            frame << RESET << CLEAR_LINE;
+        }
+        frame << CLEAR_LINE;
+    }
+    frame << "\x1b[J";
+    return frame.str();
+}
+
+/**
+ * @brief Switch the terminal to the alternate screen and start the ladder thread
+ */
+void DepthLadder::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    write_all(this->output_fd, DEPTH_LADDER_ENTER);
+    this->worker = std::thread(&DepthLadder::run, this);
+}
+
+/**
+ * @brief Stop the ladder thread and give the terminal back
+ */
+void DepthLadder::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+        write_all(this->output_fd, DEPTH_LADDER_RESTORE);
+    }
+}
+
+/**
+ * @brief Ladder thread body - draw a frame every refresh interval, on a fixed schedule however long drawing took
+ */
+void DepthLadder::run()
+{
+    this->last_frame = std::chrono::steady_clock::now();
+    auto next_frame = this->last_frame;
+    while (this->running.load(std::memory_order_acquire))
+    {
+        // after a stall, carry on from now rather than drawing the missed frames back to back
+        next_frame = std::max(next_frame + this->refresh_interval, std::chrono::steady_clock::now());
+        std::this_thread::sleep_until(next_frame);
+        write_all(this->output_fd, render());
+        this->frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t DepthLadder::get_frames() const
+{
+    return this->frames.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,550 @@
+// implementation for DepthServer class
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/depth_server.h"
+
+namespace
+{
+    /**
+     * @brief Append a little endian value to a frame buffer
+     */
+    template <typename T>
+    void append(std::vector<char> &out, T value)
+    {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    /**
+     * @brief Append a uint8 length-prefixed string to a frame buffer
+     */
+    void append_string(std::vector<char> &out, const std::string &value)
+    {
+        uint8_t len = static_cast<uint8_t>(std::min<size_t>(value.size(), 255));
+        append(out, len);
+        out.insert(out.end(), value.data(), value.data() + len);
+    }
+
+    /**
+     * @brief Start a frame - appends a placeholder length and the type
+     * @return The offset of the length field, to pass to end_frame()
+     */
+    size_t begin_frame(std::vector<char> &out, DepthMessageType type)
+    {
+        size_t start = out.size();
+        append<uint32_t>(out, 0);
+        append(out, static_cast<uint8_t>(type));
+        return start;
+    }
+
+    /**
+     * @brief Finish a frame - fills in the length field
+     */
+    void end_frame(std::vector<char> &out, size_t start)
+    {
+        uint32_t len = static_cast<uint32_t>(out.size() - start - sizeof(uint32_t));
+        std::memcpy(out.data() + start, &len, sizeof(len));
+    }
+
+    /**
+     * @brief Read a uint8 length-prefixed string from a request payload
+     * @return false if the payload is too short
+     */
+    bool read_string(const char *&payload, size_t &len, std::string &value)
+    {
+        if (len < 1)
+        {
+            return false;
+        }
+        uint8_t str_len = static_cast<uint8_t>(payload[0]);
+        if (len < 1u + str_len)
+        {
+            return false;
+        }
+        value.assign(payload + 1, str_len);
+        payload += 1 + str_len;
+        len -= 1 + str_len;
+        return true;
+    }
+}
+
+/**
+ * @brief Construct a new DepthServer
+ * @param socket_path Path of the Unix domain socket file to listen on (replaced if it exists)
+ * @param poll_interval How often books are checked for BBO changes
+ */
+DepthServer::DepthServer(const std::string &socket_path, std::chrono::microseconds poll_interval)
+    : socket_path(socket_path), poll_interval(poll_interval) {}
+
+DepthServer::~DepthServer()
+{
+    stop();
+}
+
+/**
+ * @brief Make a book available to clients - must be called before start()
+ */
+void DepthServer::add_book(const std::string &symbol, const SeqLock<DepthView> &view)
+{
+    this->books.push_back(ServedBook{symbol, &view, 0, PriceLevel{0, 0}, PriceLevel{0, 0}});
+}
+
+/**
+ * @brief Bind the socket and start the server thread
+ */
+void DepthServer::start()
+{
+    if (this->running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (this->socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("[DepthServer] Socket path too long: " + this->socket_path);
+    }
+    std::memcpy(address.sun_path, this->socket_path.c_str(), this->socket_path.size() + 1);
+
+    this->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (this->listen_fd < 0)
+    {
+        throw std::runtime_error(std::string("[DepthServer] socket failed: ") + std::strerror(errno));
+    }
+
+    // remove a socket file left behind by a previous run
+    unlink(this->socket_path.c_str());
+    if (bind(this->listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(this->listen_fd, 16) != 0)
+    {
+        std::string error = std::strerror(errno);
+        close(this->listen_fd);
+        this->listen_fd = -1;
+        throw std::runtime_error("[DepthServer] Failed to listen on " + this->socket_path + ": " + error);
+    }
+
+    std::cout << "[DepthServer] Listening on " << this->socket_path << std::endl;
+    this->running.store(true, std::memory_order_release);
+    this->worker = std::thread(&DepthServer::run, this);
+}
+
+/**
+ * @brief Stop the server thread, disconnect every client and remove the socket file
+ */
+void DepthServer::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+
+    for (Client &client : this->clients)
+    {
+        close(client.fd);
+    }
+    this->clients.clear();
+
+    if (this->listen_fd >= 0)
+    {
+        close(this->listen_fd);
+        this->listen_fd = -1;
+        unlink(this->socket_path.c_str());
+    }
+}
+
+/**
+ * @brief Get the number of clients disconnected for not keeping up
+ */
+uint64_t DepthServer::get_slow_client_disconnects() const
+{
+    return this->slow_client_disconnects.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Find a served book by symbol
+ * @return The book's index, or -1 if not served
+ */
+int DepthServer::find_book(const std::string &symbol) const
+{
+    for (size_t i = 0; i < this->books.size(); i++)
+    {
+        if (this->books[i].symbol == symbol)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Accept every pending connection
+ */
+void DepthServer::accept_clients()
+{
+    while (true)
+    {
+        int fd = accept4(this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        if (this->clients.size() >= DEPTH_SERVER_MAX_CLIENTS)
+        {
+            std::cerr << "[DepthServer] Too many clients, rejecting connection" << std::endl;
+            close(fd);
+            continue;
+        }
+
+        Client client{fd, {}, {}, 0, std::vector<bool>(this->books.size(), false), false};
+        client.in.reserve(DEPTH_SERVER_MAX_REQUEST_BYTES);
+        client.out.reserve(64 * 1024);
+        this->clients.push_back(std::move(client));
+    }
+}
+
+/**
+ * @brief Read everything available from a client and handle each complete request frame
+ */
+void DepthServer::read_client(Client &client)
+{
+    char chunk[4096];
+    // a client that pipelines requests without reading the replies is dropped here, before its next requests are read
+    while (!over_pending_limit(client))
+    {
+        ssize_t received = recv(client.fd, chunk, sizeof(chunk), 0);
+        if (received == 0)
+        {
+            client.closing = true;
+            return;
+        }
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                client.closing = true;
+            }
+            return;
+        }
+        client.in.insert(client.in.end(), chunk, chunk + received);
+        // handle frames as they arrive, so only the partial frame at the end is ever kept
+        handle_frames(client);
+    }
+}
+
+/**
+ * @brief Handle every complete frame in a client's input buffer, keeping the partial frame at the end.
+ * A partial frame can't be longer than the largest request, so a client that leaves more than that unparsed is disconnected.
+ */
+void DepthServer::handle_frames(Client &client)
+{
+    size_t offset = 0;
+    while (client.in.size() - offset >= sizeof(uint32_t) + 1)
+    {
+        uint32_t len;
+        std::memcpy(&len, client.in.data() + offset, sizeof(len));
+        if (len == 0 || len > DEPTH_SERVER_MAX_REQUEST_BYTES)
+        {
+            // not our protocol - drop the client rather than trying to resynchronise the stream
+            client.closing = true;
+            return;
+        }
+        if (client.in.size() - offset < sizeof(uint32_t) + len)
+        {
+            break;
+        }
+
+        const char *frame = client.in.data() + offset + sizeof(uint32_t);
+        handle_request(client, static_cast<DepthMessageType>(frame[0]), frame + 1, len - 1);
+        offset += sizeof(uint32_t) + len;
+        if (client.closing)
+        {
+            return;
+        }
+    }
+    client.in.erase(client.in.begin(), client.in.begin() + offset);
+
+    if (client.in.size() > sizeof(uint32_t) + DEPTH_SERVER_MAX_REQUEST_BYTES)
+    {
+        std::cerr << "[DepthServer] Client sent " << client.in.size() << " bytes without a complete request, disconnecting" << std::endl;
+        client.closing = true;
+    }
+}
+
+/**
+ * @brief Handle one request frame from a client
+ */
+void DepthServer::handle_request(Client &client, DepthMessageType type, const char *payload, size_t len)
+{
+    std::string symbol;
+    if (!read_string(payload, len, symbol))
+    {
+        queue_error(client, "malformed request");
+        return;
+    }
+
+    int book_index = find_book(symbol);
+    if (book_index < 0)
+    {
+        queue_error(client, "unknown symbol " + symbol);
+        return;
+    }
+
+    switch (type)
+    {
+    case DepthMessageType::REQUEST_DEPTH:
+    {
+        uint16_t levels = static_cast<uint16_t>(DEPTH_VIEW_LEVELS);
+        if (len >= sizeof(uint16_t))
+        {
+            std::memcpy(&levels, payload, sizeof(levels));
+        }
+        queue_depth(client, this->books[book_index], levels);
+        break;
+    }
+
+    case DepthMessageType::SUBSCRIBE_BBO:
+        client.bbo_subscriptions[book_index] = true;
+        break;
+
+    case DepthMessageType::UNSUBSCRIBE_BBO:
+        client.bbo_subscriptions[book_index] = false;
+        break;
+
+    default:
+        queue_error(client, "unknown request type");
+        break;
+    }
+}
+
+/**
+ * @brief Queue a DEPTH frame with the top levels of a book
+ */
+void DepthServer::queue_depth(Client &client, const ServedBook &book, uint16_t levels)
+{
+    if (over_pending_limit(client))
+    {
+        return;
+    }
+
+    DepthView view;
+    book.view->load(view);
+
+    uint16_t bid_count = static_cast<uint16_t>(std::min<uint32_t>(levels, view.bid_count));
+    uint16_t ask_count = static_cast<uint16_t>(std::min<uint32_t>(levels, view.ask_count));
+
+    size_t start = begin_frame(client.out, DepthMessageType::DEPTH);
+    append_string(client.out, book.symbol);
+    append(client.out, view.update_id);
+    append(client.out, view.event_time);
+    append(client.out, bid_count);
+    append(client.out, ask_count);
+    for (uint16_t i = 0; i < bid_count; i++)
+    {
+        append(client.out, view.bids[i].price);
+        append(client.out, view.bids[i].quantity);
+    }
+    for (uint16_t i = 0; i < ask_count; i++)
+    {
+        append(client.out, view.asks[i].price);
+        append(client.out, view.asks[i].quantity);
+    }
+    end_frame(client.out, start);
+}
+
+/**
+ * @brief Queue an ERROR frame
+ */
+void DepthServer::queue_error(Client &client, const std::string &message)
+{
+    if (over_pending_limit(client))
+    {
+        return;
+    }
+
+    size_t start = begin_frame(client.out, DepthMessageType::ERROR);
+    append_string(client.out, message);
+    end_frame(client.out, start);
+}
+
+/**
+ * @brief Check each book for a new BBO and queue a BBO frame to every subscribed client
+ */
+void DepthServer::publish_bbo_changes()
+{
+    for (size_t book_index = 0; book_index < this->books.size(); book_index++)
+    {
+        ServedBook &book = this->books[book_index];
+
+        // cheap check first - nothing published since the last look
+        uint64_t version = book.view->version();
+        if (version == book.last_version)
+        {
+            continue;
+        }
+
+        DepthView view;
+        if (!book.view->try_load(view))
+        {
+            // mid-write, pick it up on the next loop
+            continue;
+        }
+        book.last_version = version;
+
+        PriceLevel best_bid = view.bid_count > 0 ? view.bids[0] : PriceLevel{0, 0};
+        PriceLevel best_ask = view.ask_count > 0 ? view.asks[0] : PriceLevel{0, 0};
+        if (best_bid.price == book.best_bid.price && best_bid.quantity == book.best_bid.quantity &&
+            best_ask.price == book.best_ask.price && best_ask.quantity == book.best_ask.quantity)
+        {
+            continue;
+        }
+        book.best_bid = best_bid;
+        book.best_ask = best_ask;
+
+        for (Client &client : this->clients)
+        {
+            if (!client.bbo_subscriptions[book_index] || over_pending_limit(client))
+            {
+                continue;
+            }
+
+            size_t start = begin_frame(client.out, DepthMessageType::BBO);
+            append_string(client.out, book.symbol);
+            append(client.out, view.update_id);
+            append(client.out, view.event_time);
+            append(client.out, best_bid.price);
+            append(client.out, best_bid.quantity);
+            append(client.out, best_ask.price);
+            append(client.out, best_ask.quantity);
+            end_frame(client.out, start);
+        }
+    }
+}
+
+/**
+ * @brief Check whether a client has more unsent output than DEPTH_SERVER_MAX_PENDING_BYTES, and mark it for disconnection if so
+ * @return true if the client is (now) closing, so nothing more should be read from or queued for it
+ */
+bool DepthServer::over_pending_limit(Client &client)
+{
+    if (client.closing)
+    {
+        return true;
+    }
+    if (client.out.size() - client.out_sent <= DEPTH_SERVER_MAX_PENDING_BYTES)
+    {
+        return false;
+    }
+    std::cerr << "[DepthServer] Client fell " << client.out.size() - client.out_sent << " bytes behind, disconnecting" << std::endl;
+    this->slow_client_disconnects.fetch_add(1, std::memory_order_relaxed);
+    client.closing = true;
+    return true;
+}
+
+/**
+ * @brief Send as much of a client's output buffer as the socket will take, disconnecting the client if it has fallen too far behind
+ */
+void DepthServer::flush_client(Client &client)
+{
+    while (client.out_sent < client.out.size())
+    {
+        ssize_t sent = send(client.fd, client.out.data() + client.out_sent, client.out.size() - client.out_sent, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                client.closing = true;
+            }
+            break;
+        }
+        client.out_sent += static_cast<size_t>(sent);
+    }
+
+    if (client.out_sent == client.out.size())
+    {
+        client.out.clear();
+        client.out_sent = 0;
+    }
+    else if (over_pending_limit(client))
+    {
+        return;
+    }
+    else if (client.out_sent > client.out.size() / 2)
+    {
+        // compact occasionally so the buffer doesn't keep growing at the front
+        client.out.erase(client.out.begin(), client.out.begin() + client.out_sent);
+        client.out_sent = 0;
+    }
+}
+
+/**
+ * @brief Server thread body
+ */
+void DepthServer::run()
+{
+    std::vector<pollfd> poll_fds;
+    // ppoll rather than poll, which can't wait less than a millisecond
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(this->poll_interval);
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(seconds.count());
+    timeout.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(this->poll_interval - seconds).count());
+
+    while (this->running.load(std::memory_order_acquire))
+    {
+        poll_fds.clear();
+        poll_fds.push_back(pollfd{this->listen_fd, POLLIN, 0});
+        for (const Client &client : this->clients)
+        {
+            poll_fds.push_back(pollfd{client.fd, static_cast<short>(POLLIN | (client.out.empty() ? 0 : POLLOUT)), 0});
+        }
+
+        ppoll(poll_fds.data(), poll_fds.size(), &timeout, nullptr);
+
+        if (poll_fds[0].revents & POLLIN)
+        {
+            accept_clients();
+        }
+
+        // poll_fds[i + 1] belongs to clients[i] - new clients were appended after, so indices still line up
+        for (size_t i = 0; i + 1 < poll_fds.size(); i++)
+        {
+            if (poll_fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                read_client(this->clients[i]);
+            }
+        }
+
+        publish_bbo_changes();
+
+        // one batched write per client per loop
+        for (Client &client : this->clients)
+        {
+            if (!client.out.empty() && !client.closing)
+            {
+                flush_client(client);
+            }
+        }
+
+        // drop disconnected clients
+        auto closed = std::remove_if(this->clients.begin(), this->clients.end(), [](const Client &client)
+                                     {
+            if (client.closing)
+            {
+                close(client.fd);
+            }
+            return client.closing; });
+        this->clients.erase(closed, this->clients.end());
+    }
+}
@@ -0,0 +1,338 @@
+// implementation for FillSimulator class
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/fill_simulator.h"
+
+void FillSimulator::level_change_callback(const LevelChange &change, void *user)
+{
+    static_cast<FillSimulator *>(user)->on_level_change(change);
+}
+
+void FillSimulator::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    (void)reloaded; // a reload comes without level changes, so queues keep their place until their level next changes
+    static_cast<FillSimulator *>(user)->on_book_update(view);
+}
+
+void FillSimulator::trade_callback(const Trade &trade, void *user)
+{
+    static_cast<FillSimulator *>(user)->on_trade(trade);
+}
+
+void FillSimulator::add_listener(SimOrderListener listener, void *user)
+{
+    this->listeners.emplace_back(listener, user);
+}
+
+/**
+ * @brief Send an order
+ * @param arrival_time_us When it reaches the venue - the sending time plus order entry latency
+ * @return The order's ID
+ * @throws std::invalid_argument If the quantity isn't positive
+ */
+uint64_t FillSimulator::submit(OrderSide side, OrderType type, double price, double quantity, int64_t arrival_time_us)
+{
+    if (!(quantity > 0))
+    {
+        throw std::invalid_argument("[FillSimulator] Order quantity must be positive");
+    }
+
+    uint64_t id = this->next_id++;
+    schedule(Pending{arrival_time_us, false, id, side, type, price, quantity});
+    return id;
+}
+
+void FillSimulator::cancel(uint64_t order_id, int64_t arrival_time_us)
+{
+    schedule(Pending{arrival_time_us, true, order_id, OrderSide::BUY, OrderType::LIMIT, 0, 0});
+}
+
+void FillSimulator::schedule(const Pending &action)
+{
+    // after anything arriving at the same time, so actions arrive in the order they were sent
+    auto position = std::upper_bound(this->pending.begin(), this->pending.end(), action.arrival_time_us,
+                                     [](int64_t time, const Pending &other)
+                                     {
+                                         return time < other.arrival_time_us;
+                                     });
+    this->pending.insert(position, action);
+}
+
+void FillSimulator::advance_to(int64_t time_us)
+{
+    // only a handful of actions are ever in flight, so taking them off the front is cheap
+    size_t due = 0;
+    while (due < this->pending.size() && this->pending[due].arrival_time_us <= time_us)
+    {
+        due++;
+    }
+    if (due == 0)
+    {
+        return;
+    }
+
+    // moved out first, as listeners can send more orders while these arrive - the buffer keeps its capacity between calls
+    this->arriving.assign(this->pending.begin(), this->pending.begin() + due);
+    this->pending.erase(this->pending.begin(), this->pending.begin() + due);
+    for (const Pending &action : this->arriving)
+    {
+        arrive(action);
+    }
+}
+
+void FillSimulator::arrive(const Pending &action)
+{
+    if (action.is_cancel)
+    {
+        cancel_now(action.id, action.arrival_time_us);
+        return;
+    }
+    cross(action.id, action.side, action.type, action.price, action.quantity, action.arrival_time_us);
+}
+
+/**
+ * @brief Fill an arriving order against the visible opposite levels up to its price, then rest or cancel the rest
+ */
+void FillSimulator::cross(uint64_t id, OrderSide side, OrderType type, double price, double quantity, int64_t time_us)
+{
+    bool is_buy = side == OrderSide::BUY;
+    double remaining = quantity;
+    double filled = 0;
+
+    if (this->has_view)
+    {
+        const PriceLevel *levels = is_buy ? this->view.asks : this->view.bids;
+        uint32_t count = is_buy ? this->view.ask_count : this->view.bid_count;
+        double *taken = is_buy ? this->ask_taken : this->bid_taken;
+        for (uint32_t depth = 0; depth < count && remaining > 0; depth++)
+        {
+            double level_price = levels[depth].price;
+            if (type != OrderType::MARKET && (is_buy ? level_price > price : level_price < price))
+            {
+                break;
+            }
+            double available = levels[depth].quantity - taken[depth];
+            if (available <= 0)
+            {
+                continue;
+            }
+            double quantity_taken = std::min(available, remaining);
+            taken[depth] += quantity_taken;
+            remaining -= quantity_taken;
+            filled += quantity_taken;
+            report(id, remaining > 0 ? SimOrderStatus::PARTIALLY_FILLED : SimOrderStatus::FILLED, false, time_us, level_price, quantity_taken, filled, remaining);
+        }
+    }
+
+    if (remaining <= 0)
+    {
+        return;
+    }
+    if (type != OrderType::LIMIT)
+    {
+        report(id, SimOrderStatus::CANCELLED, false, time_us, 0, 0, filled, remaining);
+        return;
+    }
+
+    // rest behind whatever is already at our price - a new level inside the view has nobody ahead, one deeper than the view is unknown
+    Order order{id, side, price, quantity, filled, 0, 0, true};
+    const PriceLevel *levels = is_buy ? this->view.bids : this->view.asks;
+    uint32_t count = this->has_view ? (is_buy ? this->view.bid_count : this->view.ask_count) : 0;
+    uint32_t depth = 0;
+    while (depth < count && (is_buy ? levels[depth].price > price : levels[depth].price < price))
+    {
+        depth++;
+    }
+    if (depth < count && levels[depth].price == price)
+    {
+        order.queue_ahead = levels[depth].quantity;
+    }
+    else if (depth == count && count == DEPTH_VIEW_LEVELS)
+    {
+        order.queue_known = false;
+    }
+
+    (is_buy ? this->bids : this->asks).push_back(order);
+    report(id, filled > 0 ? SimOrderStatus::PARTIALLY_FILLED : SimOrderStatus::RESTING, false, time_us, 0, 0, filled, remaining);
+}
+
+void FillSimulator::cancel_now(uint64_t id, int64_t time_us)
+{
+    for (std::vector<Order> *orders : {&this->bids, &this->asks})
+    {
+        for (size_t index = 0; index < orders->size(); index++)
+        {
+            Order &order = (*orders)[index];
+            if (order.id == id)
+            {
+                report(id, SimOrderStatus::CANCELLED, false, time_us, 0, 0, order.filled, order.quantity - order.filled);
+                orders->erase(orders->begin() + index);
+                return;
+            }
+        }
+    }
+    report(id, SimOrderStatus::REJECTED, false, time_us, 0, 0, 0, 0);
+}
+
+/**
+ * @brief Fill part of a resting order, removing it once it's complete
+ * @return true if the order was completed and removed
+ */
+bool FillSimulator::fill(std::vector<Order> &orders, size_t index, double price, double quantity, int64_t time_us)
+{
+    Order &order = orders[index];
+    quantity = std::min(quantity, order.quantity - order.filled);
+    order.filled += quantity;
+    double remaining = order.quantity - order.filled;
+    report(order.id, remaining > 0 ? SimOrderStatus::PARTIALLY_FILLED : SimOrderStatus::FILLED, true, time_us, price, quantity, order.filled, remaining);
+    if (remaining > 0)
+    {
+        return false;
+    }
+    orders.erase(orders.begin() + index);
+    return true;
+}
+
+void FillSimulator::report(uint64_t id, SimOrderStatus status, bool maker, int64_t time_us, double price, double quantity, double filled, double remaining)
+{
+    SimOrderUpdate update{id, status, maker, time_us, price, quantity, filled, remaining};
+    for (const auto &listener : this->listeners)
+    {
+        listener.first(update, listener.second);
+    }
+}
+
+/**
+ * @brief Move the queue of resting orders at a changed level
+ */
+void FillSimulator::on_level_change(const LevelChange &change)
+{
+    if (!this->pending.empty())
+    {
+        advance_to(change.event_time * 1000);
+    }
+
+    std::vector<Order> &orders = change.is_bid ? this->bids : this->asks;
+    for (Order &order : orders)
+    {
+        if (order.price != change.price)
+        {
+            continue;
+        }
+        if (!order.queue_known)
+        {
+            // everything at the level before this change was there before us
+            order.queue_ahead = change.previous_quantity;
+            order.queue_known = true;
+        }
+
+        // a decrease that only echoes trades already counted doesn't move us again
+        double decrease = change.previous_quantity - change.quantity;
+        if (decrease > 0)
+        {
+            double echoed = std::min(decrease, order.traded_at_level);
+            order.traded_at_level -= echoed;
+            order.queue_ahead = std::max(0.0, order.queue_ahead - (decrease - echoed));
+        }
+        // additions join behind us, so the queue ahead can't be more than the level
+        order.queue_ahead = std::min(order.queue_ahead, change.quantity);
+    }
+}
+
+/**
+ * @brief Take the book after an event, and fill resting orders the opposite side has moved onto or through
+ */
+void FillSimulator::on_book_update(const DepthView &view)
+{
+    if (!this->pending.empty())
+    {
+        advance_to(view.event_time * 1000);
+    }
+
+    this->view = view;
+    this->has_view = true;
+    std::fill(this->bid_taken, this->bid_taken + DEPTH_VIEW_LEVELS, 0.0);
+    std::fill(this->ask_taken, this->ask_taken + DEPTH_VIEW_LEVELS, 0.0);
+
+    int64_t time_us = view.event_time * 1000;
+    for (size_t index = 0; index < this->bids.size();)
+    {
+        const Order &order = this->bids[index];
+        if (view.ask_count > 0 && view.asks[0].price <= order.price && fill(this->bids, index, order.price, order.quantity, time_us))
+        {
+            continue;
+        }
+        index++;
+    }
+    for (size_t index = 0; index < this->asks.size();)
+    {
+        const Order &order = this->asks[index];
+        if (view.bid_count > 0 && view.bids[0].price >= order.price && fill(this->asks, index, order.price, order.quantity, time_us))
+        {
+            continue;
+        }
+        index++;
+    }
+}
+
+/**
+ * @brief Match a trade against the resting orders on the side it hit
+ */
+void FillSimulator::on_trade(const Trade &trade)
+{
+    // the time the trade executed, not when the stream published it
+    int64_t time_us = trade.trade_time * 1000;
+    if (!this->pending.empty())
+    {
+        advance_to(time_us);
+    }
+
+    // the buyer was the maker, so the taker sold into the bids
+    std::vector<Order> &orders = trade.is_buyer_maker ? this->bids : this->asks;
+    for (size_t index = 0; index < orders.size();)
+    {
+        Order &order = orders[index];
+        bool through = trade.is_buyer_maker ? trade.price < order.price : trade.price > order.price;
+        if (through)
+        {
+            // the taker went past our price, so our whole queue was taken
+            fill(orders, index, order.price, order.quantity, time_us);
+            continue;
+        }
+        if (trade.price != order.price || !order.queue_known)
+        {
+            index++;
+            continue;
+        }
+
+        order.traded_at_level += trade.quantity;
+        double reaching_us = trade.quantity - order.queue_ahead;
+        order.queue_ahead = std::max(0.0, order.queue_ahead - trade.quantity);
+        if (reaching_us > 0 && fill(orders, index, order.price, reaching_us, time_us))
+        {
+            continue;
+        }
+        index++;
+    }
+}
+
+double FillSimulator::get_queue_ahead(uint64_t order_id) const
+{
+    for (const std::vector<Order> *orders : {&this->bids, &this->asks})
+    {
+        for (const Order &order : *orders)
+        {
+            if (order.id == order_id)
+            {
+                return order.queue_known ? order.queue_ahead : -1;
+            }
+        }
+    }
+    return -1;
+}
+
+size_t FillSimulator::get_resting_count() const
+{
+    return this->bids.size() + this->asks.size();
+}
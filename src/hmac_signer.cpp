@@ -0,0 +1,78 @@
+// implementation for HmacSigner class
+
+// The SHA256_* functions are deprecated in OpenSSL 3 in favour of EVP, but an EVP digest context can't be copied without allocating,
+// and resuming from a copied state on every signature is the point of the signer
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "../include/hmac_signer.h"
+
+namespace
+{
+    // SHA-256 block size, and so the HMAC key pad length
+    constexpr size_t BLOCK_SIZE = 64;
+}
+
+/**
+ * @brief Precompute the pad states for a key
+ * @param secret The key - keys longer than a block are hashed first, as HMAC requires
+ */
+HmacSigner::HmacSigner(const std::string &secret)
+{
+    unsigned char key[BLOCK_SIZE] = {};
+    if (secret.size() > BLOCK_SIZE)
+    {
+        SHA256(reinterpret_cast<const unsigned char *>(secret.data()), secret.size(), key);
+    }
+    else
+    {
+        std::memcpy(key, secret.data(), secret.size());
+    }
+
+    unsigned char inner_pad[BLOCK_SIZE];
+    unsigned char outer_pad[BLOCK_SIZE];
+    for (size_t i = 0; i < BLOCK_SIZE; i++)
+    {
+        inner_pad[i] = key[i] ^ 0x36;
+        outer_pad[i] = key[i] ^ 0x5c;
+    }
+
+    SHA256_Init(&this->inner);
+    SHA256_Update(&this->inner, inner_pad, BLOCK_SIZE);
+    SHA256_Init(&this->outer);
+    SHA256_Update(&this->outer, outer_pad, BLOCK_SIZE);
+}
+
+/**
+ * @brief Sign a payload
+ * @param digest Set to the SHA256_DIGEST_LENGTH byte signature
+ */
+void HmacSigner::sign(const char *payload, size_t length, unsigned char *digest) const
+{
+    SHA256_CTX context = this->inner;
+    SHA256_Update(&context, payload, length);
+    unsigned char inner_digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(inner_digest, &context);
+
+    context = this->outer;
+    SHA256_Update(&context, inner_digest, SHA256_DIGEST_LENGTH);
+    SHA256_Final(digest, &context);
+}
+
+/**
+ * @brief Sign a payload, as lowercase hex
+ * @param signature Set to the HMAC_SHA256_HEX_LENGTH character signature (not terminated)
+ * @return HMAC_SHA256_HEX_LENGTH
+ */
+size_t HmacSigner::sign_hex(const char *payload, size_t length, char *signature) const
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    sign(payload, length, digest);
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    for (size_t i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        signature[2 * i] = HEX[digest[i] >> 4];
+        signature[2 * i + 1] = HEX[digest[i] & 0x0F];
+    }
+    return HMAC_SHA256_HEX_LENGTH;
+}
@@ -1,226 +1,528 @@
 #include <cpr/cpr.h>
 #include <iostream>
-#include "../include/websocket_client.h"
-#include "../include/binance.h"
-#include "simdjson.h"
-#include "../include/circular_buffer.h"
+#include "../include/binance_depth.h"
+#include "../include/binance_streams.h"
 #include "../include/order_book.h"
+#include "../include/venue_feed.h"
+#include "../include/snapshot_verifier.h"
+#include "../include/depth_server.h"
+#include "../include/multicast_publisher.h"
+#include "../include/consolidated_book.h"
+#include "../include/synthetic_books.h"
+#include "../include/triangular_arbitrage.h"
+#include "../include/bar_builder.h"
+#include "../include/bar_reconciler.h"
+#include "../include/order_flow_signals.h"
+#include "../include/capture.h"
+#include "../include/order_gateway.h"
+#include "../include/mock_order_venue.h"
+#include "../include/hmac_signer.h"
+#include "../include/risk_engine.h"
+#include "../include/alert_detector.h"
+#include "../include/bbo_series.h"
+#include "../include/depth_heatmap.h"
+#include "../include/depth_ladder.h"
+#include "../include/touch_quoter.h"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <thread>
+#include <unistd.h>
 
-// Helper function to safely parse bid/ask arrays
-bool parse_order_array(simdjson::ondemand::array array, std::vector<std::array<std::string, 2>> &orders)
+// set on SIGINT or SIGTERM - main then stops the ladder, the feeds and every consumer in order
+std::atomic<bool> shutdown_requested{false};
+// terminal the ladder is drawing on, -1 when it isn't running
+std::atomic<int> ladder_terminal{-1};
+
+/**
+ * @brief SIGINT and SIGTERM handler - the first signal only sets the flag main waits on, and the shutdown runs on the main thread.
+ * A second one means the shutdown is stuck (or hasn't been reached yet), so the process is killed - after giving the terminal back if
+ * the ladder has it on the alternate screen.
+ */
+void request_shutdown(int signal)
 {
-    try
+    if (!shutdown_requested.exchange(true, std::memory_order_relaxed))
     {
-        // Pre-allocate to avoid reallocation
-        orders.clear();
-        orders.reserve(1024); // reasonable default size for depth updates
+        return;
+    }
+    int terminal = ladder_terminal.load(std::memory_order_relaxed);
+    if (terminal >= 0)
+    {
+        // write() is async-signal-safe, the ladder's own stop() isn't
+        (void)!write(terminal, DEPTH_LADDER_RESTORE, sizeof(DEPTH_LADDER_RESTORE) - 1);
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
 
-        // Single pass through the array
-        for (auto element : array)
-        {
-            auto values = element.get_array();
-            std::array<std::string, 2> entry;
+/**
+ * @brief Log an arbitrage opportunity found by the scanner
+ * @param opportunity The opportunity
+ * @param user The scanner, used to describe the cycle
+ */
+void log_opportunity(const ArbitrageOpportunity &opportunity, void *user)
+{
+    TriangularArbitrageScanner *scanner = static_cast<TriangularArbitrageScanner *>(user);
+    std::cout << "[Arbitrage] " << scanner->get_cycle_description(opportunity.cycle) << " net return: " << opportunity.net_return * 100 << "%"
+              << " size: " << opportunity.start_quantity << " detected " << opportunity.detection_latency_us << "us after the exchange event" << std::endl;
+}
 
-            // Get first value (price)
-            auto price_val = values.at(0);
-            if (price_val.type() == simdjson::ondemand::json_type::string)
-            {
-                entry[0] = std::string(price_val.get_string().value());
-            }
-            else if (price_val.type() == simdjson::ondemand::json_type::number)
-            {
-                entry[0] = std::to_string(price_val.get_double().value());
-            }
-            else
+/**
+ * @brief Append closed bars to a CSV file as they are published, until stop is set and the ring is empty
+ * @param ring The ring the aggregator publishes to - this is its only consumer
+ * @param bars The aggregator, used to name the symbols
+ * @param stop Set once the aggregator has stopped - the bars still in the ring are written before returning
+ */
+void write_bars(BarRing *ring, const BarAggregator *bars, const std::atomic<bool> *stop)
+{
+    std::ofstream file("bars.csv", std::ios::app);
+    Bar bar;
+    while (true)
+    {
+        if (!ring->try_pop(bar))
+        {
+            file.flush();
+            if (stop->load(std::memory_order_acquire))
             {
-                continue; // Skip invalid entries
+                return;
             }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        file << bars->get_symbol(bar.symbol) << "," << bar.interval_ms << "," << bar.open_time << "," << bar.open << "," << bar.high << "," << bar.low << ","
+             << bar.close << "," << bar.volume << "," << bar.trade_count << "," << bar.mid_close << "," << bar.microprice_close << "\n";
+    }
+}
 
-            // Get second value (quantity)
-            auto qty_val = values.at(1);
-            if (qty_val.type() == simdjson::ondemand::json_type::string)
-            {
-                entry[1] = std::string(qty_val.get_string().value());
-            }
-            else if (qty_val.type() == simdjson::ondemand::json_type::number)
-            {
-                entry[1] = std::to_string(qty_val.get_double().value());
-            }
-            else
+/**
+ * @brief Log a local bar that didn't match the venue's kline
+ * @param divergence The divergence
+ * @param user The aggregator, used to name the symbol
+ */
+void log_divergence(const BarDivergence &divergence, void *user)
+{
+    const BarAggregator *bars = static_cast<const BarAggregator *>(user);
+    std::cerr << "[BarReconciler] " << bars->get_symbol(divergence.symbol) << " " << divergence.interval_ms << "ms bar at " << divergence.open_time
+              << " diverged (fields " << divergence.fields << "), missed trades: " << divergence.missed_trades << " missed volume: " << divergence.missed_volume << std::endl;
+}
+
+/**
+ * @brief Record a trade the bar aggregator took from a trade buffer
+ * @param symbol The aggregator's symbol ID, which is also the trade stream's ID in the capture
+ * @param trade The trade
+ * @param user The capture
+ */
+void record_trade(uint32_t symbol, const Trade &trade, void *user)
+{
+    static_cast<CaptureWriter *>(user)->write_trade(static_cast<uint16_t>(symbol), trade);
+}
+
+/**
+ * @brief Send orders through the order gateway to a local mock venue, one at a time, and print the ack latencies
+ * @param count Number of orders - each is placed, then cancelled
+ */
+int run_mock_orders(int count)
+{
+    const int port = 9443;
+    MockOrderVenue venue(port, "mock-key", "mock-secret");
+    venue.start();
+    OrderGateway gateway(OrderGatewayEndpoints::mock(port), "mock-key", "mock-secret");
+    gateway.connect();
+    while (!gateway.is_connected())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // wait for each response, so the histograms measure an idle round trip rather than queueing
+    auto await = [&gateway](int64_t request_id)
+    {
+        OrderResponse response;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (request_id >= 0 && !gateway.get_response(request_id, response))
+        {
+            if (std::chrono::steady_clock::now() > deadline)
             {
-                continue; // Skip invalid entries
+                return false;
             }
-
-            orders.push_back(entry);
         }
-        return true;
-    }
-    catch (const simdjson::simdjson_error &e)
+        return request_id >= 0 && response.state == RequestState::ACKED;
+    };
+    int rejected = 0;
+    for (int i = 0; i < count; i++)
     {
-        std::cerr << "Error parsing order array: " << e.what() << std::endl;
-        return false;
+        OrderRequest order{};
+        std::strncpy(order.symbol, "XRPUSDT", sizeof(order.symbol));
+        order.side = i % 2 == 0 ? OrderSide::BUY : OrderSide::SELL;
+        order.type = OrderType::LIMIT;
+        order.price_decimals = 4;
+        order.quantity_decimals = 1;
+        order.price = i % 2 == 0 ? 0.5 : 5.0;
+        order.quantity = 10;
+        order.client_order_id = static_cast<uint64_t>(i) + 1;
+        rejected += !await(gateway.place(order));
+        rejected += !await(gateway.cancel(order.symbol, order.client_order_id));
     }
+
+    gateway.get_submit_to_ack().print(std::cout, "submit to ack");
+    gateway.get_write_to_ack().print(std::cout, "write to ack");
+    std::cout << "rejected " << rejected << ", timed out " << gateway.get_timeouts() << ", unmatched " << gateway.get_unmatched_responses() << std::endl;
+    gateway.stop();
+    venue.stop();
+    return rejected == 0 ? 0 : 1;
 }
 
 /**
- * @brief Custom callback method for Binance fstream websocket specifically
- * @param wsi The websocket instance
- * @param reason The reason for the callback
- * @param user User data
- * @param in Incoming data
- * @param len Length of incoming data
+ * @brief Time request signing from precomputed pad states against OpenSSL's one-shot HMAC()
+ * @param iterations Signatures per method
  */
-int binance_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+int run_signing_benchmark(int iterations)
 {
-    WebSocketClientData *client_data = static_cast<WebSocketClientData *>(user);
+    const std::string secret = "NhqPtmdSJYdKjVHjA7PZj4Mge3R5YNiP1e3UZjInClVN65XAbvqqM6A7H5fATj0j";
+    const std::string payload = "apiKey=vmPUZE6mv9SD5VNHk4HlWFsOr6aKE2zvsw0MuIgwCIPy6utIco14y7Ju91duEh8A&newClientOrderId=1234567&price=0.5123"
+                                "&quantity=10.0&side=BUY&symbol=XRPUSDT&timeInForce=GTC&timestamp=1700000000000&type=LIMIT";
+    HmacSigner signer(secret);
+
+    // the payload's last byte changes every time, so neither loop can be hoisted
+    std::string naive_payload = payload;
+    std::string fast_payload = payload;
+    unsigned char naive_digest[EVP_MAX_MD_SIZE];
+    unsigned char fast_digest[SHA256_DIGEST_LENGTH];
+    unsigned int digest_length = 0;
+    uint64_t checksum = 0;
 
-    // Only proceed if we have valid client data
-    if (!client_data)
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
     {
-        return 0;
+        naive_payload.back() = static_cast<char>('A' + i % 26);
+        HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()), reinterpret_cast<const unsigned char *>(naive_payload.data()), naive_payload.size(),
+             naive_digest, &digest_length);
+        checksum += naive_digest[0];
     }
-
-    CircularBuffer<Binance_DiffDepth, 1024> *buffer = client_data->buffer; // Access the buffer through the client
-
-    // Handle different WebSocket events
-    switch (reason)
+    auto naive_end = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
     {
-    case LWS_CALLBACK_CLIENT_ESTABLISHED:
-        lws_callback_on_writable(wsi);
-        break;
+        fast_payload.back() = static_cast<char>('A' + i % 26);
+        signer.sign(fast_payload.data(), fast_payload.size(), fast_digest);
+        checksum -= fast_digest[0];
+    }
+    auto fast_end = std::chrono::steady_clock::now();
 
-    case LWS_CALLBACK_CLIENT_WRITEABLE:
-        // No action needed
-        break;
+    double naive_ns = std::chrono::duration<double, std::nano>(naive_end - start).count() / iterations;
+    double fast_ns = std::chrono::duration<double, std::nano>(fast_end - naive_end).count() / iterations;
+    bool match = checksum == 0 && std::memcmp(naive_digest, fast_digest, SHA256_DIGEST_LENGTH) == 0;
+    std::cout << "HMAC(): " << naive_ns << "ns per signature, precomputed pads: " << fast_ns << "ns per signature ("
+              << naive_ns / fast_ns << "x), signatures " << (match ? "match" : "DIFFER") << std::endl;
+    return match ? 0 : 1;
+}
 
-    case LWS_CALLBACK_CLIENT_RECEIVE:
-    {
-        std::cout << "--------------- Buffer size: " << buffer->size() << " ---------------" << std::endl;
+/**
+ * @brief Time pre-trade risk checks against a book whose BBO changes every few orders
+ * @param iterations Orders to check
+ */
+int run_risk_benchmark(int iterations)
+{
+    SeqLock<DepthView> view;
+    DepthView depth{};
+    depth.bid_count = 1;
+    depth.ask_count = 1;
+    depth.bids[0] = PriceLevel{0.5000, 1000};
+    depth.asks[0] = PriceLevel{0.5001, 1000};
+    view.store(depth);
 
-        // Parse incoming JSON payload
-        simdjson::ondemand::parser parser;
-        simdjson::padded_string json_data((const char *)in, len);
+    RiskEngine risk;
+    uint32_t symbol = risk.add_symbol("XRPUSDT", view, RiskLimits{10000, 0.05, 1e6, 1e9, 1000});
 
-        try
+    uint32_t rejected = 0;
+    int64_t elapsed_ns = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        // the book moves every 8 orders, so some checks re-read the BBO
+        if (i % 8 == 0)
         {
-            auto doc = parser.iterate(json_data);
+            depth.bids[0].price = 0.5000 + (i % 64) * 0.0001;
+            depth.asks[0].price = depth.bids[0].price + 0.0001;
+            view.store(depth);
+        }
+        OrderSide side = i % 2 == 0 ? OrderSide::BUY : OrderSide::SELL;
+        // one order in 16 is priced outside the collar
+        double price = i % 16 == 0 ? 1.0 : depth.bids[0].price;
 
-            // Create Binance struct from JSON payload
-            Binance_DiffDepth event_update;
+        auto start = std::chrono::steady_clock::now();
+        uint32_t result = risk.check(symbol, side, OrderType::LIMIT, price, 100, static_cast<int64_t>(i) * 1000);
+        elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 
-            // Parse basic fields
-            event_update.event = std::string(doc["e"].get_string().value());
-            event_update.event_time = doc["E"].get_int64();
-            event_update.symbol = std::string(doc["s"].get_string().value());
-            event_update.first_update_id = std::to_string(doc["U"].get_int64());
-            event_update.final_update_id = std::to_string(doc["u"].get_int64());
+        rejected += result != RISK_PASSED;
+        risk.on_done(symbol, side, result == RISK_PASSED ? 100 : 0);
+    }
 
-            // Parse bids array
-            auto bids = doc["b"].get_array();
-            for (auto bid : bids)
-            {
-                std::array<std::string, 2> bid_entry;
-                auto bid_array = bid.get_array();
-                size_t index = 0;
-                for (auto value : bid_array)
-                {
-                    if (index < 2)
-                    {
-                        bid_entry[index] = std::string(value.get_string().value());
-                        index++;
-                    }
-                }
-                event_update.bids.push_back(bid_entry);
-            }
+    // the same pair of clock reads with nothing between them, to take out of the per-check time
+    int64_t clock_ns = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        clock_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
 
-            // Parse asks array
-            auto asks = doc["a"].get_array();
-            for (auto ask : asks)
-            {
-                std::array<std::string, 2> ask_entry;
-                auto ask_array = ask.get_array();
-                size_t index = 0;
-                for (auto value : ask_array)
-                {
-                    if (index < 2)
-                    {
-                        ask_entry[index] = std::string(value.get_string().value());
-                        index++;
-                    }
-                }
-                event_update.asks.push_back(ask_entry);
-            }
+    std::cout << "risk check: " << static_cast<double>(elapsed_ns - clock_ns) / iterations << "ns per check (" << static_cast<double>(clock_ns) / iterations
+              << "ns of clock reads taken out), " << rejected << " of " << iterations << " rejected" << std::endl;
+    return 0;
+}
 
-            // Push to buffer
-            if (!buffer->try_push(event_update))
-            {
-                std::cerr << "Failed to push to buffer" << std::endl;
-            }
-            else
-            {
-                std::cout << "Successfully pushed to buffer" << std::endl;
-            }
-        }
-        catch (const simdjson::simdjson_error &e)
+int main(int argc, char **argv)
+{
+    // --mock-orders N exercises order entry against a local mock venue instead of running the feeds
+    if (argc >= 3 && std::strcmp(argv[1], "--mock-orders") == 0)
+    {
+        return run_mock_orders(std::atoi(argv[2]));
+    }
+    // --bench-signing N compares request signing with precomputed HMAC pads against HMAC()
+    if (argc >= 3 && std::strcmp(argv[1], "--bench-signing") == 0)
+    {
+        return run_signing_benchmark(std::atoi(argv[2]));
+    }
+    // --bench-risk N times pre-trade risk checks
+    if (argc >= 3 && std::strcmp(argv[1], "--bench-risk") == 0)
+    {
+        return run_risk_benchmark(std::atoi(argv[2]));
+    }
+    // --backtest DEPTH TRADES replays recorded captures through the fill simulator and reports the PnL of quoting the touch
+    if (argc >= 4 && std::strcmp(argv[1], "--backtest") == 0)
+    {
+        return run_touch_backtest(argv[2], argv[3]);
+    }
+    // --ladder draws a depth ladder of the books on the terminal, and sends everything else written to stdout and stderr to cryptopp.log
+    int terminal = -1;
+    if (argc >= 2 && std::strcmp(argv[1], "--ladder") == 0)
+    {
+        int log_fd = open("cryptopp.log", O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (log_fd < 0)
         {
-            std::cerr << "JSON parsing error: " << e.what() << std::endl;
+            std::cerr << "Failed to open cryptopp.log" << std::endl;
+            return 1;
         }
-        break;
+        terminal = dup(STDOUT_FILENO);
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
     }
 
-    case LWS_CALLBACK_CLIENT_CLOSED:
-        std::cout << "Connection to server closed" << std::endl;
-        // Clean up our client data when connection closes
-        if (client_data)
-        {
-            delete client_data;
-        }
-        break;
+    // One feed per book - each has its own buffer, websocket client and apply thread, sharing the same book engine
+    // the spot book also tracks level age, for signals that need to know how long the touch has been resting
+    VenueFeed<BinanceSpot, true> spot_feed("XRPUSDT");
+    VenueFeed<BinanceFutures> perp_feed("XRPUSDT");
+    VenueFeed<BinanceSpot> btc_feed("BTCUSDT");
+    VenueFeed<BinanceSpot> xrpbtc_feed("XRPBTC");
+    OrderBook<BinanceSpot, true> &order_book = spot_feed.get_book();
+    OrderBook<BinanceFutures> &perp_book = perp_feed.get_book();
+    OrderBook<BinanceSpot> &btc_book = btc_feed.get_book();
+    OrderBook<BinanceSpot> &xrpbtc_book = xrpbtc_feed.get_book();
+
+    // Aggregate trade streams for the bars
+    StreamFeed<BinanceAggTrades> xrp_trades(BinanceAggTrades::endpoints<BinanceSpot>("XRPUSDT"));
+    StreamFeed<BinanceAggTrades> btc_trades(BinanceAggTrades::endpoints<BinanceSpot>("BTCUSDT"));
+    // and the venue's own klines to check the bars against
+    StreamFeed<BinanceKlines> xrp_klines(BinanceKlines::endpoints<BinanceSpot>("XRPUSDT", {"1s", "1m", "5m"}));
+    StreamFeed<BinanceKlines> btc_klines(BinanceKlines::endpoints<BinanceSpot>("BTCUSDT", {"1s", "1m", "5m"}));
+
+    // Mirror the books into shared memory so other local processes can read them
+    SharedBookRegion shared_books("/cryptopp_books", 64);
+    order_book.attach_shared_region(shared_books, "XRPUSDT");
+    perp_book.attach_shared_region(shared_books, "XRPUSDT-PERP");
+    btc_book.attach_shared_region(shared_books, "BTCUSDT");
+    xrpbtc_book.attach_shared_region(shared_books, "XRPBTC");
+
+    // Serve depth requests and BBO updates to local clients that can't map shared memory
+    DepthServer depth_server("/tmp/cryptopp_depth.sock");
+    depth_server.add_book("XRPUSDT", order_book.get_depth_view());
+    depth_server.add_book("XRPUSDT-PERP", perp_book.get_depth_view());
+    depth_server.add_book("BTCUSDT", btc_book.get_depth_view());
+    depth_server.add_book("XRPBTC", xrpbtc_book.get_depth_view());
+
+    // Fan book deltas out to other consumers over multicast
+    MulticastPublisher multicast("239.255.0.1", 30001);
+    multicast.add_book(order_book, "XRPUSDT");
+    multicast.add_book(perp_book, "XRPUSDT-PERP");
+    multicast.add_book(btc_book, "BTCUSDT");
+    multicast.add_book(xrpbtc_book, "XRPBTC");
+
+    // Merge spot and perp into one consolidated book, served like any other book
+    ConsolidatedBook consolidated_book;
+    consolidated_book.add_source(order_book, BinanceSpot::NAME);
+    consolidated_book.add_source(perp_book, BinanceFutures::NAME);
+    depth_server.add_book("XRPUSDT-ALL", consolidated_book.get_depth_view());
+    multicast.add_book(consolidated_book, "XRPUSDT-ALL");
 
-    default:
-        break;
+    // Price XRPBTC from the two USDT legs
+    SyntheticBookEngine synthetic_books;
+    synthetic_books.add_leg(order_book, "XRPUSDT");
+    synthetic_books.add_leg(btc_book, "BTCUSDT");
+    uint32_t xrpbtc = synthetic_books.add_synthetic("XRPBTC", "XRPUSDT", "BTCUSDT", SyntheticLegs::DIVIDE);
+    depth_server.add_book("XRPBTC-SYN", synthetic_books.get_depth_view(xrpbtc));
+
+    // Scan the USDT/BTC/XRP triangle for fee-adjusted arbitrage
+    TriangularArbitrageScanner arbitrage_scanner(0.001, 0.0005);
+    arbitrage_scanner.add_pair(order_book, "XRPUSDT", "XRP", "USDT");
+    arbitrage_scanner.add_pair(btc_book, "BTCUSDT", "BTC", "USDT");
+    arbitrage_scanner.add_pair(xrpbtc_book, "XRPBTC", "XRP", "BTC");
+    arbitrage_scanner.add_listener(log_opportunity, &arbitrage_scanner);
+
+    // 1s, 1m and 5m bars from trades and the BBO, written out as they close
+    BarAggregator bars({1000, 60000, 300000}, std::chrono::milliseconds(250));
+    uint32_t xrp_bars = bars.add_symbol("XRPUSDT", xrp_trades.get_buffer(), order_book);
+    uint32_t btc_bars = bars.add_symbol("BTCUSDT", btc_trades.get_buffer(), btc_book);
+    BarRing bar_log;
+    bars.add_output(bar_log);
+
+    // Flag bars that don't match the venue's klines, i.e. trades were missed
+    BarReconciler bar_reconciler(bars);
+    bar_reconciler.add_symbol(xrp_bars, xrp_klines.get_buffer());
+    bar_reconciler.add_symbol(btc_bars, btc_klines.get_buffer());
+    bar_reconciler.add_listener(log_divergence, &bars);
+
+    // Record the spot book and the trades for backtests - each capture is recorded from one thread (the book's apply thread, the aggregator thread)
+    // and written to its file from its own writer thread
+    CaptureWriter spot_capture("XRPUSDT-depth.cap");
+    order_book.attach_capture(spot_capture, "XRPUSDT@depth");
+    CaptureWriter trade_capture("trades.cap");
+    // declared in symbol ID order, so a trade's symbol ID is its stream ID
+    for (uint32_t symbol = 0; symbol <= btc_bars; symbol++)
+    {
+        trade_capture.add_stream(bars.get_symbol(symbol) + "@aggTrade");
     }
+    bars.add_trade_listener(record_trade, &trade_capture);
 
-    return 0; // Indicate success
-}
+    // The last 15 minutes of each spot BBO for range queries, with older history spilled to disk
+    BboSeries bbo_series(std::chrono::minutes(15), 1 << 17, "bbo.bin");
+    bbo_series.add_book(order_book, "XRPUSDT");
+    bbo_series.add_book(btc_book, "BTCUSDT");
+    bbo_series.add_book(xrpbtc_book, "XRPBTC");
 
-int main(int argc, char **argv)
-{
-    // Create a buffer for data ingestion
-    CircularBuffer<Binance_DiffDepth, 1024> buffer;
+    // 1s liquidity heatmaps of the spot books for monitoring, in 0.0001 and 1.0 price buckets
+    DepthHeatmap heatmap("heatmap.bin");
+    heatmap.add_book(order_book, "XRPUSDT", 0.0001);
+    heatmap.add_book(btc_book, "BTCUSDT", 1.0);
+
+    // Alert on outsized trades and sudden drops in top-of-book depth - added in the aggregator's order, so its symbol IDs line up
+    AlertDetector alerts("alerts.log");
+    uint32_t xrp_alerts = alerts.add_symbol("XRPUSDT");
+    uint32_t btc_alerts = alerts.add_symbol("BTCUSDT");
+    alerts.attach(order_book, xrp_alerts);
+    alerts.attach(btc_book, btc_alerts);
+    bars.add_trade_listener(AlertDetector::trade_callback, &alerts);
+
+    // Order flow imbalance and queue depletion of the spot book, computed on its apply thread
+    OrderFlowSignals order_flow(5, std::chrono::milliseconds(1000));
+    order_flow.attach(order_book);
 
-    // Create new order book
-    OrderBook order_book("https://api.binance.com/api/v3/depth?symbol=XRPUSDT&limit=1024", buffer);
+    // Top 10 levels of every book, redrawn four times a second from the published depth views
+    DepthLadder ladder(10, std::chrono::milliseconds(250), terminal);
+    ladder.add_book(order_book, "XRPUSDT", 4);
+    ladder.add_book(perp_book, "XRPUSDT-PERP", 4);
+    ladder.add_book(btc_book, "BTCUSDT", 2);
+    ladder.add_book(xrpbtc_book, "XRPBTC", 8);
+    // Run until interrupted - the handlers only set a flag, the shutdown below runs on this thread
+    std::signal(SIGINT, request_shutdown);
+    std::signal(SIGTERM, request_shutdown);
+    if (terminal >= 0)
+    {
+        ladder.start();
+        ladder_terminal.store(terminal, std::memory_order_relaxed);
+    }
 
-    // Connect to Binance WebSocket API
-    WebSocketClient client("stream.binance.com", 443, "/ws/xrpusdt@depth@100ms", binance_callback, &buffer);
+    // Launch websocket client threads
+    spot_feed.connect();
+    perp_feed.connect();
+    btc_feed.connect();
+    xrpbtc_feed.connect();
+    xrp_trades.connect();
+    btc_trades.connect();
+    xrp_klines.connect();
+    btc_klines.connect();
 
-    // Used to track if the init method for the order book is complete
-    std::atomic<bool> order_book_init_done(false);
+    // Initialise the books in parallel - each feed starts its apply thread once its book is synced
+    std::thread spot_init_thread(&VenueFeed<BinanceSpot, true>::sync, &spot_feed);
+    std::thread perp_init_thread(&VenueFeed<BinanceFutures>::sync, &perp_feed);
+    std::thread btc_init_thread(&VenueFeed<BinanceSpot>::sync, &btc_feed);
+    std::thread xrpbtc_init_thread(&VenueFeed<BinanceSpot>::sync, &xrpbtc_feed);
+    spot_init_thread.join();
+    perp_init_thread.join();
+    btc_init_thread.join();
+    xrpbtc_init_thread.join();
 
-    // Launch websocket client thread
-    std::thread client_thread(&WebSocketClient::init, &client);
+    // Periodically verify the live books against a REST snapshot, resyncing if they have drifted
+    SnapshotVerifier<OrderBook<BinanceSpot, true>> verifier(order_book, std::chrono::seconds(30));
+    SnapshotVerifier<OrderBook<BinanceFutures>> perp_verifier(perp_book, std::chrono::seconds(30));
+    SnapshotVerifier<OrderBook<BinanceSpot>> btc_verifier(btc_book, std::chrono::seconds(30));
+    verifier.start();
+    perp_verifier.start();
+    btc_verifier.start();
 
-    // Launch order book thread - for init
-    std::thread order_book_init_thread([&order_book, &order_book_init_done]()
-                                       {
-        order_book.init();
-        order_book_init_done.store(true, std::memory_order_release); });
+    consolidated_book.start();
+    synthetic_books.start();
+    arbitrage_scanner.start();
+    bar_reconciler.start();
+    alerts.start();
+    bbo_series.start();
+    heatmap.start();
+    spot_capture.start();
+    trade_capture.start();
+    bars.start();
+    std::atomic<bool> bar_writer_stop{false};
+    std::thread bar_writer(write_bars, &bar_log, &bars, &bar_writer_stop);
+    depth_server.start();
+    multicast.start();
 
-    // Wait for order book initialization to complete
-    while (!order_book_init_done.load(std::memory_order_acquire))
+    while (!shutdown_requested.load(std::memory_order_relaxed))
     {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    std::cout << "Shutting down" << std::endl;
+
+    // Give the terminal back first, so it is restored even if something below hangs
+    ladder_terminal.store(-1, std::memory_order_relaxed);
+    ladder.stop();
 
-    // Start the sync thread
-    std::thread order_book_sync_thread(&OrderBook::keep_orderbook_sync, &order_book);
+    // The verifiers first, as they can ask a book to resync, then the feeds - nothing new enters the pipeline after this
+    btc_verifier.stop();
+    perp_verifier.stop();
+    verifier.stop();
+    spot_feed.stop();
+    perp_feed.stop();
+    btc_feed.stop();
+    xrpbtc_feed.stop();
+    xrp_trades.stop();
+    btc_trades.stop();
+    xrp_klines.stop();
+    btc_klines.stop();
+    spot_feed.join();
+    perp_feed.join();
+    btc_feed.join();
+    xrpbtc_feed.join();
+    xrp_trades.join();
+    btc_trades.join();
+    xrp_klines.join();
+    btc_klines.join();
 
-    // Wait for all threads
-    client_thread.join();
-    order_book_init_thread.join();
-    order_book_sync_thread.join(); // Add this to keep the program running
+    // Then the consumers in reverse start order, so each one drains what the ones stopped before it produced
+    // (the aggregator goes before the bar writer, which writes the bars left in the ring)
+    multicast.stop();
+    depth_server.stop();
+    bars.stop();
+    bar_writer_stop.store(true, std::memory_order_release);
+    bar_writer.join();
+    trade_capture.stop();
+    spot_capture.stop();
+    heatmap.stop();
+    bbo_series.stop();
+    alerts.stop();
+    bar_reconciler.stop();
+    arbitrage_scanner.stop();
+    synthetic_books.stop();
+    consolidated_book.stop();
 
     return 0;
 }
@@ -0,0 +1,361 @@
+// implementation for MockOrderVenue class
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include "../include/mock_order_venue.h"
+
+namespace
+{
+    /**
+     * @brief A JSON value's text - strings unescaped, anything else as written
+     * @param quoted Set to whether the value was a string
+     */
+    std::string value_text(simdjson::ondemand::value value, bool &quoted)
+    {
+        simdjson::ondemand::json_type type = value.type();
+        quoted = type == simdjson::ondemand::json_type::string;
+        if (quoted)
+        {
+            return std::string(std::string_view(value.get_string()));
+        }
+        std::string_view token = value.raw_json_token();
+        while (!token.empty() && (token.back() == ' ' || token.back() == '\n' || token.back() == '\r' || token.back() == '\t'))
+        {
+            token.remove_suffix(1);
+        }
+        return std::string(token);
+    }
+
+    int64_t now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+/**
+ * @brief Construct a venue - nothing listens until start()
+ * @param port Port to listen on
+ * @param api_key The only API key accepted
+ * @param secret Its secret
+ * @param response_delay Time to wait before answering each request
+ */
+MockOrderVenue::MockOrderVenue(int port, const std::string &api_key, const std::string &secret, std::chrono::microseconds response_delay)
+    : port(port), api_key(api_key), secret(secret), response_delay(response_delay) {}
+
+MockOrderVenue::~MockOrderVenue()
+{
+    stop();
+}
+
+/**
+ * @brief Start listening
+ * @throws std::runtime_error If the port can't be listened on
+ */
+void MockOrderVenue::start()
+{
+    if (this->context)
+    {
+        return;
+    }
+
+    // plain HTTP falls to the first protocol, websocket clients ask for WebSocketClient's protocol name
+    this->protocols[0] = {"http", lws_callback_http_dummy, 0, 0};
+    this->protocols[1] = {"my-protocol", &MockOrderVenue::venue_callback, 0, 4096};
+    this->protocols[2] = {NULL, NULL, 0, 0};
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+    info.port = this->port;
+    info.protocols = this->protocols;
+    info.gid = -1;
+    info.uid = -1;
+    info.user = this;
+
+    this->context = lws_create_context(&info);
+    if (!this->context)
+    {
+        throw std::runtime_error("[MockOrderVenue] Failed to listen on port " + std::to_string(this->port));
+    }
+
+    std::cout << "[MockOrderVenue] Listening on port " << this->port << std::endl;
+    this->stop_requested.store(false, std::memory_order_release);
+    this->thread = std::thread([this]()
+                               {
+                                   while (lws_service(this->context, 0) >= 0 && !this->stop_requested.load(std::memory_order_acquire))
+                                   {
+                                   }
+                               });
+}
+
+/**
+ * @brief Stop listening and wait for the venue's thread
+ */
+void MockOrderVenue::stop()
+{
+    if (!this->context)
+    {
+        return;
+    }
+    this->stop_requested.store(true, std::memory_order_release);
+    lws_cancel_service(this->context);
+    if (this->thread.joinable())
+    {
+        this->thread.join();
+    }
+    lws_context_destroy(this->context);
+    this->context = nullptr;
+    this->sessions.clear();
+}
+
+uint64_t MockOrderVenue::get_requests() const
+{
+    return this->requests;
+}
+
+std::string MockOrderVenue::error(const std::string &id, int status, int code, const char *message) const
+{
+    return "{\"id\":" + id + ",\"status\":" + std::to_string(status) + ",\"error\":{\"code\":" + std::to_string(code) + ",\"msg\":\"" + message + "\"}}";
+}
+
+/**
+ * @brief Check a request's signature the way the venue does - HMAC-SHA256 of the parameters, computed independently of OrderGateway
+ */
+bool MockOrderVenue::verify(const std::string &payload, const std::string &signature) const
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_length = 0;
+    if (!HMAC(EVP_sha256(), this->secret.data(), static_cast<int>(this->secret.size()), reinterpret_cast<const unsigned char *>(payload.data()), payload.size(), digest, &digest_length))
+    {
+        return false;
+    }
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string expected(2 * digest_length, '0');
+    for (unsigned int i = 0; i < digest_length; i++)
+    {
+        expected[2 * i] = HEX[digest[i] >> 4];
+        expected[2 * i + 1] = HEX[digest[i] & 0x0F];
+    }
+    return expected == signature;
+}
+
+/**
+ * @brief Answer a request
+ * @param message The request (non-const, simdjson may pad it)
+ * @return The response
+ */
+std::string MockOrderVenue::handle(std::string &message)
+{
+    this->requests++;
+    std::string id = "null";
+    std::string method;
+    std::vector<std::pair<std::string, std::string>> params;
+    try
+    {
+        message.reserve(message.size() + simdjson::SIMDJSON_PADDING);
+        simdjson::ondemand::document doc = this->parser.iterate(simdjson::padded_string_view(message.data(), message.size(), message.capacity()));
+        for (auto field : doc.get_object())
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "id")
+            {
+                bool quoted;
+                id = value_text(field.value(), quoted);
+                if (quoted)
+                {
+                    id = "\"" + id + "\"";
+                }
+            }
+            else if (key == "method")
+            {
+                method = std::string(std::string_view(field.value().get_string()));
+            }
+            else if (key == "params")
+            {
+                for (auto param : field.value().get_object())
+                {
+                    std::string name(std::string_view(param.unescaped_key()));
+                    bool quoted;
+                    params.emplace_back(name, value_text(param.value(), quoted));
+                }
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &)
+    {
+        return error(id, 400, -1100, "Illegal characters found in a parameter.");
+    }
+
+    // signed payload - every other parameter, alphabetically, as a query string
+    std::string signature;
+    std::unordered_map<std::string, std::string> values;
+    std::sort(params.begin(), params.end());
+    std::string payload;
+    for (const auto &param : params)
+    {
+        if (param.first == "signature")
+        {
+            signature = param.second;
+            continue;
+        }
+        payload += (payload.empty() ? "" : "&") + param.first + "=" + param.second;
+        values[param.first] = param.second;
+    }
+
+    if (values["apiKey"] != this->api_key)
+    {
+        return error(id, 401, -2014, "API-key format invalid.");
+    }
+    if (!verify(payload, signature))
+    {
+        return error(id, 400, -1022, "Signature for this request is not valid.");
+    }
+
+    std::string symbol = "\"symbol\":\"" + values["symbol"] + "\"";
+    if (method == "order.place")
+    {
+        int64_t order_id = this->next_order_id++;
+        std::string client_order_id = values["newClientOrderId"];
+        this->orders[client_order_id] = order_id;
+        return "{\"id\":" + id + ",\"status\":200,\"result\":{" + symbol + ",\"orderId\":" + std::to_string(order_id) + ",\"clientOrderId\":\"" +
+               client_order_id + "\",\"transactTime\":" + std::to_string(now_ms()) + ",\"status\":\"NEW\"}}";
+    }
+    if (method == "order.cancel")
+    {
+        std::string client_order_id = values["origClientOrderId"];
+        auto it = this->orders.find(client_order_id);
+        if (it == this->orders.end())
+        {
+            return error(id, 400, -2011, "Unknown order sent.");
+        }
+        int64_t order_id = it->second;
+        this->orders.erase(it);
+        return "{\"id\":" + id + ",\"status\":200,\"result\":{" + symbol + ",\"origClientOrderId\":\"" + client_order_id + "\",\"orderId\":" +
+               std::to_string(order_id) + ",\"status\":\"CANCELED\"}}";
+    }
+    return error(id, 400, -1020, "This operation is not supported.");
+}
+
+/**
+ * @brief Ask for a writable callback if the session's next response is due, or set its timer for when it will be
+ */
+void MockOrderVenue::write_when_due(Session &session)
+{
+    if (session.responses.empty())
+    {
+        return;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(session.responses.front().due - std::chrono::steady_clock::now());
+    if (wait.count() <= 0)
+    {
+        lws_callback_on_writable(session.timer.wsi);
+        return;
+    }
+    lws_sul_schedule(this->context, 0, &session.timer.sul, &MockOrderVenue::response_due, wait.count());
+}
+
+/**
+ * @brief Timer callback - a session's next response is due
+ */
+void MockOrderVenue::response_due(lws_sorted_usec_list_t *sul)
+{
+    ResponseTimer *timer = lws_container_of(sul, ResponseTimer, sul);
+    lws_callback_on_writable(timer->wsi);
+}
+
+/**
+ * @brief libwebsockets callback for client connections
+ * @param wsi The websocket instance
+ * @param reason The reason for the callback
+ * @param user User data (unused - sessions are kept by the venue)
+ * @param in Incoming data
+ * @param len Length of incoming data
+ */
+int MockOrderVenue::venue_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+{
+    (void)user;
+    MockOrderVenue *venue = static_cast<MockOrderVenue *>(lws_context_user(lws_get_context(wsi)));
+    if (!venue)
+    {
+        return 0;
+    }
+
+    switch (reason)
+    {
+    case LWS_CALLBACK_ESTABLISHED:
+    {
+        Session &session = venue->sessions[wsi];
+        memset(&session.timer, 0, sizeof(session.timer));
+        session.timer.wsi = wsi;
+        break;
+    }
+
+    case LWS_CALLBACK_RECEIVE:
+    {
+        Session &session = venue->sessions[wsi];
+        if (lws_is_first_fragment(wsi))
+        {
+            session.message.clear();
+        }
+        session.message.append(static_cast<const char *>(in), len);
+        if (!lws_is_final_fragment(wsi))
+        {
+            break;
+        }
+        session.responses.push_back(Response{venue->handle(session.message), std::chrono::steady_clock::now() + venue->response_delay});
+        // only the first response waiting needs the timer - the ones behind it are due after it
+        if (session.responses.size() == 1)
+        {
+            venue->write_when_due(session);
+        }
+        break;
+    }
+
+    case LWS_CALLBACK_SERVER_WRITEABLE:
+    {
+        auto it = venue->sessions.find(wsi);
+        if (it == venue->sessions.end() || it->second.responses.empty())
+        {
+            break;
+        }
+        if (it->second.responses.front().due > std::chrono::steady_clock::now())
+        {
+            venue->write_when_due(it->second);
+            break;
+        }
+        std::string &response = it->second.responses.front().text;
+        std::vector<unsigned char> buffer(LWS_PRE + response.size());
+        memcpy(buffer.data() + LWS_PRE, response.data(), response.size());
+        if (lws_write(wsi, buffer.data() + LWS_PRE, response.size(), LWS_WRITE_TEXT) < static_cast<int>(response.size()))
+        {
+            std::cerr << "[MockOrderVenue] Error writing response" << std::endl;
+            return -1;
+        }
+        it->second.responses.pop_front();
+        venue->write_when_due(it->second);
+        break;
+    }
+
+    case LWS_CALLBACK_CLOSED:
+    {
+        auto it = venue->sessions.find(wsi);
+        if (it != venue->sessions.end())
+        {
+            lws_sul_cancel(&it->second.timer.sul);
+            venue->sessions.erase(it);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return 0;
+}
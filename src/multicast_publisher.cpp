@@ -0,0 +1,328 @@
+// implementation for MulticastPublisher class
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../include/multicast_publisher.h"
+
+namespace
+{
+    /**
+     * @brief Current wall clock time in nanoseconds since epoch
+     */
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Check if price a is better than price b on a side - higher for bids, lower for asks
+     */
+    template <bool IsBid>
+    bool is_better(double a, double b)
+    {
+        return IsBid ? a > b : a < b;
+    }
+}
+
+/**
+ * @brief Construct a new MulticastPublisher
+ * @param group Multicast group address, e.g. "239.255.0.1"
+ * @param port Destination UDP port
+ * @param snapshot_interval How often a snapshot of every book is sent
+ * @param ttl Multicast TTL - 0 keeps packets on this host, 1 on the local network
+ * @param interface_address Local interface address to send from, empty for the system default
+ */
+MulticastPublisher::MulticastPublisher(const std::string &group, uint16_t port, std::chrono::milliseconds snapshot_interval, int ttl, const std::string &interface_address)
+    : group(group), port(port), ttl(ttl), interface_address(interface_address), snapshot_interval(snapshot_interval) {}
+
+MulticastPublisher::~MulticastPublisher()
+{
+    stop();
+}
+
+/**
+ * @brief Register a book's depth view
+ */
+uint16_t MulticastPublisher::add_channel(const std::string &symbol, const SeqLock<DepthView> &view)
+{
+    if (symbol.size() >= sizeof(MulticastSnapshot::symbol))
+    {
+        throw std::invalid_argument("[MulticastPublisher] Symbol too long: " + symbol);
+    }
+
+    auto channel = std::make_unique<Channel>();
+    channel->symbol = symbol;
+    channel->symbol_id = static_cast<uint16_t>(this->channels.size());
+    channel->view = &view;
+    this->channels.push_back(std::move(channel));
+    return this->channels.back()->symbol_id;
+}
+
+/**
+ * @brief Open the socket and start the publisher thread
+ */
+void MulticastPublisher::start()
+{
+    if (this->running.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::memset(&this->destination, 0, sizeof(this->destination));
+    this->destination.sin_family = AF_INET;
+    this->destination.sin_port = htons(this->port);
+    if (inet_pton(AF_INET, this->group.c_str(), &this->destination.sin_addr) != 1)
+    {
+        throw std::runtime_error("[MulticastPublisher] Invalid group address: " + this->group);
+    }
+
+    this->socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (this->socket_fd < 0)
+    {
+        throw std::runtime_error(std::string("[MulticastPublisher] socket failed: ") + std::strerror(errno));
+    }
+
+    // TTL limits how far packets travel, loopback lets consumers on this host receive them
+    unsigned char multicast_ttl = static_cast<unsigned char>(this->ttl);
+    unsigned char loopback = 1;
+    setsockopt(this->socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &multicast_ttl, sizeof(multicast_ttl));
+    setsockopt(this->socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopback, sizeof(loopback));
+
+    if (!this->interface_address.empty())
+    {
+        in_addr interface{};
+        if (inet_pton(AF_INET, this->interface_address.c_str(), &interface) != 1 ||
+            setsockopt(this->socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0)
+        {
+            close(this->socket_fd);
+            this->socket_fd = -1;
+            throw std::runtime_error("[MulticastPublisher] Invalid multicast interface: " + this->interface_address);
+        }
+    }
+
+    std::cout << "[MulticastPublisher] Publishing " << this->channels.size() << " books to " << this->group << ":" << this->port << std::endl;
+    this->running.store(true, std::memory_order_release);
+    this->worker = std::thread(&MulticastPublisher::run, this);
+}
+
+/**
+ * @brief Stop the publisher thread and close the socket
+ */
+void MulticastPublisher::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+    if (this->socket_fd >= 0)
+    {
+        close(this->socket_fd);
+        this->socket_fd = -1;
+    }
+}
+
+uint64_t MulticastPublisher::get_packets_sent() const
+{
+    return this->packets_sent.load(std::memory_order_relaxed);
+}
+
+uint64_t MulticastPublisher::get_deltas_sent() const
+{
+    return this->deltas_sent.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Send the first len bytes of the packet buffer
+ */
+void MulticastPublisher::send_packet(size_t len)
+{
+    ssize_t sent = sendto(this->socket_fd, this->packet, len, 0, reinterpret_cast<sockaddr *>(&this->destination), sizeof(this->destination));
+    if (sent < 0)
+    {
+        std::cerr << "[MulticastPublisher] sendto failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+    this->packets_sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Add a delta to the packet being built, sending the packet first if it is full
+ */
+void MulticastPublisher::add_delta(Channel &channel, const DepthView &view, const PriceLevel &level, bool is_bid)
+{
+    if (this->packet_deltas == MULTICAST_DELTAS_PER_PACKET)
+    {
+        flush_deltas(channel);
+    }
+
+    MulticastDelta &delta = reinterpret_cast<MulticastDelta *>(this->packet + sizeof(MulticastPacketHeader))[this->packet_deltas++];
+    delta.update_id = view.update_id;
+    delta.event_time = view.event_time;
+    delta.price = level.price;
+    delta.quantity = level.quantity;
+    delta.is_bid = is_bid ? 1 : 0;
+    std::memset(delta.reserved, 0, sizeof(delta.reserved));
+}
+
+/**
+ * @brief Send the deltas in the packet being built as a DELTAS packet, if there are any
+ */
+void MulticastPublisher::flush_deltas(Channel &channel)
+{
+    if (this->packet_deltas == 0)
+    {
+        return;
+    }
+
+    MulticastPacketHeader *header = reinterpret_cast<MulticastPacketHeader *>(this->packet);
+    header->magic = MULTICAST_MAGIC;
+    header->version = MULTICAST_PROTOCOL_VERSION;
+    header->symbol_id = channel.symbol_id;
+    header->type = static_cast<uint8_t>(MulticastPacketType::DELTAS);
+    header->reserved = 0;
+    header->count = static_cast<uint16_t>(this->packet_deltas);
+    header->first_sequence = channel.next_sequence;
+    header->send_time_ns = now_ns();
+    // the sequence numbers are used up whether or not the send succeeds, so receivers see a lost packet as a gap
+    channel.next_sequence += this->packet_deltas;
+
+    send_packet(sizeof(MulticastPacketHeader) + this->packet_deltas * sizeof(MulticastDelta));
+    this->deltas_sent.fetch_add(this->packet_deltas, std::memory_order_relaxed);
+    this->packet_deltas = 0;
+}
+
+/**
+ * @brief Add the deltas between two top-N views of one side of a book.
+ * Both arrays are sorted best first, so a single merge walk finds levels that were removed, added or changed.
+ */
+template <bool IsBid>
+void MulticastPublisher::diff_side(Channel &channel, const DepthView &view, const PriceLevel *previous, uint32_t previous_count,
+                                   const PriceLevel *current, uint32_t current_count)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < previous_count || j < current_count)
+    {
+        if (j == current_count || (i < previous_count && is_better<IsBid>(previous[i].price, current[j].price)))
+        {
+            // no longer in the top levels - removed, or pushed out by better levels
+            add_delta(channel, view, PriceLevel{previous[i].price, 0.0}, IsBid);
+            i++;
+        }
+        else if (i == previous_count || is_better<IsBid>(current[j].price, previous[i].price))
+        {
+            // new to the top levels
+            add_delta(channel, view, current[j], IsBid);
+            j++;
+        }
+        else
+        {
+            if (previous[i].quantity != current[j].quantity)
+            {
+                add_delta(channel, view, current[j], IsBid);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * @brief Diff a book's latest view against the last one sent, and send the differences as DELTAS packets
+ * @return The number of deltas sent
+ */
+size_t MulticastPublisher::publish_changes(Channel &channel)
+{
+    // cheap check first - nothing published since the last look
+    uint64_t version = channel.view->version();
+    if (version == channel.last_version)
+    {
+        return 0;
+    }
+
+    DepthView view;
+    if (!channel.view->try_load(view))
+    {
+        // mid-write, pick it up on the next loop
+        return 0;
+    }
+    channel.last_version = version;
+
+    uint64_t first_sequence = channel.next_sequence;
+    diff_side<true>(channel, view, channel.sent.bids, channel.sent.bid_count, view.bids, view.bid_count);
+    diff_side<false>(channel, view, channel.sent.asks, channel.sent.ask_count, view.asks, view.ask_count);
+    flush_deltas(channel);
+    channel.sent = view;
+    return static_cast<size_t>(channel.next_sequence - first_sequence);
+}
+
+/**
+ * @brief Send a SNAPSHOT packet with the levels receivers hold after the deltas sent so far
+ */
+void MulticastPublisher::send_snapshot(Channel &channel)
+{
+    // the last view sent rather than the latest, so the snapshot is exactly the levels after delta first_sequence
+    const DepthView &view = channel.sent;
+
+    MulticastPacketHeader *header = reinterpret_cast<MulticastPacketHeader *>(this->packet);
+    MulticastSnapshot *snapshot = reinterpret_cast<MulticastSnapshot *>(this->packet + sizeof(MulticastPacketHeader));
+
+    header->magic = MULTICAST_MAGIC;
+    header->version = MULTICAST_PROTOCOL_VERSION;
+    header->symbol_id = channel.symbol_id;
+    header->type = static_cast<uint8_t>(MulticastPacketType::SNAPSHOT);
+    header->reserved = 0;
+    header->count = 1;
+    header->first_sequence = channel.next_sequence - 1;
+    header->send_time_ns = now_ns();
+
+    std::memset(snapshot, 0, sizeof(MulticastSnapshot));
+    std::memcpy(snapshot->symbol, channel.symbol.c_str(), channel.symbol.size() + 1);
+    snapshot->update_id = view.update_id;
+    snapshot->event_time = view.event_time;
+    snapshot->bid_count = static_cast<uint16_t>(view.bid_count);
+    snapshot->ask_count = static_cast<uint16_t>(view.ask_count);
+    std::memcpy(snapshot->bids, view.bids, sizeof(PriceLevel) * view.bid_count);
+    std::memcpy(snapshot->asks, view.asks, sizeof(PriceLevel) * view.ask_count);
+
+    send_packet(sizeof(MulticastPacketHeader) + sizeof(MulticastSnapshot));
+}
+
+/**
+ * @brief Publisher thread body - send the changes to each book's view, and snapshots on the interval
+ */
+void MulticastPublisher::run()
+{
+    auto next_snapshot = std::chrono::steady_clock::now();
+
+    while (this->running.load(std::memory_order_acquire))
+    {
+        size_t sent = 0;
+        for (auto &channel : this->channels)
+        {
+            sent += publish_changes(*channel);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_snapshot)
+        {
+            for (auto &channel : this->channels)
+            {
+                send_snapshot(*channel);
+            }
+            next_snapshot = now + this->snapshot_interval;
+        }
+
+        // nothing to send - back off briefly rather than spinning a core
+        if (sent == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+}
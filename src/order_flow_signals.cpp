@@ -0,0 +1,171 @@
+// implementation for OrderFlowSignals class
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "../include/order_flow_signals.h"
+
+/**
+ * @brief Construct a new OrderFlowSignals
+ * @param levels Number of levels to compute signals for, at most ORDER_FLOW_LEVELS
+ * @param time_constant Decay time constant of the rates
+ */
+OrderFlowSignals::OrderFlowSignals(size_t levels, std::chrono::milliseconds time_constant)
+    : levels(levels), time_constant_ms(static_cast<double>(time_constant.count()))
+{
+    if (levels == 0 || levels > ORDER_FLOW_LEVELS)
+    {
+        throw std::invalid_argument("[OrderFlowSignals] Levels must be between 1 and " + std::to_string(ORDER_FLOW_LEVELS));
+    }
+    if (time_constant.count() <= 0)
+    {
+        throw std::invalid_argument("[OrderFlowSignals] Time constant must be positive");
+    }
+    this->sums.levels = static_cast<uint32_t>(levels);
+}
+
+void OrderFlowSignals::level_change_callback(const LevelChange &change, void *user)
+{
+    static_cast<OrderFlowSignals *>(user)->on_level_change(change);
+}
+
+void OrderFlowSignals::book_update_callback(const DepthView &view, bool reloaded, void *user)
+{
+    static_cast<OrderFlowSignals *>(user)->on_book_update(view, reloaded);
+}
+
+const SeqLock<OrderFlowSnapshot> &OrderFlowSignals::get_snapshot() const
+{
+    return this->snapshot;
+}
+
+/**
+ * @brief Get the depth of a price in the book before the current event - the number of better levels
+ * @return The depth, or levels if it's deeper than the tracked levels
+ */
+size_t OrderFlowSignals::depth_of(double price, bool is_bid) const
+{
+    const PriceLevel *side = is_bid ? this->previous.bids : this->previous.asks;
+    size_t count = std::min<size_t>(is_bid ? this->previous.bid_count : this->previous.ask_count, this->levels);
+    size_t depth = 0;
+    while (depth < count && (is_bid ? side[depth].price > price : side[depth].price < price))
+    {
+        depth++;
+    }
+    return depth;
+}
+
+void OrderFlowSignals::clear_event()
+{
+    std::fill(this->bid_removed, this->bid_removed + ORDER_FLOW_LEVELS, 0.0);
+    std::fill(this->ask_removed, this->ask_removed + ORDER_FLOW_LEVELS, 0.0);
+    std::fill(this->bid_added, this->bid_added + ORDER_FLOW_LEVELS, 0.0);
+    std::fill(this->ask_added, this->ask_added + ORDER_FLOW_LEVELS, 0.0);
+}
+
+/**
+ * @brief Classify one applied level change as a removal or an addition at its depth
+ */
+void OrderFlowSignals::on_level_change(const LevelChange &change)
+{
+    if (!this->has_previous)
+    {
+        return;
+    }
+
+    // depth is taken against the book before the event, so a decrease at depth 0 is always the best queue shrinking
+    size_t depth = depth_of(change.price, change.is_bid);
+    if (depth >= this->levels)
+    {
+        return;
+    }
+
+    double delta = change.quantity - change.previous_quantity;
+    if (delta < 0)
+    {
+        (change.is_bid ? this->bid_removed : this->ask_removed)[depth] -= delta;
+    }
+    else
+    {
+        (change.is_bid ? this->bid_added : this->ask_added)[depth] += delta;
+    }
+}
+
+/**
+ * @brief Close out an event - compute its order flow imbalance from the previous and new top levels, decay and publish
+ */
+void OrderFlowSignals::on_book_update(const DepthView &view, bool reloaded)
+{
+    if (reloaded || !this->has_previous)
+    {
+        // a snapshot replaced the book - nothing before it is comparable
+        this->previous = view;
+        this->has_previous = true;
+        this->last_event_time = view.event_time;
+        clear_event();
+        return;
+    }
+
+    // decay the sums to this event's time
+    double elapsed = static_cast<double>(std::max<int64_t>(view.event_time - this->last_event_time, 0));
+    double decay = std::exp(-elapsed / this->time_constant_ms);
+    this->last_event_time = std::max(this->last_event_time, view.event_time);
+
+    OrderFlowSnapshot &sums = this->sums;
+    sums.update_id = view.update_id;
+    sums.event_time = view.event_time;
+    for (size_t level = 0; level < this->levels; level++)
+    {
+        // order flow imbalance needs the level on both sides, before and after
+        double e = 0;
+        if (level < view.bid_count && level < view.ask_count && level < this->previous.bid_count && level < this->previous.ask_count)
+        {
+            const PriceLevel &bid = view.bids[level];
+            const PriceLevel &ask = view.asks[level];
+            const PriceLevel &previous_bid = this->previous.bids[level];
+            const PriceLevel &previous_ask = this->previous.asks[level];
+            if (bid.price >= previous_bid.price)
+            {
+                e += bid.quantity;
+            }
+            if (bid.price <= previous_bid.price)
+            {
+                e -= previous_bid.quantity;
+            }
+            if (ask.price <= previous_ask.price)
+            {
+                e -= ask.quantity;
+            }
+            if (ask.price >= previous_ask.price)
+            {
+                e += previous_ask.quantity;
+            }
+        }
+        sums.ofi[level] = e;
+        sums.ofi_rate[level] = sums.ofi_rate[level] * decay + e;
+        sums.bid_cancel_rate[level] = sums.bid_cancel_rate[level] * decay + this->bid_removed[level];
+        sums.ask_cancel_rate[level] = sums.ask_cancel_rate[level] * decay + this->ask_removed[level];
+        sums.bid_replenish_rate[level] = sums.bid_replenish_rate[level] * decay + this->bid_added[level];
+        sums.ask_replenish_rate[level] = sums.ask_replenish_rate[level] * decay + this->ask_added[level];
+    }
+    sums.bid_depletion_rate = sums.bid_depletion_rate * decay + this->bid_removed[0];
+    sums.ask_depletion_rate = sums.ask_depletion_rate * decay + this->ask_removed[0];
+
+    // the sums are kept undivided so decaying them stays exact - publish them as rates per second
+    OrderFlowSnapshot published = sums;
+    double per_second = 1000.0 / this->time_constant_ms;
+    for (size_t level = 0; level < this->levels; level++)
+    {
+        published.ofi_rate[level] *= per_second;
+        published.bid_cancel_rate[level] *= per_second;
+        published.ask_cancel_rate[level] *= per_second;
+        published.bid_replenish_rate[level] *= per_second;
+        published.ask_replenish_rate[level] *= per_second;
+    }
+    published.bid_depletion_rate *= per_second;
+    published.ask_depletion_rate *= per_second;
+    this->snapshot.store(published);
+
+    this->previous = view;
+    clear_event();
+}
@@ -0,0 +1,508 @@
+// implementation for OrderGateway class
+
+#include <cstring>
+#include <iostream>
+#include "../include/order_gateway.h"
+#include "../include/venue_adapter.h"
+
+namespace
+{
+    /**
+     * @brief Monotonic time in nanoseconds, for latencies
+     */
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Wall clock time in milliseconds since epoch, for the request timestamp
+     */
+    int64_t now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+/**
+ * @brief Construct a gateway - nothing is connected until connect()
+ * @param endpoints Where to connect
+ * @param api_key The API key sent with every request
+ * @param secret The API key's secret, used to sign requests
+ * @param request_timeout How long a request can go without a response before its slot can be reused
+ */
+OrderGateway::OrderGateway(const OrderGatewayEndpoints &endpoints, const std::string &api_key, const std::string &secret, std::chrono::milliseconds request_timeout)
+    : endpoints(endpoints),
+      api_key(api_key),
+      signer(secret),
+      request_timeout(request_timeout),
+      slots(ORDER_GATEWAY_SLOTS),
+      client(this->endpoints.host.c_str(), this->endpoints.port, this->endpoints.path.c_str(), &OrderGateway::gateway_callback, this, this->endpoints.ssl)
+{
+    this->client.enable_event_driven();
+}
+
+OrderGateway::~OrderGateway()
+{
+    stop();
+}
+
+void OrderGateway::add_listener(OrderResponseListener listener, void *user)
+{
+    this->listeners.emplace_back(listener, user);
+}
+
+void OrderGateway::connect()
+{
+    this->client_thread = std::thread([this]()
+                                      { this->client.init(); });
+}
+
+void OrderGateway::stop()
+{
+    this->client.stop();
+    if (this->client_thread.joinable())
+    {
+        this->client_thread.join();
+    }
+    this->connected.store(false, std::memory_order_release);
+}
+
+bool OrderGateway::is_connected() const
+{
+    return this->connected.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Claim the slot for the next request ID - a request still waiting for its response holds its slot until it times out
+ * @return The slot, or nullptr if it's still in flight
+ */
+OrderGateway::Slot *OrderGateway::claim(int64_t &request_id)
+{
+    // the slot is fixed by the request ID, so skip IDs until one lands on a free slot - a slow request only holds up its own slot
+    for (size_t attempt = 0; attempt < ORDER_GATEWAY_SLOTS; attempt++)
+    {
+        int64_t candidate = this->next_request_id + static_cast<int64_t>(attempt);
+        Slot &slot = this->slots[static_cast<size_t>(candidate) & (ORDER_GATEWAY_SLOTS - 1)];
+
+        RequestState state = slot.state.load(std::memory_order_acquire);
+        if (state == RequestState::SENT && now_ns() - slot.submit_ns > this->request_timeout.count())
+        {
+            // fails if the response is being recorded right now, in which case the slot is free next time
+            if (slot.state.compare_exchange_strong(state, RequestState::TIMED_OUT, std::memory_order_acq_rel))
+            {
+                this->timeouts.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "[OrderGateway] Request " << slot.request_id.load(std::memory_order_relaxed) << " timed out" << std::endl;
+                state = RequestState::TIMED_OUT;
+            }
+        }
+        if (state == RequestState::QUEUED || state == RequestState::SENT || state == RequestState::COMPLETING)
+        {
+            continue;
+        }
+
+        request_id = candidate;
+        this->next_request_id = candidate + 1;
+        slot.request_id.store(request_id, std::memory_order_relaxed);
+        slot.status = 0;
+        slot.error_code = 0;
+        slot.order_id = -1;
+        slot.submit_to_ack_ns = 0;
+        slot.write_to_ack_ns = 0;
+        return &slot;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Hand a built request to the connection thread
+ */
+void OrderGateway::publish(Slot &slot, int64_t request_id)
+{
+    slot.state.store(RequestState::QUEUED, std::memory_order_release);
+    // the queue is twice the number of slots, so a claimed slot always fits
+    this->queue.try_push(static_cast<uint32_t>(static_cast<size_t>(request_id) & (ORDER_GATEWAY_SLOTS - 1)));
+    this->client.wake();
+}
+
+/**
+ * @brief Build a signed request into a claimed slot
+ * @param params The parameters, in alphabetical order
+ * @return false if the request didn't fit in the slot
+ */
+bool OrderGateway::build(const char *method, const Param *params, size_t count, int64_t request_id, Slot &slot) const
+{
+    // signed payload - the parameters as a query string
+    char query[ORDER_REQUEST_SIZE];
+    PayloadWriter payload(query, sizeof(query));
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            payload.character('&');
+        }
+        payload.text(params[i].key).character('=').text(params[i].value);
+    }
+    if (!payload.ok())
+    {
+        return false;
+    }
+    char signature[HMAC_SHA256_HEX_LENGTH];
+    this->signer.sign_hex(payload.data(), payload.size(), signature);
+
+    // built in place after the padding lws_write() needs
+    PayloadWriter message(reinterpret_cast<char *>(slot.buffer + LWS_PRE), ORDER_REQUEST_SIZE);
+    message.text("{\"id\":").integer(request_id).text(",\"method\":\"").text(method).text("\",\"params\":{");
+    for (size_t i = 0; i < count; i++)
+    {
+        message.character('"').text(params[i].key).text("\":");
+        if (params[i].quoted)
+        {
+            message.character('"').text(params[i].value).text("\",");
+        }
+        else
+        {
+            message.text(params[i].value).character(',');
+        }
+    }
+    message.text("\"signature\":\"").text(std::string_view(signature, sizeof(signature))).text("\"}}");
+    slot.length = message.size();
+    return message.ok();
+}
+
+/**
+ * @brief Send a new order
+ * @return The request ID, or -1 if the gateway isn't connected or every slot is in flight
+ */
+int64_t OrderGateway::place(const OrderRequest &order)
+{
+    int64_t submit_ns = now_ns();
+    if (!is_connected())
+    {
+        return -1;
+    }
+    int64_t request_id;
+    Slot *slot = claim(request_id);
+    if (!slot)
+    {
+        return -1;
+    }
+
+    // numbers are formatted into one scratch buffer, each parameter pointing at its part
+    char numbers[128];
+    PayloadWriter scratch(numbers, sizeof(numbers));
+    bool is_market = order.type == OrderType::MARKET;
+
+    // alphabetical - price and timeInForce only for limit orders
+    Param params[9];
+    size_t count = 0;
+    params[count++] = Param{"apiKey", this->api_key, true};
+    params[count++] = Param{"newClientOrderId", scratch.integer(order.client_order_id).last(), true};
+    if (!is_market)
+    {
+        params[count++] = Param{"price", scratch.decimal(order.price, order.price_decimals).last(), true};
+    }
+    params[count++] = Param{"quantity", scratch.decimal(order.quantity, order.quantity_decimals).last(), true};
+    params[count++] = Param{"side", order.side == OrderSide::BUY ? "BUY" : "SELL", true};
+    params[count++] = Param{"symbol", std::string_view(order.symbol, strnlen(order.symbol, sizeof(order.symbol))), true};
+    if (!is_market)
+    {
+        params[count++] = Param{"timeInForce", order.type == OrderType::IOC ? "IOC" : "GTC", true};
+    }
+    params[count++] = Param{"timestamp", scratch.integer(now_ms()).last(), false};
+    params[count++] = Param{"type", is_market ? "MARKET" : "LIMIT", true};
+
+    if (!scratch.ok() || !build("order.place", params, count, request_id, *slot))
+    {
+        std::cerr << "[OrderGateway] Couldn't build order " << order.client_order_id << std::endl;
+        slot->state.store(RequestState::REJECTED, std::memory_order_release);
+        return -1;
+    }
+
+    slot->submit_ns = submit_ns;
+    publish(*slot, request_id);
+    return request_id;
+}
+
+/**
+ * @brief Cancel an order by its client order ID
+ * @return The request ID, or -1 if the gateway isn't connected or every slot is in flight
+ */
+int64_t OrderGateway::cancel(const char *symbol, uint64_t client_order_id)
+{
+    int64_t submit_ns = now_ns();
+    if (!is_connected())
+    {
+        return -1;
+    }
+    int64_t request_id;
+    Slot *slot = claim(request_id);
+    if (!slot)
+    {
+        return -1;
+    }
+
+    char numbers[64];
+    PayloadWriter scratch(numbers, sizeof(numbers));
+    Param params[4] = {
+        Param{"apiKey", this->api_key, true},
+        Param{"origClientOrderId", scratch.integer(client_order_id).last(), true},
+        Param{"symbol", symbol, true},
+        Param{"timestamp", scratch.integer(now_ms()).last(), false},
+    };
+
+    if (!scratch.ok() || !build("order.cancel", params, 4, request_id, *slot))
+    {
+        std::cerr << "[OrderGateway] Couldn't build cancel for " << client_order_id << std::endl;
+        slot->state.store(RequestState::REJECTED, std::memory_order_release);
+        return -1;
+    }
+
+    slot->submit_ns = submit_ns;
+    publish(*slot, request_id);
+    return request_id;
+}
+
+/**
+ * @brief Get a request's response - must be called from the sending thread, the only thread that reuses slots
+ * @param request_id The request ID from place() or cancel()
+ * @param response Set to the response
+ * @return true if the response has arrived, false if it hasn't (or the slot has moved on to another request)
+ */
+bool OrderGateway::get_response(int64_t request_id, OrderResponse &response) const
+{
+    const Slot &slot = this->slots[static_cast<size_t>(request_id) & (ORDER_GATEWAY_SLOTS - 1)];
+    RequestState state = slot.state.load(std::memory_order_acquire);
+    if (slot.request_id.load(std::memory_order_relaxed) != request_id || (state != RequestState::ACKED && state != RequestState::REJECTED))
+    {
+        return false;
+    }
+    response = OrderResponse{request_id, state, slot.status, slot.error_code, slot.order_id, slot.submit_to_ack_ns, slot.write_to_ack_ns};
+    return true;
+}
+
+/**
+ * @brief Write the next queued request - one per writable callback, asking for another while more are queued
+ */
+void OrderGateway::write_next()
+{
+    uint32_t index;
+    if (!this->connection || !this->queue.try_pop(index))
+    {
+        return;
+    }
+
+    Slot &slot = this->slots[index];
+    slot.write_ns = now_ns();
+    if (lws_write(this->connection, slot.buffer + LWS_PRE, slot.length, LWS_WRITE_TEXT) < static_cast<int>(slot.length))
+    {
+        std::cerr << "[OrderGateway] Error writing request " << slot.request_id.load(std::memory_order_relaxed) << std::endl;
+        complete(slot, slot.request_id.load(std::memory_order_relaxed), RequestState::REJECTED, 0, 0, -1);
+    }
+    else
+    {
+        slot.state.store(RequestState::SENT, std::memory_order_release);
+    }
+
+    if (!this->queue.empty())
+    {
+        lws_callback_on_writable(this->connection);
+    }
+}
+
+/**
+ * @brief Record a request's result and tell the listeners
+ */
+void OrderGateway::complete(Slot &slot, int64_t request_id, RequestState state, int32_t status, int32_t error_code, int64_t order_id)
+{
+    int64_t ack_ns = now_ns();
+    slot.status = status;
+    slot.error_code = error_code;
+    slot.order_id = order_id;
+    slot.submit_to_ack_ns = ack_ns - slot.submit_ns;
+    slot.write_to_ack_ns = status == 0 ? 0 : ack_ns - slot.write_ns;
+    if (status != 0)
+    {
+        this->submit_to_ack.record(static_cast<uint64_t>(slot.submit_to_ack_ns));
+        this->write_to_ack.record(static_cast<uint64_t>(slot.write_to_ack_ns));
+    }
+    slot.state.store(state, std::memory_order_release);
+
+    OrderResponse response{request_id, state, status, error_code, order_id, slot.submit_to_ack_ns, slot.write_to_ack_ns};
+    for (const auto &listener : this->listeners)
+    {
+        listener.first(response, listener.second);
+    }
+}
+
+/**
+ * @brief Match a response to its request
+ */
+void OrderGateway::on_message(std::string &message)
+{
+    int64_t request_id = -1;
+    int64_t status = 0;
+    int64_t error_code = 0;
+    int64_t order_id = -1;
+    try
+    {
+        simdjson::ondemand::document doc = this->parser.iterate(simdjson::padded_string_view(message.data(), message.size(), message.capacity()));
+        for (auto field : doc.get_object())
+        {
+            std::string_view key = field.unescaped_key();
+            if (key == "id")
+            {
+                // requests we didn't send have no numeric ID
+                if (field.value().get_int64().get(request_id) != simdjson::SUCCESS)
+                {
+                    request_id = -1;
+                }
+            }
+            else if (key == "status")
+            {
+                status = field.value().get_int64();
+            }
+            else if (key == "result")
+            {
+                simdjson::ondemand::object result;
+                if (field.value().get_object().get(result) == simdjson::SUCCESS && result["orderId"].get_int64().get(order_id) != simdjson::SUCCESS)
+                {
+                    order_id = -1;
+                }
+            }
+            else if (key == "error")
+            {
+                error_code = field.value()["code"].get_int64();
+            }
+        }
+    }
+    catch (const simdjson::simdjson_error &e)
+    {
+        std::cerr << "[OrderGateway] JSON parsing error: " << e.what() << std::endl;
+        return;
+    }
+
+    if (request_id <= 0)
+    {
+        this->unmatched_responses.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // the slot must still hold this request, and not have timed out - only this thread sends, so it can't move on to SENT in between
+    Slot &slot = this->slots[static_cast<size_t>(request_id) & (ORDER_GATEWAY_SLOTS - 1)];
+    RequestState expected = RequestState::SENT;
+    if (slot.request_id.load(std::memory_order_acquire) != request_id ||
+        !slot.state.compare_exchange_strong(expected, RequestState::COMPLETING, std::memory_order_acq_rel))
+    {
+        this->unmatched_responses.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    bool accepted = status == 200 && error_code == 0;
+    complete(slot, request_id, accepted ? RequestState::ACKED : RequestState::REJECTED, static_cast<int32_t>(status), static_cast<int32_t>(error_code), accepted ? order_id : -1);
+}
+
+/**
+ * @brief Reject every request that was still waiting for the socket
+ */
+void OrderGateway::fail_queued()
+{
+    uint32_t index;
+    while (this->queue.try_pop(index))
+    {
+        Slot &slot = this->slots[index];
+        complete(slot, slot.request_id.load(std::memory_order_relaxed), RequestState::REJECTED, 0, 0, -1);
+    }
+}
+
+/**
+ * @brief libwebsockets callback for the order entry connection
+ * @param wsi The websocket instance
+ * @param reason The reason for the callback
+ * @param user User data (WebSocketClientData, whose stream_buffer is the gateway)
+ * @param in Incoming data
+ * @param len Length of incoming data
+ */
+int OrderGateway::gateway_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+{
+    // a wake() comes without a connection, so the gateway is found through the context's client instead
+    if (reason == LWS_CALLBACK_EVENT_WAIT_CANCELLED)
+    {
+        WebSocketClient *client = static_cast<WebSocketClient *>(lws_context_user(lws_get_context(wsi)));
+        OrderGateway *gateway = client ? static_cast<OrderGateway *>(client->get_stream_buffer()) : nullptr;
+        if (gateway && gateway->connection && !gateway->queue.empty())
+        {
+            lws_callback_on_writable(gateway->connection);
+        }
+        return 0;
+    }
+
+    WebSocketClientData *client_data = static_cast<WebSocketClientData *>(user);
+    if (!client_data)
+    {
+        return 0;
+    }
+    OrderGateway *gateway = static_cast<OrderGateway *>(client_data->stream_buffer);
+
+    switch (reason)
+    {
+    case LWS_CALLBACK_CLIENT_ESTABLISHED:
+        std::cout << "[OrderGateway] Connected to " << gateway->endpoints.host << ":" << gateway->endpoints.port << gateway->endpoints.path << std::endl;
+        gateway->connection = wsi;
+        gateway->connected.store(true, std::memory_order_release);
+        // anything queued before now was refused, but a wake() may have been missed
+        lws_callback_on_writable(wsi);
+        break;
+
+    case LWS_CALLBACK_CLIENT_WRITEABLE:
+        gateway->write_next();
+        break;
+
+    case LWS_CALLBACK_CLIENT_RECEIVE:
+        if (append_fragment(wsi, client_data, in, len))
+        {
+            gateway->on_message(client_data->message);
+        }
+        break;
+
+    case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+        std::cerr << "[OrderGateway] Connection error: " << (in ? static_cast<const char *>(in) : "unknown") << std::endl;
+        gateway->connected.store(false, std::memory_order_release);
+        gateway->fail_queued();
+        break;
+
+    case LWS_CALLBACK_CLIENT_CLOSED:
+        std::cout << "[OrderGateway] Connection to server closed" << std::endl;
+        // requests already sent may still have reached the venue, so they're left to time out rather than rejected
+        gateway->connected.store(false, std::memory_order_release);
+        gateway->connection = nullptr;
+        gateway->fail_queued();
+        delete client_data;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+const LatencyHistogram &OrderGateway::get_submit_to_ack() const
+{
+    return this->submit_to_ack;
+}
+
+const LatencyHistogram &OrderGateway::get_write_to_ack() const
+{
+    return this->write_to_ack;
+}
+
+uint64_t OrderGateway::get_timeouts() const
+{
+    return this->timeouts.load(std::memory_order_relaxed);
+}
+
+uint64_t OrderGateway::get_unmatched_responses() const
+{
+    return this->unmatched_responses.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,280 @@
+// implementation for PnlTracker class
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "../include/pnl_tracker.h"
+
+namespace
+{
+    // positions smaller than this are flat - what's left of rounding after closing a position in several fills
+    constexpr double FLAT_QUANTITY = 1e-9;
+}
+
+/**
+ * @brief Construct a new PnlTracker
+ * @param mark_price Price open positions are marked at
+ * @param poll_interval How long the tracker thread sleeps when nothing changed
+ */
+PnlTracker::PnlTracker(MarkPrice mark_price, std::chrono::microseconds poll_interval)
+    : mark_price(mark_price), poll_interval(poll_interval) {}
+
+PnlTracker::~PnlTracker()
+{
+    stop();
+}
+
+/**
+ * @brief Track a symbol marked from a published depth view - must be called before start()
+ */
+uint32_t PnlTracker::add_symbol(const std::string &symbol, const SeqLock<DepthView> &view)
+{
+    std::unique_ptr<Symbol> tracked = std::make_unique<Symbol>();
+    tracked->name = symbol;
+    tracked->view = &view;
+    // never a published version, so a position's first mark reads the book
+    tracked->last_version = 1;
+    tracked->open_index = -1;
+    tracked->pnl = SymbolPnl{};
+    tracked->exposure = 0;
+    this->symbols.push_back(std::move(tracked));
+    return static_cast<uint32_t>(this->symbols.size() - 1);
+}
+
+/**
+ * @brief Hand a fill to the tracker - must only be called from one thread
+ * @return false if the queue is full and the fill was dropped
+ */
+bool PnlTracker::on_fill(const PositionFill &fill)
+{
+    if (!this->fills.try_push(fill))
+    {
+        std::cerr << "[PnlTracker] Fill queue full, dropping fill for symbol " << fill.symbol << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Apply a fill to its symbol's position, average cost and realised PnL
+ */
+void PnlTracker::apply_fill(const PositionFill &fill)
+{
+    if (fill.symbol >= this->symbols.size())
+    {
+        std::cerr << "[PnlTracker] Fill for unknown symbol " << fill.symbol << std::endl;
+        return;
+    }
+    Symbol &symbol = *this->symbols[fill.symbol];
+    SymbolPnl &pnl = symbol.pnl;
+
+    double previous = pnl.position;
+    double signed_quantity = fill.side == OrderSide::BUY ? fill.quantity : -fill.quantity;
+    double realised = -fill.fee;
+    if (previous == 0 || (previous > 0) == (signed_quantity > 0))
+    {
+        // opening or adding - the average cost moves towards the fill price
+        pnl.average_cost = (pnl.average_cost * std::fabs(previous) + fill.price * fill.quantity) / (std::fabs(previous) + fill.quantity);
+        pnl.position = previous + signed_quantity;
+    }
+    else
+    {
+        // reducing - the closed part realises against the average cost, and a flip opens the rest at the fill price
+        double closed = std::min(fill.quantity, std::fabs(previous));
+        realised += closed * (fill.price - pnl.average_cost) * (previous > 0 ? 1.0 : -1.0);
+        pnl.position = previous + signed_quantity;
+        if (std::fabs(pnl.position) < FLAT_QUANTITY)
+        {
+            pnl.position = 0;
+            pnl.average_cost = 0;
+        }
+        else if ((pnl.position > 0) != (previous > 0))
+        {
+            pnl.average_cost = fill.price;
+        }
+    }
+    pnl.realised_pnl += realised;
+    pnl.fills++;
+    this->totals.realised_pnl += realised;
+    this->totals.fills++;
+
+    // keep the open list to the symbols with a position
+    if (pnl.position != 0 && symbol.open_index < 0)
+    {
+        symbol.open_index = static_cast<int32_t>(this->open.size());
+        this->open.push_back(fill.symbol);
+        mark(symbol);
+    }
+    else if (pnl.position == 0 && symbol.open_index >= 0)
+    {
+        uint32_t moved = this->open.back();
+        this->open[symbol.open_index] = moved;
+        this->symbols[moved]->open_index = symbol.open_index;
+        this->open.pop_back();
+        symbol.open_index = -1;
+    }
+
+    set_unrealised(symbol);
+    if (this->open.empty())
+    {
+        // nothing open, so clear what rounding has left in the running totals
+        this->totals.unrealised_pnl = 0;
+        this->totals.gross_exposure = 0;
+        this->totals.net_exposure = 0;
+    }
+    symbol.published.store(pnl);
+}
+
+/**
+ * @brief Re-read a symbol's mark if its book has changed - just the top levels, in place
+ * @return true if the mark was updated
+ */
+bool PnlTracker::mark(Symbol &symbol)
+{
+    uint64_t version = symbol.view->version();
+    if (version == symbol.last_version)
+    {
+        return false;
+    }
+
+    PriceLevel bid{0, 0};
+    PriceLevel ask{0, 0};
+    int64_t event_time = 0;
+    auto read_top = [&bid, &ask, &event_time](const DepthView &view)
+    {
+        bid = view.bid_count > 0 ? view.bids[0] : PriceLevel{0, 0};
+        ask = view.ask_count > 0 ? view.asks[0] : PriceLevel{0, 0};
+        event_time = view.event_time;
+    };
+    if (!symbol.view->try_read(read_top))
+    {
+        // a write is in progress - the next pass sees the version change again
+        return false;
+    }
+    symbol.last_version = version;
+    if (!(bid.price > 0) || !(ask.price > 0))
+    {
+        return false;
+    }
+
+    double quantity = bid.quantity + ask.quantity;
+    symbol.pnl.mark = this->mark_price == MarkPrice::MICROPRICE && quantity > 0 ? (bid.price * ask.quantity + ask.price * bid.quantity) / quantity
+                                                                                  : (bid.price + ask.price) / 2;
+    symbol.pnl.mark_time = event_time;
+    return true;
+}
+
+/**
+ * @brief Recompute a symbol's unrealised PnL and exposure, moving the totals by the difference
+ */
+void PnlTracker::set_unrealised(Symbol &symbol)
+{
+    SymbolPnl &pnl = symbol.pnl;
+    double unrealised = pnl.position != 0 && pnl.mark > 0 ? pnl.position * (pnl.mark - pnl.average_cost) : 0;
+    double exposure = pnl.position * pnl.mark;
+
+    this->totals.unrealised_pnl += unrealised - pnl.unrealised_pnl;
+    this->totals.net_exposure += exposure - symbol.exposure;
+    this->totals.gross_exposure += std::fabs(exposure) - std::fabs(symbol.exposure);
+    pnl.unrealised_pnl = unrealised;
+    symbol.exposure = exposure;
+}
+
+/**
+ * @brief Apply queued fills and re-mark open positions whose book changed
+ * @return The number of fills applied and positions re-marked
+ */
+size_t PnlTracker::poll()
+{
+    size_t changed = 0;
+    PositionFill fill;
+    while (this->fills.try_pop(fill))
+    {
+        apply_fill(fill);
+        changed++;
+    }
+
+    // flat symbols are never looked at
+    for (uint32_t id : this->open)
+    {
+        Symbol &symbol = *this->symbols[id];
+        if (!mark(symbol))
+        {
+            continue;
+        }
+        set_unrealised(symbol);
+        symbol.published.store(symbol.pnl);
+        this->totals.marks++;
+        changed++;
+    }
+
+    if (changed > 0)
+    {
+        this->totals.total_pnl = this->totals.realised_pnl + this->totals.unrealised_pnl;
+        this->totals.open_positions = static_cast<uint32_t>(this->open.size());
+        this->portfolio.store(this->totals);
+    }
+    return changed;
+}
+
+/**
+ * @brief Start the tracker thread
+ */
+void PnlTracker::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    this->worker = std::thread(&PnlTracker::run, this);
+}
+
+/**
+ * @brief Stop the tracker thread
+ */
+void PnlTracker::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Tracker thread body - apply fills and re-mark open positions, back off briefly when nothing changed
+ */
+void PnlTracker::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
+
+SymbolPnl PnlTracker::get_symbol_pnl(uint32_t symbol) const
+{
+    SymbolPnl pnl;
+    this->symbols[symbol]->published.load(pnl);
+    return pnl;
+}
+
+PortfolioSnapshot PnlTracker::get_portfolio() const
+{
+    PortfolioSnapshot snapshot;
+    this->portfolio.load(snapshot);
+    return snapshot;
+}
+
+const SeqLock<PortfolioSnapshot> &PnlTracker::get_portfolio_view() const
+{
+    return this->portfolio;
+}
+
+const std::string &PnlTracker::get_symbol(uint32_t symbol) const
+{
+    return this->symbols[symbol]->name;
+}
@@ -0,0 +1,182 @@
+// implementation for RiskEngine class
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "../include/risk_engine.h"
+
+/**
+ * @brief Add a symbol to check orders for
+ * @param symbol The symbol's name
+ * @param view The SeqLock its book publishes top levels through
+ * @param limits Its limits
+ * @return The symbol's ID, for check()
+ * @throws std::invalid_argument If a limit isn't positive
+ */
+uint32_t RiskEngine::add_symbol(const std::string &symbol, const SeqLock<DepthView> &view, const RiskLimits &limits)
+{
+    if (!(limits.max_notional > 0) || !(limits.price_collar > 0) || !(limits.max_position > 0) || !(limits.orders_per_second > 0) || limits.burst == 0)
+    {
+        throw std::invalid_argument("[RiskEngine] Limits for " + symbol + " must be positive");
+    }
+
+    SymbolRisk risk{};
+    risk.view = &view;
+    // never a published version, so the first check reads the book
+    risk.version = 1;
+    risk.max_notional = limits.max_notional;
+    risk.collar_low = 1 - limits.price_collar;
+    risk.collar_high = 1 + limits.price_collar;
+    risk.max_position = limits.max_position;
+    risk.rate_interval_ns = static_cast<int64_t>(1e9 / limits.orders_per_second);
+    risk.rate_tolerance_ns = risk.rate_interval_ns * static_cast<int64_t>(limits.burst - 1);
+    risk.rate_tat_ns = INT64_MIN / 2;
+
+    this->symbols.push_back(risk);
+    this->names.push_back(symbol);
+    return static_cast<uint32_t>(this->symbols.size() - 1);
+}
+
+/**
+ * @brief Read the best bid and ask from the book - just the two levels, in place
+ */
+void RiskEngine::refresh_bbo(SymbolRisk &risk) const
+{
+    // read first, so a change during the read only means the next check reads again
+    uint64_t version = risk.view->version();
+    double bid = 0;
+    double ask = 0;
+    auto read_bbo = [&bid, &ask](const DepthView &view)
+    {
+        bid = view.bid_count > 0 ? view.bids[0].price : 0;
+        ask = view.ask_count > 0 ? view.asks[0].price : 0;
+    };
+    while (!risk.view->try_read(read_bbo))
+    {
+    }
+    risk.version = version;
+    risk.bid = bid;
+    risk.ask = ask;
+}
+
+/**
+ * @brief Check an order, and count it against the rate limit and the open quantity if it passes
+ * @param symbol The symbol's ID
+ * @param price Limit price, ignored for market orders
+ * @param now_ns Monotonic time now, e.g. steady_clock - passed in so a caller that has already read the clock doesn't read it again
+ * @return RISK_PASSED, or the RiskRejection bits of every check that failed
+ */
+uint32_t RiskEngine::check(uint32_t symbol, OrderSide side, OrderType type, double price, double quantity, int64_t now_ns)
+{
+    SymbolRisk &risk = this->symbols[symbol];
+    risk.checks++;
+    if (risk.view->version() != risk.version)
+    {
+        refresh_bbo(risk);
+    }
+
+    bool is_buy = side == OrderSide::BUY;
+    bool is_market = type == OrderType::MARKET;
+    // market orders are valued at the touch they would take
+    double order_price = is_market ? (is_buy ? risk.ask : risk.bid) : price;
+
+    // bitwise rather than logical operators, so every check is evaluated without branching
+    bool invalid = !(quantity > 0) | !(order_price > 0);
+    bool no_market = !(risk.bid > 0) | !(risk.ask > 0);
+    bool notional = order_price * quantity > risk.max_notional;
+    bool collar = (!is_market) & ((price < risk.bid * risk.collar_low) | (price > risk.ask * risk.collar_high));
+    // as if this order and every open order on its side fill
+    double exposure = is_buy ? risk.position + risk.open_buy + quantity : risk.open_sell + quantity - risk.position;
+    bool position = exposure > risk.max_position;
+    bool rate = now_ns < risk.rate_tat_ns - risk.rate_tolerance_ns;
+
+    uint32_t result = (static_cast<uint32_t>(invalid) * RISK_INVALID) | (static_cast<uint32_t>(no_market) * RISK_NO_MARKET) |
+                      (static_cast<uint32_t>(notional) * RISK_NOTIONAL) | (static_cast<uint32_t>(collar) * RISK_PRICE_COLLAR) |
+                      (static_cast<uint32_t>(position) * RISK_POSITION) | (static_cast<uint32_t>(rate) * RISK_RATE);
+    if (result != RISK_PASSED)
+    {
+        risk.rejections++;
+        return result;
+    }
+
+    risk.rate_tat_ns = std::max(risk.rate_tat_ns, now_ns) + risk.rate_interval_ns;
+    (is_buy ? risk.open_buy : risk.open_sell) += quantity;
+    return RISK_PASSED;
+}
+
+void RiskEngine::on_fill(uint32_t symbol, OrderSide side, double quantity)
+{
+    SymbolRisk &risk = this->symbols[symbol];
+    if (side == OrderSide::BUY)
+    {
+        risk.open_buy = std::max(0.0, risk.open_buy - quantity);
+        risk.position += quantity;
+    }
+    else
+    {
+        risk.open_sell = std::max(0.0, risk.open_sell - quantity);
+        risk.position -= quantity;
+    }
+}
+
+void RiskEngine::on_done(uint32_t symbol, OrderSide side, double remaining)
+{
+    SymbolRisk &risk = this->symbols[symbol];
+    double &open = side == OrderSide::BUY ? risk.open_buy : risk.open_sell;
+    open = std::max(0.0, open - remaining);
+}
+
+double RiskEngine::get_position(uint32_t symbol) const
+{
+    return this->symbols[symbol].position;
+}
+
+double RiskEngine::get_open_quantity(uint32_t symbol, OrderSide side) const
+{
+    return side == OrderSide::BUY ? this->symbols[symbol].open_buy : this->symbols[symbol].open_sell;
+}
+
+uint64_t RiskEngine::get_checks(uint32_t symbol) const
+{
+    return this->symbols[symbol].checks;
+}
+
+uint64_t RiskEngine::get_rejections(uint32_t symbol) const
+{
+    return this->symbols[symbol].rejections;
+}
+
+const std::string &RiskEngine::get_symbol(uint32_t symbol) const
+{
+    return this->names[symbol];
+}
+
+/**
+ * @brief Describe a check result, e.g. "notional|price collar"
+ */
+std::string RiskEngine::describe(uint32_t result)
+{
+    if (result == RISK_PASSED)
+    {
+        return "passed";
+    }
+
+    static const std::pair<uint32_t, const char *> NAMES[] = {
+        {RISK_INVALID, "invalid"},
+        {RISK_NO_MARKET, "no market"},
+        {RISK_NOTIONAL, "notional"},
+        {RISK_PRICE_COLLAR, "price collar"},
+        {RISK_POSITION, "position"},
+        {RISK_RATE, "rate"},
+    };
+    std::string description;
+    for (const auto &name : NAMES)
+    {
+        if (result & name.first)
+        {
+            description += (description.empty() ? "" : "|") + std::string(name.second);
+        }
+    }
+    return description;
+}
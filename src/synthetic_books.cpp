@@ -0,0 +1,277 @@
+// implementation for SyntheticBookEngine class
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "../include/synthetic_books.h"
+
+namespace
+{
+    /**
+     * @brief Check if two views have the same top levels - update IDs and times are ignored, a change deeper in the book doesn't count
+     */
+    bool same_levels(const DepthView &lhs, const DepthView &rhs)
+    {
+        return lhs.bid_count == rhs.bid_count && lhs.ask_count == rhs.ask_count &&
+               std::memcmp(lhs.bids, rhs.bids, sizeof(PriceLevel) * lhs.bid_count) == 0 &&
+               std::memcmp(lhs.asks, rhs.asks, sizeof(PriceLevel) * lhs.ask_count) == 0;
+    }
+
+    /**
+     * @brief Walk one side of each leg at once, producing the implied levels of one side of the synthetic.
+     * Liquidity is matched in the middle asset B (the shared quote for DIVIDE, the chained asset for MULTIPLY):
+     * a first leg level of q at p is worth q * p of B, a second leg level is worth q * p of B (DIVIDE) or q of B (MULTIPLY).
+     * Each step takes the smaller of the two remaining amounts, so every implied level can actually be traded through both legs.
+     * @param first Levels of the first leg, best first
+     * @param second Levels of the second leg, best first
+     * @param out Implied levels, best first
+     * @return The number of implied levels written
+     */
+    uint32_t walk_legs(const PriceLevel *first, uint32_t first_count, const PriceLevel *second, uint32_t second_count, SyntheticLegs legs, PriceLevel *out)
+    {
+        uint32_t count = 0;
+        uint32_t i = 0;
+        uint32_t j = 0;
+        double first_remaining = i < first_count ? first[0].quantity * first[0].price : 0.0;
+        double second_remaining = j < second_count ? (legs == SyntheticLegs::DIVIDE ? second[0].quantity * second[0].price : second[0].quantity) : 0.0;
+
+        while (i < first_count && j < second_count && count < DEPTH_VIEW_LEVELS)
+        {
+            double amount = std::min(first_remaining, second_remaining);
+            double price = legs == SyntheticLegs::DIVIDE ? first[i].price / second[j].price : first[i].price * second[j].price;
+            double quantity = amount / first[i].price;
+
+            // consecutive steps can imply the same price - merge them into one level
+            if (count > 0 && out[count - 1].price == price)
+            {
+                out[count - 1].quantity += quantity;
+            }
+            else if (quantity > 0)
+            {
+                out[count++] = PriceLevel{price, quantity};
+            }
+
+            first_remaining -= amount;
+            second_remaining -= amount;
+            if (first_remaining <= 0 && ++i < first_count)
+            {
+                first_remaining = first[i].quantity * first[i].price;
+            }
+            if (second_remaining <= 0 && ++j < second_count)
+            {
+                second_remaining = legs == SyntheticLegs::DIVIDE ? second[j].quantity * second[j].price : second[j].quantity;
+            }
+        }
+        return count;
+    }
+}
+
+/**
+ * @brief Construct a new SyntheticBookEngine
+ * @param poll_interval How long the engine thread sleeps when no leg has moved
+ */
+SyntheticBookEngine::SyntheticBookEngine(std::chrono::microseconds poll_interval)
+    : poll_interval(poll_interval) {}
+
+SyntheticBookEngine::~SyntheticBookEngine()
+{
+    stop();
+}
+
+int SyntheticBookEngine::find_leg(const std::string &symbol) const
+{
+    for (size_t i = 0; i < this->legs.size(); i++)
+    {
+        if (this->legs[i].symbol == symbol)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Register a published depth view synthetics can use as a leg
+ */
+void SyntheticBookEngine::add_leg(const std::string &symbol, const SeqLock<DepthView> &view)
+{
+    if (find_leg(symbol) >= 0)
+    {
+        throw std::invalid_argument("[SyntheticBookEngine] Leg already registered: " + symbol);
+    }
+
+    Leg leg{};
+    leg.symbol = symbol;
+    leg.view = &view;
+    leg.last_version = 0;
+    this->legs.push_back(leg);
+    this->dependents.emplace_back();
+}
+
+/**
+ * @brief Define a synthetic pair and add it to the dependency index of both legs
+ */
+uint32_t SyntheticBookEngine::add_synthetic(const std::string &symbol, const std::string &first_leg, const std::string &second_leg, SyntheticLegs legs)
+{
+    int first = find_leg(first_leg);
+    int second = find_leg(second_leg);
+    if (first < 0 || second < 0)
+    {
+        throw std::invalid_argument("[SyntheticBookEngine] Unknown leg for " + symbol + ": " + (first < 0 ? first_leg : second_leg));
+    }
+
+    auto synthetic = std::make_unique<Synthetic>();
+    synthetic->symbol = symbol;
+    synthetic->first_leg = static_cast<uint32_t>(first);
+    synthetic->second_leg = static_cast<uint32_t>(second);
+    synthetic->legs = legs;
+
+    uint32_t id = static_cast<uint32_t>(this->synthetics.size());
+    this->synthetics.push_back(std::move(synthetic));
+    this->dependents[first].push_back(id);
+    if (second != first)
+    {
+        this->dependents[second].push_back(id);
+    }
+    return id;
+}
+
+const SeqLock<DepthView> &SyntheticBookEngine::get_depth_view(uint32_t synthetic) const
+{
+    return this->synthetics.at(synthetic)->view;
+}
+
+const std::vector<uint32_t> &SyntheticBookEngine::get_dependents(const std::string &leg) const
+{
+    int index = find_leg(leg);
+    if (index < 0)
+    {
+        throw std::invalid_argument("[SyntheticBookEngine] Unknown leg: " + leg);
+    }
+    return this->dependents[index];
+}
+
+uint64_t SyntheticBookEngine::get_recomputes() const
+{
+    return this->recomputes.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Rebuild a synthetic's implied top levels from its legs' current views and publish them
+ */
+void SyntheticBookEngine::recompute(Synthetic &synthetic)
+{
+    const DepthView &first = this->legs[synthetic.first_leg].current;
+    const DepthView &second = this->legs[synthetic.second_leg].current;
+
+    DepthView view;
+    view.update_id = ++synthetic.sequence;
+    view.event_time = std::max(first.event_time, second.event_time);
+
+    // synthetic bids sell the first leg's base: into the first leg's bids, then into the second leg's asks (DIVIDE) or bids (MULTIPLY)
+    // synthetic asks buy it: from the first leg's asks, then the second leg's bids (DIVIDE) or asks (MULTIPLY)
+    if (synthetic.legs == SyntheticLegs::DIVIDE)
+    {
+        view.bid_count = walk_legs(first.bids, first.bid_count, second.asks, second.ask_count, synthetic.legs, view.bids);
+        view.ask_count = walk_legs(first.asks, first.ask_count, second.bids, second.bid_count, synthetic.legs, view.asks);
+    }
+    else
+    {
+        view.bid_count = walk_legs(first.bids, first.bid_count, second.bids, second.bid_count, synthetic.legs, view.bids);
+        view.ask_count = walk_legs(first.asks, first.ask_count, second.asks, second.ask_count, synthetic.legs, view.asks);
+    }
+
+    synthetic.view.store(view);
+}
+
+/**
+ * @brief Check every leg and recompute the synthetics of legs that moved
+ * @return The number of synthetics recomputed
+ */
+size_t SyntheticBookEngine::poll_legs()
+{
+    DepthView view;
+    for (size_t index = 0; index < this->legs.size(); index++)
+    {
+        Leg &leg = this->legs[index];
+
+        // cheap check first - nothing published since the last poll
+        uint64_t version = leg.view->version();
+        if (version == leg.last_version || !leg.view->try_load(view))
+        {
+            continue;
+        }
+        leg.last_version = version;
+
+        // a change below the top levels doesn't move any synthetic
+        if (same_levels(view, leg.current))
+        {
+            leg.current.update_id = view.update_id;
+            leg.current.event_time = view.event_time;
+            continue;
+        }
+        leg.current = view;
+
+        for (uint32_t id : this->dependents[index])
+        {
+            if (!this->synthetics[id]->dirty)
+            {
+                this->synthetics[id]->dirty = true;
+                this->dirty.push_back(id);
+            }
+        }
+    }
+
+    // each synthetic is recomputed once per poll, however many of its legs moved
+    size_t recomputed = this->dirty.size();
+    for (uint32_t id : this->dirty)
+    {
+        Synthetic &synthetic = *this->synthetics[id];
+        synthetic.dirty = false;
+        recompute(synthetic);
+    }
+    this->dirty.clear();
+
+    this->recomputes.fetch_add(recomputed, std::memory_order_relaxed);
+    return recomputed;
+}
+
+/**
+ * @brief Start the engine thread
+ */
+void SyntheticBookEngine::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    std::cout << "[SyntheticBookEngine] Pricing " << this->synthetics.size() << " synthetics from " << this->legs.size() << " legs" << std::endl;
+    this->worker = std::thread(&SyntheticBookEngine::run, this);
+}
+
+/**
+ * @brief Stop the engine thread
+ */
+void SyntheticBookEngine::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Engine thread body - recompute synthetics as their legs move, back off briefly when none have
+ */
+void SyntheticBookEngine::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll_legs() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+// implementation for TouchQuoter class
+
+#include <iostream>
+#include "../include/binance_depth.h"
+#include "../include/touch_quoter.h"
+
+/**
+ * @brief Construct a quoter
+ * @param simulator The simulator orders are sent to
+ * @param pnl The tracker fills are booked into
+ * @param pnl_symbol The tracker's symbol ID for the quoted book
+ * @param quantity Size of each quote
+ * @param fee_rate Fee per unit of quote traded
+ * @param order_latency How long after the quoter sees a book change its orders reach the simulator
+ */
+TouchQuoter::TouchQuoter(FillSimulator &simulator, PnlTracker &pnl, uint32_t pnl_symbol, double quantity, double fee_rate, std::chrono::microseconds order_latency)
+    : simulator(simulator), pnl(pnl), pnl_symbol(pnl_symbol), quantity(quantity), fee_rate(fee_rate), order_latency(order_latency) {}
+
+/**
+ * @brief Requote a side whose best price moved
+ */
+void TouchQuoter::on_book(Backtester &backtester, const BookEvent &event)
+{
+    if (event.view.bid_count > 0 && event.view.bids[0].price != this->bid_price)
+    {
+        requote(backtester, OrderSide::BUY, event.view.bids[0].price, this->bid_order, this->bid_price);
+    }
+    if (event.view.ask_count > 0 && event.view.asks[0].price != this->ask_price)
+    {
+        requote(backtester, OrderSide::SELL, event.view.asks[0].price, this->ask_order, this->ask_price);
+    }
+    // the tracker isn't on its own thread here, so re-mark open positions as the book moves
+    this->pnl.poll();
+}
+
+void TouchQuoter::on_trade(Backtester &, const TradeEvent &)
+{
+}
+
+/**
+ * @brief Cancel a side's quote, if any, and quote the new price
+ */
+void TouchQuoter::requote(Backtester &backtester, OrderSide side, double price, uint64_t &order, double &quoted_price)
+{
+    int64_t arrival_time_us = backtester.now_us() + this->order_latency.count();
+    if (order != 0)
+    {
+        this->simulator.cancel(order, arrival_time_us);
+    }
+    order = this->simulator.submit(side, OrderType::LIMIT, price, this->quantity, arrival_time_us);
+    quoted_price = price;
+    this->open_orders[order] = side;
+}
+
+/**
+ * @brief Simulator listener - books fills and forgets finished orders
+ * @param user The quoter
+ */
+void TouchQuoter::order_update_callback(const SimOrderUpdate &update, void *user)
+{
+    TouchQuoter &quoter = *static_cast<TouchQuoter *>(user);
+    auto order = quoter.open_orders.find(update.order_id);
+    if (order == quoter.open_orders.end())
+    {
+        return;
+    }
+    if (update.fill_quantity > 0)
+    {
+        double fee = update.fill_price * update.fill_quantity * quoter.fee_rate;
+        quoter.pnl.on_fill(PositionFill{quoter.pnl_symbol, order->second, update.fill_price, update.fill_quantity, fee});
+        quoter.pnl.poll();
+    }
+    if (update.status == SimOrderStatus::FILLED || update.status == SimOrderStatus::CANCELLED || update.status == SimOrderStatus::REJECTED)
+    {
+        // a filled quote is replaced on the next book change, as its price no longer matches the touch
+        if (update.order_id == quoter.bid_order)
+        {
+            quoter.bid_order = 0;
+            quoter.bid_price = 0;
+        }
+        if (update.order_id == quoter.ask_order)
+        {
+            quoter.ask_order = 0;
+            quoter.ask_price = 0;
+        }
+        quoter.open_orders.erase(order);
+    }
+}
+
+/**
+ * @brief Replay the recorded spot book and trades through the fill simulator with a TouchQuoter, and print its PnL
+ * @param depth_path The spot book capture (XRPUSDT-depth.cap)
+ * @param trades_path The trade capture (trades.cap)
+ * @return Process exit code
+ */
+int run_touch_backtest(const std::string &depth_path, const std::string &trades_path)
+{
+    Backtester backtester;
+    backtester.add_capture(depth_path);
+    backtester.add_capture(trades_path);
+    uint32_t book_id = backtester.add_book<BinanceSpot>("XRPUSDT@depth");
+    uint32_t trades = backtester.add_trade_stream("XRPUSDT@aggTrade");
+    OrderBook<BinanceSpot> &book = backtester.get_book<BinanceSpot>(book_id);
+
+    FillSimulator simulator;
+    simulator.attach(book);
+    backtester.add_trade_listener(trades, FillSimulator::trade_callback, &simulator);
+
+    PnlTracker pnl;
+    uint32_t symbol = pnl.add_book(book, "XRPUSDT");
+    TouchQuoter quoter(simulator, pnl, symbol, 10, 0.001, std::chrono::milliseconds(5));
+    simulator.add_listener(TouchQuoter::order_update_callback, &quoter);
+    backtester.add_strategy(quoter, std::chrono::milliseconds(2));
+
+    BacktestStats stats = backtester.run();
+    pnl.poll();
+    SymbolPnl position = pnl.get_symbol_pnl(symbol);
+    PortfolioSnapshot portfolio = pnl.get_portfolio();
+    std::cout << "replayed " << stats.records << " records in " << stats.wall_seconds << "s (" << stats.speedup << "x)" << std::endl;
+    std::cout << "fills " << portfolio.fills << ", position " << position.position << " at " << position.average_cost << ", marked at " << position.mark
+              << std::endl;
+    std::cout << "realised " << portfolio.realised_pnl << ", unrealised " << portfolio.unrealised_pnl << ", total " << portfolio.total_pnl << std::endl;
+    return 0;
+}
@@ -0,0 +1,318 @@
+// implementation for TriangularArbitrageScanner class
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include "../include/triangular_arbitrage.h"
+
+/**
+ * @brief Construct a new TriangularArbitrageScanner
+ * @param fee_rate Taker fee charged on every trade
+ * @param threshold Minimum fee-adjusted return of a cycle to report
+ * @param poll_interval How long the scanner thread sleeps when no BBO changed
+ */
+TriangularArbitrageScanner::TriangularArbitrageScanner(double fee_rate, double threshold, std::chrono::microseconds poll_interval)
+    : fee_rate(fee_rate), log_threshold(std::log1p(threshold)), poll_interval(poll_interval) {}
+
+TriangularArbitrageScanner::~TriangularArbitrageScanner()
+{
+    stop();
+}
+
+/**
+ * @brief Get the ID of an asset, adding it to the graph if it's new
+ */
+uint16_t TriangularArbitrageScanner::asset_id(const std::string &asset)
+{
+    for (size_t i = 0; i < this->assets.size(); i++)
+    {
+        if (this->assets[i] == asset)
+        {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    this->assets.push_back(asset);
+    return static_cast<uint16_t>(this->assets.size() - 1);
+}
+
+/**
+ * @brief Add a pair's published depth view to the graph
+ */
+void TriangularArbitrageScanner::add_pair(const std::string &symbol, const std::string &base, const std::string &quote, const SeqLock<DepthView> &view)
+{
+    if (base == quote)
+    {
+        throw std::invalid_argument("[TriangularArbitrageScanner] Pair " + symbol + " has the same base and quote");
+    }
+
+    Pair pair{};
+    pair.symbol = symbol;
+    pair.base = asset_id(base);
+    pair.quote = asset_id(quote);
+    pair.view = &view;
+    pair.last_version = 0;
+    pair.valid = false;
+    this->pairs.push_back(pair);
+}
+
+void TriangularArbitrageScanner::add_listener(OpportunityListener listener, void *user)
+{
+    this->listeners.emplace_back(listener, user);
+}
+
+/**
+ * @brief Find a pair that trades from one asset to another
+ * @param sells_base Set to true if the trade sells the pair's base asset, false if it buys it
+ * @return The pair index, or -1 if no pair connects the assets
+ */
+int TriangularArbitrageScanner::find_pair(uint16_t from, uint16_t to, bool &sells_base) const
+{
+    for (size_t i = 0; i < this->pairs.size(); i++)
+    {
+        if (this->pairs[i].base == from && this->pairs[i].quote == to)
+        {
+            sells_base = true;
+            return static_cast<int>(i);
+        }
+        if (this->pairs[i].base == to && this->pairs[i].quote == from)
+        {
+            sells_base = false;
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Enumerate every directed three-asset cycle once - each starts at its lowest asset ID, so rotations aren't repeated
+ */
+void TriangularArbitrageScanner::build_cycles()
+{
+    this->cycles.clear();
+    this->cycles_by_pair.assign(this->pairs.size(), {});
+
+    uint16_t asset_count = static_cast<uint16_t>(this->assets.size());
+    for (uint16_t a = 0; a < asset_count; a++)
+    {
+        for (uint16_t b = a + 1; b < asset_count; b++)
+        {
+            for (uint16_t c = a + 1; c < asset_count; c++)
+            {
+                if (c == b)
+                {
+                    continue;
+                }
+
+                Cycle cycle;
+                cycle.assets[0] = a;
+                cycle.assets[1] = b;
+                cycle.assets[2] = c;
+                int first = find_pair(a, b, cycle.sells_base[0]);
+                int second = find_pair(b, c, cycle.sells_base[1]);
+                int third = find_pair(c, a, cycle.sells_base[2]);
+                if (first < 0 || second < 0 || third < 0)
+                {
+                    continue;
+                }
+                cycle.pairs[0] = static_cast<uint16_t>(first);
+                cycle.pairs[1] = static_cast<uint16_t>(second);
+                cycle.pairs[2] = static_cast<uint16_t>(third);
+
+                uint32_t id = static_cast<uint32_t>(this->cycles.size());
+                this->cycles.push_back(cycle);
+                for (uint16_t pair : cycle.pairs)
+                {
+                    this->cycles_by_pair[pair].push_back(id);
+                }
+            }
+        }
+    }
+}
+
+void TriangularArbitrageScanner::prepare()
+{
+    build_cycles();
+}
+
+size_t TriangularArbitrageScanner::get_cycle_count() const
+{
+    return this->cycles.size();
+}
+
+uint64_t TriangularArbitrageScanner::get_evaluations() const
+{
+    return this->evaluations.load(std::memory_order_relaxed);
+}
+
+uint64_t TriangularArbitrageScanner::get_opportunities() const
+{
+    return this->opportunities.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get a readable description of a cycle
+ */
+std::string TriangularArbitrageScanner::get_cycle_description(uint32_t cycle_id) const
+{
+    const Cycle &cycle = this->cycles.at(cycle_id);
+    std::string description;
+    for (uint16_t asset : cycle.assets)
+    {
+        description += this->assets[asset] + " -> ";
+    }
+    description += this->assets[cycle.assets[0]] + " (";
+    for (size_t step = 0; step < 3; step++)
+    {
+        description += (cycle.sells_base[step] ? "sell " : "buy ") + this->pairs[cycle.pairs[step]].symbol;
+        description += step < 2 ? ", " : ")";
+    }
+    return description;
+}
+
+/**
+ * @brief Evaluate one cycle with the current edges, notifying listeners if it clears the threshold
+ * @param event_time Exchange event time of the BBO change that triggered the evaluation
+ * @return true if the cycle was an opportunity
+ */
+bool TriangularArbitrageScanner::evaluate(uint32_t cycle_id, int64_t event_time)
+{
+    const Cycle &cycle = this->cycles[cycle_id];
+
+    double log_return = 0;
+    for (size_t step = 0; step < 3; step++)
+    {
+        const Pair &pair = this->pairs[cycle.pairs[step]];
+        if (!pair.valid)
+        {
+            return false;
+        }
+        log_return += cycle.sells_base[step] ? pair.log_sell : pair.log_buy;
+    }
+    if (log_return <= this->log_threshold)
+    {
+        return false;
+    }
+
+    // size: each step can carry at most its top level, expressed in the start asset through the rates of the steps before it
+    double start_quantity = std::numeric_limits<double>::infinity();
+    double rate_so_far = 1.0;
+    for (size_t step = 0; step < 3; step++)
+    {
+        const Pair &pair = this->pairs[cycle.pairs[step]];
+        double capacity = cycle.sells_base[step] ? pair.best_bid.quantity : pair.best_ask.quantity * pair.best_ask.price;
+        start_quantity = std::min(start_quantity, capacity / rate_so_far);
+        rate_so_far *= std::exp(cycle.sells_base[step] ? pair.log_sell : pair.log_buy);
+    }
+
+    ArbitrageOpportunity opportunity;
+    opportunity.cycle = cycle_id;
+    for (size_t step = 0; step < 3; step++)
+    {
+        opportunity.assets[step] = cycle.assets[step];
+        opportunity.pairs[step] = cycle.pairs[step];
+        opportunity.sells_base[step] = cycle.sells_base[step];
+    }
+    opportunity.net_return = std::expm1(log_return);
+    opportunity.start_quantity = start_quantity;
+    opportunity.event_time = event_time;
+    opportunity.detected_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    opportunity.detection_latency_us = opportunity.detected_ns / 1000 - event_time * 1000;
+
+    this->opportunities.fetch_add(1, std::memory_order_relaxed);
+    for (const auto &listener : this->listeners)
+    {
+        listener.first(opportunity, listener.second);
+    }
+    return true;
+}
+
+/**
+ * @brief Check every pair for a BBO change and re-evaluate the cycles through the pairs that changed
+ * @return The number of pairs whose BBO changed
+ */
+size_t TriangularArbitrageScanner::poll_pairs()
+{
+    size_t changed = 0;
+    DepthView view;
+    for (size_t index = 0; index < this->pairs.size(); index++)
+    {
+        Pair &pair = this->pairs[index];
+
+        // cheap check first - nothing published since the last poll
+        uint64_t version = pair.view->version();
+        if (version == pair.last_version || !pair.view->try_load(view))
+        {
+            continue;
+        }
+        pair.last_version = version;
+
+        PriceLevel best_bid = view.bid_count > 0 ? view.bids[0] : PriceLevel{0, 0};
+        PriceLevel best_ask = view.ask_count > 0 ? view.asks[0] : PriceLevel{0, 0};
+        if (best_bid.price == pair.best_bid.price && best_bid.quantity == pair.best_bid.quantity &&
+            best_ask.price == pair.best_ask.price && best_ask.quantity == pair.best_ask.quantity)
+        {
+            continue;
+        }
+
+        // only this pair's edges change
+        pair.best_bid = best_bid;
+        pair.best_ask = best_ask;
+        pair.valid = best_bid.price > 0 && best_ask.price > 0;
+        if (pair.valid)
+        {
+            pair.log_sell = std::log(best_bid.price * (1.0 - this->fee_rate));
+            pair.log_buy = std::log((1.0 - this->fee_rate) / best_ask.price);
+        }
+        changed++;
+
+        // and only the cycles through it can have changed
+        const std::vector<uint32_t> &affected = this->cycles_by_pair[index];
+        for (uint32_t cycle_id : affected)
+        {
+            evaluate(cycle_id, view.event_time);
+        }
+        this->evaluations.fetch_add(affected.size(), std::memory_order_relaxed);
+    }
+    return changed;
+}
+
+/**
+ * @brief Build the cycle index and start the scanner thread
+ */
+void TriangularArbitrageScanner::start()
+{
+    if (this->running.exchange(true))
+    {
+        return;
+    }
+    prepare();
+    std::cout << "[TriangularArbitrageScanner] Scanning " << this->cycles.size() << " cycles over " << this->pairs.size() << " pairs" << std::endl;
+    this->worker = std::thread(&TriangularArbitrageScanner::run, this);
+}
+
+/**
+ * @brief Stop the scanner thread
+ */
+void TriangularArbitrageScanner::stop()
+{
+    this->running.store(false, std::memory_order_release);
+    if (this->worker.joinable())
+    {
+        this->worker.join();
+    }
+}
+
+/**
+ * @brief Scanner thread body - re-evaluate cycles as BBOs change, back off briefly when none have
+ */
+void TriangularArbitrageScanner::run()
+{
+    while (this->running.load(std::memory_order_acquire))
+    {
+        if (poll_pairs() == 0)
+        {
+            std::this_thread::sleep_for(this->poll_interval);
+        }
+    }
+}
@@ -40,19 +40,23 @@ WebSocketClient::WebSocketClient(char *uri, int port, char *path)
  * @param port The WS server port
  * @param path The WS server path
  * @param callback The custom callback method
+ * @param buffer A pointer to the CircularBuffer to store incoming data
+ * @param use_ssl Connect with TLS
  */
 WebSocketClient::WebSocketClient(
     const char *uri,
     int port,
     const char *path,
     int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len),
-    CircularBuffer<Binance_DiffDepth, 1024> *buffer)
+    CircularBuffer<DepthUpdate, 1024> *buffer,
+    bool use_ssl)
 {
     this->uri = uri;
     this->port = port;
     this->path = path;
     this->callback = callback;
     this->buffer = buffer;
+    this->use_ssl = use_ssl;
 
     if (this->buffer == nullptr)
     {
@@ -64,6 +68,36 @@ WebSocketClient::WebSocketClient(
     }
 }
 
+/**
+ * @brief Constructor for streams other than depth, whose callback knows the buffer's type (see stream_callback)
+ * @param uri The WS server URI
+ * @param port The WS server port
+ * @param path The WS server path
+ * @param callback The custom callback method
+ * @param stream_buffer Buffer handed to the callback through WebSocketClientData::stream_buffer
+ * @param use_ssl Connect with TLS
+ */
+WebSocketClient::WebSocketClient(
+    const char *uri,
+    int port,
+    const char *path,
+    int (*callback)(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len),
+    void *stream_buffer,
+    bool use_ssl)
+{
+    this->uri = uri;
+    this->port = port;
+    this->path = path;
+    this->callback = callback;
+    this->stream_buffer = stream_buffer;
+    this->use_ssl = use_ssl;
+
+    if (this->stream_buffer == nullptr)
+    {
+        std::cerr << "Error: Stream buffer is not initialized!" << std::endl;
+    }
+}
+
 /**
  * @brief Default callback method for handling different Websocket events
  * @param wsi The websocket instance
@@ -141,17 +175,17 @@ int WebSocketClient::init()
     // Create client data structure
     WebSocketClientData *client_data = new WebSocketClientData;
     client_data->buffer = this->buffer;
+    client_data->stream_buffer = this->stream_buffer;
     client_data->client = this;
 
-    // define WS client protocol
-    static struct lws_protocols protocols[] = {
-        {
-            "my-protocol",
-            this->callback,
-            sizeof(WebSocketClientData), // use our data structure size,
-            1024,
-        },
-        {NULL, NULL, 0, 0}};
+    // define WS client protocol - a member rather than a static, so clients with different callbacks can run side by side
+    this->protocols[0] = {
+        "my-protocol",
+        this->callback,
+        sizeof(WebSocketClientData), // use our data structure size,
+        1024,
+    };
+    this->protocols[1] = {NULL, NULL, 0, 0};
 
     // create WS client
     struct lws_context_creation_info info;
@@ -160,10 +194,11 @@ int WebSocketClient::init()
 
     // we don't want to listen for incoming connections
     info.port = CONTEXT_PORT_NO_LISTEN;
-    info.protocols = protocols;
+    info.protocols = this->protocols;
     info.gid = -1;
     info.uid = -1;
     info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT; // SSL global init
+    info.user = this;                                    // lets callbacks without a connection find the client
 
     // create WS context, this holds the state of the WS connection - pass in mem addr of into struct
     struct lws_context *context = lws_create_context(&info);
@@ -172,6 +207,7 @@ int WebSocketClient::init()
         std::cerr << "Context creation failed" << std::endl;
         return -1;
     }
+    this->context.store(context, std::memory_order_release);
 
     // set logging level
     // lws_set_log_level(LLL_DEBUG | LLL_INFO | LLL_WARN | LLL_ERR, NULL);
@@ -187,8 +223,8 @@ int WebSocketClient::init()
     ccinfo.path = this->path;
     ccinfo.host = ccinfo.address;
     ccinfo.origin = ccinfo.address;
-    ccinfo.protocol = protocols[0].name;
-    ccinfo.ssl_connection = LCCSCF_USE_SSL | LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK; // Use SSL/TLS for the connection
+    ccinfo.protocol = this->protocols[0].name;
+    ccinfo.ssl_connection = this->use_ssl ? LCCSCF_USE_SSL | LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK : 0; // Use SSL/TLS for the connection
     ccinfo.alpn = "http/1.1";                                                        // Application Layer Protocol Negotiation
     ccinfo.userdata = client_data;
 
@@ -201,28 +237,69 @@ int WebSocketClient::init()
     if (wsi == NULL)
     {
         std::cerr << "Client connection failed" << std::endl;
+        this->context.store(nullptr, std::memory_order_release);
         lws_context_destroy(context);
         return -1;
     }
 
     // connection successful, set ready flag
-    this->buffer->set_is_ready(true);
+    if (this->buffer)
+    {
+        this->buffer->set_is_ready(true);
+    }
 
     // Event loop
-    while (lws_service(context, 0) >= 0)
+    while (lws_service(context, 0) >= 0 && !this->stop_requested.load(std::memory_order_acquire))
     {
+        // event driven connections block in lws_service until there is traffic or a wake()
+        if (this->event_driven)
+        {
+            continue;
+        }
         // small sleep to prevent CPU spinning
         lws_callback_on_writable(wsi);
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 
     // clean up
+    this->context.store(nullptr, std::memory_order_release);
     lws_context_destroy(context);
     return 0;
 };
 
+void WebSocketClient::enable_event_driven()
+{
+    this->event_driven = true;
+}
+
+void WebSocketClient::wake()
+{
+    // no context before init() or once the session has ended - there is no loop to wake then
+    struct lws_context *context = this->context.load(std::memory_order_acquire);
+    if (context)
+    {
+        lws_cancel_service(context);
+    }
+}
+
+void WebSocketClient::stop()
+{
+    this->stop_requested.store(true, std::memory_order_release);
+    // the context only exists while init() runs - before that the flag alone stops the loop after its first pass
+    struct lws_context *context = this->context.load(std::memory_order_acquire);
+    if (context)
+    {
+        lws_cancel_service(context);
+    }
+}
+
+void *WebSocketClient::get_stream_buffer() const
+{
+    return this->stream_buffer;
+}
+
 // Get buffer instance
-CircularBuffer<Binance_DiffDepth, 1024> *WebSocketClient::get_buffer()
+CircularBuffer<DepthUpdate, 1024> *WebSocketClient::get_buffer()
 {
     if (!this->buffer)
     {
@@ -0,0 +1,180 @@
+// order gateway test - runs an OrderGateway against a MockOrderVenue on the loopback interface
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/mock_order_venue.h"
+#include "../include/order_gateway.h"
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "[FAIL] " << what << std::endl;
+            failures++;
+        }
+    }
+
+    /**
+     * @brief Poll until done() returns true
+     * @return false if it didn't within the timeout
+     */
+    template <typename Done>
+    bool wait_for(Done done, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Connect a gateway, and wait for the connection to be up
+     */
+    void connect(OrderGateway &gateway, const std::string &what)
+    {
+        gateway.connect();
+        check(wait_for([&gateway]()
+                       { return gateway.is_connected(); }),
+              what + ": gateway connected");
+    }
+
+    /**
+     * @brief Wait for the response to a request
+     */
+    OrderResponse await_response(const OrderGateway &gateway, int64_t request_id, const std::string &what)
+    {
+        OrderResponse response{};
+        check(request_id > 0, what + ": request sent");
+        check(request_id > 0 && wait_for([&]()
+                                         { return gateway.get_response(request_id, response); }),
+              what + ": response to request " + std::to_string(request_id));
+        return response;
+    }
+
+    OrderRequest limit_order(uint64_t client_order_id, double price)
+    {
+        OrderRequest order{};
+        std::strncpy(order.symbol, "XRPUSDT", sizeof(order.symbol));
+        order.side = OrderSide::BUY;
+        order.type = OrderType::LIMIT;
+        order.price_decimals = 4;
+        order.quantity_decimals = 1;
+        order.price = price;
+        order.quantity = 10;
+        order.client_order_id = client_order_id;
+        return order;
+    }
+
+    /**
+     * @brief Responses are matched to their requests by ID - with several requests in flight, each gets its own venue order ID back,
+     * and a cancel gets the ID of the order it cancelled
+     */
+    void test_correlation()
+    {
+        MockOrderVenue venue(19191, "test-key", "test-secret", std::chrono::milliseconds(20));
+        venue.start();
+        OrderGateway gateway(OrderGatewayEndpoints::mock(19191), "test-key", "test-secret");
+        connect(gateway, "correlation");
+
+        // all three in flight at once - the venue numbers its orders 1, 2, 3 in the order it receives them
+        int64_t first = gateway.place(limit_order(101, 0.5));
+        int64_t second = gateway.place(limit_order(102, 0.6));
+        int64_t third = gateway.place(limit_order(103, 0.7));
+        check(first != second && second != third, "correlation: distinct request IDs");
+        OrderResponse response = await_response(gateway, first, "correlation place 1");
+        check(response.state == RequestState::ACKED && response.request_id == first && response.order_id == 1, "correlation: place 1 acked as order 1");
+        response = await_response(gateway, second, "correlation place 2");
+        check(response.state == RequestState::ACKED && response.request_id == second && response.order_id == 2, "correlation: place 2 acked as order 2");
+        response = await_response(gateway, third, "correlation place 3");
+        check(response.state == RequestState::ACKED && response.request_id == third && response.order_id == 3, "correlation: place 3 acked as order 3");
+
+        response = await_response(gateway, gateway.cancel("XRPUSDT", 102), "correlation cancel 2");
+        check(response.state == RequestState::ACKED && response.order_id == 2, "correlation: cancel of 102 cancelled order 2");
+        // already cancelled
+        response = await_response(gateway, gateway.cancel("XRPUSDT", 102), "correlation cancel 2 again");
+        check(response.state == RequestState::REJECTED && response.error_code == -2011 && response.order_id == -1, "correlation: second cancel of 102 rejected with -2011");
+
+        check(gateway.get_timeouts() == 0, "correlation: no timeouts");
+        check(gateway.get_unmatched_responses() == 0, "correlation: no unmatched responses");
+        gateway.stop();
+        venue.stop();
+    }
+
+    /**
+     * @brief A request signed with the wrong secret is rejected by the venue with -1022
+     */
+    void test_bad_signature()
+    {
+        MockOrderVenue venue(19192, "test-key", "test-secret");
+        venue.start();
+        OrderGateway gateway(OrderGatewayEndpoints::mock(19192), "test-key", "wrong-secret");
+        connect(gateway, "bad signature");
+
+        OrderResponse response = await_response(gateway, gateway.place(limit_order(201, 0.5)), "bad signature place");
+        check(response.state == RequestState::REJECTED && response.status == 400 && response.error_code == -1022 && response.order_id == -1,
+              "bad signature: place rejected with -1022, got " + std::to_string(response.error_code));
+
+        gateway.stop();
+        venue.stop();
+    }
+
+    /**
+     * @brief A request the venue doesn't answer within the timeout has its slot reclaimed the next time a request lands on it,
+     * and the late response is counted as unmatched rather than completing the slot's new request
+     */
+    void test_timeout()
+    {
+        MockOrderVenue venue(19193, "test-key", "test-secret", std::chrono::milliseconds(300));
+        venue.start();
+        OrderGateway gateway(OrderGatewayEndpoints::mock(19193), "test-key", "test-secret", std::chrono::milliseconds(50));
+        connect(gateway, "timeout");
+
+        int64_t late = gateway.place(limit_order(1, 0.5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // fill every other slot, so the next request wraps round to the late request's slot
+        for (size_t i = 1; i < ORDER_GATEWAY_SLOTS; i++)
+        {
+            check(gateway.place(limit_order(1 + i, 0.5)) > 0, "timeout: slot " + std::to_string(i) + " claimed");
+        }
+        int64_t reclaimed = gateway.place(limit_order(1 + ORDER_GATEWAY_SLOTS, 0.5));
+        check(reclaimed == late + static_cast<int64_t>(ORDER_GATEWAY_SLOTS), "timeout: the late request's slot was reclaimed by request " + std::to_string(reclaimed));
+        check(gateway.get_timeouts() == 1, "timeout: " + std::to_string(gateway.get_timeouts()) + " timeouts, expected 1");
+
+        OrderResponse response = await_response(gateway, reclaimed, "timeout reclaimed request");
+        check(response.state == RequestState::ACKED && response.request_id == reclaimed, "timeout: the reclaimed slot's own response completed it");
+        check(!gateway.get_response(late, response), "timeout: no response for the timed out request");
+        check(gateway.get_unmatched_responses() == 1, "timeout: " + std::to_string(gateway.get_unmatched_responses()) + " unmatched responses, expected 1");
+
+        gateway.stop();
+        venue.stop();
+    }
+}
+
+int main()
+{
+    test_correlation();
+    test_bad_signature();
+    test_timeout();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All order gateway checks passed" << std::endl;
+    return 0;
+}
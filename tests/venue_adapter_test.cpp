@@ -0,0 +1,460 @@
+// venue adapter test - runs books against a loopback mock venue that serves canned REST snapshots and a scripted diff stream
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libwebsockets.h>
+#include "../include/binance_depth.h"
+#include "../include/order_book.h"
+#include "../include/websocket_client.h"
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "[FAIL] " << what << std::endl;
+            failures++;
+        }
+    }
+
+    /**
+     * @brief Poll until done() returns true
+     * @return false if it didn't within the timeout
+     */
+    template <typename Done>
+    bool wait_for(Done done, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
+    /**
+     * @brief A local stand-in for a venue's depth endpoints - REST snapshots over plain HTTP, and the diff stream over a plain WebSocket.
+     * Snapshots are served in the order given, the last one repeated. Stream messages are sent to the connected client as they are queued.
+     */
+    class MockDepthVenue
+    {
+    private:
+        int http_port;
+        int stream_port;
+        std::vector<std::string> snapshots;
+        std::atomic<size_t> snapshot_requests{0};
+        int listen_fd = -1;
+        std::thread http_thread;
+
+        struct lws_protocols protocols[3];
+        struct lws_context *context = nullptr;
+        std::thread stream_thread;
+        std::atomic<bool> stop_requested{false};
+        // messages waiting to be sent - queued by the test, sent on the stream thread
+        std::mutex mutex;
+        std::deque<std::string> messages;
+        // the connected client, only touched on the stream thread
+        struct lws *client = nullptr;
+
+        /**
+         * @brief Answer every HTTP request with the next snapshot
+         */
+        void serve_http()
+        {
+            while (!this->stop_requested.load(std::memory_order_acquire))
+            {
+                struct pollfd listening{this->listen_fd, POLLIN, 0};
+                if (poll(&listening, 1, 100) <= 0)
+                {
+                    continue;
+                }
+                int fd = accept(this->listen_fd, nullptr, nullptr);
+                if (fd < 0)
+                {
+                    continue;
+                }
+
+                // the request has no body, so it ends at the blank line
+                std::string request;
+                char chunk[1024];
+                while (request.find("\r\n\r\n") == std::string::npos)
+                {
+                    ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+                    if (received <= 0)
+                    {
+                        break;
+                    }
+                    request.append(chunk, static_cast<size_t>(received));
+                }
+
+                size_t index = std::min(this->snapshot_requests.fetch_add(1), this->snapshots.size() - 1);
+                const std::string &body = this->snapshots[index];
+                std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) +
+                                       "\r\nConnection: close\r\n\r\n" + body;
+                size_t sent = 0;
+                while (sent < response.size())
+                {
+                    ssize_t written = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                    if (written <= 0)
+                    {
+                        break;
+                    }
+                    sent += static_cast<size_t>(written);
+                }
+                close(fd);
+            }
+        }
+
+        static int stream_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
+        {
+            (void)user;
+            (void)in;
+            (void)len;
+            MockDepthVenue *venue = static_cast<MockDepthVenue *>(lws_context_user(lws_get_context(wsi)));
+            if (!venue)
+            {
+                return 0;
+            }
+
+            switch (reason)
+            {
+            case LWS_CALLBACK_ESTABLISHED:
+                venue->client = wsi;
+                lws_callback_on_writable(wsi);
+                break;
+
+            // send() woke the service loop
+            case LWS_CALLBACK_EVENT_WAIT_CANCELLED:
+                if (venue->client)
+                {
+                    lws_callback_on_writable(venue->client);
+                }
+                break;
+
+            case LWS_CALLBACK_SERVER_WRITEABLE:
+            {
+                std::string message;
+                bool more;
+                {
+                    std::lock_guard<std::mutex> lock(venue->mutex);
+                    if (venue->messages.empty())
+                    {
+                        break;
+                    }
+                    message = std::move(venue->messages.front());
+                    venue->messages.pop_front();
+                    more = !venue->messages.empty();
+                }
+                std::vector<unsigned char> buffer(LWS_PRE + message.size());
+                memcpy(buffer.data() + LWS_PRE, message.data(), message.size());
+                if (lws_write(wsi, buffer.data() + LWS_PRE, message.size(), LWS_WRITE_TEXT) < static_cast<int>(message.size()))
+                {
+                    return -1;
+                }
+                if (more)
+                {
+                    lws_callback_on_writable(wsi);
+                }
+                break;
+            }
+
+            case LWS_CALLBACK_CLOSED:
+                venue->client = nullptr;
+                break;
+
+            default:
+                break;
+            }
+            return 0;
+        }
+
+    public:
+        MockDepthVenue(int http_port, int stream_port, std::vector<std::string> snapshots)
+            : http_port(http_port), stream_port(stream_port), snapshots(std::move(snapshots)) {}
+
+        ~MockDepthVenue()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Start listening on both ports
+         * @throws std::runtime_error If either port can't be listened on
+         */
+        void start()
+        {
+            this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            int reuse = 1;
+            setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            struct sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(this->http_port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(this->listen_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 || listen(this->listen_fd, 8) < 0)
+            {
+                throw std::runtime_error("[MockDepthVenue] Failed to listen on port " + std::to_string(this->http_port));
+            }
+
+            this->protocols[0] = {"http", lws_callback_http_dummy, 0, 0};
+            this->protocols[1] = {"my-protocol", &MockDepthVenue::stream_callback, 0, 4096};
+            this->protocols[2] = {NULL, NULL, 0, 0};
+            struct lws_context_creation_info info;
+            memset(&info, 0, sizeof(info));
+            info.port = this->stream_port;
+            info.iface = "127.0.0.1";
+            info.protocols = this->protocols;
+            info.gid = -1;
+            info.uid = -1;
+            info.user = this;
+            this->context = lws_create_context(&info);
+            if (!this->context)
+            {
+                throw std::runtime_error("[MockDepthVenue] Failed to listen on port " + std::to_string(this->stream_port));
+            }
+
+            this->http_thread = std::thread(&MockDepthVenue::serve_http, this);
+            this->stream_thread = std::thread([this]()
+                                              {
+                                                  while (lws_service(this->context, 0) >= 0 && !this->stop_requested.load(std::memory_order_acquire))
+                                                  {
+                                                  }
+                                              });
+        }
+
+        void stop()
+        {
+            this->stop_requested.store(true, std::memory_order_release);
+            if (this->context)
+            {
+                lws_cancel_service(this->context);
+            }
+            if (this->stream_thread.joinable())
+            {
+                this->stream_thread.join();
+            }
+            if (this->http_thread.joinable())
+            {
+                this->http_thread.join();
+            }
+            if (this->context)
+            {
+                lws_context_destroy(this->context);
+                this->context = nullptr;
+            }
+            if (this->listen_fd >= 0)
+            {
+                close(this->listen_fd);
+                this->listen_fd = -1;
+            }
+        }
+
+        /**
+         * @brief Queue stream messages for the client - sent as soon as it is connected
+         */
+        void send(const std::vector<std::string> &batch)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->messages.insert(this->messages.end(), batch.begin(), batch.end());
+            }
+            if (this->context)
+            {
+                lws_cancel_service(this->context);
+            }
+        }
+
+        size_t get_snapshot_requests() const
+        {
+            return this->snapshot_requests.load();
+        }
+
+        /**
+         * @brief Endpoints that point a book and its stream at this venue
+         */
+        VenueEndpoints endpoints(const std::string &symbol) const
+        {
+            return VenueEndpoints{symbol, "127.0.0.1", this->stream_port, "/ws/" + BinanceDepthCodec::stream_symbol(symbol) + "@depth@100ms", false,
+                                  "http://127.0.0.1:" + std::to_string(this->http_port) + "/depth?symbol=" + symbol};
+        }
+    };
+
+    /**
+     * @brief A spot diff depth event - levels as ["price","quantity"] pairs
+     */
+    std::string spot_event(int64_t first_update_id, int64_t final_update_id, const std::string &bids, const std::string &asks)
+    {
+        return "{\"e\":\"depthUpdate\",\"E\":" + std::to_string(1700000000000 + final_update_id) + ",\"s\":\"XRPUSDT\",\"U\":" + std::to_string(first_update_id) +
+               ",\"u\":" + std::to_string(final_update_id) + ",\"b\":[" + bids + "],\"a\":[" + asks + "]}";
+    }
+
+    /**
+     * @brief A futures diff depth event - as a spot one, plus pu, the final update ID of the event before it
+     */
+    std::string futures_event(int64_t first_update_id, int64_t final_update_id, int64_t previous_final_update_id, const std::string &bids, const std::string &asks)
+    {
+        return "{\"e\":\"depthUpdate\",\"E\":" + std::to_string(1700000000000 + final_update_id) + ",\"T\":" + std::to_string(1700000000000 + final_update_id) +
+               ",\"s\":\"XRPUSDT\",\"U\":" + std::to_string(first_update_id) + ",\"u\":" + std::to_string(final_update_id) +
+               ",\"pu\":" + std::to_string(previous_final_update_id) + ",\"b\":[" + bids + "],\"a\":[" + asks + "]}";
+    }
+
+    std::string snapshot(int64_t last_update_id, const std::string &bids, const std::string &asks)
+    {
+        return "{\"lastUpdateId\":" + std::to_string(last_update_id) + ",\"bids\":[" + bids + "],\"asks\":[" + asks + "]}";
+    }
+
+    /**
+     * @brief Check one side of a depth view against the expected (price, quantity) levels, best first
+     */
+    void check_levels(const PriceLevel *levels, uint32_t count, const std::vector<PriceLevel> &expected, const std::string &what)
+    {
+        check(count == expected.size(), what + ": " + std::to_string(count) + " levels, expected " + std::to_string(expected.size()));
+        for (uint32_t i = 0; i < count && i < expected.size(); i++)
+        {
+            check(levels[i].price == expected[i].price && levels[i].quantity == expected[i].quantity,
+                  what + " level " + std::to_string(i) + ": " + std::to_string(levels[i].price) + " x " + std::to_string(levels[i].quantity));
+        }
+    }
+
+    /**
+     * @brief Wait for a book to apply up to an update ID, and return its depth view
+     */
+    template <typename Book>
+    DepthView await_update(const Book &book, int64_t update_id, const std::string &what)
+    {
+        DepthView view{};
+        bool reached = wait_for([&]()
+                                {
+                                    book.get_depth_view().load(view);
+                                    return view.update_id == update_id;
+                                });
+        check(reached, what + ": book at update " + std::to_string(view.update_id) + ", expected " + std::to_string(update_id));
+        return view;
+    }
+
+    /**
+     * @brief Spot: events the snapshot covers are dropped, U <= lastUpdateId + 1 <= u is applied, and a gap too large to repair
+     * discards the book and resyncs it from a new snapshot
+     */
+    void test_spot()
+    {
+        MockDepthVenue venue(19181, 19182,
+                             {snapshot(100, "[\"1.00\",\"5\"],[\"0.99\",\"3\"]", "[\"1.01\",\"4\"],[\"1.02\",\"6\"]"),
+                              snapshot(20109, "[\"1.10\",\"1\"]", "[\"1.11\",\"2\"]")});
+        venue.start();
+        // buffered before the snapshot is fetched: one event it covers, one straddling it, one after it
+        venue.send({spot_event(95, 99, "", "[\"1.03\",\"9\"]"),
+                    spot_event(100, 102, "[\"1.00\",\"8\"]", "[\"1.01\",\"0\"]"),
+                    spot_event(103, 105, "[\"0.98\",\"2\"]", "")});
+
+        VenueEndpoints endpoints = venue.endpoints("XRPUSDT");
+        CircularBuffer<DepthUpdate, 1024> buffer;
+        OrderBook<BinanceSpot> book(endpoints, buffer);
+        WebSocketClient client(endpoints.stream_host.c_str(), endpoints.stream_port, endpoints.stream_path.c_str(), venue_callback<BinanceSpot>, &buffer, false);
+        std::thread client_thread(&WebSocketClient::init, &client);
+
+        book.init();
+        std::thread sync_thread(&OrderBook<BinanceSpot>::keep_orderbook_sync, &book);
+
+        DepthView view = await_update(book, 105, "spot sync");
+        check_levels(view.bids, view.bid_count, {{1.00, 8}, {0.99, 3}, {0.98, 2}}, "spot bids after sync");
+        check_levels(view.asks, view.ask_count, {{1.02, 6}}, "spot asks after sync");
+        check(venue.get_snapshot_requests() == 1, "spot: one snapshot to sync");
+
+        // 20000 update IDs missing - too many to repair, so the book is re-initialised from the next snapshot
+        venue.send({spot_event(20106, 20108, "[\"1.00\",\"1\"]", ""),
+                    spot_event(20109, 20110, "[\"1.10\",\"9\"]", "")});
+        view = await_update(book, 20110, "spot resync");
+        check_levels(view.bids, view.bid_count, {{1.10, 9}}, "spot bids after resync");
+        check_levels(view.asks, view.ask_count, {{1.11, 2}}, "spot asks after resync");
+        SyncStats stats = book.get_sync_stats();
+        check(stats.full_resyncs == 1 && stats.gap_repairs == 0, "spot: the large gap was a full resync");
+        check(stats.last_gap_size == 20000, "spot: gap size " + std::to_string(stats.last_gap_size));
+        check(venue.get_snapshot_requests() == 2, "spot: one snapshot to resync");
+
+        book.stop();
+        sync_thread.join();
+        client.stop();
+        client_thread.join();
+        venue.stop();
+    }
+
+    /**
+     * @brief Futures: update IDs aren't contiguous, so continuity is pu == the last applied u. A small break in the chain is
+     * repaired from one snapshot, with the event after the break replayed on top of it
+     */
+    void test_futures()
+    {
+        MockDepthVenue venue(19183, 19184,
+                             {snapshot(100, "[\"2.00\",\"5\"]", "[\"2.01\",\"5\"]"),
+                              snapshot(132, "[\"2.10\",\"1\"]", "[\"2.11\",\"1\"]")});
+        venue.start();
+        // one event the snapshot covers, one straddling it, then one chained on through pu
+        venue.send({futures_event(90, 95, 85, "", "[\"2.03\",\"9\"]"),
+                    futures_event(98, 104, 95, "[\"2.00\",\"6\"]", ""),
+                    futures_event(110, 115, 104, "", "[\"2.01\",\"0\"],[\"2.02\",\"3\"]")});
+
+        VenueEndpoints endpoints = venue.endpoints("XRPUSDT");
+        CircularBuffer<DepthUpdate, 1024> buffer;
+        OrderBook<BinanceFutures> book(endpoints, buffer);
+        WebSocketClient client(endpoints.stream_host.c_str(), endpoints.stream_port, endpoints.stream_path.c_str(), venue_callback<BinanceFutures>, &buffer, false);
+        std::thread client_thread(&WebSocketClient::init, &client);
+
+        book.init();
+        std::thread sync_thread(&OrderBook<BinanceFutures>::keep_orderbook_sync, &book);
+
+        DepthView view = await_update(book, 115, "futures sync");
+        check_levels(view.bids, view.bid_count, {{2.00, 6}}, "futures bids after sync");
+        check_levels(view.asks, view.ask_count, {{2.02, 3}}, "futures asks after sync");
+
+        // pu 120 doesn't chain on to 115 - the events ending at 116 to 120 were missed
+        venue.send({futures_event(130, 135, 120, "[\"2.10\",\"4\"]", ""),
+                    futures_event(136, 140, 135, "", "[\"2.11\",\"7\"]")});
+        view = await_update(book, 140, "futures repair");
+        check_levels(view.bids, view.bid_count, {{2.10, 4}}, "futures bids after repair");
+        check_levels(view.asks, view.ask_count, {{2.11, 7}}, "futures asks after repair");
+        SyncStats stats = book.get_sync_stats();
+        check(stats.gap_repairs == 1 && stats.full_resyncs == 0, "futures: the small gap was repaired");
+        check(stats.last_gap_size == 5, "futures: gap size " + std::to_string(stats.last_gap_size));
+        check(venue.get_snapshot_requests() == 2, "futures: one snapshot to repair");
+
+        book.stop();
+        sync_thread.join();
+        client.stop();
+        client_thread.join();
+        venue.stop();
+    }
+}
+
+int main()
+{
+    test_spot();
+    test_futures();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All venue adapter checks passed" << std::endl;
+    return 0;
+}